@@ -0,0 +1,126 @@
+/**
+Single-producer single-consumer FIFO of bytes, for passing variable-length records between threads.
+The producer writes a record in as many pieces as it likes and publishes it with commit(), the consumer
+reads it back the same way and hands the space back with release(). Unlike CircularFifo, the producer
+is expected to wait for space with has_space() before writing a record, as the consumer may have to be woken up.
+**/
+#ifndef BYTEFIFO_HPP
+#define BYTEFIFO_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include "errors.hpp"
+
+template<size_t Size>
+class ByteFifo
+{
+    static_assert((Size & (Size - 1)) == 0, "ByteFifo size must be a power of two");
+public:
+    ByteFifo() : _tail(0), _head(0), write_pos(0), cached_head(0), read_pos(0), cached_tail(0)
+    {
+        buffer = new uint8_t[Size];
+    }
+    ~ByteFifo()
+    {
+        delete[] buffer;
+    }
+
+    //Producer side
+    bool has_space(size_t size);
+    void write(const void* data, size_t size);
+    void commit();
+
+    //Consumer side. Records must be read back whole, as only committed data is visible.
+    bool has_data();
+    void read(void* data, size_t size);
+    void release();
+    void clear();
+
+private:
+    uint8_t* buffer;
+
+    std::atomic<uint64_t> _tail; //published by the producer
+    std::atomic<uint64_t> _head; //published by the consumer
+
+    //Only touched by the producer
+    uint64_t write_pos, cached_head;
+
+    //Only touched by the consumer
+    uint64_t read_pos, cached_tail;
+};
+
+template<size_t Size>
+bool ByteFifo<Size>::has_space(size_t size)
+{
+    if (write_pos + size - cached_head <= Size)
+        return true;
+    cached_head = _head.load(std::memory_order_acquire);
+    return write_pos + size - cached_head <= Size;
+}
+
+template<size_t Size>
+void ByteFifo<Size>::write(const void* data, size_t size)
+{
+    if (!has_space(size))
+        Errors::die("FIFO FULL!");
+
+    size_t offset = write_pos & (Size - 1);
+    size_t first = std::min(size, Size - offset);
+    memcpy(buffer + offset, data, first);
+    memcpy(buffer, (const uint8_t*)data + first, size - first);
+    write_pos += size;
+}
+
+template<size_t Size>
+void ByteFifo<Size>::commit()
+{
+    _tail.store(write_pos, std::memory_order_release);
+}
+
+template<size_t Size>
+bool ByteFifo<Size>::has_data()
+{
+    if (read_pos != cached_tail)
+    {
+        //Hand back space now and then so a producer waiting on a full FIFO doesn't wait for the whole batch
+        if (read_pos - _head.load(std::memory_order_relaxed) >= Size / 4)
+            release();
+        return true;
+    }
+
+    //Everything read so far is handed back before looking for more
+    release();
+    cached_tail = _tail.load(std::memory_order_acquire);
+    return read_pos != cached_tail;
+}
+
+template<size_t Size>
+void ByteFifo<Size>::read(void* data, size_t size)
+{
+    if (read_pos + size > cached_tail)
+        Errors::die("ByteFifo read past the end of committed data");
+
+    size_t offset = read_pos & (Size - 1);
+    size_t first = std::min(size, Size - offset);
+    memcpy(data, buffer + offset, first);
+    memcpy((uint8_t*)data + first, buffer, size - first);
+    read_pos += size;
+}
+
+template<size_t Size>
+void ByteFifo<Size>::release()
+{
+    _head.store(read_pos, std::memory_order_release);
+}
+
+template<size_t Size>
+void ByteFifo<Size>::clear()
+{
+    read_pos = cached_tail = _tail.load(std::memory_order_acquire);
+    release();
+}
+
+#endif // BYTEFIFO_HPP
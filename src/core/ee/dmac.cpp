@@ -114,6 +114,7 @@ void DMAC::store128(uint32_t addr, uint128_t data)
     {
         addr &= 0x01FFFFF0;
         *(uint128_t*)&RDRAM[addr] = data;
+        cpu->check_rdram_write(addr);
     }
 }
 
@@ -398,18 +399,29 @@ void DMAC::process_IPU_TO(int cycles)
 {
     while (cycles)
     {
-        cycles--;
         if (channels[IPU_TO].quadword_count)
         {
-            if (ipu->can_write_FIFO())
-            {
-                ipu->write_FIFO(fetch128(channels[IPU_TO].address));
+            //Fill up the FIFO in one go, at a quadword per cycle. Nothing drains it while we're here.
+            int count = ipu->get_FIFO_space();
+            if (!count)
+                return;
+            if (count > cycles)
+                count = cycles;
+            if ((uint32_t)count > channels[IPU_TO].quadword_count)
+                count = channels[IPU_TO].quadword_count;
 
+            uint128_t quads[IPU_FIFO::SIZE];
+            for (int i = 0; i < count; i++)
+            {
+                quads[i] = fetch128(channels[IPU_TO].address);
                 advance_source_dma(IPU_TO);
             }
+            ipu->write_FIFO(quads, count);
+            cycles -= count;
         }
         else
         {
+            cycles--;
             if (channels[IPU_TO].tag_end)
             {
                 transfer_end(IPU_TO);
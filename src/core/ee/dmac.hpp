@@ -102,6 +102,7 @@ class DMAC
              VectorInterface* vif0, VectorInterface* vif1, VectorUnit* vu0, VectorUnit* vu1);
         void reset(uint8_t* RDRAM, uint8_t* scratchpad);
         void run(int cycles);
+        bool is_active();
         void start_DMA(int index);
 
         uint32_t read_master_disable();
@@ -117,4 +118,17 @@ class DMAC
         void save_state(std::ofstream& state);
 };
 
+//Whether run() has any work to do. Channels are only started by register writes, so this never misses a transfer.
+inline bool DMAC::is_active()
+{
+    if (!control.master_enable || (master_disable & (1 << 16)))
+        return false;
+    for (int i = 0; i < 10; i++)
+    {
+        if (channels[i].started)
+            return true;
+    }
+    return false;
+}
+
 #endif // DMAC_HPP
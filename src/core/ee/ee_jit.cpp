@@ -0,0 +1,35 @@
+#include "ee_jit.hpp"
+#include "ee_jit64.hpp"
+#include "emotion.hpp"
+
+namespace EE_JIT
+{
+
+EE_JIT64 jit64;
+
+void run(EmotionEngine *ee)
+{
+    jit64.run(*ee);
+}
+
+void reset()
+{
+    jit64.reset();
+}
+
+uint8_t* get_code_pages()
+{
+    return jit64.get_code_pages();
+}
+
+void invalidate_page(uint32_t page)
+{
+    jit64.invalidate_page(page);
+}
+
+void invalidate_all()
+{
+    jit64.invalidate_all();
+}
+
+};
@@ -0,0 +1,19 @@
+#ifndef EE_JIT_HPP
+#define EE_JIT_HPP
+#include <cstdint>
+
+class EmotionEngine;
+
+namespace EE_JIT
+{
+
+void run(EmotionEngine* ee);
+void reset();
+
+uint8_t* get_code_pages();
+void invalidate_page(uint32_t page);
+void invalidate_all();
+
+};
+
+#endif // EE_JIT_HPP
@@ -0,0 +1,765 @@
+#include <cstring>
+#include "ee_jit64.hpp"
+#include "emotioninterpreter.hpp"
+
+#include "../errors.hpp"
+
+#ifdef _WIN32
+const static REG_64 abi_regs[] = {RCX, RDX, R8, R9};
+#else
+const static REG_64 abi_regs[] = {RDI, RSI, RDX, RCX, R8, R9};
+#endif
+
+EE_JIT64::EE_JIT64() : emitter(&cache)
+{
+    reset();
+}
+
+void EE_JIT64::reset()
+{
+    cache.flush_all_blocks();
+    memset(code_pages, 0, sizeof(code_pages));
+    for (int i = 0; i < RDRAM_PAGES; i++)
+        page_blocks[i].clear();
+    dirty_pages.clear();
+    flush_requested = false;
+    block_dirty = false;
+    abi_int_count = 0;
+    pending_cycles = 0;
+}
+
+uint8_t* EE_JIT64::get_code_pages()
+{
+    return code_pages;
+}
+
+void EE_JIT64::invalidate_page(uint32_t page)
+{
+    if (!code_pages[page])
+        return;
+
+    code_pages[page] = 0;
+    dirty_pages.push_back(page);
+    block_dirty = true;
+}
+
+void EE_JIT64::invalidate_all()
+{
+    flush_requested = true;
+    block_dirty = true;
+}
+
+void EE_JIT64::free_dirty_blocks()
+{
+    for (unsigned int i = 0; i < dirty_pages.size(); i++)
+    {
+        std::vector<uint32_t>& blocks = page_blocks[dirty_pages[i]];
+        for (unsigned int j = 0; j < blocks.size(); j++)
+            cache.free_block(BlockState(blocks[j], 0, 0, 0, 0));
+        blocks.clear();
+    }
+    dirty_pages.clear();
+}
+
+void EE_JIT64::run(EmotionEngine& ee)
+{
+    if (flush_requested)
+        reset();
+    else if (dirty_pages.size())
+        free_dirty_blocks();
+
+    uint32_t pc = ee.PC;
+    if (!cache.find_block(BlockState(pc, 0, 0, 0, 0)))
+    {
+        //Writes are only tracked for RDRAM, so code anywhere else other than the BIOS is interpreted
+        uint8_t* mem = ee.tlb_map[pc / 4096];
+        bool in_rdram = mem >= ee.RDRAM && mem < ee.RDRAM + 1024 * 1024 * 32;
+        if (!in_rdram && (mem <= (uint8_t*)1 || (pc & 0x1FFFFFFF) < 0x1FC00000))
+        {
+            ee.interpret_instr();
+            return;
+        }
+        recompile_block(ee, pc);
+    }
+
+    block_dirty = false;
+    ((void(*)())cache.get_current_block_start())();
+}
+
+void EE_JIT64::recompile_block(EmotionEngine& ee, uint32_t start)
+{
+    uint32_t pcs[MAX_BLOCK_INSTRS + 1];
+    uint32_t instrs[MAX_BLOCK_INSTRS + 1];
+    int count = 0;
+    bool has_branch = false;
+
+    //Blocks end after a branch's delay slot, after a COP0 operation, or at the end of a page
+    uint32_t pc = start;
+    while (true)
+    {
+        uint32_t instr = ee.read32(pc);
+        pcs[count] = pc;
+        instrs[count] = instr;
+        count++;
+
+        pc += 4;
+
+        //Simulate dual-issue if both instructions are NOPs
+        if (!instr && !ee.read32(pc))
+            pc += 4;
+
+        if (has_branch)
+            break;
+
+        if (is_branch(instr))
+        {
+            has_branch = true;
+            continue;
+        }
+
+        if (ends_block(instr) || count >= MAX_BLOCK_INSTRS || (pc & ~0xFFF) != (start & ~0xFFF))
+            break;
+    }
+
+    uint32_t end = pc;
+    bool cached = ee.cp0->is_cached(start);
+
+    cache.alloc_block(BlockState(start, 0, 0, 0, 0));
+    register_block(ee, start, pcs[count - 1]);
+
+    exits.clear();
+    abi_int_count = 0;
+    pending_cycles = 0;
+
+    emit_prologue();
+
+    //Instruction cache misses are all taken upon entering the block
+    if (cached)
+    {
+        prepare_abi((uint64_t)&ee);
+        prepare_abi(start);
+        prepare_abi(pcs[count - 1] + 4);
+        call_abi_func((uint64_t)&fetch_block);
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        pending_cycles++;
+        if (!cached)
+            pending_cycles += 16;
+
+        emit_instruction(ee, instrs[i], pcs[i]);
+
+        //The branch has been handled, so the next instruction is its delay slot
+        if (has_branch && i == count - 2)
+        {
+            emitter.load_addr((uint64_t)&ee.delay_slot, REG_64::RAX);
+            emitter.MOV32_IMM_MEM(0, REG_64::RAX);
+        }
+    }
+
+    flush_cycles(ee);
+
+    if (has_branch)
+    {
+        prepare_abi((uint64_t)&ee);
+        prepare_abi(pcs[count - 1]);
+        prepare_abi(end);
+        call_abi_func((uint64_t)&end_branch);
+    }
+    else
+        store_pc(ee, end);
+
+    //The PC can only end up at the end of the block or, for most branches, at the branch target
+    std::vector<uint32_t> successors;
+    successors.push_back(end);
+    uint32_t target;
+    if (has_branch && get_branch_target(instrs[count - 2], pcs[count - 2], target) && target != end)
+        successors.push_back(target);
+    emit_links(ee, successors);
+
+    emit_exit_stubs(ee);
+
+    cache.set_current_block_rx();
+}
+
+void EE_JIT64::register_block(EmotionEngine& ee, uint32_t start, uint32_t end)
+{
+    uint32_t pages[] = {start / 4096, end / 4096};
+    for (int i = 0; i < 2; i++)
+    {
+        if (i && pages[1] == pages[0])
+            break;
+
+        uint8_t* mem = ee.tlb_map[pages[i]];
+        if (mem >= ee.RDRAM && mem < ee.RDRAM + 1024 * 1024 * 32)
+        {
+            uint32_t page = (mem - ee.RDRAM) / 4096;
+            code_pages[page] = 1;
+            page_blocks[page].push_back(start);
+        }
+    }
+}
+
+void EE_JIT64::emit_prologue()
+{
+    //Keeps the stack aligned on a 16-byte boundary for calls
+    emitter.PUSH(REG_64::RBP);
+    emitter.MOV64_MR(REG_64::RSP, REG_64::RBP);
+#ifdef _WIN32
+    //x64 Windows requires a 32-byte "shadow region" for the callee
+    emitter.SUB64_REG_IMM(32, REG_64::RSP);
+#endif
+}
+
+void EE_JIT64::emit_epilogue()
+{
+    emitter.MOV64_MR(REG_64::RBP, REG_64::RSP);
+    emitter.POP(REG_64::RBP);
+    emitter.RET();
+}
+
+//Jumps straight into the block at the new PC instead of returning to the dispatcher, when the dispatcher
+//would have run that block anyway. The jumps are patched by the cache as blocks come and go.
+void EE_JIT64::emit_links(EmotionEngine& ee, const std::vector<uint32_t>& successors)
+{
+    std::vector<ExitStub> links;
+
+    prepare_abi((uint64_t)this);
+    prepare_abi((uint64_t)&ee);
+    call_abi_func((uint64_t)&can_link);
+    emitter.TEST32_EAX(1);
+    uint8_t* no_link = emitter.JE_NEAR_DEFERRED();
+
+    emitter.load_addr((uint64_t)&ee.PC, REG_64::RAX);
+    emitter.MOV32_FROM_MEM(REG_64::RAX, REG_64::RCX);
+    for (unsigned int i = 0; i < successors.size(); i++)
+    {
+        emitter.CMP32_IMM(successors[i], REG_64::RCX);
+        uint8_t* next = emitter.JNE_NEAR_DEFERRED();
+        emitter.MOV64_MR(REG_64::RBP, REG_64::RSP);
+        emitter.POP(REG_64::RBP);
+        links.push_back({emitter.JMP_NEAR_DEFERRED(), successors[i]});
+        emitter.set_jump_dest(next);
+    }
+
+    emitter.set_jump_dest(no_link);
+    emit_epilogue();
+
+    //Until their blocks exist, the links go to the RET that ends the epilogue
+    uint8_t* ret = cache.get_current_block_pos() - 1;
+    for (unsigned int i = 0; i < links.size(); i++)
+        cache.add_link(BlockState(links[i].pc, 0, 0, 0, 0), links[i].jump, ret);
+}
+
+void EE_JIT64::emit_exit_stubs(EmotionEngine& ee)
+{
+    for (unsigned int i = 0; i < exits.size(); i++)
+    {
+        emitter.set_jump_dest(exits[i].jump);
+        prepare_abi((uint64_t)&ee);
+        prepare_abi(exits[i].pc);
+        call_abi_func((uint64_t)&exit_block);
+        emit_epilogue();
+    }
+}
+
+void EE_JIT64::prepare_abi(uint64_t value)
+{
+    if (abi_int_count >= sizeof(abi_regs) / sizeof(REG_64))
+        Errors::die("[EE_JIT64] ABI integer arguments exceeded %d!", sizeof(abi_regs) / sizeof(REG_64));
+
+    emitter.MOV64_OI(value, abi_regs[abi_int_count]);
+    abi_int_count++;
+}
+
+//Returns the next argument register so that it can be filled in by the caller
+REG_64 EE_JIT64::prepare_abi_reg()
+{
+    if (abi_int_count >= sizeof(abi_regs) / sizeof(REG_64))
+        Errors::die("[EE_JIT64] ABI integer arguments exceeded %d!", sizeof(abi_regs) / sizeof(REG_64));
+
+    REG_64 arg = abi_regs[abi_int_count];
+    abi_int_count++;
+    return arg;
+}
+
+void EE_JIT64::call_abi_func(uint64_t addr)
+{
+    emitter.MOV64_OI(addr, REG_64::RAX);
+    emitter.CALL_INDIR(REG_64::RAX);
+    abi_int_count = 0;
+}
+
+void EE_JIT64::flush_cycles(EmotionEngine& ee)
+{
+    if (!pending_cycles)
+        return;
+
+    emitter.load_addr((uint64_t)&ee.cycles_to_run, REG_64::RAX);
+    emitter.MOV32_FROM_MEM(REG_64::RAX, REG_64::RCX);
+    emitter.ADD32_REG_IMM(-pending_cycles, REG_64::RCX);
+    emitter.MOV32_TO_MEM(REG_64::RCX, REG_64::RAX);
+    pending_cycles = 0;
+}
+
+void EE_JIT64::store_pc(EmotionEngine& ee, uint32_t pc)
+{
+    emitter.load_addr((uint64_t)&ee.PC, REG_64::RAX);
+    emitter.MOV32_IMM_MEM(pc, REG_64::RAX);
+}
+
+//Leave the block if the last call changed the PC or invalidated code
+void EE_JIT64::check_exit(uint32_t pc)
+{
+    emitter.TEST32_EAX(1);
+    exits.push_back({emitter.JNE_NEAR_DEFERRED(), pc});
+}
+
+void EE_JIT64::load_gpr(EmotionEngine& ee, int reg, REG_64 dest)
+{
+    if (!reg)
+    {
+        emitter.XOR32_REG(dest, dest);
+        return;
+    }
+    emitter.load_addr((uint64_t)&ee.gpr[reg * sizeof(uint64_t) * 2], REG_64::RAX);
+    emitter.MOV64_FROM_MEM(REG_64::RAX, dest);
+}
+
+void EE_JIT64::store_gpr(EmotionEngine& ee, REG_64 source, int reg)
+{
+    emitter.load_addr((uint64_t)&ee.gpr[reg * sizeof(uint64_t) * 2], REG_64::RAX);
+    emitter.MOV64_TO_MEM(source, REG_64::RAX);
+}
+
+//Calculates base + offset for loads and stores
+void EE_JIT64::load_address(EmotionEngine& ee, uint32_t instr, REG_64 dest)
+{
+    int base = (instr >> 21) & 0x1F;
+    int16_t offset = (int16_t)(instr & 0xFFFF);
+    if (!base)
+    {
+        emitter.MOV32_REG_IMM((int32_t)offset, dest);
+        return;
+    }
+    emitter.load_addr((uint64_t)&ee.gpr[base * sizeof(uint64_t) * 2], REG_64::RAX);
+    emitter.MOV32_FROM_MEM(REG_64::RAX, dest);
+    if (offset)
+        emitter.ADD32_REG_IMM((int32_t)offset, dest);
+}
+
+void EE_JIT64::emit_instruction(EmotionEngine& ee, uint32_t instr, uint32_t pc)
+{
+    int op = instr >> 26;
+    int rs = (instr >> 21) & 0x1F;
+    int rt = (instr >> 16) & 0x1F;
+    uint16_t imm = instr & 0xFFFF;
+
+    switch (op)
+    {
+        case 0x00:
+            if (emit_special(ee, instr))
+                return;
+            break;
+        case 0x08:
+        case 0x09:
+            //ADDI/ADDIU
+            if (rt)
+            {
+                load_gpr(ee, rs, REG_64::RCX);
+                if (imm)
+                    emitter.ADD32_REG_IMM((int32_t)(int16_t)imm, REG_64::RCX);
+                emitter.MOVSXD64_REG(REG_64::RCX, REG_64::RCX);
+                store_gpr(ee, REG_64::RCX, rt);
+            }
+            return;
+        case 0x0C:
+            //ANDI
+            if (rt)
+            {
+                load_gpr(ee, rs, REG_64::RCX);
+                emitter.AND32_REG_IMM(imm, REG_64::RCX);
+                store_gpr(ee, REG_64::RCX, rt);
+            }
+            return;
+        case 0x0D:
+            //ORI
+            if (rt)
+            {
+                load_gpr(ee, rs, REG_64::RCX);
+                if (imm)
+                    emitter.OR64_REG_IMM(imm, REG_64::RCX);
+                store_gpr(ee, REG_64::RCX, rt);
+            }
+            return;
+        case 0x0E:
+            //XORI
+            if (rt)
+            {
+                load_gpr(ee, rs, REG_64::RCX);
+                if (imm)
+                    emitter.XOR64_REG_IMM(imm, REG_64::RCX);
+                store_gpr(ee, REG_64::RCX, rt);
+            }
+            return;
+        case 0x0F:
+            //LUI
+            if (rt)
+            {
+                emitter.MOV64_OI((int64_t)(int32_t)(imm << 16), REG_64::RCX);
+                store_gpr(ee, REG_64::RCX, rt);
+            }
+            return;
+        case 0x18:
+        case 0x19:
+            //DADDI/DADDIU
+            if (rt)
+            {
+                load_gpr(ee, rs, REG_64::RCX);
+                if (imm)
+                    emitter.ADD64_REG_IMM((int32_t)(int16_t)imm, REG_64::RCX);
+                store_gpr(ee, REG_64::RCX, rt);
+            }
+            return;
+        case 0x20:
+            emit_load(ee, instr, pc, (uint64_t)&load8);
+            return;
+        case 0x21:
+            emit_load(ee, instr, pc, (uint64_t)&load16);
+            return;
+        case 0x23:
+            emit_load(ee, instr, pc, (uint64_t)&load32);
+            return;
+        case 0x24:
+            emit_load(ee, instr, pc, (uint64_t)&load8u);
+            return;
+        case 0x25:
+            emit_load(ee, instr, pc, (uint64_t)&load16u);
+            return;
+        case 0x27:
+            emit_load(ee, instr, pc, (uint64_t)&load32u);
+            return;
+        case 0x28:
+            emit_store(ee, instr, pc, (uint64_t)&store8);
+            return;
+        case 0x29:
+            emit_store(ee, instr, pc, (uint64_t)&store16);
+            return;
+        case 0x2B:
+            emit_store(ee, instr, pc, (uint64_t)&store32);
+            return;
+        case 0x37:
+            emit_load(ee, instr, pc, (uint64_t)&load64);
+            return;
+        case 0x3F:
+            emit_store(ee, instr, pc, (uint64_t)&store64);
+            return;
+        default:
+            break;
+    }
+    fallback_interpreter(ee, instr, pc);
+}
+
+bool EE_JIT64::emit_special(EmotionEngine& ee, uint32_t instr)
+{
+    int rs = (instr >> 21) & 0x1F;
+    int rt = (instr >> 16) & 0x1F;
+    int rd = (instr >> 11) & 0x1F;
+    int sa = (instr >> 6) & 0x1F;
+
+    switch (instr & 0x3F)
+    {
+        case 0x00:
+        case 0x02:
+        case 0x03:
+            //SLL/SRL/SRA. This also covers NOP.
+            if (rd)
+            {
+                load_gpr(ee, rt, REG_64::RCX);
+                if (sa)
+                {
+                    if ((instr & 0x3F) == 0x00)
+                        emitter.SHL32_REG_IMM(sa, REG_64::RCX);
+                    else if ((instr & 0x3F) == 0x02)
+                        emitter.SHR32_REG_IMM(sa, REG_64::RCX);
+                    else
+                        emitter.SAR32_REG_IMM(sa, REG_64::RCX);
+                }
+                emitter.MOVSXD64_REG(REG_64::RCX, REG_64::RCX);
+                store_gpr(ee, REG_64::RCX, rd);
+            }
+            return true;
+        case 0x20:
+        case 0x21:
+        case 0x22:
+        case 0x23:
+            //ADD/ADDU/SUB/SUBU
+            if (rd)
+            {
+                load_gpr(ee, rs, REG_64::RCX);
+                load_gpr(ee, rt, REG_64::RDX);
+                if (instr & 0x2)
+                    emitter.SUB32_REG(REG_64::RDX, REG_64::RCX);
+                else
+                    emitter.ADD32_REG(REG_64::RDX, REG_64::RCX);
+                emitter.MOVSXD64_REG(REG_64::RCX, REG_64::RCX);
+                store_gpr(ee, REG_64::RCX, rd);
+            }
+            return true;
+        case 0x24:
+        case 0x25:
+        case 0x26:
+        case 0x27:
+        case 0x2C:
+        case 0x2D:
+        case 0x2E:
+        case 0x2F:
+            //AND/OR/XOR/NOR/DADD/DADDU/DSUB/DSUBU
+            if (rd)
+            {
+                load_gpr(ee, rs, REG_64::RCX);
+                load_gpr(ee, rt, REG_64::RDX);
+                switch (instr & 0x3F)
+                {
+                    case 0x24:
+                        emitter.AND64_REG(REG_64::RDX, REG_64::RCX);
+                        break;
+                    case 0x25:
+                        emitter.OR64_REG(REG_64::RDX, REG_64::RCX);
+                        break;
+                    case 0x26:
+                        emitter.XOR64_REG(REG_64::RDX, REG_64::RCX);
+                        break;
+                    case 0x27:
+                        emitter.OR64_REG(REG_64::RDX, REG_64::RCX);
+                        emitter.NOT64(REG_64::RCX);
+                        break;
+                    case 0x2C:
+                    case 0x2D:
+                        emitter.ADD64_REG(REG_64::RDX, REG_64::RCX);
+                        break;
+                    default:
+                        emitter.SUB64_REG(REG_64::RDX, REG_64::RCX);
+                        break;
+                }
+                store_gpr(ee, REG_64::RCX, rd);
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+void EE_JIT64::emit_load(EmotionEngine& ee, uint32_t instr, uint32_t pc, uint64_t func)
+{
+    int rt = (instr >> 16) & 0x1F;
+
+    //Loads from MMIO may have side effects, such as the INTC_STAT speedhack halting the EE
+    flush_cycles(ee);
+    store_pc(ee, pc);
+
+    prepare_abi((uint64_t)this);
+    prepare_abi((uint64_t)&ee);
+    load_address(ee, instr, prepare_abi_reg());
+    prepare_abi(rt);
+    call_abi_func(func);
+    check_exit(pc);
+}
+
+void EE_JIT64::emit_store(EmotionEngine& ee, uint32_t instr, uint32_t pc, uint64_t func)
+{
+    int rt = (instr >> 16) & 0x1F;
+
+    //Stores may raise an interrupt or overwrite code, so the EE state needs to be up to date
+    flush_cycles(ee);
+    store_pc(ee, pc);
+
+    prepare_abi((uint64_t)this);
+    prepare_abi((uint64_t)&ee);
+    load_address(ee, instr, prepare_abi_reg());
+    load_gpr(ee, rt, prepare_abi_reg());
+    call_abi_func(func);
+    check_exit(pc);
+}
+
+void EE_JIT64::fallback_interpreter(EmotionEngine& ee, uint32_t instr, uint32_t pc)
+{
+    flush_cycles(ee);
+    store_pc(ee, pc);
+
+    prepare_abi((uint64_t)this);
+    prepare_abi((uint64_t)&ee);
+    prepare_abi(instr);
+    call_abi_func((uint64_t)&interpret);
+    check_exit(pc);
+}
+
+bool EE_JIT64::is_branch(uint32_t instr)
+{
+    switch (instr >> 26)
+    {
+        case 0x00:
+            //JR/JALR
+            return (instr & 0x3E) == 0x08;
+        case 0x01:
+            //BLTZ/BGEZ/BLTZL/BGEZL and their -AL variants
+            return (((instr >> 16) & 0x1F) & ~0x13) == 0;
+        case 0x02:
+        case 0x03:
+        case 0x04:
+        case 0x05:
+        case 0x06:
+        case 0x07:
+        case 0x14:
+        case 0x15:
+        case 0x16:
+        case 0x17:
+            return true;
+        case 0x10:
+        case 0x11:
+        case 0x12:
+            //BC0/BC1/BC2
+            return ((instr >> 21) & 0x1F) == 0x08;
+        default:
+            return false;
+    }
+}
+
+//Branches with a target encoded in the instruction, i.e. everything but JR/JALR
+bool EE_JIT64::get_branch_target(uint32_t instr, uint32_t pc, uint32_t& target)
+{
+    switch (instr >> 26)
+    {
+        case 0x00:
+            return false;
+        case 0x02:
+        case 0x03:
+            target = ((pc + 4) & 0xF0000000) | ((instr & 0x3FFFFFF) << 2);
+            return true;
+        default:
+            target = pc + 4 + (int16_t)(instr & 0xFFFF) * 4;
+            return true;
+    }
+}
+
+bool EE_JIT64::ends_block(uint32_t instr)
+{
+    //COP0 operations can change the memory map, the TLB, or the processor mode
+    return (instr >> 26) == 0x10;
+}
+
+void EE_JIT64::fetch_block(EmotionEngine& ee, uint32_t start, uint32_t end)
+{
+    for (uint32_t addr = start & ~0x3F; addr < end; addr += 64)
+        ee.read_instr(addr);
+}
+
+int EE_JIT64::interpret(EE_JIT64& jit, EmotionEngine& ee, uint32_t instr)
+{
+    uint32_t pc = ee.PC;
+    EmotionInterpreter::interpret(ee, instr);
+    return jit.must_exit(ee, pc);
+}
+
+//True if the interpreter would not simply continue with the next instruction
+bool EE_JIT64::must_exit(EmotionEngine& ee, uint32_t pc)
+{
+    return ee.PC != pc || ee.wait_for_IRQ || block_dirty;
+}
+
+//Mirrors the checks made by the dispatcher between blocks
+int EE_JIT64::can_link(EE_JIT64& jit, EmotionEngine& ee)
+{
+    return ee.cycles_to_run > 0 && !ee.branch_on && !ee.can_disassemble && !jit.block_dirty;
+}
+
+//Finishes the instruction that caused an early exit the same way the interpreter would
+void EE_JIT64::exit_block(EmotionEngine& ee, uint32_t last_pc)
+{
+    ee.PC += 4;
+    ee.update_delay_slot(last_pc);
+}
+
+void EE_JIT64::end_branch(EmotionEngine& ee, uint32_t last_pc, uint32_t next_pc)
+{
+    ee.PC = next_pc;
+    ee.update_delay_slot(last_pc);
+}
+
+int EE_JIT64::load8(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t reg)
+{
+    uint32_t pc = ee.PC;
+    ee.set_gpr<int64_t>(reg, (int8_t)ee.read8(addr));
+    return jit.must_exit(ee, pc);
+}
+
+int EE_JIT64::load8u(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t reg)
+{
+    uint32_t pc = ee.PC;
+    ee.set_gpr<uint64_t>(reg, ee.read8(addr));
+    return jit.must_exit(ee, pc);
+}
+
+int EE_JIT64::load16(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t reg)
+{
+    uint32_t pc = ee.PC;
+    ee.set_gpr<int64_t>(reg, (int16_t)ee.read16(addr));
+    return jit.must_exit(ee, pc);
+}
+
+int EE_JIT64::load16u(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t reg)
+{
+    uint32_t pc = ee.PC;
+    ee.set_gpr<uint64_t>(reg, ee.read16(addr));
+    return jit.must_exit(ee, pc);
+}
+
+int EE_JIT64::load32(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t reg)
+{
+    uint32_t pc = ee.PC;
+    ee.set_gpr<int64_t>(reg, (int32_t)ee.read32(addr));
+    return jit.must_exit(ee, pc);
+}
+
+int EE_JIT64::load32u(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t reg)
+{
+    uint32_t pc = ee.PC;
+    ee.set_gpr<uint64_t>(reg, ee.read32(addr));
+    return jit.must_exit(ee, pc);
+}
+
+int EE_JIT64::load64(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t reg)
+{
+    uint32_t pc = ee.PC;
+    ee.set_gpr<uint64_t>(reg, ee.read64(addr));
+    return jit.must_exit(ee, pc);
+}
+
+int EE_JIT64::store8(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t value)
+{
+    uint32_t pc = ee.PC;
+    ee.write8(addr, value);
+    return jit.must_exit(ee, pc);
+}
+
+int EE_JIT64::store16(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t value)
+{
+    uint32_t pc = ee.PC;
+    ee.write16(addr, value);
+    return jit.must_exit(ee, pc);
+}
+
+int EE_JIT64::store32(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t value)
+{
+    uint32_t pc = ee.PC;
+    ee.write32(addr, value);
+    return jit.must_exit(ee, pc);
+}
+
+int EE_JIT64::store64(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t value)
+{
+    uint32_t pc = ee.PC;
+    ee.write64(addr, value);
+    return jit.must_exit(ee, pc);
+}
@@ -0,0 +1,103 @@
+#ifndef EE_JIT64_HPP
+#define EE_JIT64_HPP
+#include <vector>
+#include "../jitcommon/emitter64.hpp"
+#include "emotion.hpp"
+
+class EE_JIT64
+{
+    private:
+        constexpr static int RDRAM_PAGES = (1024 * 1024 * 32) / 4096;
+        constexpr static int MAX_BLOCK_INSTRS = 128;
+
+        JitCache cache;
+        Emitter64 emitter;
+
+        //Nonzero for every 4 KB page of RDRAM that has recompiled code in it.
+        //The EE checks this on writes to RDRAM and invalidates the page if necessary.
+        uint8_t code_pages[RDRAM_PAGES];
+
+        //Start PCs of the blocks recompiled from each page
+        std::vector<uint32_t> page_blocks[RDRAM_PAGES];
+
+        //Invalidation happens while a block may be running, so blocks are only freed before the next lookup.
+        std::vector<uint32_t> dirty_pages;
+        bool flush_requested;
+
+        //Set when a page is invalidated during a block, telling the block to exit after the current instruction
+        bool block_dirty;
+
+        unsigned int abi_int_count;
+
+        //Cycles of the block that haven't yet been subtracted from cycles_to_run
+        int pending_cycles;
+
+        struct ExitStub
+        {
+            uint8_t* jump;
+            uint32_t pc;
+        };
+        std::vector<ExitStub> exits;
+
+        void recompile_block(EmotionEngine& ee, uint32_t start);
+        void register_block(EmotionEngine& ee, uint32_t start, uint32_t end);
+        void free_dirty_blocks();
+
+        void emit_prologue();
+        void emit_epilogue();
+        void emit_links(EmotionEngine& ee, const std::vector<uint32_t>& successors);
+        void emit_exit_stubs(EmotionEngine& ee);
+
+        void prepare_abi(uint64_t value);
+        REG_64 prepare_abi_reg();
+        void call_abi_func(uint64_t addr);
+
+        void flush_cycles(EmotionEngine& ee);
+        void store_pc(EmotionEngine& ee, uint32_t pc);
+        void check_exit(uint32_t pc);
+
+        void load_gpr(EmotionEngine& ee, int reg, REG_64 dest);
+        void store_gpr(EmotionEngine& ee, REG_64 source, int reg);
+        void load_address(EmotionEngine& ee, uint32_t instr, REG_64 dest);
+
+        void emit_instruction(EmotionEngine& ee, uint32_t instr, uint32_t pc);
+        bool emit_special(EmotionEngine& ee, uint32_t instr);
+        void emit_load(EmotionEngine& ee, uint32_t instr, uint32_t pc, uint64_t func);
+        void emit_store(EmotionEngine& ee, uint32_t instr, uint32_t pc, uint64_t func);
+        void fallback_interpreter(EmotionEngine& ee, uint32_t instr, uint32_t pc);
+
+        static bool is_branch(uint32_t instr);
+        static bool get_branch_target(uint32_t instr, uint32_t pc, uint32_t& target);
+        static bool ends_block(uint32_t instr);
+
+        static void fetch_block(EmotionEngine& ee, uint32_t start, uint32_t end);
+        bool must_exit(EmotionEngine& ee, uint32_t pc);
+
+        static int interpret(EE_JIT64& jit, EmotionEngine& ee, uint32_t instr);
+        static int can_link(EE_JIT64& jit, EmotionEngine& ee);
+        static void exit_block(EmotionEngine& ee, uint32_t last_pc);
+        static void end_branch(EmotionEngine& ee, uint32_t last_pc, uint32_t next_pc);
+
+        static int load8(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t reg);
+        static int load8u(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t reg);
+        static int load16(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t reg);
+        static int load16u(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t reg);
+        static int load32(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t reg);
+        static int load32u(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t reg);
+        static int load64(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t reg);
+        static int store8(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t value);
+        static int store16(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t value);
+        static int store32(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t value);
+        static int store64(EE_JIT64& jit, EmotionEngine& ee, uint32_t addr, uint64_t value);
+    public:
+        EE_JIT64();
+
+        void reset();
+        void run(EmotionEngine& ee);
+
+        uint8_t* get_code_pages();
+        void invalidate_page(uint32_t page);
+        void invalidate_all();
+};
+
+#endif // EE_JIT64_HPP
@@ -4,6 +4,7 @@
 #include "emotion.hpp"
 #include "emotiondisasm.hpp"
 #include "emotioninterpreter.hpp"
+#include "ee_jit.hpp"
 #include "vu.hpp"
 #include "../errors.hpp"
 
@@ -17,6 +18,8 @@ EmotionEngine::EmotionEngine(Cop0* cp0, Cop1* fpu, Emulator* e, VectorUnit* vu0,
     cp0(cp0), fpu(fpu), e(e), vu0(vu0), vu1(vu1)
 {
     tlb_map = nullptr;
+    RDRAM = nullptr;
+    jit_pages = nullptr;
 }
 
 const char* EmotionEngine::REG(int id)
@@ -128,6 +131,57 @@ void EmotionEngine::init_tlb()
     tlb_map = cp0->get_vtlb_map();
 }
 
+void EmotionEngine::init_mem_pointers(uint8_t *RDRAM)
+{
+    this->RDRAM = RDRAM;
+}
+
+void EmotionEngine::interpret_instr()
+{
+    cycles_to_run--;
+
+    uint32_t instruction = read_instr(PC);
+    uint32_t lastPC = PC;
+
+    if (can_disassemble)
+    {
+        std::string disasm = EmotionDisasm::disasm_instr(instruction, PC);
+        printf("[$%08X] $%08X - %s\n", PC, instruction, disasm.c_str());
+        //print_state();
+    }
+
+    EmotionInterpreter::interpret(*this, instruction);
+    PC += 4;
+
+    //Simulate dual-issue if both instructions are NOPs
+    if (!instruction && !read32(PC))
+        PC += 4;
+
+    update_delay_slot(lastPC);
+}
+
+void EmotionEngine::update_delay_slot(uint32_t last_PC)
+{
+    if (branch_on)
+    {
+        if (!delay_slot)
+        {
+            //If the PC == LastPC it means we've reversed it to handle COP2 sync, so don't branch yet
+            if (PC != last_PC)
+            {
+                branch_on = false;
+                if (!new_PC || (new_PC & 0x3))
+                {
+                    Errors::die("[EE] Jump to invalid address $%08X from $%08X\n", new_PC, PC - 8);
+                }
+                PC = new_PC;
+            }
+        }
+        else
+            delay_slot--;
+    }
+}
+
 int EmotionEngine::run(int cycles)
 {
     cycle_count += cycles;
@@ -135,47 +189,42 @@ int EmotionEngine::run(int cycles)
     {
         cycles_to_run += cycles;
         while (cycles_to_run > 0)
-        {
-            cycles_to_run--;
-
-            uint32_t instruction = read_instr(PC);
-            uint32_t lastPC = PC;
+            interpret_instr();
+    }
 
-            if (can_disassemble)
-            {
-                std::string disasm = EmotionDisasm::disasm_instr(instruction, PC);
-                printf("[$%08X] $%08X - %s\n", PC, instruction, disasm.c_str());
-                //print_state();
-            }
+    check_interrupts(cycles);
 
-            EmotionInterpreter::interpret(*this, instruction);
-            PC += 4;
+    return cycles;
+}
 
-            //Simulate dual-issue if both instructions are NOPs
-            if (!instruction && !read32(PC))
-                PC += 4;
+int EmotionEngine::run_jit(int cycles)
+{
+    //Enable code invalidation on writes now that there may be recompiled code in RDRAM
+    if (!jit_pages)
+        jit_pages = EE_JIT::get_code_pages();
 
-            if (branch_on)
-            {
-                if (!delay_slot)
-                {
-                    //If the PC == LastPC it means we've reversed it to handle COP2 sync, so don't branch yet
-                    if (PC != lastPC)
-                    {
-                        branch_on = false;
-                        if (!new_PC || (new_PC & 0x3))
-                        {
-                            Errors::die("[EE] Jump to invalid address $%08X from $%08X\n", new_PC, PC - 8);
-                        }
-                        PC = new_PC;
-                    }
-                }
-                else
-                    delay_slot--;
-            }
+    cycle_count += cycles;
+    if (!wait_for_IRQ)
+    {
+        cycles_to_run += cycles;
+        while (cycles_to_run > 0)
+        {
+            //Blocks always start outside of a delay slot.
+            //If a block exited while a branch was pending (e.g. a COP2 stall in the delay slot), step through it.
+            if (branch_on || can_disassemble)
+                interpret_instr();
+            else
+                EE_JIT::run(this);
         }
     }
 
+    check_interrupts(cycles);
+
+    return cycles;
+}
+
+void EmotionEngine::check_interrupts(int cycles)
+{
     if (cp0->int_enabled())
     {
         if (cp0->cause.int0_pending)
@@ -185,8 +234,11 @@ int EmotionEngine::run(int cycles)
     }
 
     cp0->count_up(cycles);
+}
 
-    return cycles;
+void EmotionEngine::invalidate_code_page(uint32_t page)
+{
+    EE_JIT::invalidate_page(page);
 }
 
 void EmotionEngine::print_state()
@@ -407,7 +459,11 @@ void EmotionEngine::write8(uint32_t address, uint8_t value)
 {
     uint8_t* mem = tlb_map[address / 4096];
     if (mem > (uint8_t*)1)
+    {
         mem[address & 4095] = value;
+        if (jit_pages)
+            check_code_write(mem);
+    }
     else if (mem == (uint8_t*)1)
         e->write8(address & 0x1FFFFFFF, value);
     else
@@ -420,7 +476,11 @@ void EmotionEngine::write16(uint32_t address, uint16_t value)
         Errors::die("[EE] Write16 to invalid address $%08X: $%04X", address, value);
     uint8_t* mem = tlb_map[address / 4096];
     if (mem > (uint8_t*)1)
+    {
         *(uint16_t*)&mem[address & 4095] = value;
+        if (jit_pages)
+            check_code_write(mem);
+    }
     else if (mem == (uint8_t*)1)
         e->write16(address & 0x1FFFFFFF, value);
     else
@@ -433,7 +493,11 @@ void EmotionEngine::write32(uint32_t address, uint32_t value)
         Errors::die("[EE] Write32 to invalid address $%08X: $%08X", address, value);
     uint8_t* mem = tlb_map[address / 4096];
     if (mem > (uint8_t*)1)
+    {
         *(uint32_t*)&mem[address & 4095] = value;
+        if (jit_pages)
+            check_code_write(mem);
+    }
     else if (mem == (uint8_t*)1)
         e->write32(address & 0x1FFFFFFF, value);
     else
@@ -446,7 +510,11 @@ void EmotionEngine::write64(uint32_t address, uint64_t value)
         Errors::die("[EE] Write64 to invalid address $%08X: $%08X_%08X", address, value >> 32, value);
     uint8_t* mem = tlb_map[address / 4096];
     if (mem > (uint8_t*)1)
+    {
         *(uint64_t*)&mem[address & 4095] = value;
+        if (jit_pages)
+            check_code_write(mem);
+    }
     else if (mem == (uint8_t*)1)
         e->write64(address & 0x1FFFFFFF, value);
     else
@@ -457,7 +525,11 @@ void EmotionEngine::write128(uint32_t address, uint128_t value)
 {
     uint8_t* mem = tlb_map[address / 4096];
     if (mem > (uint8_t*)1)
+    {
         *(uint128_t*)&mem[address & 4095] = value;
+        if (jit_pages)
+            check_code_write(mem);
+    }
     else if (mem == (uint8_t*)1)
         e->write128(address & 0x1FFFFFFF, value);
     else
@@ -896,6 +968,10 @@ void EmotionEngine::tlbwi()
 {
     int index = cp0->gpr[0];
     cp0->set_tlb(index);
+
+    //Recompiled code may depend on the old mappings
+    if (jit_pages)
+        EE_JIT::invalidate_all();
 }
 
 void EmotionEngine::tlbp()
@@ -1087,7 +1163,7 @@ void EmotionEngine::cop2_updatevu0()
     else if (!vu0->is_interlocked())
     {
         uint64_t current_count = ((cycle_count - cycles_to_run) - cop2_last_cycle) + 1;
-        vu0->run((current_count >> 1));
+        e->run_vu0((current_count >> 1));
         cop2_last_cycle = (cycle_count - cycles_to_run);
     }
 }
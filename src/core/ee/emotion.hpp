@@ -9,6 +9,7 @@
 
 class Emulator;
 class VectorUnit;
+class EE_JIT64;
 
 //Handler used for Deci2Call (syscall 0x7C)
 struct Deci2Handler
@@ -40,6 +41,11 @@ class EmotionEngine
 
         uint8_t** tlb_map;
 
+        //Used to invalidate recompiled code on RDRAM writes.
+        //jit_pages is only set once the JIT has been used, so the interpreter doesn't pay for the check.
+        uint8_t* RDRAM;
+        uint8_t* jit_pages;
+
         //Each register is 128-bit
         uint8_t gpr[32 * sizeof(uint64_t) * 2];
         uint64_t LO, HI, LO1, HI1;
@@ -59,13 +65,21 @@ class EmotionEngine
         uint32_t get_paddr(uint32_t vaddr);
         void handle_exception(uint32_t new_addr, uint8_t code);
         void deci2call(uint32_t func, uint32_t param);
+
+        void interpret_instr();
+        void update_delay_slot(uint32_t last_PC);
+        void check_interrupts(int cycles);
+        void check_code_write(uint8_t* page);
+        void invalidate_code_page(uint32_t page);
     public:
         EmotionEngine(Cop0* cp0, Cop1* fpu, Emulator* e, VectorUnit* vu0, VectorUnit* vu1);
         static const char* REG(int id);
         static const char* SYSCALL(int id);
         void reset();
+        void init_mem_pointers(uint8_t* RDRAM);
         void init_tlb();
         int run(int cycles);
+        int run_jit(int cycles);
         uint64_t get_cycle_count();
         uint64_t get_cop2_last_cycle();
         void set_cop2_last_cycle(uint64_t value);
@@ -102,6 +116,7 @@ class EmotionEngine
         void write32(uint32_t address, uint32_t value);
         void write64(uint32_t address, uint64_t value);
         void write128(uint32_t address, uint128_t value);
+        void check_rdram_write(uint32_t address);
 
         void jp(uint32_t new_addr);
         void branch(bool condition, int offset);
@@ -166,6 +181,8 @@ class EmotionEngine
 
         void load_state(std::ifstream& state);
         void save_state(std::ofstream& state);
+
+        friend class EE_JIT64;
 };
 
 template <typename T>
@@ -181,6 +198,20 @@ inline void EmotionEngine::set_gpr(int id, T value, int offset)
         *(T*)&gpr[(id * sizeof(uint64_t) * 2) + (offset * sizeof(T))] = value;
 }
 
+inline void EmotionEngine::check_code_write(uint8_t* page)
+{
+    uint64_t offset = page - RDRAM;
+    if (offset < 1024 * 1024 * 32 && jit_pages[offset / 4096])
+        invalidate_code_page(offset / 4096);
+}
+
+//Used by DMA and other bus masters that write directly to physical RDRAM
+inline void EmotionEngine::check_rdram_write(uint32_t address)
+{
+    if (jit_pages && jit_pages[(address & 0x1FFFFFF) / 4096])
+        invalidate_code_page((address & 0x1FFFFFF) / 4096);
+}
+
 inline uint64_t EmotionEngine::get_cycle_count()
 {
     return cycle_count - cycles_to_run;
@@ -2,6 +2,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <emmintrin.h>
 #include "ipu.hpp"
 #include "../intc.hpp"
 #include "../../errors.hpp"
@@ -97,7 +98,7 @@ void ImageProcessingUnit::reset()
     dct_coeff = nullptr;
     VDEC_table = nullptr;
     in_FIFO.reset();
-    out_FIFO.reset();
+    out_FIFO = std::queue<uint128_t>();
     prepare_IDCT();
 
     ctrl.error_code = false;
@@ -122,31 +123,31 @@ void ImageProcessingUnit::run()
             switch (command)
             {
                 case 0x01:
-                    if (in_FIFO.f.size())
+                    if (in_FIFO.size())
                     {
                         if (process_IDEC())
                             finish_command();
                     }
                     break;
                 case 0x02:
-                    if (in_FIFO.f.size())
+                    if (in_FIFO.size())
                     {
                         if (process_BDEC())
                             finish_command();
                     }
                     break;
                 case 0x03:
-                    if (in_FIFO.f.size())
+                    if (in_FIFO.size())
                         process_VDEC();
                     break;
                 case 0x04:
-                    if (in_FIFO.f.size())
+                    if (in_FIFO.size())
                         process_FDEC();
                     break;
                 case 0x05:
                     if (!in_FIFO.advance_stream(command_option & 0x3F))
                         return;
-                    while (bytes_left && in_FIFO.f.size())
+                    while (bytes_left && in_FIFO.size())
                     {
                         uint32_t value;
                         if (!in_FIFO.get_bits(value, 8))
@@ -163,10 +164,9 @@ void ImageProcessingUnit::run()
                         ctrl.busy = false;
                     break;
                 case 0x06:
-                    while (bytes_left && in_FIFO.f.size())
+                    while (bytes_left && in_FIFO.size())
                     {
-                        uint128_t quad = in_FIFO.f.front();
-                        in_FIFO.f.pop();
+                        uint128_t quad = in_FIFO.pop();
                         for (int i = 0; i < 8; i++)
                         {
                             int index = (32 - bytes_left) >> 1;
@@ -178,7 +178,7 @@ void ImageProcessingUnit::run()
                         ctrl.busy = false;
                     break;
                 case 0x07:
-                    if (in_FIFO.f.size())
+                    if (in_FIFO.size())
                     {
                         if (process_CSC())
                             finish_command();
@@ -274,8 +274,8 @@ bool ImageProcessingUnit::process_IDEC()
                 printf("[IPU] Init CSC\n");
                 for (int i = 0; i < BLOCK_SIZE / 8; i++)
                 {
-                    uint128_t quad = idec.temp_fifo.f.front();
-                    idec.temp_fifo.f.pop();
+                    uint128_t quad = idec.temp_fifo.front();
+                    idec.temp_fifo.pop();
 
                     int offset = i * 8;
 
@@ -424,9 +424,7 @@ bool ImageProcessingUnit::process_BDEC()
                 dequantize(bdec.cur_block);
                 printf("[IPU] IDCT!\n");
 
-                int16_t temp[0x40];
-                memcpy(temp, bdec.cur_block, 0x40 * sizeof(int16_t));
-                perform_IDCT(temp, bdec.cur_block);
+                perform_IDCT(bdec.cur_block);
                 bdec.state = BDEC_STATE::LOAD_NEXT_BLOCK;
             }
                 break;
@@ -445,29 +443,29 @@ bool ImageProcessingUnit::process_BDEC()
                 for (int i = 0; i < 8; i++)
                 {
                     memcpy(quad._u8, bdec.blocks[0] + (i * 8), sizeof(int16_t) * 8);
-                    bdec.out_fifo->f.push(quad);
+                    bdec.out_fifo->push(quad);
                     memcpy(quad._u8, bdec.blocks[1] + (i * 8), sizeof(int16_t) * 8);
-                    bdec.out_fifo->f.push(quad);
+                    bdec.out_fifo->push(quad);
                 }
 
                 for (int i = 0; i < 8; i++)
                 {
                     memcpy(quad._u8, bdec.blocks[2] + (i * 8), sizeof(int16_t) * 8);
-                    bdec.out_fifo->f.push(quad);
+                    bdec.out_fifo->push(quad);
                     memcpy(quad._u8, bdec.blocks[3] + (i * 8), sizeof(int16_t) * 8);
-                    bdec.out_fifo->f.push(quad);
+                    bdec.out_fifo->push(quad);
                 }
 
                 for (int i = 0; i < 8; i++)
                 {
                     memcpy(quad._u8, bdec.blocks[4] + (i * 8), sizeof(int16_t) * 8);
-                    bdec.out_fifo->f.push(quad);
+                    bdec.out_fifo->push(quad);
                 }
 
                 for (int i = 0; i < 8; i++)
                 {
                     memcpy(quad._u8, bdec.blocks[5] + (i * 8), sizeof(int16_t) * 8);
-                    bdec.out_fifo->f.push(quad);
+                    bdec.out_fifo->push(quad);
                 }
 
                 if (bdec.check_start_code)
@@ -627,7 +625,8 @@ void ImageProcessingUnit::prepare_IDCT()
     }
 }
 
-void ImageProcessingUnit::perform_IDCT(const int16_t* pUV, int16_t* pXY)
+//Double precision IDCT, kept as the reference the fixed-point version is checked against
+void ImageProcessingUnit::perform_IDCT_reference(const int16_t* pUV, int16_t* pXY)
 {
     int i, j, k, v;
     double partial_product;
@@ -668,6 +667,174 @@ void ImageProcessingUnit::perform_IDCT(const int16_t* pUV, int16_t* pXY)
     }
 }
 
+
+//Fixed-point IDCT, also from mpeg2decode (Chen-Wang algorithm, meets IEEE 1180 accuracy).
+//The row and column passes each work on all eight rows/columns at once, two SSE registers per stage.
+#define W1 2841 //2048*sqrt(2)*cos(1*pi/16)
+#define W2 2676 //2048*sqrt(2)*cos(2*pi/16)
+#define W3 2408 //2048*sqrt(2)*cos(3*pi/16)
+#define W5 1609 //2048*sqrt(2)*cos(5*pi/16)
+#define W6 1108 //2048*sqrt(2)*cos(6*pi/16)
+#define W7 565  //2048*sqrt(2)*cos(7*pi/16)
+
+static inline void transpose_8x8(__m128i* v)
+{
+    __m128i a0 = _mm_unpacklo_epi16(v[0], v[1]);
+    __m128i a1 = _mm_unpackhi_epi16(v[0], v[1]);
+    __m128i a2 = _mm_unpacklo_epi16(v[2], v[3]);
+    __m128i a3 = _mm_unpackhi_epi16(v[2], v[3]);
+    __m128i a4 = _mm_unpacklo_epi16(v[4], v[5]);
+    __m128i a5 = _mm_unpackhi_epi16(v[4], v[5]);
+    __m128i a6 = _mm_unpacklo_epi16(v[6], v[7]);
+    __m128i a7 = _mm_unpackhi_epi16(v[6], v[7]);
+
+    __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+    v[0] = _mm_unpacklo_epi64(b0, b4);
+    v[1] = _mm_unpackhi_epi64(b0, b4);
+    v[2] = _mm_unpacklo_epi64(b1, b5);
+    v[3] = _mm_unpackhi_epi64(b1, b5);
+    v[4] = _mm_unpacklo_epi64(b2, b6);
+    v[5] = _mm_unpackhi_epi64(b2, b6);
+    v[6] = _mm_unpacklo_epi64(b3, b7);
+    v[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+static inline __m128i interleave16(__m128i a, __m128i b, bool high)
+{
+    return high ? _mm_unpackhi_epi16(a, b) : _mm_unpacklo_epi16(a, b);
+}
+
+//181/256 = 1/sqrt(2). SSE2 has no 32-bit multiply, so it's done with shifts.
+static inline __m128i mul_181(__m128i x)
+{
+    __m128i sum = _mm_add_epi32(_mm_slli_epi32(x, 7), _mm_slli_epi32(x, 5));
+    sum = _mm_add_epi32(sum, _mm_slli_epi32(x, 4));
+    sum = _mm_add_epi32(sum, _mm_slli_epi32(x, 2));
+    return _mm_add_epi32(sum, x);
+}
+
+//v[k] holds coefficient k of all eight lines. The odd and the 2/6 rotations are PMADDWD on interleaved
+//coefficient pairs, e.g. W1 * blk[1] + W7 * blk[7].
+template <bool column>
+static inline void IDCT_pass(__m128i* v)
+{
+    const __m128i w1_w7 = _mm_setr_epi16(W1, W7, W1, W7, W1, W7, W1, W7);
+    const __m128i w7_nw1 = _mm_setr_epi16(W7, -W1, W7, -W1, W7, -W1, W7, -W1);
+    const __m128i w5_w3 = _mm_setr_epi16(W5, W3, W5, W3, W5, W3, W5, W3);
+    const __m128i w3_nw5 = _mm_setr_epi16(W3, -W5, W3, -W5, W3, -W5, W3, -W5);
+    const __m128i w2_w6 = _mm_setr_epi16(W2, W6, W2, W6, W2, W6, W2, W6);
+    const __m128i w6_nw2 = _mm_setr_epi16(W6, -W2, W6, -W2, W6, -W2, W6, -W2);
+    const int shift = column ? 8 : 11;
+
+    __m128i out[2][8];
+    for (int half = 0; half < 2; half++)
+    {
+        //First stage
+        __m128i x0 = _mm_srai_epi32(interleave16(v[0], v[0], half), 16);
+        __m128i x1 = _mm_srai_epi32(interleave16(v[4], v[4], half), 16);
+        x0 = _mm_add_epi32(_mm_slli_epi32(x0, shift), _mm_set1_epi32(column ? 8192 : 128));
+        x1 = _mm_slli_epi32(x1, shift);
+
+        __m128i pair = interleave16(v[1], v[7], half);
+        __m128i x4 = _mm_madd_epi16(pair, w1_w7);
+        __m128i x5 = _mm_madd_epi16(pair, w7_nw1);
+        pair = interleave16(v[5], v[3], half);
+        __m128i x6 = _mm_madd_epi16(pair, w5_w3);
+        __m128i x7 = _mm_madd_epi16(pair, w3_nw5);
+        pair = interleave16(v[2], v[6], half);
+        __m128i x3 = _mm_madd_epi16(pair, w2_w6);
+        __m128i x2 = _mm_madd_epi16(pair, w6_nw2);
+
+        if (column)
+        {
+            const __m128i round = _mm_set1_epi32(4);
+            x2 = _mm_srai_epi32(_mm_add_epi32(x2, round), 3);
+            x3 = _mm_srai_epi32(_mm_add_epi32(x3, round), 3);
+            x4 = _mm_srai_epi32(_mm_add_epi32(x4, round), 3);
+            x5 = _mm_srai_epi32(_mm_add_epi32(x5, round), 3);
+            x6 = _mm_srai_epi32(_mm_add_epi32(x6, round), 3);
+            x7 = _mm_srai_epi32(_mm_add_epi32(x7, round), 3);
+        }
+
+        //Second stage
+        __m128i x8 = _mm_add_epi32(x0, x1);
+        x0 = _mm_sub_epi32(x0, x1);
+        x1 = _mm_add_epi32(x4, x6);
+        x4 = _mm_sub_epi32(x4, x6);
+        x6 = _mm_add_epi32(x5, x7);
+        x5 = _mm_sub_epi32(x5, x7);
+
+        //Third stage
+        x7 = _mm_add_epi32(x8, x3);
+        x8 = _mm_sub_epi32(x8, x3);
+        x3 = _mm_add_epi32(x0, x2);
+        x0 = _mm_sub_epi32(x0, x2);
+        const __m128i round181 = _mm_set1_epi32(128);
+        x2 = _mm_srai_epi32(_mm_add_epi32(mul_181(_mm_add_epi32(x4, x5)), round181), 8);
+        x4 = _mm_srai_epi32(_mm_add_epi32(mul_181(_mm_sub_epi32(x4, x5)), round181), 8);
+
+        //Fourth stage
+        out[half][0] = _mm_add_epi32(x7, x1);
+        out[half][1] = _mm_add_epi32(x3, x2);
+        out[half][2] = _mm_add_epi32(x0, x4);
+        out[half][3] = _mm_add_epi32(x8, x6);
+        out[half][4] = _mm_sub_epi32(x8, x6);
+        out[half][5] = _mm_sub_epi32(x0, x4);
+        out[half][6] = _mm_sub_epi32(x3, x2);
+        out[half][7] = _mm_sub_epi32(x7, x1);
+    }
+
+    for (int i = 0; i < 8; i++)
+    {
+        if (column)
+        {
+            //Output is clipped to [-256, 255]
+            __m128i lo = _mm_srai_epi32(out[0][i], 14);
+            __m128i hi = _mm_srai_epi32(out[1][i], 14);
+            __m128i result = _mm_packs_epi32(lo, hi);
+            result = _mm_max_epi16(result, _mm_set1_epi16(-256));
+            v[i] = _mm_min_epi16(result, _mm_set1_epi16(255));
+        }
+        else
+        {
+            //Rows are stored back as 16-bit values, truncating like the scalar version does
+            __m128i lo = _mm_srai_epi32(_mm_slli_epi32(out[0][i], 8), 16);
+            __m128i hi = _mm_srai_epi32(_mm_slli_epi32(out[1][i], 8), 16);
+            v[i] = _mm_packs_epi32(lo, hi);
+        }
+    }
+}
+
+#undef W1
+#undef W2
+#undef W3
+#undef W5
+#undef W6
+#undef W7
+
+void ImageProcessingUnit::perform_IDCT(int16_t* block)
+{
+    __m128i v[8];
+    for (int i = 0; i < 8; i++)
+        v[i] = _mm_loadu_si128((__m128i*)&block[i * 8]);
+
+    transpose_8x8(v);
+    IDCT_pass<false>(v);
+    transpose_8x8(v);
+    IDCT_pass<true>(v);
+
+    for (int i = 0; i < 8; i++)
+        _mm_storeu_si128((__m128i*)&block[i * 8], v[i]);
+}
+
 //End IDCT code
 
 bool ImageProcessingUnit::BDEC_read_coeffs()
@@ -873,6 +1040,15 @@ void ImageProcessingUnit::process_FDEC()
     }
 }
 
+//Truncates eight 8-bit channels to 5 bits. The dither offset is in half steps, so the math is done with one extra bit.
+static inline __m128i RGB16_channel(__m128i value, __m128i dither)
+{
+    value = _mm_add_epi16(_mm_slli_epi16(value, 1), dither);
+    value = _mm_max_epi16(value, _mm_setzero_si128());
+    value = _mm_min_epi16(value, _mm_set1_epi16(0x1FF));
+    return _mm_srli_epi16(value, 4);
+}
+
 bool ImageProcessingUnit::process_CSC()
 {
     while (true)
@@ -903,87 +1079,104 @@ bool ImageProcessingUnit::process_CSC()
                 break;
             case CSC_STATE::CONVERT:
             {
-                uint32_t pixels[0x100];
-
+                //A row of 16 pixels is converted at a time, as four groups of four in single precision.
+                //The operations are the same as in the scalar formula so the results match it exactly.
                 uint8_t* lum_block = csc.block;
                 uint8_t* cb_block = csc.block + 0x100;
                 uint8_t* cr_block = csc.block + 0x140;
 
-                uint32_t alpha_thresh0 = (TH0 & 0xFF) | ((TH0 & 0xFF) << 8) | ((TH0 & 0xFF) << 16);
-                uint32_t alpha_thresh1 = (TH1 & 0xFF) | ((TH1 & 0xFF) << 8) | ((TH1 & 0xFF) << 16);
+                const __m128i zero = _mm_setzero_si128();
+                const __m128 offset = _mm_set1_ps(128.0f);
+                const __m128 min_value = _mm_setzero_ps();
+                const __m128 max_value = _mm_set1_ps(255.0f);
+                const __m128i th0_r = _mm_set1_epi32(TH0 & 0xFF);
+                const __m128i th0_g = _mm_set1_epi32((TH0 >> 8) & 0xFF);
+                const __m128i th0_b = _mm_set1_epi32((TH0 >> 16) & 0xFF);
+                const __m128i th1_r = _mm_set1_epi32(TH1 & 0xFF);
+                const __m128i th1_g = _mm_set1_epi32((TH1 >> 8) & 0xFF);
+                const __m128i th1_b = _mm_set1_epi32((TH1 >> 16) & 0xFF);
+                const __m128i alpha_half = _mm_set1_epi32(1 << 30);
+                const __m128i alpha_full = _mm_set1_epi32(1 << 31);
 
                 for (int i = 0; i < 16; i++)
                 {
-                    for (int j = 0; j < 16; j++)
-                    {
-                        int index = j + (i * 16);
-                        float lum = lum_block[index];
-                        float cb = cb_block[crcb_map[index]];
-                        float cr = cr_block[crcb_map[index]];
-
-                        float r = lum + 1.402f * (cr - 128);
-                        float g = lum - 0.34414f * (cb - 128) - 0.71414f * (cr - 128);
-                        float b = lum + 1.772f * (cb - 128);
-
-                        if (r < 0)
-                            r = 0;
-                        if (r > 255)
-                            r = 255;
-                        if (g < 0)
-                            g = 0;
-                        if (g > 255)
-                            g = 255;
-                        if (b < 0)
-                            b = 0;
-                        if (b > 255)
-                            b = 255;
-
-                        uint32_t color = (uint8_t)r;
-                        color |= ((uint8_t)g) << 8;
-                        color |= ((uint8_t)b) << 16;
-
-                        uint32_t alpha;
-                        if (r < (TH0 & 0xFF) && g < ((TH0 >> 8) & 0xFF) && b < ((TH0 >> 16) & 0xFF))
-                            alpha = 0;
-                        else if (r < (TH1 & 0xFF) && g < ((TH1 >> 8) & 0xFF) && b < ((TH1 >> 16) & 0xFF))
-                            alpha = 1 << 30;
-                        else
-                            alpha = 1 << 31;
+                    __m128i lum8 = _mm_loadu_si128((__m128i*)&lum_block[i * 16]);
+
+                    //Chroma is subsampled in both directions, so every sample covers two pixels of two rows
+                    __m128i cb8 = _mm_loadl_epi64((__m128i*)&cb_block[(i / 2) * 8]);
+                    __m128i cr8 = _mm_loadl_epi64((__m128i*)&cr_block[(i / 2) * 8]);
+                    cb8 = _mm_unpacklo_epi8(cb8, cb8);
+                    cr8 = _mm_unpacklo_epi8(cr8, cr8);
 
-                        pixels[index] = color | alpha;
-                        //printf("Pixel: $%08X (%d, %d)\n", pixels[index], i, j);
+                    __m128i r[4], g[4], b[4], alpha[4];
+                    for (int j = 0; j < 4; j++)
+                    {
+                        bool high = j & 1;
+                        __m128i lum16 = (j < 2) ? _mm_unpacklo_epi8(lum8, zero) : _mm_unpackhi_epi8(lum8, zero);
+                        __m128i cb16 = (j < 2) ? _mm_unpacklo_epi8(cb8, zero) : _mm_unpackhi_epi8(cb8, zero);
+                        __m128i cr16 = (j < 2) ? _mm_unpacklo_epi8(cr8, zero) : _mm_unpackhi_epi8(cr8, zero);
+
+                        __m128 lum = _mm_cvtepi32_ps(interleave16(lum16, zero, high));
+                        __m128 cb = _mm_sub_ps(_mm_cvtepi32_ps(interleave16(cb16, zero, high)), offset);
+                        __m128 cr = _mm_sub_ps(_mm_cvtepi32_ps(interleave16(cr16, zero, high)), offset);
+
+                        __m128 rf = _mm_add_ps(lum, _mm_mul_ps(_mm_set1_ps(1.402f), cr));
+                        __m128 gf = _mm_sub_ps(lum, _mm_mul_ps(_mm_set1_ps(0.34414f), cb));
+                        gf = _mm_sub_ps(gf, _mm_mul_ps(_mm_set1_ps(0.71414f), cr));
+                        __m128 bf = _mm_add_ps(lum, _mm_mul_ps(_mm_set1_ps(1.772f), cb));
+
+                        r[j] = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(rf, min_value), max_value));
+                        g[j] = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(gf, min_value), max_value));
+                        b[j] = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(bf, min_value), max_value));
+
+                        //Alpha is 0 below TH0, half below TH1 and full otherwise
+                        __m128i below_th0 = _mm_and_si128(_mm_cmplt_epi32(r[j], th0_r), _mm_cmplt_epi32(g[j], th0_g));
+                        below_th0 = _mm_and_si128(below_th0, _mm_cmplt_epi32(b[j], th0_b));
+                        __m128i below_th1 = _mm_and_si128(_mm_cmplt_epi32(r[j], th1_r), _mm_cmplt_epi32(g[j], th1_g));
+                        below_th1 = _mm_and_si128(below_th1, _mm_cmplt_epi32(b[j], th1_b));
+                        alpha[j] = _mm_or_si128(_mm_and_si128(below_th1, alpha_half), _mm_andnot_si128(below_th1, alpha_full));
+                        alpha[j] = _mm_andnot_si128(below_th0, alpha[j]);
                     }
-                }
 
-                uint128_t quad;
-                if (csc.use_RGB16)
-                {
-                    //We must convert from RGB32 to RGB16.
-                    //It's worth noting that bit 30 is the alpha bit for RGB16, not bit 31.
-                    //TODO: Figure out how dithering works. It uses "pixel position"
-                    for (int i = 0; i < 0x100 / 8; i++)
+                    uint128_t quad;
+                    if (csc.use_RGB16)
                     {
-                        for (int j = 0; j < 8; j++)
+                        //We must convert from RGB32 to RGB16.
+                        //It's worth noting that bit 30 is the alpha bit for RGB16, not bit 31.
+                        //Dithering adds half of the matrix entry for the pixel position before truncating to 5 bits.
+                        __m128i dither = zero;
+                        if (csc.use_dither)
                         {
-                            uint32_t color32 = pixels[j + (i * 8)];
-                            uint16_t color16 = (color32 >> 3) & 0x1F;
-                            color16 |= ((color32 >> 11) & 0x1F) << 5;
-                            color16 |= ((color32 >> 19) & 0x1F) << 10;
-                            color16 |= ((color32 >> 30) & 0x1) << 15;
-                            quad._u16[j] = color16;
+                            int8_t* d = dither_mtx[i & 3];
+                            dither = _mm_setr_epi16(d[0], d[1], d[2], d[3], d[0], d[1], d[2], d[3]);
+                        }
+
+                        for (int j = 0; j < 4; j += 2)
+                        {
+                            __m128i r5 = RGB16_channel(_mm_packs_epi32(r[j], r[j + 1]), dither);
+                            __m128i g5 = RGB16_channel(_mm_packs_epi32(g[j], g[j + 1]), dither);
+                            __m128i b5 = RGB16_channel(_mm_packs_epi32(b[j], b[j + 1]), dither);
+                            __m128i a0 = _mm_srai_epi32(_mm_slli_epi32(alpha[j], 1), 31);
+                            __m128i a1 = _mm_srai_epi32(_mm_slli_epi32(alpha[j + 1], 1), 31);
+                            __m128i a = _mm_and_si128(_mm_packs_epi32(a0, a1), _mm_set1_epi16((int16_t)0x8000));
+
+                            __m128i color = _mm_or_si128(r5, _mm_slli_epi16(g5, 5));
+                            color = _mm_or_si128(color, _mm_slli_epi16(b5, 10));
+                            color = _mm_or_si128(color, a);
+                            _mm_storeu_si128((__m128i*)&quad, color);
+                            out_FIFO.push(quad);
                         }
-                        out_FIFO.f.push(quad);
                     }
-                }
-                else
-                {
-                    for (int i = 0; i < 0x100 / 4; i++)
+                    else
                     {
                         for (int j = 0; j < 4; j++)
                         {
-                            quad._u32[j] = pixels[j + (i * 4)];
+                            __m128i color = _mm_or_si128(r[j], _mm_slli_epi32(g[j], 8));
+                            color = _mm_or_si128(color, _mm_slli_epi32(b[j], 16));
+                            color = _mm_or_si128(color, alpha[j]);
+                            _mm_storeu_si128((__m128i*)&quad, color);
+                            out_FIFO.push(quad);
                         }
-                        out_FIFO.f.push(quad);
                     }
                 }
                 csc.macroblocks--;
@@ -1008,7 +1201,7 @@ uint64_t ImageProcessingUnit::read_command()
 uint32_t ImageProcessingUnit::read_control()
 {
     uint32_t reg = 0;
-    reg |= in_FIFO.f.size();
+    reg |= in_FIFO.size();
     reg |= (ctrl.coded_block_pattern & 0x3F) << 8;
     reg |= ctrl.error_code << 14;
     reg |= ctrl.start_code << 15;
@@ -1025,7 +1218,7 @@ uint32_t ImageProcessingUnit::read_control()
 uint32_t ImageProcessingUnit::read_BP()
 {
     uint32_t reg = 0;
-    uint8_t fifo_size = in_FIFO.f.size();
+    uint8_t fifo_size = in_FIFO.size();
 
     //Check for FP bit
     if (in_FIFO.bit_pointer && fifo_size)
@@ -1042,7 +1235,7 @@ uint32_t ImageProcessingUnit::read_BP()
 uint64_t ImageProcessingUnit::read_top()
 {
     uint64_t reg = 0;
-    int max_bits = (in_FIFO.f.size() * 128) - in_FIFO.bit_pointer;
+    int max_bits = (in_FIFO.size() * 128) - in_FIFO.bit_pointer;
     if (max_bits > 32)
         max_bits = 32;
     uint32_t next_data;
@@ -1079,6 +1272,7 @@ void ImageProcessingUnit::write_command(uint32_t value)
                 idec.decodes_dct = command_option & (1 << 24);
                 idec.blocks_decoded = 0;
                 csc.use_RGB16 = command_option & (1 << 27);
+                csc.use_dither = command_option & (1 << 26);
                 break;
             case 0x02:
                 printf("[IPU] BDEC\n");
@@ -1115,6 +1309,7 @@ void ImageProcessingUnit::write_command(uint32_t value)
                 csc.state = CSC_STATE::BEGIN;
                 csc.macroblocks = command_option & 0x7FF;
                 csc.use_RGB16 = command_option & (1 << 27);
+                csc.use_dither = command_option & (1 << 26);
                 break;
             case 0x09:
                 printf("[IPU] SETTH\n");
@@ -1145,34 +1340,39 @@ void ImageProcessingUnit::write_control(uint32_t value)
         command_decoding = false;
         command = 0;
         in_FIFO.reset();
-        out_FIFO.reset();
+        out_FIFO = std::queue<uint128_t>();
     }
 }
 
 bool ImageProcessingUnit::can_read_FIFO()
 {
-    return out_FIFO.f.size() > 0;
+    return out_FIFO.size() > 0;
 }
 
 bool ImageProcessingUnit::can_write_FIFO()
 {
-    return in_FIFO.f.size() < 8;
+    return in_FIFO.space() > 0;
+}
+
+int ImageProcessingUnit::get_FIFO_space()
+{
+    return in_FIFO.space();
 }
 
 uint128_t ImageProcessingUnit::read_FIFO()
 {
-    uint128_t quad = out_FIFO.f.front();
-    out_FIFO.f.pop();
+    uint128_t quad = out_FIFO.front();
+    out_FIFO.pop();
     return quad;
 }
 
 void ImageProcessingUnit::write_FIFO(uint128_t quad)
 {
     printf("[IPU] Write FIFO: $%08X_%08X_%08X_%08X\n", quad._u32[3], quad._u32[2], quad._u32[1], quad._u32[0]);
-    if (in_FIFO.f.size() >= 8)
-    {
-        Errors::die("[IPU] Error: data sent to IPU exceeding FIFO limit!\n");
-    }
-    in_FIFO.f.push(quad);
-    in_FIFO.bit_cache_dirty = true;
+    in_FIFO.push(quad);
+}
+
+void ImageProcessingUnit::write_FIFO(const uint128_t* quads, int count)
+{
+    in_FIFO.push(quads, count);
 }
@@ -75,7 +75,7 @@ struct IDEC_Command
     bool decodes_dct;
     uint32_t qsc;
 
-    IPU_FIFO temp_fifo;
+    std::queue<uint128_t> temp_fifo;
 
     int blocks_decoded;
 };
@@ -83,7 +83,7 @@ struct IDEC_Command
 struct BDEC_Command
 {
     BDEC_STATE state;
-    IPU_FIFO* out_fifo;
+    std::queue<uint128_t>* out_fifo;
     bool intra;
     bool reset_dc;
     bool check_start_code;
@@ -133,6 +133,7 @@ struct CSC_Command
     CSC_STATE state;
     int macroblocks;
     bool use_RGB16;
+    bool use_dither;
 
     uint8_t block[BLOCK_SIZE];
     int block_index;
@@ -156,7 +157,8 @@ class ImageProcessingUnit
         Macroblock_BPic macroblock_B_pic;
         MotionCode motioncode;
         VLC_Table* VDEC_table;
-        IPU_FIFO in_FIFO, out_FIFO;
+        IPU_FIFO in_FIFO;
+        std::queue<uint128_t> out_FIFO;
 
         int8_t dither_mtx[4][4];
 
@@ -194,18 +196,23 @@ class ImageProcessingUnit
         void inverse_scan(int16_t* block);
         void dequantize(int16_t* block);
         void prepare_IDCT();
-        void perform_IDCT(const int16_t* pUV, int16_t* pXY);
+        void perform_IDCT_reference(const int16_t* pUV, int16_t* pXY);
+        void perform_IDCT(int16_t* block);
         bool BDEC_read_coeffs();
         bool BDEC_read_diff();
 
         void process_VDEC();
         void process_FDEC();
         bool process_CSC();
+
+        //The tests check perform_IDCT against perform_IDCT_reference
+        friend class Emulator;
     public:
         ImageProcessingUnit(INTC* intc);
 
         void reset();
         void run();
+        bool is_busy();
 
         uint64_t read_command();
         uint32_t read_control();
@@ -218,7 +225,14 @@ class ImageProcessingUnit
         bool can_read_FIFO();
         bool can_write_FIFO();
         uint128_t read_FIFO();
+        int get_FIFO_space();
         void write_FIFO(uint128_t quad);
+        void write_FIFO(const uint128_t* quads, int count);
 };
 
+inline bool ImageProcessingUnit::is_busy()
+{
+    return ctrl.busy;
+}
+
 #endif // IPU_HPP
@@ -1,80 +1,117 @@
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 #include "ipu_fifo.hpp"
 #include "../../errors.hpp"
 
-bool IPU_FIFO::get_bits(uint32_t &data, int bits)
+static inline uint64_t bswap64(uint64_t value)
 {
-    int bits_available = (f.size() * 128) - bit_pointer;
+#ifdef _MSC_VER
+    return _byteswap_uint64(value);
+#else
+    return __builtin_bswap64(value);
+#endif
+}
 
-    if (bits_available < bits || bits_available == 0)
-    {
-        data = 0;
-        return false;
-    }
+void IPU_FIFO::push(const uint128_t& quad)
+{
+    if (count >= SIZE)
+        Errors::die("[IPU] Error: data sent to IPU exceeding FIFO limit!\n");
+    data[(head + count) & (SIZE - 1)] = quad;
+    count++;
+}
 
-    if (bit_cache_dirty)
-    {
-        std::queue<uint128_t> temp_fifo = f;
-        uint8_t temp[32];
-        *(uint128_t*)&temp[0] = temp_fifo.front();
-        if (temp_fifo.size() > 1)
-        {
-            temp_fifo.pop();
-            *(uint128_t*)&temp[16] = temp_fifo.front();
-        }
+void IPU_FIFO::push(const uint128_t* quads, int amount)
+{
+    if (count + amount > SIZE)
+        Errors::die("[IPU] Error: data sent to IPU exceeding FIFO limit!\n");
+    int tail = (head + count) & (SIZE - 1);
+    int first = amount;
+    if (first > SIZE - tail)
+        first = SIZE - tail;
+    memcpy(&data[tail], quads, first * sizeof(uint128_t));
+    memcpy(&data[0], quads + first, (amount - first) * sizeof(uint128_t));
+    count += amount;
+}
 
-        uint8_t blorp[8];
-        int index = (bit_pointer & ~0x1F) / 8;
+uint128_t IPU_FIFO::pop()
+{
+    uint128_t quad = data[head];
+    head = (head + 1) & (SIZE - 1);
+    count--;
 
-        //MPEG is big-endian...
+    //The bit pointer now refers to the next quadword, so the cache has to be rebuilt
+    cached_bits = 0;
+    cached_count = 0;
+    return quad;
+}
+
+//Loads as many of the bits following the cache as fit.
+//MPEG is big-endian, so eight bytes are read at a time and byte-swapped.
+void IPU_FIFO::refill()
+{
+    int end = bit_pointer + cached_count;
+    int bits_available = (count * 128) - end;
+    if (bits_available <= 0 || cached_count > 56)
+        return;
+
+    const uint8_t* bytes = (const uint8_t*)data;
+    int offset = ((head * 16) + (end >> 3)) & ((SIZE * 16) - 1);
+    uint64_t chunk;
+    if (offset <= (SIZE * 16) - 8)
+        memcpy(&chunk, bytes + offset, sizeof(chunk));
+    else
+    {
+        uint8_t temp[8];
         for (int i = 0; i < 8; i++)
-        {
-            int fifo_index = index + i;
-            blorp[7 - i] = temp[fifo_index];
-        }
-        bit_cache_dirty = false;
-        cached_bits = *(uint64_t*)&blorp[0];
+            temp[i] = bytes[(offset + i) & ((SIZE * 16) - 1)];
+        memcpy(&chunk, temp, sizeof(chunk));
     }
-    int shift = 64 - (bit_pointer % 32) - bits;
-    uint64_t mask = ~0x0ULL >> (64 - bits);
-    data = (cached_bits >> shift) & mask;
+    chunk = bswap64(chunk) << (end & 7);
 
-    return true;
+    int new_bits = 64 - (end & 7);
+    if (new_bits > 64 - cached_count)
+        new_bits = 64 - cached_count;
+    if (new_bits > bits_available)
+        new_bits = bits_available;
+
+    chunk &= ~0ULL << (64 - new_bits);
+    cached_bits |= chunk >> cached_count;
+    cached_count += new_bits;
 }
 
 bool IPU_FIFO::advance_stream(uint8_t amount)
 {
     if (amount > 32)
         amount = 32;
-    
-    //printf("Advance stream: %d + %d = %d\n", bit_pointer - amount, amount, bit_pointer);
 
-    if ((bit_pointer + amount) > (f.size() * 128))
+    if ((bit_pointer + amount) > (count * 128))
     {
        // Errors::die("[IPU] Bit pointer exceeds FIFO size!\n");
         return false;
     }
 
-    uint32_t old_words = bit_pointer / 32;
-    uint32_t new_words = (bit_pointer + amount) / 32;
-    bit_cache_dirty |= (old_words != new_words);
+    if (cached_count < amount)
+        refill();
+
+    cached_bits <<= amount;
+    cached_count -= amount;
     bit_pointer += amount;
 
     while (bit_pointer >= 128)
     {
         bit_pointer -= 128;
-        f.pop();
-        bit_cache_dirty = true;
+        head = (head + 1) & (SIZE - 1);
+        count--;
     }
     return true;
 }
 
 void IPU_FIFO::reset()
 {
-    std::queue<uint128_t> empty;
-    f.swap(empty);
+    head = 0;
+    count = 0;
     bit_pointer = 0;
     cached_bits = 0;
-    bit_cache_dirty = true;
+    cached_count = 0;
 }
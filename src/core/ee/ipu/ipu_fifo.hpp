@@ -1,20 +1,64 @@
 #ifndef IPU_FIFO_HPP
 #define IPU_FIFO_HPP
 #include <cstdint>
-#include <queue>
 
 #include "../../int128.hpp"
 
+//Input FIFO of the IPU. Like the hardware it holds up to eight quadwords, in a ring.
+//It also serves as the bitstream reader for the decoding commands: get_bits peeks at the bits after the
+//bit pointer and advance_stream consumes them. Up to 64 bits following the bit pointer are kept in a
+//left-justified cache, so both usually come down to a few shifts.
 struct IPU_FIFO
 {
-    std::queue<uint128_t> f;
+    static const int SIZE = 8;
+
+    uint128_t data[SIZE];
+    int head;
+    int count;
     int bit_pointer;
+
     uint64_t cached_bits;
-    bool bit_cache_dirty;
+    int cached_count;
+
+    int size() const;
+    int space() const;
+    void push(const uint128_t& quad);
+    void push(const uint128_t* quads, int amount);
+    uint128_t pop();
+
     bool get_bits(uint32_t& data, int bits);
     bool advance_stream(uint8_t amount);
 
     void reset();
+private:
+    void refill();
 };
 
+inline int IPU_FIFO::size() const
+{
+    return count;
+}
+
+inline int IPU_FIFO::space() const
+{
+    return SIZE - count;
+}
+
+inline bool IPU_FIFO::get_bits(uint32_t &data, int bits)
+{
+    if (cached_count < bits || !cached_count)
+    {
+        refill();
+        if (cached_count < bits || !cached_count)
+        {
+            data = 0;
+            return false;
+        }
+    }
+
+    //Split shift so that zero bits doesn't shift by 64
+    data = (uint32_t)((cached_bits >> 1) >> (63 - bits));
+    return true;
+}
+
 #endif // IPU_FIFO_HPP
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstdlib>
 #include <cstdio>
 #include "vlc_table.hpp"
@@ -6,10 +7,72 @@
 VLC_Table::VLC_Table(VLC_Entry* table, int table_size, int max_bits) :
     table(table), table_size(table_size), max_bits(max_bits)
 {
+    build_lookup();
+}
+
+void VLC_Table::build_lookup()
+{
+    lookup_bits = std::min(max_bits, LOOKUP_BITS);
+    int sub_bits = max_bits - lookup_bits;
+
+    lookup.assign(1 << lookup_bits, {-1, 0});
+
+    //Where codes overlap, the shortest one wins, as it's the first one a bit-by-bit search would find
+    auto fill = [this](int start, int count, int index)
+    {
+        for (int i = start; i < start + count; i++)
+        {
+            int old = lookup[i].entry;
+            if (old < 0 || table[old].bits > table[index].bits)
+                lookup[i].entry = index;
+        }
+    };
+
+    for (int i = 0; i < table_size; i++)
+    {
+        int bits = table[i].bits;
+        if (bits > max_bits)
+            Errors::die("[VLC_Table] Code $%X is longer than the table's %d bits", table[i].key, max_bits);
+
+        if (bits <= lookup_bits)
+        {
+            fill(table[i].key << (lookup_bits - bits), 1 << (lookup_bits - bits), i);
+            continue;
+        }
 
+        uint32_t prefix = table[i].key >> (bits - lookup_bits);
+        if (!lookup[prefix].subtable)
+        {
+            lookup[prefix].subtable = lookup.size();
+            lookup.resize(lookup.size() + (1 << sub_bits), {-1, 0});
+        }
+
+        uint32_t suffix = table[i].key & ((1 << (bits - lookup_bits)) - 1);
+        fill(lookup[prefix].subtable + (suffix << (max_bits - bits)), 1 << (max_bits - bits), i);
+    }
 }
 
 bool VLC_Table::peek_symbol(IPU_FIFO &FIFO, VLC_Entry &entry)
+{
+    uint32_t key;
+
+    //Near the end of the available data there may still be enough for a shorter code
+    if (!FIFO.get_bits(key, max_bits))
+        return peek_symbol_slow(FIFO, entry);
+
+    int sub_bits = max_bits - lookup_bits;
+    const VLC_Node* node = &lookup[key >> sub_bits];
+    if (node->entry < 0 && node->subtable)
+        node = &lookup[node->subtable + (key & ((1 << sub_bits) - 1))];
+
+    if (node->entry < 0)
+        throw VLC_Error("VLC symbol not found");
+
+    entry = table[node->entry];
+    return true;
+}
+
+bool VLC_Table::peek_symbol_slow(IPU_FIFO &FIFO, VLC_Entry &entry)
 {
     uint32_t key;
     for (int i = 0; i < max_bits; i++)
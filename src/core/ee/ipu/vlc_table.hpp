@@ -3,6 +3,7 @@
 #include <stdexcept>
 #include <cstdint>
 #include <queue>
+#include <vector>
 #include "ipu_fifo.hpp"
 
 struct VLC_Entry
@@ -12,6 +13,13 @@ struct VLC_Entry
     uint8_t bits;
 };
 
+//One slot of the lookup table, indexed by the next bits of the stream
+struct VLC_Node
+{
+    int16_t entry; //Index of the matching entry, -1 if there isn't one within this level
+    uint16_t subtable; //Where the next level for longer codes starts, 0 if there are none
+};
+
 class VLC_Error : public std::runtime_error
 {
     using std::runtime_error::runtime_error;
@@ -22,11 +30,21 @@ class VLC_Table
     private:
         VLC_Entry* table;
         int table_size, max_bits;
+
+        //Codes up to LOOKUP_BITS long resolve in one lookup, longer ones take a second lookup into a subtable
+        constexpr static int LOOKUP_BITS = 10;
+        int lookup_bits;
+        std::vector<VLC_Node> lookup;
+
+        void build_lookup();
     protected:
         VLC_Table(VLC_Entry* table, int table_size, int max_bits);
     public:
         bool peek_symbol(IPU_FIFO& FIFO, VLC_Entry& entry);
         bool get_symbol(IPU_FIFO& FIFO, uint32_t& result);
+
+        //Bit-by-bit search that the lookup table has to agree with, used for codes cut off by the end of the data
+        bool peek_symbol_slow(IPU_FIFO& FIFO, VLC_Entry& entry);
 };
 
 #endif // VLC_TABLE_HPP
@@ -28,16 +28,6 @@ void EmotionTiming::reset()
     next_event = 0xFFFFFFFF;
 }
 
-void EmotionTiming::run(int cycles)
-{
-    cycle_count += cycles;
-    if (cycle_count >= next_event)
-    {
-        update_timers();
-        reschedule();
-    }
-}
-
 void EmotionTiming::update_timers()
 {
     for (int i = 0; i < 4; i++)
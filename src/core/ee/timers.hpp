@@ -64,4 +64,15 @@ class EmotionTiming
         void save_state(std::ofstream& state);
 };
 
+//Called every slice, so the common case of no timer event pending stays inline
+inline void EmotionTiming::run(int cycles)
+{
+    cycle_count += cycles;
+    if (cycle_count >= next_event)
+    {
+        update_timers();
+        reschedule();
+    }
+}
+
 #endif // TIMERS_HPP
@@ -1,5 +1,6 @@
 #include <cstdio>
 #include <cstdlib>
+#include <emmintrin.h>
 #include "vu_jit.hpp"
 #include "vif.hpp"
 
@@ -34,6 +35,7 @@ void VectorInterface::reset()
     vif_stop = false;
     mark_detected = false;
     flush_stall = false;
+    unpack_func = &VectorInterface::UNPACK_invalid;
 
     if (id)
         mem_mask = 0x3FF;
@@ -436,75 +438,72 @@ void VectorInterface::init_UNPACK(uint32_t value)
     data_read /= 32;
 
     command_len += data_read;
+    setup_UNPACK();
 
     //printf("[VIF] UNPACK V%d-%d addr: %x num: %d masked: %d word per op: %d command_len = %d\n", (vn + 1), (32 >> vl), unpack.addr, unpack.num, unpack.masked, unpack.words_per_op, command_len);
 }
 
-void VectorInterface::handle_UNPACK_masking(uint128_t& quad)
+void VectorInterface::setup_UNPACK()
 {
-    if (unpack.masked || is_filling_write())
+    //MASK has two bits per field for each of the first four rows written in a cycle
+    for (int row = 0; row < 4; row++)
     {
-        uint8_t tempmask;
-        
+        UNPACK_Masks& masks = unpack_masks[row];
         for (int i = 0; i < 4; i++)
         {
-            tempmask = (MASK >> ((i * 2) + std::min(unpack.blocks_written * 8, 24))) & 0x3;
-            
-            switch (tempmask)
-            {
-                case 1:
-                    //printf("[VIF] Writing ROW to position %d\n", i);
-                    quad._u32[i] = ROW[i];
-                    break;
-                case 2:
-                    //printf("[VIF] Writing COL to position %d\n", i);
-                    quad._u32[i] = COL[std::min(unpack.blocks_written, 3)];
-                    break;
-                case 3:
-                    //printf("[VIF] Write Protecting to position %d\n", i);
-                    quad._u32[i] = vu->read_data<uint32_t>(unpack.addr + (i * 4));
-                    break;
-                default:
-                    //No masking, ignore
-                    break;
-            }
+            uint8_t field = (MASK >> ((row * 8) + (i * 2))) & 0x3;
+            masks.data._u32[i] = (field == 0) ? 0xFFFFFFFF : 0;
+            masks.row._u32[i] = (field == 1) ? 0xFFFFFFFF : 0;
+            masks.col._u32[i] = (field == 2) ? 0xFFFFFFFF : 0;
+            masks.protect._u32[i] = (field == 3) ? 0xFFFFFFFF : 0;
         }
     }
-}
 
-void VectorInterface::handle_UNPACK_mode(uint128_t& quad)
-{
-    //Do not apply addition decompression when the format is V4-5
-    if (MODE && unpack.cmd != 0xF)
+    bool sign = unpack.sign_extend;
+    switch (unpack.cmd)
     {
-        uint8_t tempmask;
-
-        for (int i = 0; i < 4; i++)
-        {
-            tempmask = (MASK >> ((i * 2) + std::min(unpack.blocks_written * 8, 24))) & 0x3;
-
-            if (!tempmask || !unpack.masked)
-            {
-                switch (MODE)
-                {
-                    case 1:
-                        //Offset mode - VU Mem = Input + Row
-                        quad._u32[i] += ROW[i];
-                        break;
-                    case 2:
-                        //Difference mode - VU Mem = Row = Input + Row
-                        quad._u32[i] += ROW[i];
-                        ROW[i] = quad._u32[i];
-                        break;
-                    case 3:
-                        ROW[i] = quad._u32[i];
-                        break;
-                    default:
-                        //Do nothing
-                        break;
-                }
-            }
-        }
+        case 0x0:
+            unpack_func = &VectorInterface::UNPACK_S32;
+            break;
+        case 0x1:
+            unpack_func = sign ? &VectorInterface::UNPACK_S16<true> : &VectorInterface::UNPACK_S16<false>;
+            break;
+        case 0x2:
+            unpack_func = sign ? &VectorInterface::UNPACK_S8<true> : &VectorInterface::UNPACK_S8<false>;
+            break;
+        case 0x4:
+            unpack_func = &VectorInterface::UNPACK_V2_32;
+            break;
+        case 0x5:
+            unpack_func = sign ? &VectorInterface::UNPACK_V2_16<true> : &VectorInterface::UNPACK_V2_16<false>;
+            break;
+        case 0x6:
+            unpack_func = sign ? &VectorInterface::UNPACK_V2_8<true> : &VectorInterface::UNPACK_V2_8<false>;
+            break;
+        case 0x8:
+            unpack_func = &VectorInterface::UNPACK_V3_32;
+            break;
+        case 0x9:
+            unpack_func = sign ? &VectorInterface::UNPACK_V3_16<true> : &VectorInterface::UNPACK_V3_16<false>;
+            break;
+        case 0xA:
+            unpack_func = sign ? &VectorInterface::UNPACK_V3_8<true> : &VectorInterface::UNPACK_V3_8<false>;
+            break;
+        case 0xC:
+            unpack_func = &VectorInterface::UNPACK_V4_32;
+            break;
+        case 0xD:
+            unpack_func = sign ? &VectorInterface::UNPACK_V4_16<true> : &VectorInterface::UNPACK_V4_16<false>;
+            break;
+        case 0xE:
+            unpack_func = sign ? &VectorInterface::UNPACK_V4_8<true> : &VectorInterface::UNPACK_V4_8<false>;
+            break;
+        case 0xF:
+            unpack_func = &VectorInterface::UNPACK_V4_5;
+            break;
+        default:
+            unpack_func = &VectorInterface::UNPACK_invalid;
+            break;
     }
 }
 
@@ -518,7 +517,6 @@ bool VectorInterface::is_filling_write()
 
 void VectorInterface::handle_UNPACK(uint32_t value)
 {
-    int bufferpos = 0;
     buffer[buffer_size] = value;
     buffer_size++;
 
@@ -527,304 +525,305 @@ void VectorInterface::handle_UNPACK(uint32_t value)
         uint128_t quad;
         if (unpack.blocks_written < CYCLE.CL)
         {
-            switch (unpack.cmd)
-            {
-                case 0x0:
-                    //S-32
-                    for (int i = 0; i < 4; i++)
-                        quad._u32[i] = buffer[0];
-                    buffer_size -= 1;
-                    break;
-                case 0x1:
-                    //S-16
-                    for (int i = 0; i < 4; i++)
-                    {
-                        if (unpack.sign_extend)
-                        {
-                            quad._u32[i] = (int32_t)(int16_t)(unpack.offset ? (buffer[0] >> 16) : buffer[0]);
-                        }
-                        else
-                        {
-                            quad._u32[i] = (uint16_t)(unpack.offset ? (buffer[0] >> 16) : buffer[0]);
-                        }
-                    }
+            if (!(this->*unpack_func)(quad))
+                return;
+        }
+        else //Filling Write
+        {
+            quad._u64[0] = 0;
+            quad._u64[1] = 0;
+        }
 
-                    if (unpack.offset++)
-                    {
-                        unpack.offset = 0;
-                        buffer_size -= 1;
-                    }
-                    break;
-                case 0x2:
-                    //S-8
-                    for (int i = 0; i < 4; i++)
-                    {
-                        if (unpack.sign_extend)
-                        {
-                            quad._u32[i] = (int32_t)(int8_t)(unpack.offset ? (buffer[0] >> (unpack.offset * 8)) : buffer[0]);
-                        }
-                        else
-                        {
-                            quad._u32[i] = (uint8_t)(unpack.offset ? (buffer[0] >> (unpack.offset * 8)) : buffer[0]);
-                        }
-                    }
+        process_UNPACK_quad(quad);
+    }
+    if (unpack.num == 0)
+        command = 0;
+}
 
-                    if (unpack.offset++ == 3)
-                    {
-                        unpack.offset = 0;
-                        buffer_size -= 1;
-                    }
-                    break;
-                case 0x4:
-                    //V2-32 - Z and W are "indeterminate"
-                    //Indeterminate data is the x vector and 0 respectively
-                    quad._u32[0] = buffer[0];
-                    quad._u32[1] = buffer[1];
-                    quad._u32[2] = buffer[0];
-                    quad._u32[3] = buffer[1];
-
-                    buffer_size -= 2;
-                    break;
-                case 0x5:
-                    //V2-16 - Z and W are "indeterminate"
-                    //Indeterminate data is just the x and y vectors respectively
-                    {
-                        uint16_t x = buffer[0] & 0xFFFF;
-                        uint16_t y = buffer[0] >> 16;
-                        if (unpack.sign_extend)
-                        {
-                            quad._u32[0] = (int32_t)(int16_t)x;
-                            quad._u32[1] = (int32_t)(int16_t)y;
-                            quad._u32[2] = (int32_t)(int16_t)x;
-                            quad._u32[3] = (int32_t)(int16_t)y;
-                        }
-                        else
-                        {
-                            quad._u32[0] = x;
-                            quad._u32[1] = y;
-                            quad._u32[2] = x;
-                            quad._u32[3] = y;
-                        }
-
-                        buffer_size -= 1;
-                    }
-                    break;
-                case 0x6:
-                    //V2-8 - Z and W are "indeterminate"
-                    //Indeterminate data is just the x and y vectors respectively
-                    {
-                        uint8_t x = (buffer[0] >> (unpack.offset * 16)) & 0xFF;
-                        uint8_t y = (buffer[0] >> ((unpack.offset * 16) + 8));
-                        if (unpack.sign_extend)
-                        {
-                            quad._u32[0] = (int32_t)(int8_t)x;
-                            quad._u32[1] = (int32_t)(int8_t)y;
-                            quad._u32[2] = (int32_t)(int8_t)x;
-                            quad._u32[3] = (int32_t)(int8_t)y;
-                        }
-                        else
-                        {
-                            quad._u32[0] = x;
-                            quad._u32[1] = y;
-                            quad._u32[2] = x;
-                            quad._u32[3] = y;
-                        }
-
-                        if (unpack.offset++)
-                        {
-                            unpack.offset = 0;
-                            buffer_size -= 1;
-                        }
-                    }
-                    break;
-                case 0x8:
-                    //V3-32 - W is "indeterminate"
-                    //Indeterminate data is the first vector of the next num
-                    //The first num uses 0, the last num uses the next VIFCode
-                    //We can't read the next VIFCode so we will just use 0
-                    if (buffer_size < 4 && unpack.num > 1 && unpack.offset > 0)
-                        return;
+//Widens the low four 16-bit or 8-bit values of a register to 32 bits
+template <bool sign_extend>
+static inline __m128i extend_16(__m128i value)
+{
+    if (sign_extend)
+        return _mm_srai_epi32(_mm_unpacklo_epi16(value, value), 16);
+    return _mm_unpacklo_epi16(value, _mm_setzero_si128());
+}
 
-                    for (int i = 0; i < 3; i++)
-                        quad._u32[i] = buffer[i];
+template <bool sign_extend>
+static inline __m128i extend_8(__m128i value)
+{
+    if (sign_extend)
+    {
+        value = _mm_unpacklo_epi8(value, value);
+        return _mm_srai_epi32(_mm_unpacklo_epi16(value, value), 24);
+    }
+    value = _mm_unpacklo_epi8(value, _mm_setzero_si128());
+    return _mm_unpacklo_epi16(value, _mm_setzero_si128());
+}
 
-                    if (buffer_size >= 4)
-                    {
-                        quad._u32[3] = buffer[3];
-                        buffer[0] = buffer[3];
-                    }
-                    else
-                        quad._u32[3] = 0;
+bool VectorInterface::UNPACK_S32(uint128_t& quad)
+{
+    _mm_storeu_si128((__m128i*)&quad, _mm_set1_epi32(buffer[0]));
+    buffer_size -= 1;
+    return true;
+}
 
-                    buffer_size -= 3;
-                    unpack.offset++;
-                    break;
-                case 0x9:
-                    //V3-16 - W is "indeterminate"
-                    //Indeterminate data is the first vector of the next num
-                    //If the data is aligned to the word write 0
-                    //FIXME: It could be the first vector of the next unpack
-                    for (int i = 0; i < 3; i++)
-                    {
-                        if (unpack.sign_extend)
-                        {
-                            quad._u32[i] = (int32_t)(int16_t)(unpack.offset ? (buffer[bufferpos] >> 16) : buffer[bufferpos]);
-                        }
-                        else
-                        {
-                            quad._u32[i] = (uint16_t)(unpack.offset ? (buffer[bufferpos] >> 16) : buffer[bufferpos]);
-                        }
-
-                        if (unpack.offset++)
-                        {
-                            unpack.offset = 0;
-                            bufferpos++;
-                            buffer_size -= 1;
-                        }
-                    }
+template <bool sign_extend>
+bool VectorInterface::UNPACK_S16(uint128_t& quad)
+{
+    uint32_t value = unpack.offset ? (buffer[0] >> 16) : buffer[0];
+    if (sign_extend)
+        value = (int32_t)(int16_t)value;
+    else
+        value = (uint16_t)value;
+    _mm_storeu_si128((__m128i*)&quad, _mm_set1_epi32(value));
 
-                    if (buffer_size >= 1)
-                    {
-                        if (unpack.sign_extend)
-                        {
-                            quad._u32[3] = (int32_t)(int16_t)(unpack.offset ? (buffer[bufferpos] >> 16) : buffer[bufferpos]);
-                        }
-                        else
-                        {
-                            quad._u32[3] = (uint16_t)(unpack.offset ? (buffer[bufferpos] >> 16) : buffer[bufferpos]);
-                        }
-                    }
-                    else
-                    {
-                        quad._u32[3] = 0;
-                    }
+    if (unpack.offset++)
+    {
+        unpack.offset = 0;
+        buffer_size -= 1;
+    }
+    return true;
+}
 
-                    if (buffer_size < 2 && unpack.offset)
-                    {
-                        buffer[0] = buffer[bufferpos];
-                    }
-                    break;
-                case 0xA:
-                    //V3-8 - W is "indeterminate"
-                    //Indeterminate data is the first vector of the next num
-                    //If the data is aligned to the word write 0
-                    //FIXME: It could be the first vector of the next unpack
-
-                    //Check we have enough data before continuing
-                    if ((buffer_size * 4) - unpack.offset < 3)
-                        return;
+template <bool sign_extend>
+bool VectorInterface::UNPACK_S8(uint128_t& quad)
+{
+    uint32_t value = buffer[0] >> (unpack.offset * 8);
+    if (sign_extend)
+        value = (int32_t)(int8_t)value;
+    else
+        value = (uint8_t)value;
+    _mm_storeu_si128((__m128i*)&quad, _mm_set1_epi32(value));
 
-                    for (int i = 0; i < 3; i++)
-                    {
-                        if (unpack.sign_extend)
-                        {
-                            quad._u32[i] = (int32_t)(int8_t)(unpack.offset ? (buffer[bufferpos] >> (unpack.offset * 8)) : buffer[bufferpos]);
-                        }
-                        else
-                        {
-                            quad._u32[i] = (uint8_t)(unpack.offset ? (buffer[bufferpos] >> (unpack.offset * 8)) : buffer[bufferpos]);
-                        }
-
-                        if (unpack.offset++ == 3)
-                        {
-                            unpack.offset = 0;
-                            bufferpos++;
-                            buffer_size -= 1;
-                        }
-                    }
+    if (unpack.offset++ == 3)
+    {
+        unpack.offset = 0;
+        buffer_size -= 1;
+    }
+    return true;
+}
 
-                    if (buffer_size >= 1)
-                    {
-                        if (unpack.sign_extend)
-                        {
-                            quad._u32[3] = (int32_t)(int8_t)(unpack.offset ? (buffer[bufferpos] >> ((unpack.offset) * 8)) : buffer[bufferpos]);
-                        }
-                        else
-                        {
-                            quad._u32[3] = (uint8_t)(unpack.offset ? (buffer[bufferpos] >> (unpack.offset * 8)) : buffer[bufferpos]);
-                        }
-                    }
-                    else
-                    {
-                        quad._u32[3] = 0;
-                    }
+//V2 - Z and W are "indeterminate"
+//Indeterminate data is just the x and y vectors respectively
+bool VectorInterface::UNPACK_V2_32(uint128_t& quad)
+{
+    __m128i xy = _mm_loadl_epi64((__m128i*)buffer);
+    _mm_storeu_si128((__m128i*)&quad, _mm_unpacklo_epi64(xy, xy));
+    buffer_size -= 2;
+    return true;
+}
 
-                    if (buffer_size == 1 && unpack.offset)
-                    {
-                        buffer[0] = buffer[bufferpos];
-                    }
-                    break;
-                case 0xC:
-                    //V4-32
-                    for (int i = 0; i < 4; i++)
-                        quad._u32[i] = buffer[i];
-                    buffer_size -= 4;
-                    break;
-                case 0xD:
-                    //V4-16
-                    for (int i = 0; i < 4; i++)
-                    {
-                        uint16_t value = (buffer[i / 2] >> ((i % 2) * 16)) & 0xFFFF;
-                        if (unpack.sign_extend)
-                            quad._u32[i] = (int32_t)(int16_t)value;
-                        else
-                            quad._u32[i] = value;
-                    }
+template <bool sign_extend>
+bool VectorInterface::UNPACK_V2_16(uint128_t& quad)
+{
+    __m128i xy = extend_16<sign_extend>(_mm_cvtsi32_si128(buffer[0]));
+    _mm_storeu_si128((__m128i*)&quad, _mm_unpacklo_epi64(xy, xy));
+    buffer_size -= 1;
+    return true;
+}
 
-                    buffer_size -= 2;
-                    break;
-                case 0xE:
-                    //V4-8
-                    for (int i = 0; i < 4; i++)
-                    {
-                        uint8_t value = (buffer[0] >> (i * 8)) & 0xFF;
-                        if (unpack.sign_extend)
-                            quad._u32[i] = (int32_t)(int8_t)value;
-                        else
-                            quad._u32[i] = value;
-                    }
+template <bool sign_extend>
+bool VectorInterface::UNPACK_V2_8(uint128_t& quad)
+{
+    __m128i xy = extend_8<sign_extend>(_mm_cvtsi32_si128((buffer[0] >> (unpack.offset * 16)) & 0xFFFF));
+    _mm_storeu_si128((__m128i*)&quad, _mm_unpacklo_epi64(xy, xy));
 
-                    buffer_size -= 1;
-                    break;
-                case 0xF:
-                    //V4-5
-                    {
-                        uint16_t data = (buffer[0] >> (unpack.offset * 16)) & 0xFFFF;
-                        quad._u32[0] = (data & 0x1F) << 3;
-                        quad._u32[1] = ((data >> 5) & 0x1F) << 3;
-                        quad._u32[2] = ((data >> 10) & 0x1F) << 3;
-                        quad._u32[3] = ((data >> 15) & 0x1) << 7;
-
-                        if (unpack.offset++)
-                        {
-                            unpack.offset = 0;
-                            buffer_size -= 1;
-                        }
-                    }
-                    break;
-                default:
-                    Errors::die("[VIF] Unhandled UNPACK cmd $%02X!\n", unpack.cmd);
-            }
+    if (unpack.offset++)
+    {
+        unpack.offset = 0;
+        buffer_size -= 1;
+    }
+    return true;
+}
+
+//V3 - W is "indeterminate"
+//Indeterminate data is the first vector of the next num
+//The first num uses 0, the last num uses the next VIFCode
+//We can't read the next VIFCode so we will just use 0
+bool VectorInterface::UNPACK_V3_32(uint128_t& quad)
+{
+    if (buffer_size < 4 && unpack.num > 1 && unpack.offset > 0)
+        return false;
+
+    for (int i = 0; i < 3; i++)
+        quad._u32[i] = buffer[i];
+
+    if (buffer_size >= 4)
+    {
+        quad._u32[3] = buffer[3];
+        buffer[0] = buffer[3];
+    }
+    else
+        quad._u32[3] = 0;
+
+    buffer_size -= 3;
+    unpack.offset++;
+    return true;
+}
+
+//If the data is aligned to the word write 0
+//FIXME: It could be the first vector of the next unpack
+template <bool sign_extend>
+bool VectorInterface::UNPACK_V3_16(uint128_t& quad)
+{
+    int bufferpos = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        if (sign_extend)
+            quad._u32[i] = (int32_t)(int16_t)(unpack.offset ? (buffer[bufferpos] >> 16) : buffer[bufferpos]);
+        else
+            quad._u32[i] = (uint16_t)(unpack.offset ? (buffer[bufferpos] >> 16) : buffer[bufferpos]);
+
+        if (unpack.offset++)
+        {
+            unpack.offset = 0;
+            bufferpos++;
+            buffer_size -= 1;
         }
-        else //Filling Write
+    }
+
+    if (buffer_size >= 1)
+    {
+        if (sign_extend)
+            quad._u32[3] = (int32_t)(int16_t)(unpack.offset ? (buffer[bufferpos] >> 16) : buffer[bufferpos]);
+        else
+            quad._u32[3] = (uint16_t)(unpack.offset ? (buffer[bufferpos] >> 16) : buffer[bufferpos]);
+    }
+    else
+        quad._u32[3] = 0;
+
+    if (buffer_size < 2 && unpack.offset)
+        buffer[0] = buffer[bufferpos];
+    return true;
+}
+
+template <bool sign_extend>
+bool VectorInterface::UNPACK_V3_8(uint128_t& quad)
+{
+    //Check we have enough data before continuing
+    if ((buffer_size * 4) - unpack.offset < 3)
+        return false;
+
+    int bufferpos = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        if (sign_extend)
+            quad._u32[i] = (int32_t)(int8_t)(buffer[bufferpos] >> (unpack.offset * 8));
+        else
+            quad._u32[i] = (uint8_t)(buffer[bufferpos] >> (unpack.offset * 8));
+
+        if (unpack.offset++ == 3)
         {
-            quad._u64[0] = 0;
-            quad._u64[1] = 0;
+            unpack.offset = 0;
+            bufferpos++;
+            buffer_size -= 1;
         }
+    }
 
-        process_UNPACK_quad(quad);
+    if (buffer_size >= 1)
+    {
+        if (sign_extend)
+            quad._u32[3] = (int32_t)(int8_t)(buffer[bufferpos] >> (unpack.offset * 8));
+        else
+            quad._u32[3] = (uint8_t)(buffer[bufferpos] >> (unpack.offset * 8));
     }
-    if (unpack.num == 0)
-        command = 0;
+    else
+        quad._u32[3] = 0;
+
+    if (buffer_size == 1 && unpack.offset)
+        buffer[0] = buffer[bufferpos];
+    return true;
+}
+
+bool VectorInterface::UNPACK_V4_32(uint128_t& quad)
+{
+    _mm_storeu_si128((__m128i*)&quad, _mm_loadu_si128((__m128i*)buffer));
+    buffer_size -= 4;
+    return true;
+}
+
+template <bool sign_extend>
+bool VectorInterface::UNPACK_V4_16(uint128_t& quad)
+{
+    _mm_storeu_si128((__m128i*)&quad, extend_16<sign_extend>(_mm_loadl_epi64((__m128i*)buffer)));
+    buffer_size -= 2;
+    return true;
+}
+
+template <bool sign_extend>
+bool VectorInterface::UNPACK_V4_8(uint128_t& quad)
+{
+    _mm_storeu_si128((__m128i*)&quad, extend_8<sign_extend>(_mm_cvtsi32_si128(buffer[0])));
+    buffer_size -= 1;
+    return true;
+}
+
+bool VectorInterface::UNPACK_V4_5(uint128_t& quad)
+{
+    uint16_t data = (buffer[0] >> (unpack.offset * 16)) & 0xFFFF;
+    quad._u32[0] = (data & 0x1F) << 3;
+    quad._u32[1] = ((data >> 5) & 0x1F) << 3;
+    quad._u32[2] = ((data >> 10) & 0x1F) << 3;
+    quad._u32[3] = ((data >> 15) & 0x1) << 7;
+
+    if (unpack.offset++)
+    {
+        unpack.offset = 0;
+        buffer_size -= 1;
+    }
+    return true;
+}
+
+bool VectorInterface::UNPACK_invalid(uint128_t&)
+{
+    Errors::die("[VIF] Unhandled UNPACK cmd $%02X!\n", unpack.cmd);
+    return false;
+}
+
+//Picks a from the fields set in mask and b from the rest
+static inline __m128i select_fields(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
 }
 
 void VectorInterface::process_UNPACK_quad(uint128_t &quad)
 {
-    handle_UNPACK_masking(quad);
-    handle_UNPACK_mode(quad);
+    int row_index = std::min(unpack.blocks_written, 3);
+    const UNPACK_Masks& masks = unpack_masks[row_index];
+    __m128i data = _mm_loadu_si128((__m128i*)&quad);
+    __m128i row = _mm_loadu_si128((__m128i*)ROW);
+    __m128i data_mask = _mm_loadu_si128((__m128i*)&masks.data);
+
+    if (unpack.masked || is_filling_write())
+    {
+        uint128_t old_quad = vu->read_data<uint128_t>(unpack.addr);
+        __m128i col = _mm_set1_epi32(COL[row_index]);
+        __m128i old = _mm_loadu_si128((__m128i*)&old_quad);
+
+        data = _mm_and_si128(data, data_mask);
+        data = _mm_or_si128(data, _mm_and_si128(row, _mm_loadu_si128((__m128i*)&masks.row)));
+        data = _mm_or_si128(data, _mm_and_si128(col, _mm_loadu_si128((__m128i*)&masks.col)));
+        data = _mm_or_si128(data, _mm_and_si128(old, _mm_loadu_si128((__m128i*)&masks.protect)));
+    }
+
+    //Do not apply addition decompression when the format is V4-5
+    if (MODE && unpack.cmd != 0xF)
+    {
+        //With masking on, only fields taken from the data are affected
+        __m128i fields = unpack.masked ? data_mask : _mm_set1_epi32(-1);
+
+        //Offset mode - VU Mem = Input + Row
+        //Difference mode - VU Mem = Row = Input + Row
+        if (MODE != 3)
+            data = select_fields(fields, _mm_add_epi32(data, row), data);
+        if (MODE >= 2)
+            _mm_storeu_si128((__m128i*)ROW, select_fields(fields, data, row));
+    }
 
     unpack.blocks_written++;
 
+    _mm_storeu_si128((__m128i*)&quad, data);
     //printf("[VIF] Write data mem $%08X: $%08X_%08X_%08X_%08X\n", unpack.addr,
     //quad._u32[3], quad._u32[2], quad._u32[1], quad._u32[0]);
     vu->write_data<uint128_t>(unpack.addr, quad);
@@ -35,6 +35,12 @@ struct UNPACK_Command
     int words_per_op; //e.g. - V4-32 has four words per op
 };
 
+//Which fields of a written quad come from the data, ROW, COL or are write protected, for one row of MASK
+struct UNPACK_Masks
+{
+    uint128_t data, row, col, protect;
+};
+
 struct CYCLE_REG
 {
     uint8_t CL, WL;
@@ -59,6 +65,10 @@ class VectorInterface
         MPG_Command mpg;
         UNPACK_Command unpack;
 
+        //Picked once per UNPACK from its format and sign extension. Host state, so it's rebuilt on load rather than saved.
+        bool (VectorInterface::*unpack_func)(uint128_t& quad);
+        UNPACK_Masks unpack_masks[4];
+
         bool vif_ibit_detected;
         uint8_t vif_stalled;
         bool vif_interrupt;
@@ -94,17 +104,33 @@ class VectorInterface
         void handle_wait_cmd(uint32_t value);
         void MSCAL(uint32_t addr);
         void init_UNPACK(uint32_t value);
+        void setup_UNPACK();
         bool is_filling_write();
         void handle_UNPACK(uint32_t value);
-        void handle_UNPACK_masking(uint128_t& quad);
-        void handle_UNPACK_mode(uint128_t& quad);
         void process_UNPACK_quad(uint128_t& quad);
+
+        //Each of these decodes one vector from the buffer, returning false if it needs more data first
+        bool UNPACK_S32(uint128_t& quad);
+        template <bool sign_extend> bool UNPACK_S16(uint128_t& quad);
+        template <bool sign_extend> bool UNPACK_S8(uint128_t& quad);
+        bool UNPACK_V2_32(uint128_t& quad);
+        template <bool sign_extend> bool UNPACK_V2_16(uint128_t& quad);
+        template <bool sign_extend> bool UNPACK_V2_8(uint128_t& quad);
+        bool UNPACK_V3_32(uint128_t& quad);
+        template <bool sign_extend> bool UNPACK_V3_16(uint128_t& quad);
+        template <bool sign_extend> bool UNPACK_V3_8(uint128_t& quad);
+        bool UNPACK_V4_32(uint128_t& quad);
+        template <bool sign_extend> bool UNPACK_V4_16(uint128_t& quad);
+        template <bool sign_extend> bool UNPACK_V4_8(uint128_t& quad);
+        bool UNPACK_V4_5(uint128_t& quad);
+        bool UNPACK_invalid(uint128_t& quad);
     public:
         VectorInterface(GraphicsInterface* gif, VectorUnit* vu, INTC* intc, int id);
         int get_id();
 
         void reset();
         void update(int cycles);
+        bool is_idle();
 
         bool transfer_DMAtag(uint128_t tag);
         bool feed_DMA(uint128_t quad);
@@ -131,4 +157,16 @@ inline int VectorInterface::get_id()
 {
     return id;
 }
+
+//True when update() would return without doing anything
+inline bool VectorInterface::is_idle()
+{
+    if (fifo_reverse || (vif_stalled & STALL_MSKPATH3))
+        return false;
+    if (vif_stalled)
+        return true;
+    if (FIFO.size() || wait_for_VU || flush_stall || wait_for_PATH3)
+        return false;
+    return command != 0 || (!vif_ibit_detected && !vif_stop);
+}
 #endif // VIF_HPP
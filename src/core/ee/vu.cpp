@@ -5,6 +5,9 @@
 #include <fstream>
 #include <iomanip>
 #include <algorithm>
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
 #include "vu.hpp"
 #include "vu_interpreter.hpp"
 #include "vu_jit.hpp"
@@ -166,6 +169,7 @@ void VectorUnit::reset()
     running = false;
     tbit_stop = false;
     vumem_is_dirty = true; //assume we don't know the contents on reset
+    dirty_instr_pages = ~0ULL;
     finish_on = false;
     branch_on = false;
     second_branch_pending = false;
@@ -480,6 +484,9 @@ void VectorUnit::correct_jit_pipeline(int cycles)
 void VectorUnit::run_jit(int cycles)
 {
     int stalled_cycles = 0;
+    if (running && !id)
+        eecpu->set_cop2_last_cycle(eecpu->get_cycle_count());
+
     if (cycles > 0)
     {
         cycle_count += cycles;
@@ -503,6 +510,14 @@ void VectorUnit::run_jit(int cycles)
 
         while (running && !XGKICK_stall && run_event < cycle_count)
         {
+            //Same as the interpreter, but the M-Bit interlock is only checked between blocks
+            if (!id && is_interlocked())
+            {
+                if (check_interlock() && mbit_wait++ < 3)
+                    break;
+                mbit_wait = 0;
+                clear_interlock();
+            }
             run_event += VU_JIT::run(this);
 
             /*if (PC > 0x1200 && PC < 0x1500)
@@ -728,10 +743,7 @@ void VectorUnit::disasm_micromem()
     uint32_t crc = crc_microprogram();
 
     //Set the current program crc to the VU JIT
-    if (get_id() == 1)
-    {
-        VU_JIT::set_current_program(crc);
-    }
+    VU_JIT::set_current_program(crc, get_id());
 
     clear_dirty();
 
@@ -802,21 +814,63 @@ void VectorUnit::disasm_micromem()
 
 #define POLY 0x82f63b78
 
-uint32_t VectorUnit::crc_microprogram()
+#ifndef __SSE4_2__
+struct CRC32CTable
 {
-    uint32_t crc = 0;
-    int len = (get_id()) ? 0x4000 : 0x1000;
-    int addr = 0x0000;
+    uint32_t t[256];
 
-    crc = ~crc;
-    while (len--) {
-        crc ^= read_instr<uint8_t>(addr++);
-        for (int k = 0; k < 8; k++)
-            crc = crc & 1 ? (crc >> 1) ^ POLY : crc >> 1;
+    CRC32CTable()
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            uint32_t crc = i;
+            for (int k = 0; k < 8; k++)
+                crc = crc & 1 ? (crc >> 1) ^ POLY : crc >> 1;
+            t[i] = crc;
+        }
     }
+};
+#endif
+
+//CRC-32C, using the SSE4.2 instructions when the build allows for them
+static uint32_t crc32c(const uint8_t* data, size_t len)
+{
+    uint32_t crc = ~0U;
+#ifdef __SSE4_2__
+    for (; len >= 8; len -= 8, data += 8)
+        crc = (uint32_t)_mm_crc32_u64(crc, *(uint64_t*)data);
+    for (; len; len--, data++)
+        crc = _mm_crc32_u8(crc, *data);
+#else
+    static const CRC32CTable table;
+    for (; len; len--, data++)
+        crc = table.t[(crc ^ *data) & 0xFF] ^ (crc >> 8);
+#endif
     return ~crc;
 }
 
+//The CRC of the program is taken over the CRCs of each page.
+//The JIT keys blocks by the pages they cover instead, through get_instr_range_key.
+uint32_t VectorUnit::crc_microprogram()
+{
+    int pages = (mem_mask + 1) / INSTR_PAGE_SIZE;
+    for (int i = 0; i < pages; i++)
+    {
+        if (dirty_instr_pages & (1ULL << i))
+            instr_page_crcs[i] = crc32c(&instr_mem.m[i * INSTR_PAGE_SIZE], INSTR_PAGE_SIZE);
+    }
+    dirty_instr_pages = 0;
+
+    instr_page_keys[0] = 0;
+    for (int i = 0; i < pages; i++)
+    {
+        uint32_t hash = (instr_page_crcs[i] ^ (i * 0x9E3779B1)) * 0x85EBCA6B;
+        instr_page_keys[i + 1] = instr_page_keys[i] ^ hash ^ (hash >> 16);
+    }
+
+    return crc32c((uint8_t*)instr_page_crcs, pages * sizeof(uint32_t));
+}
+
 void VectorUnit::start_program(uint32_t addr)
 {
     uint32_t new_addr = addr & mem_mask;
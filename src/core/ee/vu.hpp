@@ -105,6 +105,16 @@ class VectorUnit
 
         std::unordered_set<uint32_t> seen_microprogram_crcs;
 
+        //Instruction memory is hashed a page at a time, so that only the pages written to since
+        //the last CRC need to be hashed again
+        constexpr static int INSTR_PAGE_SIZE = 256;
+        uint32_t instr_page_crcs[1024 * 16 / INSTR_PAGE_SIZE];
+        uint64_t dirty_instr_pages;
+
+        //Running XOR of a hash of each page's CRC, entry i covering the pages before page i,
+        //so that the key of any range of pages takes two lookups
+        uint32_t instr_page_keys[1024 * 16 / INSTR_PAGE_SIZE + 1];
+
         bool running;
         bool tbit_stop;
         bool vumem_is_dirty;
@@ -219,9 +229,11 @@ class VectorUnit
         template <typename T> void write_data(uint32_t addr, T data);
 
         bool is_running();
+        bool is_active();
         bool stopped_by_tbit();
         bool is_dirty();
         void clear_dirty();
+        uint32_t get_instr_range_key(uint32_t start, uint32_t end);
         uint16_t get_PC();
         void set_PC(uint32_t newPC);
         uint32_t get_gpr_u(int index, int field);
@@ -377,6 +389,7 @@ class VectorUnit
 
         friend void vu_update_xgkick(VectorUnit& vu, int cycles);
         friend void vu_update_pipelines(VectorUnit& vu, int cycles);
+        friend void vu_check_interlock(VectorUnit& vu);
         friend uint8_t* exec_block(VU_JIT64& jit, VectorUnit& vu);
 };
 
@@ -396,6 +409,7 @@ template <typename T>
 inline void VectorUnit::write_instr(uint32_t addr, T data)
 {
     *(T*)&instr_mem.m[addr & mem_mask] = data;
+    dirty_instr_pages |= 1ULL << ((addr & mem_mask) / INSTR_PAGE_SIZE);
     vumem_is_dirty = true;
 }
 
@@ -410,11 +424,33 @@ inline bool VectorUnit::is_running()
     return running;
 }
 
+//Whether the interpreter's run() has any work to do, either executing or finishing an XGKICK
+inline bool VectorUnit::is_active()
+{
+    return running || transferring_GIF;
+}
+
 inline bool VectorUnit::stopped_by_tbit()
 {
     return tbit_stop;
 }
 
+//Key for the instructions from start to end, which changes whenever one of the pages they are in does.
+//Only valid once crc_microprogram has run. An end past the instruction memory means up to the end of it.
+inline uint32_t VectorUnit::get_instr_range_key(uint32_t start, uint32_t end)
+{
+    int pages = (mem_mask + 1) / INSTR_PAGE_SIZE;
+    int first = (start & mem_mask) / INSTR_PAGE_SIZE;
+    int last = end / INSTR_PAGE_SIZE;
+    if (last >= pages || last < first)
+        last = pages - 1;
+
+    uint32_t key = instr_page_keys[last + 1] ^ instr_page_keys[first] ^ (((first << 8) | last) * 0x9E3779B1);
+
+    //0 is kept for blocks that aren't keyed by their contents
+    return key ? key : 1;
+}
+
 inline bool VectorUnit::is_dirty()
 {
     return vumem_is_dirty;
@@ -0,0 +1,163 @@
+#include <cstdio>
+#include "vu_ircache.hpp"
+
+VU_IRCache::VU_IRCache(const std::string& file_name) : file_name(file_name)
+{
+    file_size = 0;
+    loaded = false;
+}
+
+VU_IRCache::~VU_IRCache()
+{
+    flush();
+}
+
+std::string VU_IRCache::get_path()
+{
+    char last = directory.back();
+    if (last == '/' || last == '\\')
+        return directory + file_name;
+    return directory + "/" + file_name;
+}
+
+//Blocks found so far are dropped, and the file in the new directory is loaded on the next lookup
+void VU_IRCache::set_directory(const std::string& directory)
+{
+    if (directory == this->directory)
+        return;
+
+    if (file.is_open())
+        file.close();
+    blocks.clear();
+    file_size = 0;
+    loaded = false;
+    this->directory = directory;
+}
+
+//Appends are only buffered, so this is called when the JIT is reset and when the cache is destroyed
+void VU_IRCache::flush()
+{
+    if (file.is_open())
+        file.flush();
+}
+
+//Loading is put off until the first lookup, as the cache is created along with the JIT at startup
+void VU_IRCache::load()
+{
+    loaded = true;
+    if (directory.empty())
+        return;
+
+    std::string path = get_path();
+    bool valid = false;
+    uint64_t size = 0;
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (in.is_open())
+    {
+        size = in.tellg();
+        in.seekg(0, std::ios::beg);
+
+        uint32_t magic = 0, version = 0, instr_size = 0;
+        in.read((char*)&magic, sizeof(magic));
+        in.read((char*)&version, sizeof(version));
+        in.read((char*)&instr_size, sizeof(instr_size));
+        valid = in.good() && magic == MAGIC && version == VERSION && instr_size == sizeof(IR::Instruction);
+
+        //A full cache is started over rather than read, so that it keeps the programs that are in use now
+        if (size >= MAX_FILE_SIZE)
+            valid = false;
+
+        while (valid && in.peek() != EOF)
+        {
+            BlockState state;
+            in.read((char*)&state.pc, sizeof(state.pc));
+            in.read((char*)&state.prev_pc, sizeof(state.prev_pc));
+            in.read((char*)&state.program, sizeof(state.program));
+            in.read((char*)&state.param1, sizeof(state.param1));
+            in.read((char*)&state.param2, sizeof(state.param2));
+
+            CachedBlock cached;
+            in.read((char*)&cached.end_pc, sizeof(cached.end_pc));
+            if (!in.good() || !cached.block.load(in))
+            {
+                //Most likely the emulator was closed partway through writing a block
+                valid = false;
+                break;
+            }
+            blocks.insert({state, cached});
+        }
+        in.close();
+        printf("[VU_IRCache] Loaded %d blocks from %s\n", (int)blocks.size(), path.c_str());
+    }
+
+    if (valid)
+    {
+        file.open(path, std::ios::binary | std::ios::app);
+        file_size = size;
+        return;
+    }
+
+    //Start over, keeping whatever could be read
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        printf("[VU_IRCache] Can't write %s, blocks will only be kept in memory\n", path.c_str());
+        return;
+    }
+    file_size = 0;
+    write_header();
+    for (auto it = blocks.begin(); it != blocks.end(); ++it)
+        write_block(it->first, it->second);
+}
+
+void VU_IRCache::write_header()
+{
+    uint32_t magic = MAGIC, version = VERSION, instr_size = sizeof(IR::Instruction);
+    file.write((char*)&magic, sizeof(magic));
+    file.write((char*)&version, sizeof(version));
+    file.write((char*)&instr_size, sizeof(instr_size));
+    file_size += sizeof(magic) + sizeof(version) + sizeof(instr_size);
+}
+
+void VU_IRCache::write_block(const BlockState& state, CachedBlock& cached)
+{
+    file.write((char*)&state.pc, sizeof(state.pc));
+    file.write((char*)&state.prev_pc, sizeof(state.prev_pc));
+    file.write((char*)&state.program, sizeof(state.program));
+    file.write((char*)&state.param1, sizeof(state.param1));
+    file.write((char*)&state.param2, sizeof(state.param2));
+    file.write((char*)&cached.end_pc, sizeof(cached.end_pc));
+    cached.block.save(file);
+
+    //Block::save writes the cycle count and the instruction count ahead of the instructions
+    file_size += sizeof(state.pc) + sizeof(state.prev_pc) + sizeof(state.program) + sizeof(state.param1) +
+                 sizeof(state.param2) + sizeof(cached.end_pc) + sizeof(int) + sizeof(uint32_t) +
+                 cached.block.get_instruction_count() * sizeof(IR::Instruction);
+}
+
+bool VU_IRCache::find_block(const BlockState& state, IR::Block& block, uint16_t& end_pc)
+{
+    if (!loaded)
+        load();
+
+    auto search = blocks.find(state);
+    if (search == blocks.end())
+        return false;
+    block = search->second.block;
+    end_pc = search->second.end_pc;
+    return true;
+}
+
+void VU_IRCache::add_block(const BlockState& state, IR::Block& block, uint16_t end_pc)
+{
+    if (!loaded)
+        load();
+
+    auto inserted = blocks.insert({state, {block, end_pc}});
+    if (!inserted.second)
+        return;
+
+    //A block cut off by a crash is dropped when the file is next loaded
+    if (file.is_open() && file_size < MAX_FILE_SIZE)
+        write_block(state, inserted.first->second);
+}
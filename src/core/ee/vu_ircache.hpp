@@ -0,0 +1,54 @@
+#ifndef VU_IRCACHE_HPP
+#define VU_IRCACHE_HPP
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include "../jitcommon/ir_block.hpp"
+#include "../jitcommon/jitcache.hpp"
+
+//Translated VU blocks, kept on disk so that microprograms seen in earlier sessions don't need to be
+//translated again. Blocks are keyed like in the JIT cache, except that the program key covers everything
+//from the block's start to the end of instruction memory, as it's needed before the block's end is known.
+//Host code embeds addresses of the running emulator, so the IR is what gets stored, along with where it ends.
+//The file lives in the cache directory set by the frontend; without one, blocks are only kept in memory.
+class VU_IRCache
+{
+    private:
+        constexpr static uint32_t MAGIC = 0x52495556; //"VUIR"
+
+        //Bump whenever VU_JitTranslator or the IR change what a microprogram translates to,
+        //or when microprogram CRCs are calculated differently
+        constexpr static uint32_t VERSION = 6;
+
+        //Once the file reaches this size no more blocks are appended, and the next session starts it over
+        constexpr static uint64_t MAX_FILE_SIZE = 64 * 1024 * 1024;
+
+        std::string file_name;
+        std::string directory;
+        struct CachedBlock
+        {
+            IR::Block block;
+            uint16_t end_pc;
+        };
+
+        std::unordered_map<BlockState, CachedBlock, BlockStateHash> blocks;
+        std::ofstream file;
+        uint64_t file_size;
+        bool loaded;
+
+        std::string get_path();
+        void load();
+        void write_header();
+        void write_block(const BlockState& state, CachedBlock& block);
+    public:
+        VU_IRCache(const std::string& file_name);
+        ~VU_IRCache();
+
+        void set_directory(const std::string& directory);
+        void flush();
+
+        bool find_block(const BlockState& state, IR::Block& block, uint16_t& end_pc);
+        void add_block(const BlockState& state, IR::Block& block, uint16_t end_pc);
+};
+
+#endif // VU_IRCACHE_HPP
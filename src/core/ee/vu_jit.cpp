@@ -11,21 +11,35 @@
 namespace VU_JIT
 {
 
-VU_JIT64 jit64;
+//Each VU gets its own cache, as blocks are compiled against the unit's memory and registers
+VU_JIT64 vu0_jit(0);
+VU_JIT64 vu1_jit(1);
+
+static VU_JIT64& get_jit(int id)
+{
+    return (id) ? vu1_jit : vu0_jit;
+}
 
 uint16_t run(VectorUnit *vu)
 {
-    return jit64.run(*vu);
+    return get_jit(vu->get_id()).run(*vu);
 }
 
 void reset()
 {
-    jit64.reset();
+    vu0_jit.reset();
+    vu1_jit.reset();
+}
+
+void set_current_program(uint32_t crc, int id)
+{
+    get_jit(id).set_current_program(crc);
 }
 
-void set_current_program(uint32_t crc)
+void set_cache_directory(const std::string& directory)
 {
-    jit64.set_current_program(crc);
+    vu0_jit.set_cache_directory(directory);
+    vu1_jit.set_cache_directory(directory);
 }
 
 };
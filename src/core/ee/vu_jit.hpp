@@ -1,6 +1,7 @@
 #ifndef VU_JIT_HPP
 #define VU_JIT_HPP
 #include <cstdint>
+#include <string>
 
 class VectorUnit;
 
@@ -9,7 +10,8 @@ namespace VU_JIT
 
 uint16_t run(VectorUnit* vu);
 void reset();
-void set_current_program(uint32_t crc);
+void set_current_program(uint32_t crc, int id);
+void set_cache_directory(const std::string& directory);
 
 };
 
@@ -1,5 +1,7 @@
 #include <cmath>
+#include <cstring>
 #include <algorithm>
+#include <string>
 
 #include "vu_jit64.hpp"
 #include "vu_interpreter.hpp"
@@ -35,7 +37,7 @@
     extern "C" void run_vu_jit(VU_JIT64& jit, VectorUnit& vu);
 #endif
 
-VU_JIT64::VU_JIT64() : emitter(&cache)
+VU_JIT64::VU_JIT64(int id) : emitter(&cache), ir_cache("vu" + std::to_string(id) + "_ir_cache.bin")
 {
     for (int i = 0; i < 4; i++)
     {
@@ -53,6 +55,7 @@ VU_JIT64::VU_JIT64() : emitter(&cache)
         max_flt_constant.u[i] = 0x7F7FFFFF;
         min_flt_constant.u[i] = 0xFF7FFFFF;
     }
+    memset(block_end_pc, 0xFF, sizeof(block_end_pc));
 }
 
 uint8_t convert_field(uint8_t value)
@@ -81,6 +84,11 @@ void vu_tbit_stop_execution(VectorUnit& vu)
     vu.stop_by_tbit();
 }
 
+void vu_check_interlock(VectorUnit& vu)
+{
+    vu.check_interlock();
+}
+
 void vu_set_int(VectorUnit& vu, int dest, uint16_t value)
 {
     vu.set_int(dest, value);
@@ -104,11 +112,6 @@ void vu_update_pipelines(VectorUnit& vu, int cycles)
     }
 }
 
-void vu_clip(VectorUnit& vu, uint32_t imm)
-{
-    vu.clip(imm);
-}
-
 void vu_update_xgkick(VectorUnit& vu, int cycles)
 {
     if (vu.transferring_GIF)
@@ -147,11 +150,13 @@ void VU_JIT64::reset(bool clear_cache)
     {
         xmm_regs[i].used = false;
         xmm_regs[i].locked = false;
+        xmm_regs[i].pinned = false;
         xmm_regs[i].age = 0;
         xmm_regs[i].needs_clamping = false;
 
         int_regs[i].used = false;
         int_regs[i].locked = false;
+        int_regs[i].pinned = false;
         int_regs[i].age = 0;
     }
 
@@ -167,15 +172,25 @@ void VU_JIT64::reset(bool clear_cache)
     xmm_regs[REG_64::XMM1].locked = true;
 
     if(clear_cache)
+    {
         cache.flush_all_blocks();
+        ir_cache.flush();
+        memset(block_end_pc, 0xFF, sizeof(block_end_pc));
+    }
 
     ir.reset_instr_info();
 
     should_update_mac = false;
     prev_pc = 0xFFFFFFFF;
+    block_instrs = nullptr;
     current_program = 0;
 }
 
+void VU_JIT64::set_cache_directory(const std::string& directory)
+{
+    ir_cache.set_directory(directory);
+}
+
 void VU_JIT64::set_current_program(uint32_t crc)
 {
     reset(false);
@@ -395,7 +410,7 @@ void VU_JIT64::load_int(VectorUnit &vu, IR::Instruction &instr)
     else
     {
         REG_64 dest = alloc_int_reg(vu, instr.get_dest(), REG_STATE::WRITE);
-        uint16_t offset = (instr.get_source() + field_offset) & 0x3FFF;
+        uint16_t offset = (instr.get_source() + field_offset) & vu.mem_mask;
         emitter.load_addr((uint64_t)&vu.data_mem.m[offset], REG_64::R15);
         emitter.MOV16_FROM_MEM(REG_64::R15, dest);
     }
@@ -459,7 +474,7 @@ void VU_JIT64::load_quad(VectorUnit &vu, IR::Instruction &instr)
     }
     else
     {
-        uint16_t offset = instr.get_source() & 0x3FFF;
+        uint16_t offset = instr.get_source() & vu.mem_mask;
         emitter.load_addr((uint64_t)&vu.data_mem.m[offset], REG_64::R15);
     }
 
@@ -500,7 +515,7 @@ void VU_JIT64::store_quad(VectorUnit &vu, IR::Instruction &instr)
     }
     else
     {
-        uint16_t offset = instr.get_source2() & 0x3FFF;
+        uint16_t offset = instr.get_source2() & vu.mem_mask;
         emitter.load_addr((uint64_t)&vu.data_mem.m[offset], REG_64::R15);
     }
 
@@ -1736,21 +1751,53 @@ void VU_JIT64::opmsub(VectorUnit &vu, IR::Instruction &instr)
 
 void VU_JIT64::clip(VectorUnit &vu, IR::Instruction &instr)
 {
-    flush_regs(vu);
-    for (int i = 0; i < 16; i++)
-    {
-        xmm_regs[i].used = false;
-        xmm_regs[i].age = 0;
-        int_regs[i].used = false;
-        int_regs[i].age = 0;
-    }
+    //Done inline rather than through the interpreter, so registers don't need to be flushed around it
+    REG_64 source = alloc_sse_reg(vu, instr.get_source(), REG_STATE::READ);
+    REG_64 w = alloc_sse_reg(vu, instr.get_source2(), REG_STATE::READ);
 
-    uint32_t imm = instr.get_source() << 11;
-    imm |= instr.get_source2() << 16;
+    clamp_vfreg(0x7, source);
+    clamp_vfreg(0x8, w);
 
-    prepare_abi(vu, (uint64_t)&vu);
-    prepare_abi(vu, imm);
-    call_abi_func((uint64_t)vu_clip);
+    //XMM1 = |w| in every field
+    emitter.PSHUFD(0xFF, w, REG_64::XMM1);
+    emitter.load_addr((uint64_t)&abs_constant, REG_64::RAX);
+    emitter.PAND_XMM_MEM(REG_64::RAX, REG_64::XMM1);
+
+    //RDI = xyz > +|w|
+    emitter.MOVAPS_REG(source, REG_64::XMM0);
+    emitter.CMPNLEPS(REG_64::XMM1, REG_64::XMM0);
+    emitter.MOVMSKPS(REG_64::XMM0, REG_64::RDI);
+
+    //RSI = xyz < -|w|
+    emitter.XORPS(REG_64::XMM0, REG_64::XMM0);
+    emitter.SUBPS(REG_64::XMM1, REG_64::XMM0);
+    emitter.CMPNLEPS(source, REG_64::XMM0);
+    emitter.MOVMSKPS(REG_64::XMM0, REG_64::RSI);
+
+    //Interleave the judgments so each field gets its +/- pair of bits
+    REG_64 masks[] = {REG_64::RDI, REG_64::RSI};
+    for (int i = 0; i < 2; i++)
+    {
+        emitter.AND32_REG_IMM(0x7, masks[i]);
+        emitter.MOV32_REG(masks[i], REG_64::RAX);
+        emitter.SHL32_REG_IMM(2, REG_64::RAX);
+        emitter.OR32_REG(REG_64::RAX, masks[i]);
+        emitter.AND32_REG_IMM(0x33, masks[i]);
+        emitter.MOV32_REG(masks[i], REG_64::RAX);
+        emitter.SHL32_REG_IMM(1, REG_64::RAX);
+        emitter.OR32_REG(REG_64::RAX, masks[i]);
+        emitter.AND32_REG_IMM(0x15, masks[i]);
+    }
+    emitter.SHL32_REG_IMM(1, REG_64::RSI);
+    emitter.OR32_REG(REG_64::RSI, REG_64::RDI);
+
+    //Move previous judgments up and add the new ones
+    emitter.load_addr((uint64_t)&vu.clip_flags, REG_64::R15);
+    emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX);
+    emitter.SHL32_REG_IMM(6, REG_64::RAX);
+    emitter.OR32_REG(REG_64::RDI, REG_64::RAX);
+    emitter.AND32_EAX(0xFFFFFF);
+    emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15);
 }
 
 void VU_JIT64::div(VectorUnit &vu, IR::Instruction &instr)
@@ -2322,6 +2369,21 @@ void VU_JIT64::update_xgkick(VectorUnit &vu, IR::Instruction &instr)
     call_abi_func((uint64_t)vu_update_xgkick);
 }
 
+void VU_JIT64::check_interlock(VectorUnit &vu, IR::Instruction &instr)
+{
+    flush_regs(vu);
+    for (int i = 0; i < 16; i++)
+    {
+        xmm_regs[i].used = false;
+        xmm_regs[i].age = 0;
+        int_regs[i].used = false;
+        int_regs[i].age = 0;
+    }
+
+    prepare_abi(vu, (uint64_t)&vu);
+    call_abi_func((uint64_t)vu_check_interlock);
+}
+
 void VU_JIT64::stop(VectorUnit &vu, IR::Instruction &instr)
 {
     prepare_abi(vu, (uint64_t)&vu);
@@ -2392,11 +2454,140 @@ void VU_JIT64::move_delayed_branch(VectorUnit &vu, IR::Instruction &instr)
     vu_branch = true;
 }
 
-int VU_JIT64::search_for_register(AllocReg *regs, int vu_reg)
+//Marks which VF and VI registers an IR instruction touches
+static void get_reg_uses(IR::Instruction& instr, uint64_t& vf, uint32_t& vi)
+{
+    vf = 0;
+    vi = 0;
+    switch (instr.op)
+    {
+        case IR::Opcode::LoadConst:
+        case IR::Opcode::MoveXTOP:
+        case IR::Opcode::MoveXITOP:
+        case IR::Opcode::GetClipFlags:
+        case IR::Opcode::AndStatFlags:
+        case IR::Opcode::VMacEq:
+        case IR::Opcode::VMacAnd:
+        case IR::Opcode::JumpAndLink:
+            vi = 1 << (instr.get_dest() & 0xF);
+            break;
+        case IR::Opcode::MoveIntReg:
+        case IR::Opcode::AddUnsignedImm:
+        case IR::Opcode::SubUnsignedImm:
+        case IR::Opcode::JumpAndLinkIndirect:
+            vi = (1 << (instr.get_dest() & 0xF)) | (1 << (instr.get_source() & 0xF));
+            break;
+        case IR::Opcode::AndInt:
+        case IR::Opcode::OrInt:
+        case IR::Opcode::AddIntReg:
+        case IR::Opcode::SubIntReg:
+            vi = (1 << (instr.get_dest() & 0xF)) | (1 << (instr.get_source() & 0xF)) |
+                 (1 << (instr.get_source2() & 0xF));
+            break;
+        case IR::Opcode::BranchEqual:
+        case IR::Opcode::BranchNotEqual:
+            vi = (1 << (instr.get_source() & 0xF)) | (1 << (instr.get_source2() & 0xF));
+            break;
+        case IR::Opcode::JumpIndirect:
+        case IR::Opcode::BranchLessThanZero:
+        case IR::Opcode::BranchGreaterThanZero:
+        case IR::Opcode::BranchGreaterOrEqualThanZero:
+        case IR::Opcode::BranchLessOrEqualThanZero:
+        case IR::Opcode::BackupVI:
+            vi = 1 << (instr.get_source() & 0xF);
+            break;
+        case IR::Opcode::LoadInt:
+            vi = (1 << (instr.get_dest() & 0xF)) | (1 << (instr.get_base() & 0xF));
+            break;
+        case IR::Opcode::StoreInt:
+            vi = (1 << (instr.get_source() & 0xF)) | (1 << (instr.get_base() & 0xF));
+            break;
+        case IR::Opcode::Xgkick:
+            vi = 1 << (instr.get_base() & 0xF);
+            break;
+        case IR::Opcode::LoadQuad:
+        case IR::Opcode::LoadQuadInc:
+        case IR::Opcode::LoadQuadDec:
+            vf = 1ULL << (instr.get_dest() & 0x3F);
+            vi = 1 << (instr.get_base() & 0xF);
+            break;
+        case IR::Opcode::StoreQuad:
+        case IR::Opcode::StoreQuadInc:
+        case IR::Opcode::StoreQuadDec:
+            vf = 1ULL << (instr.get_source() & 0x3F);
+            vi = 1 << (instr.get_base() & 0xF);
+            break;
+        case IR::Opcode::VMoveToInt:
+            vf = 1ULL << (instr.get_source() & 0x3F);
+            vi = 1 << (instr.get_dest() & 0xF);
+            break;
+        case IR::Opcode::VMoveFromInt:
+            vf = 1ULL << (instr.get_dest() & 0x3F);
+            vi = 1 << (instr.get_source() & 0xF);
+            break;
+        case IR::Opcode::LoadFloatConst:
+            vf = 1ULL << (instr.get_dest() & 0x3F);
+            break;
+        case IR::Opcode::VMoveFromP:
+            vf = (1ULL << (instr.get_dest() & 0x3F)) | (1ULL << VU_SpecialReg::P);
+            break;
+        case IR::Opcode::VMaddVectors:
+        case IR::Opcode::VMaddVectorByScalar:
+        case IR::Opcode::VMsubVectors:
+        case IR::Opcode::VMsubVectorByScalar:
+        case IR::Opcode::VOpMsub:
+        case IR::Opcode::VOpMula:
+            //ACC is read or written without being one of the operands
+            vf = (1ULL << (instr.get_dest() & 0x3F)) | (1ULL << (instr.get_source() & 0x3F)) |
+                 (1ULL << (instr.get_source2() & 0x3F)) | (1ULL << VU_SpecialReg::ACC);
+            break;
+        case IR::Opcode::BackupVF:
+        case IR::Opcode::RestoreVF:
+            vf = 1ULL << (instr.get_source() & 0x3F);
+            break;
+        case IR::Opcode::UpdateQ:
+            vf = 1ULL << VU_SpecialReg::Q;
+            break;
+        case IR::Opcode::UpdateP:
+            vf = 1ULL << VU_SpecialReg::P;
+            break;
+        default:
+            //The rest of the upper and lower float ops keep their VF operands in dest, source and source2
+            if (instr.op >= IR::Opcode::VAbs && instr.op <= IR::Opcode::VRInit)
+            {
+                vf = (1ULL << (instr.get_dest() & 0x3F)) | (1ULL << (instr.get_source() & 0x3F)) |
+                     (1ULL << (instr.get_source2() & 0x3F));
+            }
+            break;
+    }
+}
+
+int VU_JIT64::next_use(int vu_reg, bool is_vf)
 {
-    //Returns the index of either a free register or the oldest allocated register, depending on availability
+    //How far to look ahead, a register not needed within this distance is as good as dead
+    const int LOOKAHEAD = 64;
+
+    if (!block_instrs)
+        return LOOKAHEAD;
+
+    for (int i = 0; i < LOOKAHEAD && block_pos + i < block_instrs->size(); i++)
+    {
+        uint64_t vf;
+        uint32_t vi;
+        get_reg_uses((*block_instrs)[block_pos + i], vf, vi);
+        if (is_vf ? ((vf >> vu_reg) & 1) : ((vi >> vu_reg) & 1))
+            return i;
+    }
+    return LOOKAHEAD;
+}
+
+int VU_JIT64::search_for_register(AllocReg *regs, bool is_vf)
+{
+    //Returns the index of either a free register or the one needed furthest in the future, depending on availability.
+    //Ties go to registers that don't need to be written back, then to the oldest.
+    //Registers already handed to the instruction being emitted are never chosen.
     int reg = -1;
-    int age = 0;
+    int distance = -1;
     for (int i = 0; i < 16; i++)
     {
         if (regs[i].locked)
@@ -2405,12 +2596,30 @@ int VU_JIT64::search_for_register(AllocReg *regs, int vu_reg)
         if (!regs[i].used)
             return i;
 
-        if (regs[i].age > age)
+        if (regs[i].pinned)
+            continue;
+
+        int reg_distance = next_use(regs[i].vu_reg, is_vf);
+        bool better = reg_distance > distance;
+        if (reg_distance == distance)
+        {
+            if (regs[i].modified != regs[reg].modified)
+                better = !regs[i].modified;
+            else
+                better = regs[i].age > regs[reg].age;
+        }
+
+        if (better)
         {
             reg = i;
-            age = regs[i].age;
+            distance = reg_distance;
         }
     }
+
+    //No VU instruction holds anywhere near as many registers as there are unlocked ones
+    if (reg == -1)
+        Errors::die("[VU_JIT64] No %s register left to allocate, all are held by the current instruction",
+                    is_vf ? "xmm" : "int");
     return reg;
 }
 
@@ -2426,6 +2635,7 @@ REG_64 VU_JIT64::alloc_int_reg(VectorUnit &vu, int vi_reg, REG_STATE state)
             if (state != REG_STATE::READ)
                 int_regs[i].modified = true;
             int_regs[i].age = 0;
+            int_regs[i].pinned = true;
             return (REG_64)i;
         }
     }
@@ -2436,7 +2646,7 @@ REG_64 VU_JIT64::alloc_int_reg(VectorUnit &vu, int vi_reg, REG_STATE state)
             int_regs[i].age++;
     }
 
-    int reg = search_for_register(int_regs, vi_reg);
+    int reg = search_for_register(int_regs, false);
 
     if (int_regs[reg].used && int_regs[reg].modified && int_regs[reg].vu_reg)
     {
@@ -2459,6 +2669,7 @@ REG_64 VU_JIT64::alloc_int_reg(VectorUnit &vu, int vi_reg, REG_STATE state)
     int_regs[reg].vu_reg = vi_reg;
     int_regs[reg].used = true;
     int_regs[reg].age = 0;
+    int_regs[reg].pinned = true;
 
     return (REG_64)reg;
 }
@@ -2476,6 +2687,7 @@ REG_64 VU_JIT64::alloc_sse_reg(VectorUnit &vu, int vf_reg, REG_STATE state)
             if (state == REG_STATE::WRITE || state == REG_STATE::READ_WRITE)
                 xmm_regs[i].modified = true;
             xmm_regs[i].age = 0;
+            xmm_regs[i].pinned = true;
             return (REG_64)i;
         }
     }
@@ -2487,7 +2699,7 @@ REG_64 VU_JIT64::alloc_sse_reg(VectorUnit &vu, int vf_reg, REG_STATE state)
             xmm_regs[i].age++;
     }
 
-    int xmm = search_for_register(xmm_regs, vf_reg);
+    int xmm = search_for_register(xmm_regs, true);
 
     //If the chosen register is used, flush it back to the VU state.
     if (xmm_regs[xmm].used && xmm_regs[xmm].modified && xmm_regs[xmm].vu_reg)
@@ -2513,6 +2725,7 @@ REG_64 VU_JIT64::alloc_sse_reg(VectorUnit &vu, int vf_reg, REG_STATE state)
     xmm_regs[xmm].vu_reg = vf_reg;
     xmm_regs[xmm].used = true;
     xmm_regs[xmm].age = 0;
+    xmm_regs[xmm].pinned = true;
     set_clamping(xmm, true, 0xF);
 
     return (REG_64)xmm;
@@ -2521,7 +2734,7 @@ REG_64 VU_JIT64::alloc_sse_reg(VectorUnit &vu, int vf_reg, REG_STATE state)
 REG_64 VU_JIT64::alloc_sse_scratchpad(VectorUnit &vu, int vf_reg)
 {
     //Get a free register
-    int xmm = search_for_register(xmm_regs, vf_reg);
+    int xmm = search_for_register(xmm_regs, true);
     if (xmm_regs[xmm].used && xmm_regs[xmm].modified && xmm_regs[xmm].vu_reg)
     {
         //printf("[VU_JIT64] Flushing xmm reg %d! (vf%d)\n", xmm, xmm_regs[xmm].vu_reg);
@@ -2553,6 +2766,7 @@ REG_64 VU_JIT64::alloc_sse_scratchpad(VectorUnit &vu, int vf_reg)
     xmm_regs[xmm].vu_reg = vf_reg;
     xmm_regs[xmm].used = true;
     xmm_regs[xmm].age = 0;
+    xmm_regs[xmm].pinned = true;
 
     return (REG_64)xmm;
 }
@@ -2631,6 +2845,13 @@ void VU_JIT64::emit_prologue()
 
 void VU_JIT64::emit_instruction(VectorUnit &vu, IR::Instruction &instr)
 {
+    //Registers the previous instruction was using can be evicted again
+    for (int i = 0; i < 16; i++)
+    {
+        xmm_regs[i].pinned = false;
+        int_regs[i].pinned = false;
+    }
+
     switch (instr.op)
     {
         case IR::Opcode::LoadConst:
@@ -2894,6 +3115,9 @@ void VU_JIT64::emit_instruction(VectorUnit &vu, IR::Instruction &instr)
         case IR::Opcode::UpdateXgkick:
             update_xgkick(vu, instr);
             break;
+        case IR::Opcode::CheckInterlock:
+            check_interlock(vu, instr);
+            break;
         case IR::Opcode::Stop:
             stop(vu, instr);
             break;
@@ -2917,9 +3141,9 @@ void VU_JIT64::emit_instruction(VectorUnit &vu, IR::Instruction &instr)
     }
 }
 
-void VU_JIT64::recompile_block(VectorUnit& vu, IR::Block& block)
+void VU_JIT64::recompile_block(VectorUnit& vu, IR::Block& block, const BlockState& state)
 {
-    cache.alloc_block(BlockState { vu.get_PC(), prev_pc, current_program, vu.pipeline_state[0], vu.pipeline_state[1] });
+    cache.alloc_block(state);
 
     vu_branch = false;
     end_of_program = false;
@@ -2932,11 +3156,10 @@ void VU_JIT64::recompile_block(VectorUnit& vu, IR::Block& block)
     emitter.PUSH(REG_64::RBP);
     emitter.MOV64_MR(REG_64::RSP, REG_64::RBP);
 
-    while (block.get_instruction_count() > 0)
-    {
-        IR::Instruction instr = block.get_next_instr();
-        emit_instruction(vu, instr);
-    }
+    block_instrs = &block.get_instrs();
+    for (block_pos = 0; block_pos < block_instrs->size(); block_pos++)
+        emit_instruction(vu, (*block_instrs)[block_pos]);
+    block_instrs = nullptr;
 
     if (vu_branch)
         handle_branch(vu);
@@ -3098,11 +3321,38 @@ extern "C"
 uint8_t* exec_block(VU_JIT64& jit, VectorUnit& vu)
 {
     //printf("[VU_JIT64] Executing block at $%04X, Prev PC $%04X Current Program %08X: recompiling\n", vu.PC, jit.prev_pc, jit.current_program);
-    if (jit.cache.find_block(BlockState { vu.get_PC(), jit.prev_pc, jit.current_program, vu.pipeline_state[0], vu.pipeline_state[1] }) == nullptr)
+    //Once the microprogram has been hashed, blocks are keyed by the pages they were translated from,
+    //so an upload to part of the program only loses the blocks in the pages it wrote to.
+    //Before the first translation at an address its end isn't known, and the rest of memory is assumed.
+    uint16_t pc = vu.get_PC();
+    uint32_t program = 0;
+    if (jit.current_program)
+        program = vu.get_instr_range_key(pc, jit.block_end_pc[pc / 8]);
+
+    BlockState state { pc, jit.prev_pc, program, vu.pipeline_state[0], vu.pipeline_state[1] };
+    if (jit.cache.find_block(state) == nullptr)
     {
         //printf("[VU_JIT64] Block not found at $%04X, Prev PC $%04X Current Program %08X: recompiling\n", vu.PC, jit.prev_pc, jit.current_program);
-        IR::Block block = jit.ir.translate(vu, vu.get_instr_mem(), jit.prev_pc);
-        jit.recompile_block(vu, block);
+        IR::Block block;
+        if (!jit.current_program)
+            block = jit.ir.translate(vu, vu.get_instr_mem(), jit.prev_pc);
+        else
+        {
+            //The IR cache is searched before translating, so it's keyed by everything up to the end of memory
+            BlockState ir_state = state;
+            ir_state.program = vu.get_instr_range_key(pc, 0xFFFF);
+
+            uint16_t end_pc;
+            if (!jit.ir_cache.find_block(ir_state, block, end_pc))
+            {
+                block = jit.ir.translate(vu, vu.get_instr_mem(), jit.prev_pc);
+                end_pc = jit.ir.get_end_PC();
+                jit.ir_cache.add_block(ir_state, block, end_pc);
+            }
+            jit.block_end_pc[pc / 8] = end_pc;
+            state.program = vu.get_instr_range_key(pc, end_pc);
+        }
+        jit.recompile_block(vu, block, state);
     }
     return jit.cache.get_current_block_start();
 }
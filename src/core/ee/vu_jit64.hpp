@@ -2,6 +2,7 @@
 #define VU_JIT64_HPP
 #include "../jitcommon/emitter64.hpp"
 #include "../jitcommon/ir_block.hpp"
+#include "vu_ircache.hpp"
 #include "vu_jittrans.hpp"
 #include "vu.hpp"
 
@@ -9,6 +10,7 @@ struct AllocReg
 {
     bool used;
     bool locked; //Prevent the register from being allocated
+    bool pinned; //Handed out to the instruction being emitted, so it can't be evicted until the next one
     bool modified;
     int age;
     int vu_reg;
@@ -38,6 +40,7 @@ class VU_JIT64
         JitCache cache;
         Emitter64 emitter;
         VU_JitTranslator ir;
+        VU_IRCache ir_cache;
 
         //Set to 0x7FFFFFFF, repeated four times
         VU_GPR abs_constant;
@@ -51,6 +54,9 @@ class VU_JIT64
 
         uint32_t current_program;
         uint32_t prev_pc;
+
+        //Where the last block translated at each address ended, 0xFFFF if none has been yet
+        uint16_t block_end_pc[1024 * 16 / 8];
         bool should_update_mac;
 
         bool vu_branch;
@@ -59,6 +65,10 @@ class VU_JIT64
         uint16_t vu_branch_delay_dest, vu_branch_delay_fail_dest;
         uint16_t cycle_count;
 
+        //The block being emitted, so the allocator can look ahead at which registers are needed next
+        std::vector<IR::Instruction>* block_instrs;
+        unsigned int block_pos;
+
         void clamp_vfreg(uint8_t field, REG_64 xmm_reg);
         void sse_abs(REG_64 source, REG_64 dest);
         void sse_div_check(REG_64 num, REG_64 denom, VU_R& dest);
@@ -164,13 +174,15 @@ class VU_JIT64
         void move_xitop(VectorUnit& vu, IR::Instruction& instr);
         void xgkick(VectorUnit& vu, IR::Instruction& instr);
         void update_xgkick(VectorUnit& vu, IR::Instruction& instr);
+        void check_interlock(VectorUnit& vu, IR::Instruction& instr);
         void stop(VectorUnit& vu, IR::Instruction& instr);
         void stop_by_tbit(VectorUnit& vu, IR::Instruction& instr);
         void save_pc(VectorUnit& vu, IR::Instruction& instr);
         void save_pipeline_state(VectorUnit& vu, IR::Instruction& instr);
         void move_delayed_branch(VectorUnit& vu, IR::Instruction& instr);
 
-        int search_for_register(AllocReg* regs, int vu_reg);
+        int next_use(int vu_reg, bool is_vf);
+        int search_for_register(AllocReg* regs, bool is_vf);
         REG_64 alloc_int_reg(VectorUnit& vu, int vi_reg, REG_STATE state = REG_STATE::READ_WRITE);
         REG_64 alloc_sse_reg(VectorUnit& vu, int vf_reg, REG_STATE state = REG_STATE::READ_WRITE);
         REG_64 alloc_sse_scratchpad(VectorUnit& vu, int vf_reg);
@@ -181,7 +193,7 @@ class VU_JIT64
 
         void emit_prologue();
         void emit_instruction(VectorUnit& vu, IR::Instruction& instr);
-        void recompile_block(VectorUnit& vu, IR::Block& block);
+        void recompile_block(VectorUnit& vu, IR::Block& block, const BlockState& state);
         //uint8_t* exec_block(VectorUnit& vu);
         void cleanup_recompiler(VectorUnit& vu, bool clear_regs);
         void emit_epilogue();
@@ -190,9 +202,10 @@ class VU_JIT64
         void call_abi_func(uint64_t addr);
         void fallback_interpreter(VectorUnit& vu, IR::Instruction& instr);
     public:
-        VU_JIT64();
+        VU_JIT64(int id);
 
         void reset(bool clear_cache = true);
+        void set_cache_directory(const std::string& directory);
         void set_current_program(uint32_t crc);
         uint16_t run(VectorUnit& vu);
 
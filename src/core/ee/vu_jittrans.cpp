@@ -41,10 +41,14 @@ IR::Block VU_JitTranslator::translate(VectorUnit &vu, uint8_t* instr_mem, uint32
     IR::Instruction clear_delay(IR::Opcode::ClearIntDelay);
     block.add_instr(clear_delay);
 
+    //Reused for every instruction pair so translation doesn't allocate per instruction
+    std::vector<IR::Instruction> upper_instrs;
+    std::vector<IR::Instruction> lower_instrs;
+
     while (!block_end)
     {
-        std::vector<IR::Instruction> upper_instrs;
-        std::vector<IR::Instruction> lower_instrs;
+        upper_instrs.clear();
+        lower_instrs.clear();
 
         if (instr_info[cur_PC].branch_delay_slot || instr_info[cur_PC].ebit_delay_slot || instr_info[cur_PC].tbit_end)
         {
@@ -165,6 +169,13 @@ IR::Block VU_JitTranslator::translate(VectorUnit &vu, uint8_t* instr_mem, uint32
             }
         }
 
+        //M-Bit, only meaningful on VU0 where it syncs up with COP2 on the EE
+        if ((upper & (1 << 29)) && vu.get_id() == 0)
+        {
+            IR::Instruction interlock(IR::Opcode::CheckInterlock);
+            block.add_instr(interlock);
+        }
+
         //End of microprogram delay slot
         if (upper & (1 << 30))
         {
@@ -243,9 +254,148 @@ IR::Block VU_JitTranslator::translate(VectorUnit &vu, uint8_t* instr_mem, uint32
     block.add_instr(update);
     block.set_cycle_count(cycles_this_block);
 
+    int_const_pass(block);
+
     return block;
 }
 
+//Address of the last instruction pair the most recent translation read
+uint16_t VU_JitTranslator::get_end_PC()
+{
+    return end_PC;
+}
+
+//Only these are known to leave the VI registers alone, anything else that isn't folded below forgets what's known
+static bool preserves_int_regs(IR::Opcode op)
+{
+    switch (op)
+    {
+        case IR::Opcode::VMoveToInt:
+        case IR::Opcode::VMacEq:
+        case IR::Opcode::VMacAnd:
+        case IR::Opcode::GetClipFlags:
+        case IR::Opcode::AndClipFlags:
+        case IR::Opcode::OrClipFlags:
+        case IR::Opcode::AndStatFlags:
+            return false;
+        case IR::Opcode::Null:
+        case IR::Opcode::LoadFloatConst:
+        case IR::Opcode::StoreInt:
+        case IR::Opcode::LoadQuad:
+        case IR::Opcode::StoreQuad:
+        case IR::Opcode::Jump:
+        case IR::Opcode::JumpIndirect:
+        case IR::Opcode::BranchEqual:
+        case IR::Opcode::BranchNotEqual:
+        case IR::Opcode::BranchLessThanZero:
+        case IR::Opcode::BranchGreaterThanZero:
+        case IR::Opcode::BranchGreaterOrEqualThanZero:
+        case IR::Opcode::BranchLessOrEqualThanZero:
+        case IR::Opcode::SetClipFlags:
+        case IR::Opcode::BackupVF:
+        case IR::Opcode::RestoreVF:
+        case IR::Opcode::BackupVI:
+        case IR::Opcode::UpdateQ:
+        case IR::Opcode::UpdateP:
+        case IR::Opcode::UpdateMacFlags:
+        case IR::Opcode::UpdateMacPipeline:
+        case IR::Opcode::Xgkick:
+        case IR::Opcode::UpdateXgkick:
+        case IR::Opcode::SavePC:
+        case IR::Opcode::SavePipelineState:
+        case IR::Opcode::MoveDelayedBranch:
+        case IR::Opcode::ClearIntDelay:
+            return true;
+        default:
+            return op >= IR::Opcode::VAbs && op <= IR::Opcode::VRInit;
+    }
+}
+
+//Folds integer ops whose inputs are known at translation time into constant loads,
+//and drops loads and moves that leave a register with the value it already has
+void VU_JitTranslator::int_const_pass(IR::Block& block)
+{
+    std::vector<IR::Instruction>& instrs = block.get_instrs();
+
+    uint16_t value[16];
+    uint16_t known = 1;
+    value[0] = 0;
+
+    unsigned int out = 0;
+    for (unsigned int i = 0; i < instrs.size(); i++)
+    {
+        IR::Instruction instr = instrs[i];
+        int dest = instr.get_dest() & 0xF;
+        int source = instr.get_source() & 0xF;
+        int source2 = instr.get_source2() & 0xF;
+        bool folds = true;
+        uint16_t result = 0;
+
+        switch (instr.op)
+        {
+            case IR::Opcode::LoadConst:
+                result = instr.get_source();
+                break;
+            case IR::Opcode::MoveIntReg:
+                folds = known & (1 << source);
+                result = value[source];
+                break;
+            case IR::Opcode::AddUnsignedImm:
+                folds = known & (1 << source);
+                result = value[source] + instr.get_source2();
+                break;
+            case IR::Opcode::SubUnsignedImm:
+                folds = known & (1 << source);
+                result = value[source] - instr.get_source2();
+                break;
+            case IR::Opcode::AddIntReg:
+                folds = (known & (1 << source)) && (known & (1 << source2));
+                result = value[source] + value[source2];
+                break;
+            case IR::Opcode::SubIntReg:
+                folds = (known & (1 << source)) && (known & (1 << source2));
+                result = value[source] - value[source2];
+                break;
+            case IR::Opcode::AndInt:
+                folds = (known & (1 << source)) && (known & (1 << source2));
+                result = value[source] & value[source2];
+                break;
+            case IR::Opcode::OrInt:
+                folds = (known & (1 << source)) && (known & (1 << source2));
+                result = value[source] | value[source2];
+                break;
+            default:
+                folds = false;
+                if (!preserves_int_regs(instr.op))
+                    known = 1;
+                instrs[out++] = instr;
+                continue;
+        }
+
+        //vi0 is hardwired to zero, so these don't do anything when they target it
+        if (!dest)
+            continue;
+
+        if (!folds)
+        {
+            known &= ~(1 << dest);
+            instrs[out++] = instr;
+            continue;
+        }
+
+        //Nothing to emit if the register already holds the result
+        if ((known & (1 << dest)) && value[dest] == result)
+            continue;
+
+        instr.op = IR::Opcode::LoadConst;
+        instr.set_source(result);
+        known |= 1 << dest;
+        value[dest] = result;
+        instrs[out++] = instr;
+    }
+    instrs.resize(out);
+}
+
 int VU_JitTranslator::fdiv_pipe_cycles(uint32_t lower_instr)
 {
     if (lower_instr & (1 << 31))
@@ -1255,7 +1405,9 @@ void VU_JitTranslator::upper_special(std::vector<IR::Instruction> &instrs, uint3
             break;
         case 0x1F:
             //CLIP
-            fallback_interpreter(instr, upper, true);
+            instr.op = IR::Opcode::VClip;
+            instr.set_source((upper >> 11) & 0x1F);
+            instr.set_source2((upper >> 16) & 0x1F);
             break;
         case 0x20:
             //ADDAq
@@ -83,6 +83,7 @@ class VU_JitTranslator
         void populate_vu_state(VectorUnit &vu, int q_pipe_delay, int p_pipe_delay, uint16_t PC);
         void interpreter_pass(VectorUnit& vu, uint8_t *instr_mem, uint32_t prev_pc);
         void flag_pass(VectorUnit& vu);
+        void int_const_pass(IR::Block& block);
 
         void fallback_interpreter(IR::Instruction& instr, uint32_t instr_word, bool is_upper);
         void update_xgkick(std::vector<IR::Instruction>& instrs);
@@ -101,8 +102,12 @@ class VU_JitTranslator
         void lower1(std::vector<IR::Instruction>& instrs, uint32_t lower);
         void lower1_special(std::vector<IR::Instruction>& instrs, uint32_t lower);
         void lower2(std::vector<IR::Instruction>& instrs, uint32_t lower, uint32_t PC);
+
+        //The tests run int_const_pass on blocks of their own
+        friend class Emulator;
     public:
         IR::Block translate(VectorUnit& vu, uint8_t *instr_mem, uint32_t prev_pc);
+        uint16_t get_end_PC();
         void reset_instr_info();
 };
 
@@ -6,7 +6,9 @@
 #include "emulator.hpp"
 #include "errors.hpp"
 
+#include "ee/ee_jit.hpp"
 #include "ee/vu_jit.hpp"
+#include "iop/iop_jit.hpp"
 
 #define CYCLES_PER_FRAME 4900000
 #define VBLANK_START_CYCLES CYCLES_PER_FRAME * 0.75
@@ -30,7 +32,10 @@ Emulator::Emulator() :
     ELF_size = 0;
     gsdump_single_frame = false;
     ee_log.open("ee_log.txt", std::ios::out);
+    set_vu0_mode(VU_MODE::DONT_CARE);
     set_vu1_mode(VU_MODE::DONT_CARE);
+    set_ee_mode(CPU_MODE::DONT_CARE);
+    set_iop_mode(CPU_MODE::DONT_CARE);
 }
 
 Emulator::~Emulator()
@@ -86,23 +91,33 @@ void Emulator::run()
         int iop_cycles = scheduler.get_iop_run_cycles();
         scheduler.update_cycle_counts();
 
-        cpu.run(ee_cycles);
-        dmac.run(bus_cycles);
+        ee_run_func(cpu, ee_cycles);
+
+        //Most units sit idle for most of a frame, and can only be woken up by a register write or DMA
+        //from another unit earlier in the slice, so skip them while they have nothing to do.
+        //The VU1 JIT is always called since it keeps its own cycle count.
+        if (dmac.is_active())
+            dmac.run(bus_cycles);
         timers.run(bus_cycles);
-        ipu.run();
-        vif0.update(bus_cycles);
-        vif1.update(bus_cycles);
-        gif.run(bus_cycles);
-        vu0.run(bus_cycles);
+        if (ipu.is_busy())
+            ipu.run();
+        if (!vif0.is_idle())
+            vif0.update(bus_cycles);
+        if (!vif1.is_idle())
+            vif1.update(bus_cycles);
+        if (!gif.fifo_empty())
+            gif.run(bus_cycles);
+        if (vu0.is_active())
+            vu0_run_func(vu0, bus_cycles);
         vu1_run_func(vu1, bus_cycles);
 
         iop_timers.run(iop_cycles);
-        iop_dma.run(iop_cycles);
-        for (int i = 0; i < iop_cycles; i++)
-        {
-            iop.run(1);
-            iop.interrupt_check(IOP_I_CTRL && (IOP_I_MASK & IOP_I_STAT));
-        }
+        if (iop_dma.is_active())
+            iop_dma.run(iop_cycles);
+        if (iop_mode == CPU_MODE::JIT)
+            iop.run_jit(iop_cycles);
+        else
+            iop.run(iop_cycles);
 
         scheduler.process_events(this);
     }
@@ -131,6 +146,7 @@ void Emulator::reset()
     cp0.reset();
     cp0.init_mem_pointers(RDRAM, BIOS, (uint8_t*)&scratchpad);
     cpu.reset();
+    cpu.init_mem_pointers(RDRAM);
     cpu.init_tlb();
     dmac.reset(RDRAM, (uint8_t*)&scratchpad);
     fpu.reset();
@@ -153,6 +169,8 @@ void Emulator::reset()
     vu0.reset();
     vu1.reset();
     VU_JIT::reset();
+    EE_JIT::reset();
+    IOP_JIT::reset();
 
     MCH_DRD = 0;
     MCH_RICM = 0;
@@ -316,6 +334,20 @@ void Emulator::set_skip_BIOS_hack(SKIP_HACK type)
     skip_BIOS_hack = type;
 }
 
+void Emulator::set_vu0_mode(VU_MODE mode)
+{
+    switch (mode)
+    {
+        case VU_MODE::JIT:
+            vu0_run_func = &VectorUnit::run_jit;
+            break;
+        case VU_MODE::INTERPRETER:
+        default:
+            vu0_run_func = &VectorUnit::run;
+            break;
+    }
+}
+
 void Emulator::set_vu1_mode(VU_MODE mode)
 {
     switch (mode)
@@ -330,6 +362,40 @@ void Emulator::set_vu1_mode(VU_MODE mode)
     }
 }
 
+void Emulator::set_ee_mode(CPU_MODE mode)
+{
+    switch (mode)
+    {
+        case CPU_MODE::JIT:
+            ee_run_func = &EmotionEngine::run_jit;
+            break;
+        case CPU_MODE::INTERPRETER:
+        default:
+            ee_run_func = &EmotionEngine::run;
+            break;
+    }
+}
+
+void Emulator::set_iop_mode(CPU_MODE mode)
+{
+    switch (mode)
+    {
+        case CPU_MODE::JIT:
+            iop_mode = CPU_MODE::JIT;
+            break;
+        case CPU_MODE::INTERPRETER:
+        default:
+            iop_mode = CPU_MODE::INTERPRETER;
+            break;
+    }
+}
+
+//Where translated VU microprograms are kept between sessions
+void Emulator::set_cache_directory(const std::string& directory)
+{
+    VU_JIT::set_cache_directory(directory);
+}
+
 void Emulator::load_BIOS(const uint8_t *BIOS_file)
 {
     if (!BIOS)
@@ -403,6 +469,12 @@ void Emulator::execute_ELF()
     cpu.set_PC(e_entry);
 }
 
+//Lets the EE catch VU0 up through whichever of the interpreter or JIT is selected
+void Emulator::run_vu0(int cycles)
+{
+    vu0_run_func(vu0, cycles);
+}
+
 void Emulator::clear_cop2_interlock()
 {
     cop2_interlock = false;
@@ -624,6 +696,7 @@ void Emulator::write8(uint32_t address, uint8_t value)
     if (address >= 0x1C000000 && address < 0x1C200000)
     {
         IOP_RAM[address & 0x1FFFFF] = value;
+        iop.check_ram_write(address);
         return;
     }
     switch (address)
@@ -646,6 +719,7 @@ void Emulator::write16(uint32_t address, uint16_t value)
     if (address >= 0x1C000000 && address < 0x1C200000)
     {
         *(uint16_t*)&IOP_RAM[address & 0x1FFFFF] = value;
+        iop.check_ram_write(address);
         return;
     }
     if (address >= 0x1A000000 && address < 0x1FC00000)
@@ -661,6 +735,7 @@ void Emulator::write32(uint32_t address, uint32_t value)
     if (address >= 0x1C000000 && address < 0x1C200000)
     {
         *(uint32_t*)&IOP_RAM[address & 0x1FFFFF] = value;
+        iop.check_ram_write(address);
         return;
     }
     if (address >= 0x10000000 && address < 0x10002000)
@@ -779,6 +854,7 @@ void Emulator::write64(uint32_t address, uint64_t value)
     if (address >= 0x1C000000 && address < 0x1C200000)
     {
         *(uint64_t*)&IOP_RAM[address & 0x1FFFFF] = value;
+        iop.check_ram_write(address);
         return;
     }
     if (address >= 0x10000000 && address < 0x10002000)
@@ -1049,6 +1125,7 @@ uint32_t Emulator::iop_read32(uint32_t address)
             //I_CTRL is reset when read
             uint32_t value = IOP_I_CTRL;
             IOP_I_CTRL = 0;
+            iop.mark_IRQ_line_stale();
             return value;
         }
         case 0x1F8010B0:
@@ -1142,6 +1219,7 @@ void Emulator::iop_write8(uint32_t address, uint8_t value)
     {
         //printf("[IOP] Write to $%08X of $%02X\n", address, value);
         IOP_RAM[address] = value;
+        iop.check_ram_write(address);
         return;
     }
     switch (address)
@@ -1194,6 +1272,7 @@ void Emulator::iop_write16(uint32_t address, uint16_t value)
     {
         //printf("[IOP] Write16 to $%08X of $%08X\n", address, value);
         *(uint16_t*)&IOP_RAM[address] = value;
+        iop.check_ram_write(address);
         return;
     }
     if (address >= 0x1F900000 && address < 0x1F900400)
@@ -1322,6 +1401,7 @@ void Emulator::iop_write32(uint32_t address, uint32_t value)
     {
         //printf("[IOP] Write to $%08X of $%08X\n", address, value);
         *(uint32_t*)&IOP_RAM[address] = value;
+        iop.check_ram_write(address);
         return;
     }
     //SIO2 send buffers
@@ -1379,6 +1459,7 @@ void Emulator::iop_write32(uint32_t address, uint32_t value)
             if (!IOP_I_CTRL && (value & 0x1))
                 iop_i_ctrl_delay = 4;
             IOP_I_CTRL = value & 0x1;
+            iop.mark_IRQ_line_stale();
             //iop.interrupt_check(IOP_I_CTRL && (IOP_I_MASK & IOP_I_STAT));
             //printf("[IOP] I_CTRL: $%08X\n", value);
             return;
@@ -1560,6 +1641,16 @@ void Emulator::iop_request_IRQ(int index)
     iop.interrupt_check(IOP_I_CTRL && (IOP_I_MASK & IOP_I_STAT));
 }
 
+bool Emulator::iop_IRQ_asserted()
+{
+    return IOP_I_CTRL && (IOP_I_MASK & IOP_I_STAT);
+}
+
+void Emulator::iop_check_ram_write(uint32_t address)
+{
+    iop.check_ram_write(address);
+}
+
 void Emulator::iop_ksprintf()
 {
     uint32_t msg_pointer = iop.get_gpr(6);
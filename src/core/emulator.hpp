@@ -33,7 +33,13 @@ enum SKIP_HACK
     LOAD_DISC
 };
 
-enum VU_MODE {
+enum class VU_MODE {
+    DONT_CARE,
+    JIT,
+    INTERPRETER
+};
+
+enum class CPU_MODE {
     DONT_CARE,
     JIT,
     INTERPRETER
@@ -72,7 +78,10 @@ class Emulator
 
         std::ofstream ee_log;
         std::string ee_stdout;
+        std::function<void(VectorUnit&, int)> vu0_run_func;
         std::function<void(VectorUnit&, int)> vu1_run_func;
+        std::function<int(EmotionEngine&, int)> ee_run_func;
+        CPU_MODE iop_mode;
 
         uint8_t* RDRAM;
         uint8_t* IOP_RAM;
@@ -113,7 +122,11 @@ class Emulator
         bool skip_BIOS();
         void fast_boot();
         void set_skip_BIOS_hack(SKIP_HACK type);
+        void set_vu0_mode(VU_MODE mode);
         void set_vu1_mode(VU_MODE mode);
+        void set_ee_mode(CPU_MODE mode);
+        void set_iop_mode(CPU_MODE mode);
+        void set_cache_directory(const std::string& directory);
         void load_BIOS(const uint8_t* BIOS);
         void load_ELF(const uint8_t* ELF, uint32_t size);
         bool load_CDVD(const char* name, CDVD_CONTAINER type);
@@ -136,6 +149,7 @@ class Emulator
         void load_state(const char* file_name);
         void save_state(const char* file_name);
 
+        void run_vu0(int cycles);
         bool interlock_cop2_check(bool isCOP2);
         void clear_cop2_interlock();
         bool check_cop2_interlock();
@@ -162,10 +176,20 @@ class Emulator
         void iop_write32(uint32_t address, uint32_t value);
 
         void iop_request_IRQ(int index);
+        bool iop_IRQ_asserted();
+        void iop_check_ram_write(uint32_t address);
         void iop_ksprintf();
         void iop_puts();
 
         void test_iop();
+        void test_gs_span();
+        void test_vif();
+        void test_ipu_vlc();
+        void test_ipu_idct();
+        void test_ipu_fifo();
+        void test_vu_const_fold();
+        void test_gs_pixel_jit();
+        void test_gs_swizzle();
         GraphicsSynthesizer& get_gs();//used for gs dumps
 
         void add_ee_event(EVENT_ID id, event_func func, uint64_t delta_time_to_run);
@@ -59,190 +59,42 @@ void GraphicsInterface::write_MODE(uint32_t value)
     resume_path3();
 }
 
-void GraphicsInterface::process_PACKED(uint128_t data)
-{
-    uint64_t data1 = data._u64[0];
-    uint64_t data2 = data._u64[1];
-    //printf("[GIF] PACKED: $%08X_%08X_%08X_%08X\n", data._u32[3], data._u32[2], data._u32[1], data._u32[0]);
-    uint64_t reg_offset = (path[active_path].current_tag.reg_count - path[active_path].current_tag.regs_left) << 2;
-    uint8_t reg = (path[active_path].current_tag.regs >> reg_offset) & 0xF;
-    switch (reg)
-    {
-        case 0x0:
-            //PRIM
-            gs->write64(0, data1);
-            break;
-        case 0x1:
-            //RGBAQ - set RGBA
-            //Q is taken from the ST command
-        {
-            uint8_t r = data1 & 0xFF;
-            uint8_t g = (data1 >> 32) & 0xFF;
-            uint8_t b = data2 & 0xFF;
-            uint8_t a = (data2 >> 32) & 0xFF;
-            gs->set_RGBA(r, g, b, a, internal_Q);
-        }
-            break;
-        case 0x2:
-        {
-            //ST - set ST coordinates and Q
-            uint32_t s = data1 & 0xFFFFFF00;
-            uint32_t t = (data1 >> 32) & 0xFFFFFF00;
-            uint32_t q = data2 & 0xFFFFFF00;
-
-            if ((s & 0x7F800000) == 0x7F800000)
-                s = (s & 0x80000000) | 0x7F7FFFFF;
-
-            if ((t & 0x7F800000) == 0x7F800000)
-                t = (t & 0x80000000) | 0x7F7FFFFF;
-
-            if ((q & 0x7F800000) == 0x7F800000)
-                q = (q & 0x80000000) | 0x7F7FFFFF;
-            internal_Q = *(float*)&q;
-            gs->set_ST(s, t);
-        }
-            break;
-        case 0x3:
-            //UV - set UV coordinates
-        {
-            uint16_t u = data1 & 0x3FFF;
-            uint16_t v = (data1 >> 32) & 0x3FFF;
-            gs->set_UV(u, v);
-        }
-            break;
-        case 0x4:
-            //XYZF2 - set XYZ and fog coefficient. Optionally disable drawing kick through bit 111
-        {
-            uint32_t x = data1 & 0xFFFF;
-            uint32_t y = (data1 >> 32) & 0xFFFF;
-            uint32_t z = (data2 >> 4) & 0xFFFFFF;
-            bool disable_drawing = (data2 >> (111 - 64)) & 0x1;
-            uint8_t fog = (data2 >> (100 - 64)) & 0xFF;
-            gs->set_XYZF(x, y, z, fog, !disable_drawing);
-        }
-            break;
-        case 0x5:
-        //XYZ2 - set XYZ. Optionally disable drawing kick through bit 111
-        {
-            uint32_t x = data1 & 0xFFFF;
-            uint32_t y = (data1 >> 32) & 0xFFFF;
-            uint32_t z = data2 & 0xFFFFFFFF;
-            bool disable_drawing = (data2 >> (111 - 64)) & 0x1;
-            gs->set_XYZ(x, y, z, !disable_drawing);
-        }
-            break;
-        case 0xA:
-        {
-            //FOG
-            uint64_t value = data2 << 20;
-            gs->write64(0xA, value);
-        }
-            break;
-        case 0xE:
-        {
-            //A+D: output data to address
-            uint32_t addr = data2 & 0xFF;
-            gs->write64(addr, data1);
-        }
-            break;
-        case 0xF:
-            //NOP
-            break;
-        default:
-            gs->write64(reg, data1);
-            break;
-    }
-}
-
-void GraphicsInterface::process_REGLIST(uint128_t data)
-{
-    //printf("[GIF] Reglist: $%08X_%08X_%08X_%08X\n", data._u32[3], data._u32[2], data._u32[1], data._u32[0]);
-    for (int i = 0; i < 2; i++)
-    {
-        uint64_t reg_offset = (path[active_path].current_tag.reg_count - path[active_path].current_tag.regs_left) << 2;
-        uint8_t reg = (path[active_path].current_tag.regs >> reg_offset) & 0xF;
-        gs->write64(reg, data._u64[i]);
-
-        path[active_path].current_tag.regs_left--;
-        if (!path[active_path].current_tag.regs_left)
-        {
-            path[active_path].current_tag.regs_left = path[active_path].current_tag.reg_count;
-            path[active_path].current_tag.data_left--;
-
-            //If NREGS * NLOOP is odd, discard the last 64 bits of data
-            if (!path[active_path].current_tag.data_left && i == 0)
-                return;
-        }
-    }
-}
-
+//Packets are decoded on the GS thread, so only enough of them is walked here to know where they end.
+//The one exception is A+D writes to SIGNAL, FINISH and LABEL, which have effects on the EE side.
 void GraphicsInterface::feed_GIF(uint128_t data)
 {
     //printf("[GIF] Data: $%08X_%08X_%08X_%08X\n", data._u32[3], data._u32[2], data._u32[1], data._u32[0]);
-    uint64_t data1 = data._u64[0];
-    uint64_t data2 = data._u64[1];
-    if (!path[active_path].current_tag.data_left)
+    GIFtag& tag = path[active_path].current_tag;
+    gs->send_GIF_data(active_path, data);
+    if (!tag.data_left)
     {
-        path_status[active_path] = path[active_path].current_tag.format;
-        //Read new GIFtag
-        path[active_path].current_tag.NLOOP = data1 & 0x7FFF;
-        path[active_path].current_tag.end_of_packet = data1 & (1 << 15);
-        path[active_path].current_tag.output_PRIM = (data1 >> 46) & 0x1;
-        path[active_path].current_tag.PRIM = (data1 >> 47) & 0x7FF;
-        path[active_path].current_tag.format = (data1 >> 58) & 0x3;
-        path[active_path].current_tag.reg_count = data1 >> 60;
-        if (!path[active_path].current_tag.reg_count)
-            path[active_path].current_tag.reg_count = 16;
-        path[active_path].current_tag.regs = data2;
-        path[active_path].current_tag.regs_left = path[active_path].current_tag.reg_count;
-        path[active_path].current_tag.data_left = path[active_path].current_tag.NLOOP;
-
-        //Q is initialized to 1.0 upon reading a GIFtag
-        internal_Q = 1.0f;
-
-        //Ignore zeroed out packets
-        /*if (data1)
-        {
-            printf("[GIF] PATH%d New primitive!\n", active_path);
-            printf("NLOOP: $%04X\n", path[active_path].current_tag.NLOOP);
-            printf("EOP: %d\n", path[active_path].current_tag.end_of_packet);
-            printf("Output PRIM: %d PRIM: $%04X\n", path[active_path].current_tag.output_PRIM, path[active_path].current_tag.PRIM);
-            printf("Format: %d\n", path[active_path].current_tag.format);
-            printf("Reg count: %d\n", path[active_path].current_tag.reg_count);
-            printf("Regs: $%08X_$%08X\n", path[active_path].current_tag.regs >> 32, path[active_path].current_tag.regs & 0xFFFFFFFF);
-        }*/
-
-        if (path[active_path].current_tag.output_PRIM && path[active_path].current_tag.format != 1)
-            gs->write64(0, path[active_path].current_tag.PRIM);
+        path_status[active_path] = tag.format;
+        tag.read(data);
     }
     else
     {
-        switch (path[active_path].current_tag.format)
+        switch (tag.format)
         {
             case 0:
-                process_PACKED(data);
-                path[active_path].current_tag.regs_left--;
-                if (!path[active_path].current_tag.regs_left)
-                {
-                    path[active_path].current_tag.regs_left = path[active_path].current_tag.reg_count;
-                    path[active_path].current_tag.data_left--;
-                }
+                if (tag.current_reg() == 0xE)
+                    gs->write64_local(data._u64[1] & 0xFF, data._u64[0]);
+                tag.next_reg();
                 break;
             case 1:
-                process_REGLIST(data);
+                for (int i = 0; i < 2; i++)
+                {
+                    //If NREGS * NLOOP is odd, discard the last 64 bits of data
+                    if (tag.next_reg() && !tag.data_left)
+                        break;
+                }
                 break;
             case 2:
             case 3:
-                gs->write64(0x54, data1);
-                gs->write64(0x54, data2);
-                path[active_path].current_tag.data_left--;
-                break;
-            default:
-                printf("[GS] Unrecognized GIFtag format %d\n", path[active_path].current_tag.format);
+                tag.data_left--;
                 break;
         }
     }
-    if (!path[active_path].current_tag.data_left && path[active_path].current_tag.end_of_packet)
+    if (!tag.data_left && tag.end_of_packet)
     {
         path_status[active_path] = 4;
         gs->assert_FINISH();
@@ -409,11 +261,6 @@ bool GraphicsInterface::fifo_full()
     return FIFO.size() == 16;
 }
 
-bool GraphicsInterface::fifo_empty()
-{
-    return FIFO.size() == 0;
-}
-
 bool GraphicsInterface::fifo_draining()
 {
     return !fifo_empty() && !path3_masked(3);
@@ -4,23 +4,10 @@
 #include <queue>
 #include <fstream>
 
+#include "giftag.hpp"
 #include "gs.hpp"
 #include "int128.hpp"
 
-struct GIFtag
-{
-    uint16_t NLOOP;
-    bool end_of_packet;
-    bool output_PRIM;
-    uint16_t PRIM;
-    uint8_t format;
-    uint8_t reg_count;
-    uint64_t regs;
-
-    uint8_t regs_left;
-    uint32_t data_left;
-};
-
 struct GIFPath
 {
     GIFtag current_tag;
@@ -44,10 +31,6 @@ class GraphicsInterface
         bool intermittent_mode;
         bool path3_dma_waiting;
 
-        float internal_Q;
-
-        void process_PACKED(uint128_t quad);
-        void process_REGLIST(uint128_t quad);
         void feed_GIF(uint128_t quad);
 
         void flush_path3_fifo();
@@ -85,6 +68,11 @@ class GraphicsInterface
         void save_state(std::ofstream& state);
 };
 
+inline bool GraphicsInterface::fifo_empty()
+{
+    return FIFO.size() == 0;
+}
+
 inline int GraphicsInterface::get_active_path()
 {
     return active_path;
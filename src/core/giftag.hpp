@@ -0,0 +1,62 @@
+#ifndef GIFTAG_HPP
+#define GIFTAG_HPP
+#include <cstdint>
+#include "int128.hpp"
+
+//GIF packets are walked on both sides of the GS thread FIFO: the GIF needs to know where packets end
+//for path arbitration, while the GS thread decodes the data the GIF forwards to it.
+struct GIFtag
+{
+    uint16_t NLOOP;
+    bool end_of_packet;
+    bool output_PRIM;
+    uint16_t PRIM;
+    uint8_t format;
+    uint8_t reg_count;
+    uint64_t regs;
+
+    uint8_t regs_left;
+    uint32_t data_left;
+
+    void read(uint128_t quad);
+
+    //Register descriptor of the next PACKED quadword or REGLIST doubleword
+    uint8_t current_reg() const;
+
+    //Moves on to the next register descriptor, returns true when a loop through all of them is done
+    bool next_reg();
+};
+
+inline void GIFtag::read(uint128_t quad)
+{
+    uint64_t data1 = quad._u64[0];
+    NLOOP = data1 & 0x7FFF;
+    end_of_packet = data1 & (1 << 15);
+    output_PRIM = (data1 >> 46) & 0x1;
+    PRIM = (data1 >> 47) & 0x7FF;
+    format = (data1 >> 58) & 0x3;
+    reg_count = data1 >> 60;
+    if (!reg_count)
+        reg_count = 16;
+    regs = quad._u64[1];
+    regs_left = reg_count;
+    data_left = NLOOP;
+}
+
+inline uint8_t GIFtag::current_reg() const
+{
+    uint64_t reg_offset = (reg_count - regs_left) << 2;
+    return (regs >> reg_offset) & 0xF;
+}
+
+inline bool GIFtag::next_reg()
+{
+    regs_left--;
+    if (regs_left)
+        return false;
+    regs_left = reg_count;
+    data_left--;
+    return true;
+}
+
+#endif // GIFTAG_HPP
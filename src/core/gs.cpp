@@ -202,6 +202,16 @@ void GraphicsSynthesizer::write64(uint32_t addr, uint64_t value)
     
     gs_thread.send_message({ GSCommand::write64_t, payload });
 
+    write64_local(addr, value);
+}
+
+//Applies the effects a register write has on the EE side, without passing it on to the GS thread
+void GraphicsSynthesizer::write64_local(uint32_t addr, uint64_t value)
+{
+    //TRXDIR
+    if (addr == 0x53)
+        gs_thread.reset_download();
+
     //We need a check for SIGNAL here so that we can fire the interrupt
     if (addr == 0x60)
     {
@@ -251,44 +261,9 @@ uint64_t GraphicsSynthesizer::read64_privileged(uint32_t addr)
     return reg.read64_privileged(addr);
 }
 
-void GraphicsSynthesizer::set_RGBA(uint8_t r, uint8_t g, uint8_t b, uint8_t a, float q)
-{
-    GSMessagePayload payload;
-    payload.rgba_payload = { r, g, b, a, q};
-    
-    gs_thread.send_message({ GSCommand::set_rgba_t, payload });
-}
-
-void GraphicsSynthesizer::set_ST(uint32_t s, uint32_t t)
-{
-    GSMessagePayload payload;
-    payload.st_payload = { s, t };
-    
-    gs_thread.send_message({ GSCommand::set_st_t, payload });
-}
-
-void GraphicsSynthesizer::set_UV(uint16_t u, uint16_t v)
-{
-    GSMessagePayload payload;
-    payload.uv_payload = { u, v };
-    
-    gs_thread.send_message({ GSCommand::set_uv_t, payload });
-}
-
-void GraphicsSynthesizer::set_XYZ(uint32_t x, uint32_t y, uint32_t z, bool drawing_kick)
+void GraphicsSynthesizer::send_GIF_data(int path, const uint128_t& quad)
 {
-    GSMessagePayload payload;
-    payload.xyz_payload = { x, y, z, drawing_kick };
-    
-    gs_thread.send_message({ GSCommand::set_xyz_t, payload });
-}
-
-void GraphicsSynthesizer::set_XYZF(uint32_t x, uint32_t y, uint32_t z, uint8_t fog, bool drawing_kick)
-{
-    GSMessagePayload payload;
-    payload.xyzf_payload = { x, y, z, fog, drawing_kick };
-
-    gs_thread.send_message({ GSCommand::set_xyzf_t, payload });
+    gs_thread.send_GIF_data(path, quad);
 }
 
 void GraphicsSynthesizer::load_state(std::ifstream &state)
@@ -337,12 +312,6 @@ void GraphicsSynthesizer::wake_gs_thread()
 
 uint128_t GraphicsSynthesizer::request_gs_download()
 {
-    GSMessagePayload payload;
-    payload.no_payload = {};
-    gs_thread.send_message({ GSCommand::request_local_host_tx, payload });
-    gs_thread.wake_thread();
-    GSReturnMessage data;
-    gs_thread.wait_for_return(GSReturn::local_host_transfer, data);
-    return data.payload.data_payload.quad_data;
+    return gs_thread.read_download();
 }
 
@@ -49,12 +49,9 @@ class GraphicsSynthesizer
         void write32_privileged(uint32_t addr, uint32_t value);
         void write64_privileged(uint32_t addr, uint64_t value);
         void write64(uint32_t addr, uint64_t value);
+        void write64_local(uint32_t addr, uint64_t value);
 
-        void set_RGBA(uint8_t r, uint8_t g, uint8_t b, uint8_t a, float q);
-        void set_ST(uint32_t s, uint32_t t);
-        void set_UV(uint16_t u, uint16_t v);
-        void set_XYZ(uint32_t x, uint32_t y, uint32_t z, bool drawing_kick);
-        void set_XYZF(uint32_t x, uint32_t y, uint32_t z, uint8_t fog, bool drawing_kick);
+        void send_GIF_data(int path, const uint128_t& quad);
 
         void load_state(std::ifstream& state);
         void save_state(std::ofstream& state);
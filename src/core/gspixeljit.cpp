@@ -0,0 +1,663 @@
+#include <cstddef>
+#include "gspixeljit.hpp"
+#include "gsthread.hpp"
+
+/**
+  * Register usage of a compiled pipeline:
+  * RDI - PixelSpan being drawn
+  * RSI - local memory
+  * R8  - source color of the current pixel
+  * R9  - source Z of the current pixel
+  * R10 - x coordinate of the current pixel
+  * R11 - x coordinate past the end of the span
+  * RBX - frame buffer address of the current pixel
+  * R14 - Z buffer address of the current pixel
+  * R15 - destination color, converted to 32-bit
+  * RBP - color being written to the frame buffer
+  * R12 - blending alpha
+  * R13 - dither offset
+  * RAX, RCX, RDX - scratch
+  **/
+
+GSPixelJIT::GSPixelJIT() : cache(CACHE_SIZE), emitter(&cache)
+{
+    reset();
+}
+
+void GSPixelJIT::reset()
+{
+    cache.flush_all_blocks();
+}
+
+PixelPipeline GSPixelJIT::get_pipeline(const PixelPipelineState& current)
+{
+    if (!is_supported(current))
+        return nullptr;
+
+    //Clear fields that have no effect so that equivalent states share a pipeline
+    PixelPipelineState new_state = current;
+    if (!new_state.test.alpha_test)
+    {
+        new_state.test.alpha_method = 0;
+        new_state.test.alpha_ref = 0;
+        new_state.test.alpha_fail_method = 0;
+    }
+    if (!new_state.test.dest_alpha_test || (new_state.frame_format & 0x1))
+    {
+        new_state.test.dest_alpha_test = false;
+        new_state.test.dest_alpha_method = false;
+    }
+    if (!new_state.test.depth_test)
+        new_state.test.depth_method = 0;
+    if (!new_state.alpha_blend)
+    {
+        new_state.alpha.spec_A = 0;
+        new_state.alpha.spec_B = 0;
+        new_state.alpha.spec_C = 0;
+        new_state.alpha.spec_D = 0;
+        new_state.alpha.fixed_alpha = 0;
+        new_state.PABE = false;
+    }
+    else if (new_state.alpha.spec_C != 2 && new_state.alpha.spec_C != 3)
+        new_state.alpha.fixed_alpha = 0;
+
+    BlockState key = get_key(new_state);
+    //The caller guarantees no pipeline is running, so evicting old pipelines while compiling is safe
+    if (!cache.find_block(key))
+        recompile(new_state);
+    return (PixelPipeline)cache.get_current_block_start();
+}
+
+bool GSPixelJIT::is_supported(const PixelPipelineState& state)
+{
+    switch (state.frame_format)
+    {
+        case 0x0:
+        case 0x1:
+        case 0x2:
+        case 0xA:
+        case 0x30:
+        case 0x31:
+        case 0x32:
+        case 0x3A:
+            break;
+        default:
+            return false;
+    }
+
+    //Unknown Z formats are fatal when read, so leave those to the interpreter
+    if (state.test.depth_test && state.test.depth_method >= 2)
+    {
+        switch (state.zbuf_format)
+        {
+            case 0x0:
+            case 0x1:
+            case 0x2:
+            case 0xA:
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+BlockState GSPixelJIT::get_key(const PixelPipelineState& state)
+{
+    uint64_t param1 = state.frame_mask;
+    param1 |= (uint64_t)state.frame_format << 32;
+    param1 |= (uint64_t)state.zbuf_format << 40;
+    param1 |= (uint64_t)state.test.alpha_ref << 48;
+    param1 |= (uint64_t)state.alpha.fixed_alpha << 56;
+
+    uint64_t param2 = state.test.alpha_test;
+    param2 |= state.test.alpha_method << 1;
+    param2 |= state.test.alpha_fail_method << 4;
+    param2 |= state.test.dest_alpha_test << 6;
+    param2 |= state.test.dest_alpha_method << 7;
+    param2 |= state.test.depth_test << 8;
+    param2 |= state.test.depth_method << 9;
+    param2 |= state.zbuf_no_update << 11;
+    param2 |= state.FBA << 12;
+    param2 |= state.alpha_blend << 13;
+    param2 |= state.PABE << 14;
+    param2 |= state.DTHE << 15;
+    param2 |= state.COLCLAMP << 16;
+    param2 |= state.alpha.spec_A << 17;
+    param2 |= state.alpha.spec_B << 19;
+    param2 |= state.alpha.spec_C << 21;
+    param2 |= state.alpha.spec_D << 23;
+
+    return BlockState(0, 0, 0, param1, param2);
+}
+
+void GSPixelJIT::recompile(const PixelPipelineState& new_state)
+{
+    state = new_state;
+    cache.alloc_block(get_key(state));
+
+    emit_prologue();
+
+    emitter.MOV64_FROM_MEM(REG_64::RDI, REG_64::RSI, offsetof(PixelSpan, local_mem));
+    emitter.MOV64_FROM_MEM(REG_64::RDI, REG_64::R8, offsetof(PixelSpan, color));
+    emitter.MOV64_FROM_MEM(REG_64::RDI, REG_64::R9, offsetof(PixelSpan, z));
+    emitter.MOV32_FROM_MEM(REG_64::RDI, REG_64::R10, offsetof(PixelSpan, x));
+    emitter.MOV32_FROM_MEM(REG_64::RDI, REG_64::R11, offsetof(PixelSpan, count));
+    emitter.ADD32_REG(REG_64::R10, REG_64::R11);
+
+    uint8_t* loop_start = cache.get_current_block_pos();
+    emitter.CMP32_REG(REG_64::R11, REG_64::R10);
+    uint8_t* loop_exit = emitter.JGE_NEAR_DEFERRED();
+
+    skip_jumps.clear();
+    emit_pixel();
+    for (unsigned int i = 0; i < skip_jumps.size(); i++)
+        emitter.set_jump_dest(skip_jumps[i]);
+
+    emitter.ADD64_REG_IMM(sizeof(RGBAQ_REG), REG_64::R8);
+    emitter.ADD64_REG_IMM(sizeof(uint32_t), REG_64::R9);
+    emitter.ADD32_REG_IMM(1, REG_64::R10);
+    emitter.JMP_NEAR(loop_start);
+
+    emitter.set_jump_dest(loop_exit);
+    emit_epilogue();
+
+    cache.set_current_block_rx();
+}
+
+void GSPixelJIT::emit_prologue()
+{
+    emitter.PUSH(REG_64::RBX);
+    emitter.PUSH(REG_64::RBP);
+    emitter.PUSH(REG_64::R12);
+    emitter.PUSH(REG_64::R13);
+    emitter.PUSH(REG_64::R14);
+    emitter.PUSH(REG_64::R15);
+#ifdef _WIN32
+    //RSI and RDI are callee-saved on Windows, and the span arrives in RCX
+    emitter.PUSH(REG_64::RSI);
+    emitter.PUSH(REG_64::RDI);
+    emitter.MOV64_MR(REG_64::RCX, REG_64::RDI);
+#endif
+}
+
+void GSPixelJIT::emit_epilogue()
+{
+#ifdef _WIN32
+    emitter.POP(REG_64::RDI);
+    emitter.POP(REG_64::RSI);
+#endif
+    emitter.POP(REG_64::R15);
+    emitter.POP(REG_64::R14);
+    emitter.POP(REG_64::R13);
+    emitter.POP(REG_64::R12);
+    emitter.POP(REG_64::RBP);
+    emitter.POP(REG_64::RBX);
+    emitter.RET();
+}
+
+//dest = local_mem + the swizzled address of pixel x on the span's line
+void GSPixelJIT::emit_address(bool is_16bit, int row_offset, int page_offset, REG_64 dest)
+{
+    emitter.MOV32_REG(REG_64::R10, REG_64::RAX);
+    emitter.SHR32_REG_IMM(6, REG_64::RAX);
+    emitter.MOV32_FROM_MEM(REG_64::RDI, REG_64::RCX, page_offset);
+    emitter.ADD32_REG(REG_64::RCX, REG_64::RAX);
+    emitter.SHL32_REG_IMM(is_16bit ? 12 : 11, REG_64::RAX);
+
+    emitter.MOV32_REG(REG_64::R10, REG_64::RCX);
+    emitter.AND32_REG_IMM(0x3F, REG_64::RCX);
+    emitter.SHL32_REG_IMM(2, REG_64::RCX);
+    emitter.MOV64_FROM_MEM(REG_64::RDI, REG_64::RDX, row_offset);
+    emitter.ADD64_REG(REG_64::RCX, REG_64::RDX);
+    emitter.MOV32_FROM_MEM(REG_64::RDX, REG_64::RCX);
+    emitter.ADD32_REG(REG_64::RCX, REG_64::RAX);
+
+    if (is_16bit)
+    {
+        emitter.SHL32_REG_IMM(1, REG_64::RAX);
+        emitter.AND32_REG_IMM(0x003FFFFE, REG_64::RAX);
+    }
+    else
+    {
+        emitter.SHL32_REG_IMM(2, REG_64::RAX);
+        emitter.AND32_REG_IMM(0x003FFFFC, REG_64::RAX);
+    }
+    emitter.MOV64_MR(REG_64::RAX, dest);
+    emitter.ADD64_REG(REG_64::RSI, dest);
+}
+
+bool GSPixelJIT::has_z_buffer()
+{
+    if (!state.test.depth_test || state.test.depth_method == 0)
+        return false;
+    if (state.test.depth_method == 1 && state.zbuf_no_update)
+        return false;
+
+    switch (state.zbuf_format)
+    {
+        case 0x0:
+        case 0x1:
+        case 0x2:
+        case 0xA:
+            return true;
+        default:
+            //Writes to unknown formats are dropped
+            return false;
+    }
+}
+
+bool GSPixelJIT::blend_reads_frame()
+{
+    if (!state.alpha_blend)
+        return false;
+    return state.alpha.spec_A == 1 || state.alpha.spec_B == 1 || state.alpha.spec_C == 1 || state.alpha.spec_D == 1;
+}
+
+void GSPixelJIT::emit_pixel()
+{
+    emit_address(state.frame_format & 0x2, offsetof(PixelSpan, frame_row), offsetof(PixelSpan, frame_page), REG_64::RBX);
+    if (has_z_buffer())
+        emit_address(state.zbuf_format & 0x2, offsetof(PixelSpan, z_row), offsetof(PixelSpan, z_page), REG_64::R14);
+
+    bool update_z = !state.zbuf_no_update;
+    if (!state.test.alpha_test || state.test.alpha_method == 1)
+    {
+        emit_tail(true, true, update_z);
+        return;
+    }
+
+    uint8_t* fail = nullptr;
+    if (state.test.alpha_method != 0)
+    {
+        emitter.MOVSX32_FROM_MEM16(REG_64::R8, REG_64::RAX, offsetof(RGBAQ_REG, a));
+        emitter.CMP32_IMM(state.test.alpha_ref, REG_64::RAX);
+        switch (state.test.alpha_method)
+        {
+            case 2: //LESS
+                fail = emitter.JGE_NEAR_DEFERRED();
+                break;
+            case 3: //LEQUAL
+                fail = emitter.JG_NEAR_DEFERRED();
+                break;
+            case 4: //EQUAL
+                fail = emitter.JNE_NEAR_DEFERRED();
+                break;
+            case 5: //GEQUAL
+                fail = emitter.JL_NEAR_DEFERRED();
+                break;
+            case 6: //GREATER
+                fail = emitter.JLE_NEAR_DEFERRED();
+                break;
+            case 7: //NOTEQUAL
+                fail = emitter.JE_NEAR_DEFERRED();
+                break;
+        }
+        emit_tail(true, true, update_z);
+        emitter.set_jump_dest(fail);
+    }
+
+    switch (state.test.alpha_fail_method)
+    {
+        case 0: //KEEP
+            break;
+        case 1: //FB_ONLY
+            emit_tail(true, true, false);
+            break;
+        case 2: //ZB_ONLY
+            emit_tail(false, true, update_z);
+            break;
+        case 3: //RGB_ONLY
+            emit_tail(true, false, false);
+            break;
+    }
+}
+
+//Everything after the alpha test. Ends with a jump to the next pixel.
+void GSPixelJIT::emit_tail(bool update_frame, bool update_alpha, bool update_z)
+{
+    if (state.test.depth_test)
+    {
+        if (state.test.depth_method == 0)
+        {
+            skip_jumps.push_back(emitter.JMP_NEAR_DEFERRED());
+            return;
+        }
+        if (state.test.depth_method >= 2)
+            emit_depth_test();
+    }
+    else
+        update_z = false;
+
+    bool frame_read = state.test.dest_alpha_test;
+    if (update_frame)
+        frame_read |= !update_alpha || state.frame_mask || blend_reads_frame();
+    if (frame_read)
+        emit_frame_read();
+
+    if (state.test.dest_alpha_test)
+    {
+        emitter.TEST32_REG_IMM(1U << 31, REG_64::R15);
+        if (state.test.dest_alpha_method)
+            skip_jumps.push_back(emitter.JE_NEAR_DEFERRED());
+        else
+            skip_jumps.push_back(emitter.JNE_NEAR_DEFERRED());
+    }
+
+    if (update_frame)
+    {
+        if (state.DTHE)
+        {
+            emitter.MOV32_REG(REG_64::R10, REG_64::RCX);
+            emitter.AND32_REG_IMM(0x3, REG_64::RCX);
+            emitter.SHL32_REG_IMM(2, REG_64::RCX);
+            emitter.MOV64_FROM_MEM(REG_64::RDI, REG_64::RAX, offsetof(PixelSpan, dither));
+            emitter.ADD64_REG(REG_64::RCX, REG_64::RAX);
+            emitter.MOV32_FROM_MEM(REG_64::RAX, REG_64::R13);
+        }
+
+        if (state.alpha_blend && state.PABE)
+        {
+            //PABE - MSB of source alpha must be set to enable alpha blending
+            emitter.MOVSX32_FROM_MEM16(REG_64::R8, REG_64::RAX, offsetof(RGBAQ_REG, a));
+            emitter.TEST32_REG_IMM(0x80, REG_64::RAX);
+            uint8_t* no_blend = emitter.JE_NEAR_DEFERRED();
+            emit_blend();
+            uint8_t* blend_done = emitter.JMP_NEAR_DEFERRED();
+            emitter.set_jump_dest(no_blend);
+            emit_no_blend();
+            emitter.set_jump_dest(blend_done);
+        }
+        else if (state.alpha_blend)
+            emit_blend();
+        else
+            emit_no_blend();
+
+        emit_frame_write(update_alpha);
+    }
+
+    if (update_z)
+        emit_z_write();
+
+    skip_jumps.push_back(emitter.JMP_NEAR_DEFERRED());
+}
+
+void GSPixelJIT::emit_depth_test()
+{
+    emitter.MOV32_FROM_MEM(REG_64::R9, REG_64::RCX);
+
+    uint32_t max_z = 0;
+    switch (state.zbuf_format)
+    {
+        case 0x0:
+            emitter.MOV32_FROM_MEM(REG_64::R14, REG_64::RDX);
+            break;
+        case 0x1:
+            max_z = 0xFFFFFF;
+            emitter.MOV32_FROM_MEM(REG_64::R14, REG_64::RDX);
+            emitter.AND32_REG_IMM(0xFFFFFF, REG_64::RDX);
+            break;
+        case 0x2:
+        case 0xA:
+            max_z = 0xFFFF;
+            emitter.MOVZX32_FROM_MEM16(REG_64::R14, REG_64::RDX, 0);
+            break;
+    }
+
+    if (max_z)
+    {
+        emitter.CMP32_IMM(max_z, REG_64::RCX);
+        uint8_t* in_range = emitter.JBE_NEAR_DEFERRED();
+        emitter.MOV32_REG_IMM(max_z, REG_64::RCX);
+        emitter.set_jump_dest(in_range);
+    }
+
+    emitter.CMP32_REG(REG_64::RDX, REG_64::RCX);
+    if (state.test.depth_method == 2) //GEQUAL
+        skip_jumps.push_back(emitter.JB_NEAR_DEFERRED());
+    else //GREATER
+        skip_jumps.push_back(emitter.JBE_NEAR_DEFERRED());
+}
+
+void GSPixelJIT::emit_frame_read()
+{
+    switch (state.frame_format)
+    {
+        case 0x0:
+        case 0x30:
+            emitter.MOV32_FROM_MEM(REG_64::RBX, REG_64::R15);
+            break;
+        case 0x1:
+        case 0x31:
+            emitter.MOV32_FROM_MEM(REG_64::RBX, REG_64::R15);
+            emitter.AND32_REG_IMM(0xFFFFFF, REG_64::R15);
+            emitter.OR32_REG_IMM(1U << 31, REG_64::R15);
+            break;
+        default:
+            //convert_color_up
+            emitter.MOVZX32_FROM_MEM16(REG_64::RBX, REG_64::RAX, 0);
+            emitter.MOV32_REG(REG_64::RAX, REG_64::R15);
+            emitter.AND32_REG_IMM(0x1F, REG_64::R15);
+            emitter.SHL32_REG_IMM(3, REG_64::R15);
+
+            emitter.MOV32_REG(REG_64::RAX, REG_64::RCX);
+            emitter.AND32_REG_IMM(0x3E0, REG_64::RCX);
+            emitter.SHL32_REG_IMM(6, REG_64::RCX);
+            emitter.OR32_REG(REG_64::RCX, REG_64::R15);
+
+            emitter.MOV32_REG(REG_64::RAX, REG_64::RCX);
+            emitter.AND32_REG_IMM(0x7C00, REG_64::RCX);
+            emitter.SHL32_REG_IMM(9, REG_64::RCX);
+            emitter.OR32_REG(REG_64::RCX, REG_64::R15);
+
+            emitter.AND32_REG_IMM(0x8000, REG_64::RAX);
+            emitter.SHL32_REG_IMM(16, REG_64::RAX);
+            emitter.OR32_REG(REG_64::RAX, REG_64::R15);
+            break;
+    }
+}
+
+//Loads channel 0-2 (R, G, B) of a blending input
+void GSPixelJIT::emit_blend_input(uint8_t spec, int channel, REG_64 dest)
+{
+    switch (spec)
+    {
+        case 0:
+            emitter.MOVSX32_FROM_MEM16(REG_64::R8, dest, offsetof(RGBAQ_REG, r) + channel * sizeof(int16_t));
+            break;
+        case 1:
+            emitter.MOV32_REG(REG_64::R15, dest);
+            if (channel)
+                emitter.SHR32_REG_IMM(channel * 8, dest);
+            emitter.AND32_REG_IMM(0xFF, dest);
+            break;
+        default:
+            emitter.MOV32_REG_IMM(0, dest);
+            break;
+    }
+}
+
+void GSPixelJIT::emit_blend()
+{
+    ALPHA& alpha = state.alpha;
+    switch (alpha.spec_C)
+    {
+        case 0:
+            emitter.MOVSX32_FROM_MEM16(REG_64::R8, REG_64::R12, offsetof(RGBAQ_REG, a));
+            break;
+        case 1:
+            emitter.MOV32_REG(REG_64::R15, REG_64::R12);
+            emitter.SHR32_REG_IMM(24, REG_64::R12);
+            break;
+        default:
+            emitter.MOV32_REG_IMM(alpha.fixed_alpha, REG_64::R12);
+            break;
+    }
+    emitter.MOV32_REG(REG_64::R12, REG_64::RBP);
+    emitter.SHL32_REG_IMM(24, REG_64::RBP);
+
+    //Inputs 2 and 3 both read as zero, so they cancel out like identical inputs do
+    bool a_is_zero = alpha.spec_A >= 2;
+    bool b_is_zero = alpha.spec_B >= 2;
+    bool cancels = alpha.spec_A == alpha.spec_B || (a_is_zero && b_is_zero);
+
+    for (int channel = 0; channel < 3; channel++)
+    {
+        //Color values are 9-bit after an alpha blending operation
+        if (cancels)
+            emit_blend_input(alpha.spec_D, channel, REG_64::RAX);
+        else
+        {
+            emit_blend_input(alpha.spec_A, channel, REG_64::RAX);
+            if (!b_is_zero)
+            {
+                emit_blend_input(alpha.spec_B, channel, REG_64::RCX);
+                emitter.SUB32_REG(REG_64::RCX, REG_64::RAX);
+            }
+            emitter.IMUL32_REG(REG_64::R12, REG_64::RAX);
+            emitter.SAR32_REG_IMM(7, REG_64::RAX);
+            if (alpha.spec_D < 2)
+            {
+                emit_blend_input(alpha.spec_D, channel, REG_64::RCX);
+                emitter.ADD32_REG(REG_64::RCX, REG_64::RAX);
+            }
+        }
+
+        if (state.DTHE)
+            emitter.ADD32_REG(REG_64::R13, REG_64::RAX);
+
+        if (state.COLCLAMP)
+            emit_clamp(REG_64::RAX);
+        else
+            emitter.AND32_REG_IMM(0xFF, REG_64::RAX);
+
+        if (channel)
+            emitter.SHL32_REG_IMM(channel * 8, REG_64::RAX);
+        emitter.OR32_REG(REG_64::RAX, REG_64::RBP);
+    }
+}
+
+void GSPixelJIT::emit_no_blend()
+{
+    emitter.MOVSX32_FROM_MEM16(REG_64::R8, REG_64::RBP, offsetof(RGBAQ_REG, a));
+    emitter.SHL32_REG_IMM(24, REG_64::RBP);
+
+    for (int channel = 0; channel < 3; channel++)
+    {
+        emitter.MOVSX32_FROM_MEM16(REG_64::R8, REG_64::RAX, offsetof(RGBAQ_REG, r) + channel * sizeof(int16_t));
+
+        //Without dithering, out of range colors are written as they are
+        if (state.DTHE)
+        {
+            emitter.ADD32_REG(REG_64::R13, REG_64::RAX);
+            if (state.COLCLAMP)
+                emit_clamp(REG_64::RAX);
+            else
+                emitter.AND32_REG_IMM(0xFF, REG_64::RAX);
+        }
+
+        if (channel)
+            emitter.SHL32_REG_IMM(channel * 8, REG_64::RAX);
+        emitter.OR32_REG(REG_64::RAX, REG_64::RBP);
+    }
+}
+
+void GSPixelJIT::emit_clamp(REG_64 reg)
+{
+    emitter.CMP32_IMM(0, reg);
+    uint8_t* not_negative = emitter.JGE_NEAR_DEFERRED();
+    emitter.MOV32_REG_IMM(0, reg);
+    emitter.set_jump_dest(not_negative);
+
+    emitter.CMP32_IMM(0xFF, reg);
+    uint8_t* in_range = emitter.JLE_NEAR_DEFERRED();
+    emitter.MOV32_REG_IMM(0xFF, reg);
+    emitter.set_jump_dest(in_range);
+}
+
+void GSPixelJIT::emit_frame_write(bool update_alpha)
+{
+    if (!update_alpha)
+    {
+        emitter.AND32_REG_IMM(0x00FFFFFF, REG_64::RBP);
+        emitter.MOV32_REG(REG_64::R15, REG_64::RAX);
+        emitter.AND32_REG_IMM(0xFF000000, REG_64::RAX);
+        emitter.OR32_REG(REG_64::RAX, REG_64::RBP);
+    }
+
+    //FBA performs "alpha correction" - MSB of alpha is always set when writing to frame buffer
+    if (state.FBA)
+        emitter.OR32_REG_IMM(1U << 31, REG_64::RBP);
+
+    if (state.frame_mask)
+    {
+        emitter.AND32_REG_IMM(~state.frame_mask, REG_64::RBP);
+        emitter.MOV32_REG(REG_64::R15, REG_64::RAX);
+        emitter.AND32_REG_IMM(state.frame_mask, REG_64::RAX);
+        emitter.OR32_REG(REG_64::RAX, REG_64::RBP);
+    }
+
+    switch (state.frame_format)
+    {
+        case 0x0:
+        case 0x30:
+            emitter.MOV32_TO_MEM(REG_64::RBP, REG_64::RBX);
+            break;
+        case 0x1:
+        case 0x31:
+            emitter.MOV32_FROM_MEM(REG_64::RBX, REG_64::RAX);
+            emitter.AND32_REG_IMM(0xFF000000, REG_64::RAX);
+            emitter.AND32_REG_IMM(0xFFFFFF, REG_64::RBP);
+            emitter.OR32_REG(REG_64::RBP, REG_64::RAX);
+            emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::RBX);
+            break;
+        default:
+            //convert_color_down
+            emitter.MOV32_REG(REG_64::RBP, REG_64::RAX);
+            emitter.SHR32_REG_IMM(3, REG_64::RAX);
+            emitter.AND32_REG_IMM(0x1F, REG_64::RAX);
+
+            emitter.MOV32_REG(REG_64::RBP, REG_64::RCX);
+            emitter.SHR32_REG_IMM(6, REG_64::RCX);
+            emitter.AND32_REG_IMM(0x3E0, REG_64::RCX);
+            emitter.OR32_REG(REG_64::RCX, REG_64::RAX);
+
+            emitter.MOV32_REG(REG_64::RBP, REG_64::RCX);
+            emitter.SHR32_REG_IMM(9, REG_64::RCX);
+            emitter.AND32_REG_IMM(0x7C00, REG_64::RCX);
+            emitter.OR32_REG(REG_64::RCX, REG_64::RAX);
+
+            emitter.MOV32_REG(REG_64::RBP, REG_64::RCX);
+            emitter.SHR32_REG_IMM(16, REG_64::RCX);
+            emitter.AND32_REG_IMM(0x8000, REG_64::RCX);
+            emitter.OR32_REG(REG_64::RCX, REG_64::RAX);
+
+            emitter.MOV16_TO_MEM(REG_64::RAX, REG_64::RBX);
+            break;
+    }
+}
+
+void GSPixelJIT::emit_z_write()
+{
+    if (!has_z_buffer())
+        return;
+
+    emitter.MOV32_FROM_MEM(REG_64::R9, REG_64::RCX);
+    switch (state.zbuf_format)
+    {
+        case 0x0:
+            emitter.MOV32_TO_MEM(REG_64::RCX, REG_64::R14);
+            break;
+        case 0x1:
+            emitter.MOV32_FROM_MEM(REG_64::R14, REG_64::RAX);
+            emitter.AND32_REG_IMM(0xFF000000, REG_64::RAX);
+            emitter.AND32_REG_IMM(0xFFFFFF, REG_64::RCX);
+            emitter.OR32_REG(REG_64::RCX, REG_64::RAX);
+            emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R14);
+            break;
+        case 0x2:
+        case 0xA:
+            emitter.MOV16_TO_MEM(REG_64::RCX, REG_64::R14);
+            break;
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef GSPIXELJIT_HPP
+#define GSPIXELJIT_HPP
+#include <cstdint>
+#include <vector>
+#include "gscontext.hpp"
+#include "jitcommon/emitter64.hpp"
+
+struct RGBAQ_REG;
+
+//Draw state that a compiled pixel pipeline is specialized on
+struct PixelPipelineState
+{
+    TEST test;
+    ALPHA alpha;
+    uint8_t frame_format;
+    uint32_t frame_mask;
+    uint8_t zbuf_format;
+    bool zbuf_no_update;
+    bool FBA;
+    bool alpha_blend;
+    bool PABE;
+    bool DTHE;
+    bool COLCLAMP;
+};
+
+//A horizontal run of pixels on one line, passed to a compiled pipeline.
+//The swizzle rows and pages are precomputed for the line, so only x varies between pixels.
+struct PixelSpan
+{
+    uint8_t* local_mem;
+    const RGBAQ_REG* color;
+    const uint32_t* z;
+
+    //Swizzle table entries for the line and the page holding x = 0
+    const uint32_t* frame_row;
+    const uint32_t* z_row;
+    uint32_t frame_page;
+    uint32_t z_page;
+
+    //Signed dither offsets for the line, indexed by x & 3
+    const int32_t* dither;
+
+    int32_t x;
+    int32_t count;
+};
+
+typedef void (*PixelPipeline)(const PixelSpan* span);
+
+class GSPixelJIT
+{
+    private:
+        //Once full, the oldest pipelines are evicted to make room for new ones
+        constexpr static size_t CACHE_SIZE = 1024 * 1024 * 4;
+
+        JitCache cache;
+        Emitter64 emitter;
+
+        PixelPipelineState state;
+
+        //Jumps taken by pixels that are finished early, patched to the start of the next pixel
+        std::vector<uint8_t*> skip_jumps;
+
+        static bool is_supported(const PixelPipelineState& state);
+        static BlockState get_key(const PixelPipelineState& state);
+
+        void recompile(const PixelPipelineState& state);
+        void emit_prologue();
+        void emit_epilogue();
+
+        void emit_address(bool is_16bit, int row_offset, int page_offset, REG_64 dest);
+        void emit_pixel();
+        void emit_tail(bool update_frame, bool update_alpha, bool update_z);
+        void emit_depth_test();
+        void emit_frame_read();
+        void emit_blend();
+        void emit_blend_input(uint8_t spec, int channel, REG_64 dest);
+        void emit_no_blend();
+        void emit_clamp(REG_64 reg);
+        void emit_frame_write(bool update_alpha);
+        void emit_z_write();
+
+        bool blend_reads_frame();
+        bool has_z_buffer();
+    public:
+        GSPixelJIT();
+
+        void reset();
+
+        //Returns nullptr for states that have to be drawn by GraphicsSynthesizerThread::draw_pixel instead
+        PixelPipeline get_pipeline(const PixelPipelineState& state);
+};
+
+#endif // GSPIXELJIT_HPP
@@ -0,0 +1,268 @@
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include "gsspan.hpp"
+
+//MSVC compiles AVX2 intrinsics anywhere, GCC and Clang only in functions built for it
+#ifdef _MSC_VER
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+bool has_avx2()
+{
+#ifdef _MSC_VER
+    static const bool supported = []
+    {
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+
+        //The OS also has to save the upper halves of the YMM registers
+        __cpuid(info, 1);
+        bool osxsave = info[2] & (1 << 27);
+        bool avx = info[2] & (1 << 28);
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    }();
+#else
+    static const bool supported = __builtin_cpu_supports("avx2");
+#endif
+    return supported;
+}
+
+//Scalar reference for a single pixel, also used for leftovers and lanes the SIMD paths can't convert.
+//The float to integer conversions here are the ones the rasterizer has always used.
+static void interpolate_pixel(const SpanGradient& start, const SpanGradient& step, int i, int index,
+                              SpanTexMode mode, const SpanOutput& out)
+{
+    float fi = (float)i;
+    float q = start.q + step.q * fi;
+
+    RGBAQ_REG& color = out.color[index];
+    color.r = start.r + step.r * fi;
+    color.g = start.g + step.g * fi;
+    color.b = start.b + step.b * fi;
+    color.a = start.a + step.a * fi;
+    color.q = q;
+    out.z[index] = (uint32_t)((start.z + step.z * fi) * 16.f);
+
+    if (mode == SpanTexMode::NONE)
+        return;
+
+    out.fog[index] = start.fog + step.fog * fi;
+    if (mode == SpanTexMode::STQ)
+    {
+        float s = (start.s + step.s * fi) * 16.f;
+        float t = (start.t + step.t * fi) * 16.f;
+        float q16 = q * 16.f;
+
+        out.s[index] = s / q16;
+        out.t[index] = t / q16;
+    }
+    else
+    {
+        out.u[index] = (uint32_t)(start.u + step.u * fi);
+        out.v[index] = (uint32_t)(start.v + step.v * fi);
+    }
+}
+
+static inline __m128 lerp_sse2(float start, float step, __m128 fi)
+{
+    return _mm_add_ps(_mm_set1_ps(start), _mm_mul_ps(_mm_set1_ps(step), fi));
+}
+
+//A scalar float to uint32_t cast goes through a 64-bit integer, so values from 2^31 up are handled separately.
+//Returns false if any lane is outside [-2^31, 2^32), where only the scalar conversion gives the right bits.
+static inline bool convert_u32_sse2(__m128 f, __m128i& result)
+{
+    const __m128 two31 = _mm_set1_ps(2147483648.f);
+    __m128 in_range = _mm_and_ps(_mm_cmpge_ps(f, _mm_set1_ps(-2147483648.f)),
+                                 _mm_cmplt_ps(f, _mm_set1_ps(4294967296.f)));
+    if (_mm_movemask_ps(in_range) != 0xF)
+        return false;
+
+    __m128 high = _mm_cmpge_ps(f, two31);
+    result = _mm_cvttps_epi32(_mm_sub_ps(f, _mm_and_ps(high, two31)));
+    result = _mm_xor_si128(result, _mm_slli_epi32(_mm_castps_si128(high), 31));
+    return true;
+}
+
+//Keeps the low 16 bits of each lane, the same truncation as converting to int16_t
+static inline __m128i pack_low16(__m128i a, __m128i b)
+{
+    a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+    b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+    return _mm_packs_epi32(a, b);
+}
+
+static inline void store_colors(RGBAQ_REG* dest, __m128i r, __m128i g, __m128i b, __m128i a, __m128 q)
+{
+    //Interleave the channels into r, g, b, a for each pixel
+    __m128i rg = pack_low16(r, g);
+    __m128i ba = pack_low16(b, a);
+    rg = _mm_unpacklo_epi16(rg, _mm_srli_si128(rg, 8));
+    ba = _mm_unpacklo_epi16(ba, _mm_srli_si128(ba, 8));
+    __m128i lo = _mm_unpacklo_epi32(rg, ba);
+    __m128i hi = _mm_unpackhi_epi32(rg, ba);
+
+    _mm_storel_epi64((__m128i*)&dest[0], lo);
+    _mm_storel_epi64((__m128i*)&dest[1], _mm_srli_si128(lo, 8));
+    _mm_storel_epi64((__m128i*)&dest[2], hi);
+    _mm_storel_epi64((__m128i*)&dest[3], _mm_srli_si128(hi, 8));
+
+    float qs[4];
+    _mm_storeu_ps(qs, q);
+    for (int i = 0; i < 4; i++)
+        dest[i].q = qs[i];
+}
+
+static inline void store_fog(uint8_t* dest, __m128i fog)
+{
+    int32_t values[4];
+    _mm_storeu_si128((__m128i*)values, fog);
+    for (int i = 0; i < 4; i++)
+        dest[i] = values[i];
+}
+
+static void interpolate_sse2(const SpanGradient& start, const SpanGradient& step, int i, int index,
+                             SpanTexMode mode, const SpanOutput& out)
+{
+    __m128 fi = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(i), _mm_set_epi32(3, 2, 1, 0)));
+
+    __m128i z, u = _mm_setzero_si128(), v = _mm_setzero_si128();
+    bool converted = convert_u32_sse2(_mm_mul_ps(lerp_sse2(start.z, step.z, fi), _mm_set1_ps(16.f)), z);
+    if (mode == SpanTexMode::UV)
+    {
+        converted = converted && convert_u32_sse2(lerp_sse2(start.u, step.u, fi), u);
+        converted = converted && convert_u32_sse2(lerp_sse2(start.v, step.v, fi), v);
+    }
+    if (!converted)
+    {
+        for (int j = 0; j < 4; j++)
+            interpolate_pixel(start, step, i + j, index + j, mode, out);
+        return;
+    }
+
+    __m128 q = lerp_sse2(start.q, step.q, fi);
+    store_colors(&out.color[index],
+                 _mm_cvttps_epi32(lerp_sse2(start.r, step.r, fi)),
+                 _mm_cvttps_epi32(lerp_sse2(start.g, step.g, fi)),
+                 _mm_cvttps_epi32(lerp_sse2(start.b, step.b, fi)),
+                 _mm_cvttps_epi32(lerp_sse2(start.a, step.a, fi)), q);
+    _mm_storeu_si128((__m128i*)&out.z[index], z);
+
+    if (mode == SpanTexMode::NONE)
+        return;
+
+    store_fog(&out.fog[index], _mm_cvttps_epi32(lerp_sse2(start.fog, step.fog, fi)));
+    if (mode == SpanTexMode::STQ)
+    {
+        const __m128 sixteen = _mm_set1_ps(16.f);
+        __m128 q16 = _mm_mul_ps(q, sixteen);
+        _mm_storeu_ps(&out.s[index], _mm_div_ps(_mm_mul_ps(lerp_sse2(start.s, step.s, fi), sixteen), q16));
+        _mm_storeu_ps(&out.t[index], _mm_div_ps(_mm_mul_ps(lerp_sse2(start.t, step.t, fi), sixteen), q16));
+    }
+    else
+    {
+        _mm_storeu_si128((__m128i*)&out.u[index], u);
+        _mm_storeu_si128((__m128i*)&out.v[index], v);
+    }
+}
+
+TARGET_AVX2
+static inline __m256 lerp_avx2(float start, float step, __m256 fi)
+{
+    return _mm256_add_ps(_mm256_set1_ps(start), _mm256_mul_ps(_mm256_set1_ps(step), fi));
+}
+
+TARGET_AVX2
+static inline bool convert_u32_avx2(__m256 f, __m256i& result)
+{
+    const __m256 two31 = _mm256_set1_ps(2147483648.f);
+    __m256 in_range = _mm256_and_ps(_mm256_cmp_ps(f, _mm256_set1_ps(-2147483648.f), _CMP_GE_OQ),
+                                    _mm256_cmp_ps(f, _mm256_set1_ps(4294967296.f), _CMP_LT_OQ));
+    if (_mm256_movemask_ps(in_range) != 0xFF)
+        return false;
+
+    __m256 high = _mm256_cmp_ps(f, two31, _CMP_GE_OQ);
+    result = _mm256_cvttps_epi32(_mm256_sub_ps(f, _mm256_and_ps(high, two31)));
+    result = _mm256_xor_si256(result, _mm256_slli_epi32(_mm256_castps_si256(high), 31));
+    return true;
+}
+
+TARGET_AVX2
+static void interpolate_avx2(const SpanGradient& start, const SpanGradient& step, int i, int index,
+                             SpanTexMode mode, const SpanOutput& out)
+{
+    __m256 fi = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(i), _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0)));
+
+    __m256i z, u = _mm256_setzero_si256(), v = _mm256_setzero_si256();
+    bool converted = convert_u32_avx2(_mm256_mul_ps(lerp_avx2(start.z, step.z, fi), _mm256_set1_ps(16.f)), z);
+    if (mode == SpanTexMode::UV)
+    {
+        converted = converted && convert_u32_avx2(lerp_avx2(start.u, step.u, fi), u);
+        converted = converted && convert_u32_avx2(lerp_avx2(start.v, step.v, fi), v);
+    }
+    if (!converted)
+    {
+        for (int j = 0; j < 8; j++)
+            interpolate_pixel(start, step, i + j, index + j, mode, out);
+        return;
+    }
+
+    __m256 q = lerp_avx2(start.q, step.q, fi);
+    __m256i r = _mm256_cvttps_epi32(lerp_avx2(start.r, step.r, fi));
+    __m256i g = _mm256_cvttps_epi32(lerp_avx2(start.g, step.g, fi));
+    __m256i b = _mm256_cvttps_epi32(lerp_avx2(start.b, step.b, fi));
+    __m256i a = _mm256_cvttps_epi32(lerp_avx2(start.a, step.a, fi));
+    store_colors(&out.color[index], _mm256_castsi256_si128(r), _mm256_castsi256_si128(g),
+                 _mm256_castsi256_si128(b), _mm256_castsi256_si128(a), _mm256_castps256_ps128(q));
+    store_colors(&out.color[index + 4], _mm256_extracti128_si256(r, 1), _mm256_extracti128_si256(g, 1),
+                 _mm256_extracti128_si256(b, 1), _mm256_extracti128_si256(a, 1), _mm256_extractf128_ps(q, 1));
+    _mm256_storeu_si256((__m256i*)&out.z[index], z);
+
+    if (mode == SpanTexMode::NONE)
+        return;
+
+    __m256i fog = _mm256_cvttps_epi32(lerp_avx2(start.fog, step.fog, fi));
+    store_fog(&out.fog[index], _mm256_castsi256_si128(fog));
+    store_fog(&out.fog[index + 4], _mm256_extracti128_si256(fog, 1));
+    if (mode == SpanTexMode::STQ)
+    {
+        const __m256 sixteen = _mm256_set1_ps(16.f);
+        __m256 q16 = _mm256_mul_ps(q, sixteen);
+        _mm256_storeu_ps(&out.s[index], _mm256_div_ps(_mm256_mul_ps(lerp_avx2(start.s, step.s, fi), sixteen), q16));
+        _mm256_storeu_ps(&out.t[index], _mm256_div_ps(_mm256_mul_ps(lerp_avx2(start.t, step.t, fi), sixteen), q16));
+    }
+    else
+    {
+        _mm256_storeu_si256((__m256i*)&out.u[index], u);
+        _mm256_storeu_si256((__m256i*)&out.v[index], v);
+    }
+}
+
+void interpolate_span(const SpanGradient& start, const SpanGradient& step, int first, int count,
+                      SpanTexMode mode, const SpanOutput& out, SpanPath path)
+{
+    int i = 0;
+    if (path == SpanPath::AVX2 || (path == SpanPath::AUTO && has_avx2()))
+    {
+        for (; i + 8 <= count; i += 8)
+            interpolate_avx2(start, step, first + i, i, mode, out);
+    }
+    if (path != SpanPath::SCALAR)
+    {
+        for (; i + 4 <= count; i += 4)
+            interpolate_sse2(start, step, first + i, i, mode, out);
+    }
+    for (; i < count; i++)
+        interpolate_pixel(start, step, first + i, i, mode, out);
+}
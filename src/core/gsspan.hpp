@@ -0,0 +1,51 @@
+#ifndef GSSPAN_HPP
+#define GSSPAN_HPP
+#include <cstdint>
+#include "gsthread.hpp"
+
+//How the texture coordinates of a span are produced
+enum class SpanTexMode
+{
+    NONE,
+    STQ,
+    UV
+};
+
+//Attributes of a span's first pixel, or their change from one pixel to the next.
+//Pixel i gets start + step * i, so the scalar and SIMD paths round identically.
+struct SpanGradient
+{
+    float z, r, g, b, a, q, s, t, u, v, fog;
+};
+
+//Destination arrays for the pixels of a span. fog is only written for textured spans,
+//s and t (already divided by q) for STQ mode and u and v for UV mode.
+struct SpanOutput
+{
+    RGBAQ_REG* color;
+    uint32_t* z;
+    uint8_t* fog;
+    float* s;
+    float* t;
+    int32_t* u;
+    int32_t* v;
+};
+
+//Which code interpolate_span runs. Anything but AUTO is only meant for checking the paths against each other.
+enum class SpanPath
+{
+    AUTO,
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+//Whether the CPU and OS support AVX2, checked once
+bool has_avx2();
+
+//Interpolates pixels [first, first + count) of a span into out[0, count).
+//Uses AVX2 when the CPU has it and SSE2 otherwise, with the scalar path handling leftovers.
+void interpolate_span(const SpanGradient& start, const SpanGradient& step, int first, int count,
+                      SpanTexMode mode, const SpanOutput& out, SpanPath path = SpanPath::AUTO);
+
+#endif // GSSPAN_HPP
@@ -0,0 +1,259 @@
+#include <cstring>
+#include <emmintrin.h>
+#include "gsswizzle.hpp"
+#include "gsmem.hpp"
+
+bool get_block_size(uint8_t format, int& width, int& height, int& bpp)
+{
+    switch (format)
+    {
+        case 0x00:
+        case 0x30:
+            width = 8;
+            height = 8;
+            bpp = 32;
+            return true;
+        case 0x01:
+        case 0x31:
+            width = 8;
+            height = 8;
+            bpp = 24;
+            return true;
+        case 0x02:
+        case 0x0A:
+        case 0x32:
+        case 0x3A:
+            width = 16;
+            height = 8;
+            bpp = 16;
+            return true;
+        case 0x13:
+            width = 16;
+            height = 16;
+            bpp = 8;
+            return true;
+        case 0x14:
+            width = 32;
+            height = 16;
+            bpp = 4;
+            return true;
+        default:
+            return false;
+    }
+}
+
+//Each 64-byte column holds two rows of pixels, alternating between them every 8 bytes
+static void swizzle_PSMCT32(uint8_t* block, const uint8_t* src, int pitch)
+{
+    for (int column = 0; column < 4; column++)
+    {
+        const uint8_t* row = src + column * 2 * pitch;
+        __m128i a0 = _mm_loadu_si128((__m128i*)row);
+        __m128i a1 = _mm_loadu_si128((__m128i*)(row + 16));
+        __m128i b0 = _mm_loadu_si128((__m128i*)(row + pitch));
+        __m128i b1 = _mm_loadu_si128((__m128i*)(row + pitch + 16));
+
+        uint8_t* dest = block + column * 64;
+        _mm_storeu_si128((__m128i*)dest, _mm_unpacklo_epi64(a0, b0));
+        _mm_storeu_si128((__m128i*)(dest + 16), _mm_unpackhi_epi64(a0, b0));
+        _mm_storeu_si128((__m128i*)(dest + 32), _mm_unpacklo_epi64(a1, b1));
+        _mm_storeu_si128((__m128i*)(dest + 48), _mm_unpackhi_epi64(a1, b1));
+    }
+}
+
+static void unswizzle_PSMCT32(uint8_t* dest, int pitch, const uint8_t* block)
+{
+    for (int column = 0; column < 4; column++)
+    {
+        const uint8_t* src = block + column * 64;
+        __m128i c0 = _mm_loadu_si128((__m128i*)src);
+        __m128i c1 = _mm_loadu_si128((__m128i*)(src + 16));
+        __m128i c2 = _mm_loadu_si128((__m128i*)(src + 32));
+        __m128i c3 = _mm_loadu_si128((__m128i*)(src + 48));
+
+        uint8_t* row = dest + column * 2 * pitch;
+        _mm_storeu_si128((__m128i*)row, _mm_unpacklo_epi64(c0, c1));
+        _mm_storeu_si128((__m128i*)(row + 16), _mm_unpacklo_epi64(c2, c3));
+        _mm_storeu_si128((__m128i*)(row + pitch), _mm_unpackhi_epi64(c0, c1));
+        _mm_storeu_si128((__m128i*)(row + pitch + 16), _mm_unpackhi_epi64(c2, c3));
+    }
+}
+
+//Pixels are packed three bytes apart in linear images, and the top byte of each pixel in local memory is left alone
+static void swizzle_PSMCT24(uint8_t* block, const uint8_t* src, int pitch)
+{
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+            memcpy(&block[columnTable32[y][x] * 4], &src[y * pitch + x * 3], 3);
+    }
+}
+
+static void unswizzle_PSMCT24(uint8_t* dest, int pitch, const uint8_t* block)
+{
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+            memcpy(&dest[y * pitch + x * 3], &block[columnTable32[y][x] * 4], 3);
+    }
+}
+
+//Same as PSMCT32 once pixel x of each row is paired with pixel x + 8
+static void swizzle_PSMCT16(uint8_t* block, const uint8_t* src, int pitch)
+{
+    for (int column = 0; column < 4; column++)
+    {
+        const uint8_t* row = src + column * 2 * pitch;
+        __m128i a_lo = _mm_loadu_si128((__m128i*)row);
+        __m128i a_hi = _mm_loadu_si128((__m128i*)(row + 16));
+        __m128i b_lo = _mm_loadu_si128((__m128i*)(row + pitch));
+        __m128i b_hi = _mm_loadu_si128((__m128i*)(row + pitch + 16));
+
+        __m128i a0 = _mm_unpacklo_epi16(a_lo, a_hi);
+        __m128i a1 = _mm_unpackhi_epi16(a_lo, a_hi);
+        __m128i b0 = _mm_unpacklo_epi16(b_lo, b_hi);
+        __m128i b1 = _mm_unpackhi_epi16(b_lo, b_hi);
+
+        uint8_t* dest = block + column * 64;
+        _mm_storeu_si128((__m128i*)dest, _mm_unpacklo_epi64(a0, b0));
+        _mm_storeu_si128((__m128i*)(dest + 16), _mm_unpackhi_epi64(a0, b0));
+        _mm_storeu_si128((__m128i*)(dest + 32), _mm_unpacklo_epi64(a1, b1));
+        _mm_storeu_si128((__m128i*)(dest + 48), _mm_unpackhi_epi64(a1, b1));
+    }
+}
+
+//Gathers the even and odd 16-bit lanes of a register into its low and high halves
+static inline __m128i deinterleave_epi16(__m128i value)
+{
+    value = _mm_shufflelo_epi16(value, _MM_SHUFFLE(3, 1, 2, 0));
+    value = _mm_shufflehi_epi16(value, _MM_SHUFFLE(3, 1, 2, 0));
+    return _mm_shuffle_epi32(value, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+static void unswizzle_PSMCT16(uint8_t* dest, int pitch, const uint8_t* block)
+{
+    for (int column = 0; column < 4; column++)
+    {
+        const uint8_t* src = block + column * 64;
+        __m128i c0 = _mm_loadu_si128((__m128i*)src);
+        __m128i c1 = _mm_loadu_si128((__m128i*)(src + 16));
+        __m128i c2 = _mm_loadu_si128((__m128i*)(src + 32));
+        __m128i c3 = _mm_loadu_si128((__m128i*)(src + 48));
+
+        __m128i a0 = deinterleave_epi16(_mm_unpacklo_epi64(c0, c1));
+        __m128i a1 = deinterleave_epi16(_mm_unpacklo_epi64(c2, c3));
+        __m128i b0 = deinterleave_epi16(_mm_unpackhi_epi64(c0, c1));
+        __m128i b1 = deinterleave_epi16(_mm_unpackhi_epi64(c2, c3));
+
+        uint8_t* row = dest + column * 2 * pitch;
+        _mm_storeu_si128((__m128i*)row, _mm_unpacklo_epi64(a0, a1));
+        _mm_storeu_si128((__m128i*)(row + 16), _mm_unpackhi_epi64(a0, a1));
+        _mm_storeu_si128((__m128i*)(row + pitch), _mm_unpacklo_epi64(b0, b1));
+        _mm_storeu_si128((__m128i*)(row + pitch + 16), _mm_unpackhi_epi64(b0, b1));
+    }
+}
+
+//The 8-bit and 4-bit layouts shuffle across rows in ways that don't map well to SSE2, so they go through the column tables
+static void swizzle_PSMCT8(uint8_t* block, const uint8_t* src, int pitch)
+{
+    for (int y = 0; y < 16; y++)
+    {
+        for (int x = 0; x < 16; x++)
+            block[columnTable8[y][x]] = src[y * pitch + x];
+    }
+}
+
+static void unswizzle_PSMCT8(uint8_t* dest, int pitch, const uint8_t* block)
+{
+    for (int y = 0; y < 16; y++)
+    {
+        for (int x = 0; x < 16; x++)
+            dest[y * pitch + x] = block[columnTable8[y][x]];
+    }
+}
+
+//Pixels with an even x are in the low nibble of a byte, both in linear images and local memory
+static void swizzle_PSMCT4(uint8_t* block, const uint8_t* src, int pitch)
+{
+    uint8_t swizzled[256];
+    memset(swizzled, 0, sizeof(swizzled));
+    for (int y = 0; y < 16; y++)
+    {
+        for (int x = 0; x < 32; x++)
+        {
+            uint8_t value = (src[y * pitch + (x >> 1)] >> ((x & 1) << 2)) & 0xF;
+            uint16_t nibble = columnTable4[y][x];
+            swizzled[nibble >> 1] |= value << ((nibble & 1) << 2);
+        }
+    }
+    memcpy(block, swizzled, sizeof(swizzled));
+}
+
+static void unswizzle_PSMCT4(uint8_t* dest, int pitch, const uint8_t* block)
+{
+    for (int y = 0; y < 16; y++)
+    {
+        for (int x = 0; x < 32; x += 2)
+        {
+            uint16_t even = columnTable4[y][x];
+            uint16_t odd = columnTable4[y][x + 1];
+            uint8_t low = (block[even >> 1] >> ((even & 1) << 2)) & 0xF;
+            uint8_t high = (block[odd >> 1] >> ((odd & 1) << 2)) & 0xF;
+            dest[y * pitch + (x >> 1)] = low | (high << 4);
+        }
+    }
+}
+
+void swizzle_block(uint8_t format, uint8_t* block, const uint8_t* src, int pitch)
+{
+    switch (format)
+    {
+        case 0x00:
+        case 0x30:
+            swizzle_PSMCT32(block, src, pitch);
+            break;
+        case 0x01:
+        case 0x31:
+            swizzle_PSMCT24(block, src, pitch);
+            break;
+        case 0x02:
+        case 0x0A:
+        case 0x32:
+        case 0x3A:
+            swizzle_PSMCT16(block, src, pitch);
+            break;
+        case 0x13:
+            swizzle_PSMCT8(block, src, pitch);
+            break;
+        case 0x14:
+            swizzle_PSMCT4(block, src, pitch);
+            break;
+    }
+}
+
+void unswizzle_block(uint8_t format, uint8_t* dest, int pitch, const uint8_t* block)
+{
+    switch (format)
+    {
+        case 0x00:
+        case 0x30:
+            unswizzle_PSMCT32(dest, pitch, block);
+            break;
+        case 0x01:
+        case 0x31:
+            unswizzle_PSMCT24(dest, pitch, block);
+            break;
+        case 0x02:
+        case 0x0A:
+        case 0x32:
+        case 0x3A:
+            unswizzle_PSMCT16(dest, pitch, block);
+            break;
+        case 0x13:
+            unswizzle_PSMCT8(dest, pitch, block);
+            break;
+        case 0x14:
+            unswizzle_PSMCT4(dest, pitch, block);
+            break;
+    }
+}
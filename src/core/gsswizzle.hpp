@@ -0,0 +1,19 @@
+#ifndef GSSWIZZLE_HPP
+#define GSSWIZZLE_HPP
+#include <cstdint>
+
+//Block-at-a-time conversion between linear images and the swizzled layout of GS local memory.
+//A block is always 256 bytes: 8x8 pixels for PSMCT32/24, 16x8 for PSMCT16(S), 16x16 for PSMCT8 and 32x16 for PSMCT4.
+//The Z formats lay out blocks the same way as their color counterparts.
+//Only the layout within a block is handled here, callers find the block with the usual addressing functions.
+
+//Block dimensions and bits per pixel of a format, false if the format has no block kernels
+bool get_block_size(uint8_t format, int& width, int& height, int& bpp);
+
+//Copies a block from rows of linear pixels, pitch bytes apart, into local memory
+void swizzle_block(uint8_t format, uint8_t* block, const uint8_t* src, int pitch);
+
+//The reverse of swizzle_block
+void unswizzle_block(uint8_t format, uint8_t* dest, int pitch, const uint8_t* block);
+
+#endif // GSSWIZZLE_HPP
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cstring>
+#include "gstexcache.hpp"
+
+bool TextureKey::operator==(const TextureKey& other) const
+{
+    if (tex_base != other.tex_base || buffer_width != other.buffer_width || format != other.format)
+        return false;
+    if (width != other.width || height != other.height)
+        return false;
+    if (alpha0 != other.alpha0 || alpha1 != other.alpha1 || trans_black != other.trans_black)
+        return false;
+    if (paletted != other.paletted)
+        return false;
+    if (!paletted)
+        return true;
+    if (clut_format != other.clut_format || clut_offset != other.clut_offset || use_CSM2 != other.use_CSM2)
+        return false;
+    return !memcmp(clut, other.clut, sizeof(clut));
+}
+
+GSTextureCache::GSTextureCache() : texel_count(0), use_counter(0)
+{
+
+}
+
+GSTextureCache::~GSTextureCache()
+{
+    clear();
+}
+
+//Dimensions in pixels of a page of the given format
+static void get_page_size(uint8_t format, uint32_t& width, uint32_t& height)
+{
+    switch (format)
+    {
+        case 0x02: //PSMCT16
+        case 0x0A: //PSMCT16S
+        case 0x32: //PSMZ16
+        case 0x3A: //PSMZ16S
+            width = 64;
+            height = 64;
+            break;
+        case 0x13: //PSMT8
+            width = 128;
+            height = 64;
+            break;
+        case 0x14: //PSMT4
+            width = 128;
+            height = 128;
+            break;
+        default:
+            width = 64;
+            height = 32;
+            break;
+    }
+}
+
+GSTextureCache::PageMask GSTextureCache::get_pages(uint32_t base, uint32_t width, uint8_t format,
+                                                   uint32_t x, uint32_t y, uint32_t w, uint32_t h)
+{
+    uint32_t page_width, page_height;
+    get_page_size(format, page_width, page_height);
+
+    PageMask pages;
+    uint32_t row_pages = std::max(1U, (width + page_width - 1) / page_width);
+    uint32_t first_row = y / page_height;
+    uint32_t rows = (y + h + page_height - 1) / page_height - first_row;
+    uint32_t last_row_pages = std::max(row_pages, (x + w + page_width - 1) / page_width);
+
+    //The extra page covers bases that aren't page-aligned
+    uint32_t count = (rows ? (rows - 1) * row_pages + last_row_pages : 0) + 1;
+    if (count >= PAGES)
+    {
+        pages.set();
+        return pages;
+    }
+
+    uint32_t first = base / PAGE_SIZE + first_row * row_pages;
+    for (uint32_t i = 0; i < count; i++)
+        pages.set((first + i) % PAGES);
+    return pages;
+}
+
+CachedTexture* GSTextureCache::find(const TextureKey& key)
+{
+    for (CachedTexture* texture : textures)
+    {
+        if (texture->key == key)
+        {
+            texture->last_used = ++use_counter;
+            return texture;
+        }
+    }
+    return nullptr;
+}
+
+CachedTexture* GSTextureCache::insert(const TextureKey& key)
+{
+    size_t size = (size_t)key.width * key.height;
+
+    //Make room by dropping the least recently used textures
+    while (!textures.empty() && texel_count + size > MAX_TEXELS)
+    {
+        auto oldest = std::min_element(textures.begin(), textures.end(),
+                                       [](const CachedTexture* a, const CachedTexture* b)
+                                       { return a->last_used < b->last_used; });
+        texel_count -= (*oldest)->texels.size();
+        delete *oldest;
+        textures.erase(oldest);
+    }
+
+    CachedTexture* texture = new CachedTexture;
+    texture->key = key;
+    texture->pages = get_pages(key.tex_base, key.buffer_width, key.format, 0, 0, key.width, key.height);
+    texture->last_used = ++use_counter;
+    texture->texels.resize(size);
+    texel_count += size;
+    textures.push_back(texture);
+    return texture;
+}
+
+void GSTextureCache::invalidate(const PageMask& pages)
+{
+    for (auto it = textures.begin(); it != textures.end();)
+    {
+        if (((*it)->pages & pages).any())
+        {
+            texel_count -= (*it)->texels.size();
+            delete *it;
+            it = textures.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
+void GSTextureCache::clear()
+{
+    for (CachedTexture* texture : textures)
+        delete texture;
+    textures.clear();
+    texel_count = 0;
+}
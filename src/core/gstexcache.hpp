@@ -0,0 +1,70 @@
+#ifndef GSTEXCACHE_HPP
+#define GSTEXCACHE_HPP
+#include <bitset>
+#include <cstdint>
+#include <vector>
+
+//Everything that affects the decoded colors of a texture
+struct TextureKey
+{
+    uint32_t tex_base;
+    uint32_t buffer_width;
+    uint8_t format;
+    uint16_t width, height;
+
+    //TEXA settings, used by 24-bit and 16-bit formats and 16-bit CLUTs
+    uint8_t alpha0, alpha1;
+    bool trans_black;
+
+    //CLUT state, only compared for paletted formats
+    bool paletted;
+    uint8_t clut_format;
+    uint16_t clut_offset;
+    bool use_CSM2;
+    uint8_t clut[1024];
+
+    bool operator==(const TextureKey& other) const;
+};
+
+struct CachedTexture
+{
+    TextureKey key;
+    std::bitset<512> pages;
+    uint64_t last_used;
+
+    //RGBA8888, width * height texels in rows
+    std::vector<uint32_t> texels;
+};
+
+//Textures decoded to linear RGBA8888, kept until a write to local memory touches one of their pages.
+//Decoding is done by the caller, as it needs the GS swizzling functions.
+class GSTextureCache
+{
+    public:
+        constexpr static int PAGES = 512;
+        typedef std::bitset<PAGES> PageMask;
+    private:
+        constexpr static uint32_t PAGE_SIZE = 2048 * 4;
+        constexpr static size_t MAX_TEXELS = 1024 * 1024 * 4;
+
+        std::vector<CachedTexture*> textures;
+        size_t texel_count;
+        uint64_t use_counter;
+    public:
+        GSTextureCache();
+        ~GSTextureCache();
+
+        //Conservative set of pages a rectangle of a buffer in the given format can touch
+        static PageMask get_pages(uint32_t base, uint32_t width, uint8_t format,
+                                  uint32_t x, uint32_t y, uint32_t w, uint32_t h);
+
+        CachedTexture* find(const TextureKey& key);
+
+        //Returns an entry with space for the texels, which the caller fills in
+        CachedTexture* insert(const TextureKey& key);
+
+        void invalidate(const PageMask& pages);
+        void clear();
+};
+
+#endif // GSTEXCACHE_HPP
@@ -1,12 +1,17 @@
 #include <algorithm>
+#include <cstddef>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <cmath>
 #include <fstream>
+#include <utility>
 
 #include "gsthread.hpp"
 #include "gsmem.hpp"
+#include "gspixeljit.hpp"
+#include "gsspan.hpp"
+#include "gsswizzle.hpp"
 #include "errors.hpp"
 
 using namespace std;
@@ -140,6 +145,25 @@ GraphicsSynthesizerThread::GraphicsSynthesizerThread()
         log2_lookup[i][3] = ldexp(calculation, 3);
     }
 
+    raster_thread_count = std::max(1U, std::min(std::thread::hardware_concurrency(), (unsigned int)MAX_RASTER_THREADS));
+    for (int i = 0; i < MAX_RASTER_THREADS; i++)
+    {
+        raster_workers[i].id = i;
+        raster_workers[i].span_x = 0;
+        raster_workers[i].span_y = 0;
+        raster_workers[i].span_count = 0;
+    }
+    pixel_jit = new GSPixelJIT();
+    pixel_pipeline = nullptr;
+    current_texture = nullptr;
+    texture_in_target = false;
+    frame_in_zbuf = false;
+    draw_state_valid = false;
+    draw_queue.reserve(MAX_QUEUED_PRIMS);
+    gsdump_recording = false;
+
+    //Reset before the thread starts, so nothing sent to it can be cleared out of the message queue by the reset
+    reset();
     thread = std::thread(&GraphicsSynthesizerThread::event_loop, this);
 }
 
@@ -148,6 +172,7 @@ GraphicsSynthesizerThread::~GraphicsSynthesizerThread()
     delete[] local_mem;
     delete message_queue;
     delete return_queue;
+    delete pixel_jit;
 }
 
 void GraphicsSynthesizerThread::wait_for_return(GSReturn type, GSReturnMessage &data)
@@ -196,16 +221,170 @@ void GraphicsSynthesizerThread::wait_for_return(GSReturn type, GSReturnMessage &
     }
 }
 
+//Parts of a message's payload that are sent through the FIFO, as the payload union is mostly padding for
+//the common commands. Returns the number of fields.
+static int get_payload_fields(GSCommand type, GSMessagePayload& payload, std::pair<void*, size_t>* fields)
+{
+    switch (type)
+    {
+        case write64_t:
+            fields[0] = {&payload.write64_payload.addr, sizeof(payload.write64_payload.addr)};
+            fields[1] = {&payload.write64_payload.value, sizeof(payload.write64_payload.value)};
+            return 2;
+        case set_rgba_t:
+            fields[0] = {&payload.rgba_payload, sizeof(payload.rgba_payload)};
+            return 1;
+        case set_st_t:
+            fields[0] = {&payload.st_payload, sizeof(payload.st_payload)};
+            return 1;
+        case set_uv_t:
+            fields[0] = {&payload.uv_payload, sizeof(payload.uv_payload)};
+            return 1;
+        case set_xyz_t:
+            fields[0] = {&payload.xyz_payload, offsetof(GSMessagePayload, xyz_payload.drawing_kick) + 1};
+            return 1;
+        case set_xyzf_t:
+            fields[0] = {&payload.xyzf_payload, offsetof(GSMessagePayload, xyzf_payload.drawing_kick) + 1};
+            return 1;
+        case gif_packet_t:
+            fields[0] = {&payload.gif_packet_payload, sizeof(payload.gif_packet_payload)};
+            return 1;
+        default:
+            fields[0] = {&payload, sizeof(payload)};
+            return 1;
+    }
+}
+
+//Messages go through the FIFO as a command byte followed by the fields of the payload the command uses,
+//and for GIF packets, the packet's data
+void GraphicsSynthesizerThread::push_message(GSMessage& message, const void* data, size_t size)
+{
+    uint8_t record[1 + sizeof(GSMessagePayload)];
+    size_t record_size = 1;
+    record[0] = message.type;
+
+    std::pair<void*, size_t> fields[2];
+    int field_count = get_payload_fields(message.type, message.payload, fields);
+    for (int i = 0; i < field_count; i++)
+    {
+        memcpy(record + record_size, fields[i].first, fields[i].second);
+        record_size += fields[i].second;
+    }
+
+    if (!message_queue->has_space(record_size + size))
+    {
+        //The GS thread may be asleep with a full FIFO, so wake it up until it frees enough space
+        while (!message_queue->has_space(record_size + size))
+        {
+            //A stopped thread will never drain the FIFO, so pass on the error it stopped with instead of waiting
+            if (thread_stopped)
+            {
+                GSReturnMessage data;
+                while (return_queue->pop(data))
+                {
+                    if (data.type == death_error_t)
+                    {
+                        auto p = data.payload.death_error_payload;
+                        std::string error(p.error_str);
+                        delete[] p.error_str;
+                        Errors::die("%s", error.c_str());
+                    }
+                }
+                Errors::die("[GS] FIFO FULL with the GS thread stopped");
+            }
+            send_data = true;
+            wake_thread();
+            std::this_thread::yield();
+        }
+    }
+    message_queue->write(record, record_size);
+    if (size)
+        message_queue->write(data, size);
+    message_queue->commit();
+    send_data = true;
+}
+
 void GraphicsSynthesizerThread::send_message(GSMessage message)
 {
     printf("[GS] Notifying gs thread of new data\n");
-    message_queue->push(message);
-    send_data = true;
+    //Anything sent after GIF data has to be seen after it
+    flush_GIF_packet();
+    push_message(message, nullptr, 0);
+}
+
+void GraphicsSynthesizerThread::send_GIF_data(int path, const uint128_t& quad)
+{
+    if (gif_packet_count && (path != gif_packet_path || gif_packet_count == MAX_GIF_PACKET_QUADS))
+        flush_GIF_packet();
+    gif_packet_path = path;
+    gif_packet[gif_packet_count] = quad;
+    gif_packet_count++;
+}
+
+void GraphicsSynthesizerThread::flush_GIF_packet()
+{
+    if (!gif_packet_count)
+        return;
+
+    GSMessage message;
+    message.type = gif_packet_t;
+    message.payload.gif_packet_payload = { (uint8_t)gif_packet_path, gif_packet_count };
+
+    //Cleared first, as waiting for space wakes the GS thread, which flushes again
+    gif_packet_count = 0;
+    push_message(message, gif_packet, message.payload.gif_packet_payload.count * sizeof(uint128_t));
+}
+
+bool GraphicsSynthesizerThread::pop_message(GSMessage& message)
+{
+    if (!message_queue->has_data())
+        return false;
+
+    uint8_t type;
+    message_queue->read(&type, sizeof(type));
+    message.type = (GSCommand)type;
+
+    std::pair<void*, size_t> fields[2];
+    int field_count = get_payload_fields(message.type, message.payload, fields);
+    for (int i = 0; i < field_count; i++)
+        message_queue->read(fields[i].first, fields[i].second);
+    return true;
+}
+
+uint128_t GraphicsSynthesizerThread::read_download()
+{
+    if (download_pos == download_buffer.size())
+    {
+        GSMessagePayload payload;
+        payload.no_payload = { 0 };
+        send_message({ GSCommand::request_local_host_tx, payload });
+        wake_thread();
+        GSReturnMessage data;
+        wait_for_return(GSReturn::local_host_transfer, data);
+
+        //Reading with no transfer active gives zeroes
+        if (download_buffer.empty())
+        {
+            uint128_t zero;
+            zero._u64[0] = 0;
+            zero._u64[1] = 0;
+            return zero;
+        }
+    }
+    return download_buffer[download_pos++];
+}
+
+//Anything left of a previous transfer is dropped when a new one is started
+void GraphicsSynthesizerThread::reset_download()
+{
+    download_buffer.clear();
+    download_pos = 0;
 }
 
 void GraphicsSynthesizerThread::wake_thread()
 {
     printf("[GS] Waking GS Thread\n");
+    flush_GIF_packet();
     std::unique_lock<std::mutex> lk(data_mutex);
     notifier.notify_one();
 }
@@ -220,8 +399,9 @@ void GraphicsSynthesizerThread::reset_fifos()
     GSReturnMessage data;
     while (return_queue->pop(data));
 
-    GSMessage data2;
-    while (message_queue->pop(data2));
+    message_queue->clear();
+    gif_packet_count = 0;
+    reset_download();
 }
 
 void GraphicsSynthesizerThread::exit()
@@ -241,10 +421,7 @@ void GraphicsSynthesizerThread::event_loop()
 {
     printf("[GS_t] Starting GS Thread\n");
 
-    reset();
-
-    bool gsdump_recording = false;
-    ofstream gsdump_file;
+    start_raster_threads();
 
     try
     {
@@ -252,11 +429,18 @@ void GraphicsSynthesizerThread::event_loop()
         {
             GSMessage data;
 
-            if (message_queue->pop(data))
+            if (pop_message(data))
             {
-                if (gsdump_recording)
+                //GIF packets are recorded as the messages they decode to, see process_GIF_packet
+                if (gsdump_recording && data.type != gif_packet_t)
                     gsdump_file.write((char*)&data, sizeof(data));
 
+                if (data.type != gif_packet_t &&
+                        !(data.type == write64_t && data.payload.write64_payload.addr == 0x54))
+                    sync_block_transfer();
+                if (transfer_buffer_loaded && data.type != request_local_host_tx)
+                    transfer_buffer_loaded = false;
+
                 switch (data.type)
                 {
                     case write64_t:
@@ -366,6 +550,8 @@ void GraphicsSynthesizerThread::event_loop()
                         break;
                     }
                     case die_t:
+                        stop_raster_threads();
+                        thread_stopped = true;
                         return;
                     case load_state_t:
                     {
@@ -409,10 +595,17 @@ void GraphicsSynthesizerThread::event_loop()
                         }
                         break;
                     }
+                    case gif_packet_t:
+                    {
+                        auto p = data.payload.gif_packet_payload;
+                        process_GIF_packet(p.path, p.count);
+                        break;
+                    }
                     case request_local_host_tx:
                     {
+                        download_transfer();
                         GSReturnMessagePayload return_payload;
-                        return_payload.data_payload.quad_data = local_to_host();
+                        return_payload.no_payload = { 0 };
                         return_queue->push({ GSReturn::local_host_transfer, return_payload });
                         std::unique_lock<std::mutex> lk(data_mutex);
                         recieve_data = true;
@@ -425,6 +618,8 @@ void GraphicsSynthesizerThread::event_loop()
             }
             else
             {
+                //Finish any queued drawing before going idle
+                flush_draws();
                 printf("GS Thread: No messages waiting, going to sleep\n");
                 std::unique_lock<std::mutex> lk(data_mutex);
                 notifier.wait(lk, [this] {return send_data;});
@@ -434,22 +629,120 @@ void GraphicsSynthesizerThread::event_loop()
     }
     catch (Emulation_error &e)
     {
+        stop_raster_threads();
         GSReturnMessagePayload return_payload;
         char* copied_string = new char[ERROR_STRING_MAX_LENGTH];
         strncpy(copied_string, e.what(), ERROR_STRING_MAX_LENGTH);
         return_payload.death_error_payload.error_str = { copied_string };
         return_queue->push({ GSReturn::death_error_t, return_payload });
+        thread_stopped = true;
         recieve_data = true;
         notifier.notify_one();
     }
 }
 
+void GraphicsSynthesizerThread::start_raster_threads()
+{
+    raster_generation = 0;
+    raster_busy = 0;
+    raster_exit = false;
+    draw_serially = false;
+    for (int i = 1; i < raster_thread_count; i++)
+        raster_threads[i] = std::thread(&GraphicsSynthesizerThread::raster_loop, this, i);
+}
+
+void GraphicsSynthesizerThread::stop_raster_threads()
+{
+    {
+        std::unique_lock<std::mutex> lk(raster_mutex);
+        raster_exit = true;
+    }
+    raster_start.notify_all();
+    for (int i = 1; i < raster_thread_count; i++)
+    {
+        if (raster_threads[i].joinable())
+            raster_threads[i].join();
+    }
+    draw_queue.clear();
+}
+
+void GraphicsSynthesizerThread::raster_loop(int id)
+{
+    RasterWorker& worker = raster_workers[id];
+    uint32_t generation = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lk(raster_mutex);
+            raster_start.wait(lk, [&] { return raster_exit || raster_generation != generation; });
+            if (raster_exit)
+                return;
+            generation = raster_generation;
+        }
+
+        render_bin(worker);
+
+        std::unique_lock<std::mutex> lk(raster_mutex);
+        raster_busy--;
+        if (!raster_busy)
+            raster_done.notify_one();
+    }
+}
+
+void GraphicsSynthesizerThread::render_bin(RasterWorker& worker)
+{
+    try
+    {
+        for (uint32_t index : worker.bin)
+            draw_primitive(draw_queue[index].type, draw_queue[index].vtx, worker);
+    }
+    catch (Emulation_error &e)
+    {
+        //Errors are passed back to the GS thread, which rethrows them once every worker is done
+        std::unique_lock<std::mutex> lk(raster_mutex);
+        if (raster_error.empty())
+            raster_error = e.what();
+    }
+    worker.bin.clear();
+}
+
+//Draws everything in the queue. Must be called before anything that reads or writes VRAM outside of drawing,
+//or changes state used by the rasterizer.
+void GraphicsSynthesizerThread::flush_draws()
+{
+    if (draw_queue.empty())
+        return;
+
+    {
+        std::unique_lock<std::mutex> lk(raster_mutex);
+        raster_busy = raster_thread_count - 1;
+        raster_generation++;
+    }
+    raster_start.notify_all();
+
+    render_bin(raster_workers[0]);
+
+    {
+        std::unique_lock<std::mutex> lk(raster_mutex);
+        raster_done.wait(lk, [this] { return !raster_busy; });
+    }
+    draw_queue.clear();
+
+    if (!raster_error.empty())
+    {
+        std::string error = raster_error;
+        raster_error.clear();
+        Errors::die("%s", error.c_str());
+    }
+}
+
 void GraphicsSynthesizerThread::reset()
 {
     if (!local_mem)
         local_mem = new uint8_t[1024 * 1024 * 4];
 
     pixels_transferred = 0;
+    TRXDIR = 3;
     num_vertices = 0;
     frame_count = 0;
 
@@ -460,16 +753,25 @@ void GraphicsSynthesizerThread::reset()
     context2.reset();
     PSMCT24_color = 0;
     PSMCT24_unpacked_count = 0;
+    transfer_blocks = false;
+    transfer_buffer_pos = 0;
+    transfer_buffer_loaded = false;
+    for (int i = 0; i < 4; i++)
+        gif_path[i].data_left = 0;
+    gif_Q = 1.0f;
     current_ctx = &context1;
     current_PRMODE = &PRIM;
     PRIM.reset();
     PRMODE.reset();
+    draw_state_valid = false;
+    texture_cache.clear();
 
     reset_fifos();
 }
 
 void GraphicsSynthesizerThread::memdump(uint32_t* target, uint16_t& width, uint16_t& height)
 {
+    flush_draws();
     SCISSOR s = current_ctx->scissor;
     width = min(static_cast<uint16_t>(s.x2 - s.x1), (uint16_t)current_ctx->frame.width);
     height = min(static_cast<uint16_t>(s.y2 - s.y1), (uint16_t)480);
@@ -554,6 +856,8 @@ void GraphicsSynthesizerThread::render_single_CRT(uint32_t *target, DISPFB &disp
 
 void GraphicsSynthesizerThread::render_CRT(uint32_t* target)
 {
+    flush_draws();
+
     //Circuit 1 only
     if (reg.PMODE.circuit1 && !reg.PMODE.circuit2)
         render_single_CRT(target, reg.DISPFB1, reg.DISPLAY1);
@@ -676,6 +980,11 @@ void GraphicsSynthesizerThread::write64(uint32_t addr, uint64_t value)
     if (reg.write64(addr, value))
         return;
     addr &= 0xFFFF;
+    if (draw_state_changed(addr, value))
+    {
+        flush_draws();
+        draw_state_valid = false;
+    }
     switch (addr)
     {
         case 0x0000:
@@ -964,6 +1273,17 @@ void GraphicsSynthesizerThread::write64(uint32_t addr, uint64_t value)
                 TRXPOS.int_source_y = TRXPOS.dest_y;
                 PSMCT24_unpacked_count = 0;
                 PSMCT24_color = 0;
+                transfer_blocks = false;
+                transfer_buffer_pos = 0;
+                transfer_buffer_loaded = false;
+                if (TRXDIR == 0)
+                    start_block_transfer(BITBLTBUF.dest_format, TRXPOS.int_dest_x, TRXPOS.int_dest_y);
+                else if (TRXDIR == 1)
+                    start_block_transfer(BITBLTBUF.source_format, TRXPOS.int_source_x, TRXPOS.int_source_y);
+                if (TRXDIR != 1)
+                    texture_cache.invalidate(GSTextureCache::get_pages(BITBLTBUF.dest_base, BITBLTBUF.dest_width,
+                                                                       BITBLTBUF.dest_format, TRXPOS.dest_x, TRXPOS.dest_y,
+                                                                       TRXREG.width, TRXREG.height));
                 //printf("Transfer addr: $%08X\n", transfer_addr);
                 if (TRXDIR == 2)
                 {
@@ -983,6 +1303,33 @@ void GraphicsSynthesizerThread::write64(uint32_t addr, uint64_t value)
     }
 }
 
+//Queued primitives are drawn with the current state, so anything other than vertex data requires a flush first
+bool GraphicsSynthesizerThread::draw_state_changed(uint32_t addr, uint64_t value)
+{
+    switch (addr)
+    {
+        case 0x0000:
+        {
+            //PRIM is often rewritten between strips without changing how they're drawn
+            uint64_t mode = (PRIM.gourand_shading << 3) | (PRIM.texture_mapping << 4) | (PRIM.fog << 5) |
+                    (PRIM.alpha_blend << 6) | (PRIM.antialiasing << 7) | (PRIM.use_UV << 8) |
+                    (PRIM.use_context2 << 9) | (PRIM.fix_fragment_value << 10);
+            return (value & 0x7F8) != mode;
+        }
+        case 0x0001: //RGBAQ
+        case 0x0002: //ST
+        case 0x0003: //UV
+        case 0x0004: //XYZF2
+        case 0x0005: //XYZ2
+        case 0x000A: //FOG
+        case 0x000C: //XYZF3
+        case 0x000D: //XYZ3
+            return false;
+        default:
+            return true;
+    }
+}
+
 void GraphicsSynthesizerThread::set_RGBA(uint8_t r, uint8_t g, uint8_t b, uint8_t a, float q)
 {
     RGBAQ.r = r;
@@ -1023,6 +1370,208 @@ void GraphicsSynthesizerThread::set_XYZF(uint32_t x, uint32_t y, uint32_t z, uin
     vertex_kick(drawing_kick);
 }
 
+void GraphicsSynthesizerThread::record_message(GSCommand type, const GSMessagePayload& payload)
+{
+    GSMessage message;
+    message.type = type;
+    message.payload = payload;
+    gsdump_file.write((char*)&message, sizeof(message));
+}
+
+//Staged transfer data has to be in sync with local memory before anything other than more transfer data is handled
+void GraphicsSynthesizerThread::sync_block_transfer()
+{
+    if (transfer_buffer_pos && TRXDIR == 0)
+        end_block_transfer();
+}
+
+void GraphicsSynthesizerThread::process_GIF_packet(int path, uint32_t count)
+{
+    //Read in chunks, the FIFO copies around its wraparound point
+    uint128_t quads[64];
+    GIFtag& tag = gif_path[path];
+    while (count)
+    {
+        uint32_t chunk = std::min(count, (uint32_t)64);
+        message_queue->read(quads, chunk * sizeof(uint128_t));
+        for (uint32_t i = 0; i < chunk; i++)
+            process_GIF_quad(tag, quads[i]);
+        count -= chunk;
+    }
+}
+
+void GraphicsSynthesizerThread::process_GIF_quad(GIFtag& tag, const uint128_t& quad)
+{
+    if (!tag.data_left)
+    {
+        tag.read(quad);
+
+        //Q is initialized to 1.0 upon reading a GIFtag
+        gif_Q = 1.0f;
+
+        if (tag.output_PRIM && tag.format != 1)
+        {
+            sync_block_transfer();
+            if (gsdump_recording)
+            {
+                GSMessagePayload payload;
+                payload.write64_payload = { 0, tag.PRIM };
+                record_message(write64_t, payload);
+            }
+            write64(0, tag.PRIM);
+        }
+        return;
+    }
+
+    switch (tag.format)
+    {
+        case 0:
+            process_PACKED(tag, quad);
+            tag.next_reg();
+            break;
+        case 1:
+            process_REGLIST(tag, quad);
+            break;
+        case 2:
+        case 3:
+            //IMAGE data goes straight to HWREG, skipping the register dispatch in write64
+            flush_draws();
+            draw_state_valid = false;
+            for (int i = 0; i < 2; i++)
+            {
+                if (gsdump_recording)
+                {
+                    GSMessagePayload payload;
+                    payload.write64_payload = { 0x54, quad._u64[i] };
+                    record_message(write64_t, payload);
+                }
+                if (TRXDIR == 0)
+                    write_HWREG(quad._u64[i]);
+            }
+            tag.data_left--;
+            break;
+    }
+}
+
+void GraphicsSynthesizerThread::process_PACKED(GIFtag& tag, const uint128_t& quad)
+{
+    uint64_t data1 = quad._u64[0];
+    uint64_t data2 = quad._u64[1];
+    uint8_t reg = tag.current_reg();
+    GSMessagePayload payload;
+    if (reg != 0xE || (data2 & 0xFF) != 0x54)
+        sync_block_transfer();
+    switch (reg)
+    {
+        case 0x1:
+            //RGBAQ - set RGBA
+            //Q is taken from the ST command
+            payload.rgba_payload = { (uint8_t)data1, (uint8_t)(data1 >> 32), (uint8_t)data2, (uint8_t)(data2 >> 32), gif_Q };
+            if (gsdump_recording)
+                record_message(set_rgba_t, payload);
+            set_RGBA(payload.rgba_payload.r, payload.rgba_payload.g, payload.rgba_payload.b, payload.rgba_payload.a, gif_Q);
+            return;
+        case 0x2:
+        {
+            //ST - set ST coordinates and Q
+            uint32_t s = data1 & 0xFFFFFF00;
+            uint32_t t = (data1 >> 32) & 0xFFFFFF00;
+            uint32_t q = data2 & 0xFFFFFF00;
+
+            if ((s & 0x7F800000) == 0x7F800000)
+                s = (s & 0x80000000) | 0x7F7FFFFF;
+
+            if ((t & 0x7F800000) == 0x7F800000)
+                t = (t & 0x80000000) | 0x7F7FFFFF;
+
+            if ((q & 0x7F800000) == 0x7F800000)
+                q = (q & 0x80000000) | 0x7F7FFFFF;
+            gif_Q = *(float*)&q;
+            payload.st_payload = { s, t };
+            if (gsdump_recording)
+                record_message(set_st_t, payload);
+            set_ST(s, t);
+            return;
+        }
+        case 0x3:
+            //UV - set UV coordinates
+            payload.uv_payload = { (uint16_t)(data1 & 0x3FFF), (uint16_t)((data1 >> 32) & 0x3FFF) };
+            if (gsdump_recording)
+                record_message(set_uv_t, payload);
+            set_UV(payload.uv_payload.u, payload.uv_payload.v);
+            return;
+        case 0x4:
+        {
+            //XYZF2 - set XYZ and fog coefficient. Optionally disable drawing kick through bit 111
+            uint32_t x = data1 & 0xFFFF;
+            uint32_t y = (data1 >> 32) & 0xFFFF;
+            uint32_t z = (data2 >> 4) & 0xFFFFFF;
+            bool disable_drawing = (data2 >> (111 - 64)) & 0x1;
+            uint8_t fog = (data2 >> (100 - 64)) & 0xFF;
+            if (gsdump_recording)
+            {
+                payload.xyzf_payload = { x, y, z, fog, !disable_drawing };
+                record_message(set_xyzf_t, payload);
+            }
+            set_XYZF(x, y, z, fog, !disable_drawing);
+            return;
+        }
+        case 0x5:
+        {
+            //XYZ2 - set XYZ. Optionally disable drawing kick through bit 111
+            uint32_t x = data1 & 0xFFFF;
+            uint32_t y = (data1 >> 32) & 0xFFFF;
+            uint32_t z = data2 & 0xFFFFFFFF;
+            bool disable_drawing = (data2 >> (111 - 64)) & 0x1;
+            if (gsdump_recording)
+            {
+                payload.xyz_payload = { x, y, z, !disable_drawing };
+                record_message(set_xyz_t, payload);
+            }
+            set_XYZ(x, y, z, !disable_drawing);
+            return;
+        }
+        case 0xA:
+            //FOG
+            payload.write64_payload = { 0xA, data2 << 20 };
+            break;
+        case 0xE:
+            //A+D: output data to address
+            payload.write64_payload = { (uint32_t)(data2 & 0xFF), data1 };
+            break;
+        case 0xF:
+            //NOP
+            return;
+        default:
+            //PRIM and the rest are written as-is
+            payload.write64_payload = { reg, data1 };
+            break;
+    }
+    if (gsdump_recording)
+        record_message(write64_t, payload);
+    write64(payload.write64_payload.addr, payload.write64_payload.value);
+}
+
+void GraphicsSynthesizerThread::process_REGLIST(GIFtag& tag, const uint128_t& quad)
+{
+    sync_block_transfer();
+    for (int i = 0; i < 2; i++)
+    {
+        uint8_t reg = tag.current_reg();
+        if (gsdump_recording)
+        {
+            GSMessagePayload payload;
+            payload.write64_payload = { reg, quad._u64[i] };
+            record_message(write64_t, payload);
+        }
+        write64(reg, quad._u64[i]);
+
+        //If NREGS * NLOOP is odd, discard the last 64 bits of data
+        if (tag.next_reg() && !tag.data_left)
+            return;
+    }
+}
+
 uint32_t GraphicsSynthesizerThread::blockid_PSMCT32(uint32_t block, uint32_t width, uint32_t x, uint32_t y)
 {
     return block + ((y & ~0x1F) * (width / 64)) + ((x >> 1) & ~0x1F) + blockTable32[(y >> 3) & 0x3][(x >> 3) & 0x7];
@@ -1312,22 +1861,211 @@ void GraphicsSynthesizerThread::vertex_kick(bool drawing_kick)
 
 void GraphicsSynthesizerThread::render_primitive()
 {
-    switch (prim_type)
+    if (!draw_state_valid)
+    {
+        update_pixel_pipeline();
+        update_texture();
+        frame_in_zbuf = frame_overlaps_zbuf();
+        draw_state_valid = true;
+    }
+
+    if (raster_thread_count == 1)
+    {
+        draw_primitive(prim_type, vtx_queue, raster_workers[0]);
+        return;
+    }
+
+    //Threads draw their rows out of order, so a primitive sampling memory that other primitives write
+    //has to see all of the earlier draws finished and draw alone.
+    //The same goes for frame and Z buffers that alias each other, as their rows no longer line up with the tiles.
+    if (texture_in_target || frame_in_zbuf)
+    {
+        flush_draws();
+        draw_serially = true;
+        draw_primitive(prim_type, vtx_queue, raster_workers[0]);
+        draw_serially = false;
+        return;
+    }
+
+    //Find the range of tiles the primitive can touch
+    int32_t min_y = INT32_MAX, max_y = INT32_MIN;
+    for (unsigned int i = 0; i < max_vertices[prim_type]; i++)
+    {
+        min_y = std::min(min_y, vtx_queue[i].y - (int32_t)current_ctx->xyoffset.y);
+        max_y = std::max(max_y, vtx_queue[i].y - (int32_t)current_ctx->xyoffset.y);
+    }
+    min_y >>= 4;
+    max_y = (max_y >> 4) + 1;
+
+    //Lines aren't scissored vertically, so they're handed to every thread
+    bool all_tiles = prim_type == 1 || prim_type == 2;
+    if (!all_tiles)
+    {
+        min_y = std::max(min_y, (int32_t)current_ctx->scissor.y1 >> 4);
+        max_y = std::min(max_y, ((int32_t)current_ctx->scissor.y2 >> 4) + 1);
+        if (min_y > max_y)
+            return;
+        min_y >>= RASTER_TILE_SHIFT;
+        max_y >>= RASTER_TILE_SHIFT;
+        all_tiles = max_y - min_y + 1 >= raster_thread_count;
+    }
+
+    uint32_t index = draw_queue.size();
+    QueuedPrimitive prim;
+    prim.type = prim_type;
+    for (int i = 0; i < 3; i++)
+        prim.vtx[i] = vtx_queue[i];
+    draw_queue.push_back(prim);
+
+    if (all_tiles)
+    {
+        for (int i = 0; i < raster_thread_count; i++)
+            raster_workers[i].bin.push_back(index);
+    }
+    else
+    {
+        for (int32_t tile = min_y; tile <= max_y; tile++)
+            raster_workers[tile % raster_thread_count].bin.push_back(index);
+    }
+
+    if (draw_queue.size() >= MAX_QUEUED_PRIMS)
+        flush_draws();
+}
+
+GSTextureCache::PageMask GraphicsSynthesizerThread::get_texture_pages()
+{
+    const TEX0& tex0 = current_ctx->tex0;
+    return GSTextureCache::get_pages(tex0.texture_base, tex0.width, tex0.format, 0, 0,
+                                     tex0.tex_width, tex0.tex_height);
+}
+
+//Pages the frame buffer can be drawn to within the scissor area
+GSTextureCache::PageMask GraphicsSynthesizerThread::get_frame_pages()
+{
+    uint32_t height = (current_ctx->scissor.y2 >> 4) + 1;
+    return GSTextureCache::get_pages(current_ctx->frame.base_pointer, current_ctx->frame.width,
+                                     current_ctx->frame.format, 0, 0,
+                                     current_ctx->frame.width, height);
+}
+
+//Pages of the Z buffer within the scissor area
+GSTextureCache::PageMask GraphicsSynthesizerThread::get_zbuf_pages()
+{
+    uint32_t height = (current_ctx->scissor.y2 >> 4) + 1;
+    return GSTextureCache::get_pages(current_ctx->zbuf.base_pointer, current_ctx->frame.width,
+                                     current_ctx->zbuf.format | 0x30, 0, 0,
+                                     current_ctx->frame.width, height);
+}
+
+//Pages the frame and Z buffers can be drawn to within the scissor area
+GSTextureCache::PageMask GraphicsSynthesizerThread::get_target_pages()
+{
+    GSTextureCache::PageMask pages = get_frame_pages();
+    if (!current_ctx->zbuf.no_update)
+        pages |= get_zbuf_pages();
+    return pages;
+}
+
+//Conservative check for whether drawing touches the Z buffer in pages that are also drawn to as the frame buffer
+bool GraphicsSynthesizerThread::frame_overlaps_zbuf()
+{
+    if (!current_ctx->test.depth_test && current_ctx->zbuf.no_update)
+        return false;
+    return (get_frame_pages() & get_zbuf_pages()).any();
+}
+
+//Conservative check for whether the texture shares any pages with the frame or Z buffers
+bool GraphicsSynthesizerThread::texture_overlaps_target()
+{
+    return (get_texture_pages() & get_target_pages()).any();
+}
+
+//Looks up the decoded texture for the current draw state, decoding it if needed.
+//Also drops decoded textures the draws about to be made can overwrite.
+void GraphicsSynthesizerThread::update_texture()
+{
+    current_texture = nullptr;
+    texture_in_target = false;
+    texture_cache.invalidate(get_target_pages());
+
+    if (!current_PRMODE->texture_mapping)
+        return;
+
+    //Textures that are still being uploaded or are drawn to by the same primitives are read directly
+    texture_in_target = texture_overlaps_target();
+    if (TRXDIR == 0 || texture_in_target)
+        return;
+
+    const TEX0& tex0 = current_ctx->tex0;
+    TextureKey key;
+    key.tex_base = tex0.texture_base;
+    key.buffer_width = tex0.width;
+    key.format = tex0.format;
+    key.width = tex0.tex_width;
+    key.height = tex0.tex_height;
+    key.alpha0 = TEXA.alpha0;
+    key.alpha1 = TEXA.alpha1;
+    key.trans_black = TEXA.trans_black;
+    switch (tex0.format)
+    {
+        case 0x13:
+        case 0x14:
+        case 0x1B:
+        case 0x24:
+        case 0x2C:
+            key.paletted = true;
+            key.clut_format = tex0.CLUT_format;
+            key.clut_offset = tex0.CLUT_offset;
+            key.use_CSM2 = tex0.use_CSM2;
+            memcpy(key.clut, clut_cache, sizeof(key.clut));
+            break;
+        default:
+            key.paletted = false;
+            break;
+    }
+
+    CachedTexture* texture = texture_cache.find(key);
+    if (!texture)
+    {
+        texture = texture_cache.insert(key);
+        decode_texture(*texture);
+    }
+    current_texture = texture;
+}
+
+void GraphicsSynthesizerThread::decode_texture(CachedTexture& texture)
+{
+    const TextureKey& key = texture.key;
+    uint32_t* texel = texture.texels.data();
+    RGBAQ_REG color;
+    for (int v = 0; v < key.height; v++)
+    {
+        for (int u = 0; u < key.width; u++)
+        {
+            read_texel(key.tex_base, key.buffer_width, u, v, color);
+            *texel++ = color.r | (color.g << 8) | (color.b << 16) | ((uint32_t)color.a << 24);
+        }
+    }
+}
+
+void GraphicsSynthesizerThread::draw_primitive(uint8_t type, const Vertex* vtx, RasterWorker& worker)
+{
+    switch (type)
     {
         case 0:
-            render_point();
+            render_point(vtx, worker);
             break;
         case 1:
         case 2:
-            render_line();
+            render_line(vtx, worker);
             break;
         case 3:
         case 4:
         case 5:
-            render_triangle2();
+            render_triangle2(vtx, worker);
             break;
         case 6:
-            render_sprite();
+            render_sprite(vtx, worker);
             break;
     }
 }
@@ -1382,9 +2120,10 @@ bool GraphicsSynthesizerThread::depth_test(int32_t x, int32_t y, uint32_t z)
     return false;
 }
 
-uint32_t GraphicsSynthesizerThread::lookup_frame_color(int32_t x, int32_t y)
+uint32_t GraphicsSynthesizerThread::lookup_frame_color(int32_t x, int32_t y, RasterWorker& worker)
 {
-    if (frame_color_looked_up)
+    uint32_t& frame_color = worker.frame_color;
+    if (worker.frame_color_looked_up)
     {
         return frame_color;
     }
@@ -1423,14 +2162,14 @@ uint32_t GraphicsSynthesizerThread::lookup_frame_color(int32_t x, int32_t y)
             Errors::die("Unknown FRAME format (%x) read attempted", current_ctx->frame.format);
             break;
     }
-    frame_color_looked_up = true;
+    worker.frame_color_looked_up = true;
 
     return frame_color;
 }
 
-void GraphicsSynthesizerThread::draw_pixel(int32_t x, int32_t y, uint32_t z, RGBAQ_REG& color)
+void GraphicsSynthesizerThread::draw_pixel(int32_t x, int32_t y, uint32_t z, RGBAQ_REG color, RasterWorker& worker)
 {
-    frame_color_looked_up = false;
+    worker.frame_color_looked_up = false;
     x >>= 4;
     y >>= 4;
 
@@ -1513,7 +2252,7 @@ void GraphicsSynthesizerThread::draw_pixel(int32_t x, int32_t y, uint32_t z, RGB
 
     if (test->dest_alpha_test && !(current_ctx->frame.format & 0x1))
     {
-        bool alpha = lookup_frame_color(x, y) & (1 << 31);
+        bool alpha = lookup_frame_color(x, y, worker) & (1 << 31);
         if (test->dest_alpha_method ^ alpha)
             return;
     }
@@ -1534,9 +2273,9 @@ void GraphicsSynthesizerThread::draw_pixel(int32_t x, int32_t y, uint32_t z, RGB
                 b1 = color.b;
                 break;
             case 1:
-                r1 = lookup_frame_color(x, y) & 0xFF;
-                g1 = (lookup_frame_color(x, y) >> 8) & 0xFF;
-                b1 = (lookup_frame_color(x, y) >> 16) & 0xFF;
+                r1 = lookup_frame_color(x, y, worker) & 0xFF;
+                g1 = (lookup_frame_color(x, y, worker) >> 8) & 0xFF;
+                b1 = (lookup_frame_color(x, y, worker) >> 16) & 0xFF;
                 break;
             case 2:
             case 3:
@@ -1554,9 +2293,9 @@ void GraphicsSynthesizerThread::draw_pixel(int32_t x, int32_t y, uint32_t z, RGB
                 b2 = color.b;
                 break;
             case 1:
-                r2 = lookup_frame_color(x, y) & 0xFF;
-                g2 = (lookup_frame_color(x, y) >> 8) & 0xFF;
-                b2 = (lookup_frame_color(x, y) >> 16) & 0xFF;
+                r2 = lookup_frame_color(x, y, worker) & 0xFF;
+                g2 = (lookup_frame_color(x, y, worker) >> 8) & 0xFF;
+                b2 = (lookup_frame_color(x, y, worker) >> 16) & 0xFF;
                 break;
             case 2:
             case 3:
@@ -1572,7 +2311,7 @@ void GraphicsSynthesizerThread::draw_pixel(int32_t x, int32_t y, uint32_t z, RGB
                 alpha = color.a;
                 break;
             case 1:
-                alpha = lookup_frame_color(x, y) >> 24;
+                alpha = lookup_frame_color(x, y, worker) >> 24;
                 break;
             case 2:
             case 3:
@@ -1588,9 +2327,9 @@ void GraphicsSynthesizerThread::draw_pixel(int32_t x, int32_t y, uint32_t z, RGB
                 cb = color.b;
                 break;
             case 1:
-                cr = lookup_frame_color(x, y) & 0xFF;
-                cg = (lookup_frame_color(x, y) >> 8) & 0xFF;
-                cb = (lookup_frame_color(x, y) >> 16) & 0xFF;
+                cr = lookup_frame_color(x, y, worker) & 0xFF;
+                cg = (lookup_frame_color(x, y, worker) >> 8) & 0xFF;
+                cb = (lookup_frame_color(x, y, worker) >> 16) & 0xFF;
                 break;
             case 2:
             case 3:
@@ -1707,7 +2446,7 @@ void GraphicsSynthesizerThread::draw_pixel(int32_t x, int32_t y, uint32_t z, RGB
     {
         if (!update_alpha)
         {
-            uint8_t alpha = lookup_frame_color(x, y) >> 24;
+            uint8_t alpha = lookup_frame_color(x, y, worker) >> 24;
             final_color &= 0x00FFFFFF;
             final_color |= alpha << 24;
         }
@@ -1716,7 +2455,7 @@ void GraphicsSynthesizerThread::draw_pixel(int32_t x, int32_t y, uint32_t z, RGB
         final_color |= current_ctx->FBA << 31;
 
         uint32_t mask = current_ctx->frame.mask;
-        final_color = (final_color & ~mask) | (lookup_frame_color(x, y) & mask);
+        final_color = (final_color & ~mask) | (lookup_frame_color(x, y, worker) & mask);
 
         //printf("[GS_t] Write $%08X (%d, %d)\n", final_color, x, y);
         switch (current_ctx->frame.format)
@@ -1771,12 +2510,114 @@ void GraphicsSynthesizerThread::draw_pixel(int32_t x, int32_t y, uint32_t z, RGB
     }
 }
 
-void GraphicsSynthesizerThread::render_point()
+void GraphicsSynthesizerThread::update_pixel_pipeline()
+{
+    PixelPipelineState state;
+    state.test = current_ctx->test;
+    state.alpha = current_ctx->alpha;
+    state.frame_format = current_ctx->frame.format;
+    state.frame_mask = current_ctx->frame.mask;
+    state.zbuf_format = current_ctx->zbuf.format;
+    state.zbuf_no_update = current_ctx->zbuf.no_update;
+    state.FBA = current_ctx->FBA;
+    state.alpha_blend = current_PRMODE->alpha_blend;
+    state.PABE = PABE;
+    state.DTHE = DTHE;
+    state.COLCLAMP = COLCLAMP;
+
+    pixel_pipeline = pixel_jit->get_pipeline(state);
+}
+
+//Swizzle table row and page of line y in a buffer, for drawing spans with the compiled pixel pipeline
+void GraphicsSynthesizerThread::get_span_row(uint8_t format, uint32_t base, uint32_t y,
+                                             const uint32_t*& row, uint32_t& page)
 {
-    Vertex v1 = vtx_queue[0]; v1.to_relative(current_ctx->xyoffset);
+    uint32_t block = base / 256;
+    uint32_t width = current_ctx->frame.width / 64;
+    switch (format)
+    {
+        case 0x0:
+        case 0x1:
+            page = (block >> 5) + (y >> 5) * width;
+            row = &page_PSMCT32.get(block & 0x1F, y & 0x1F, 0);
+            break;
+        case 0x2:
+            page = (block >> 5) + (y >> 6) * width;
+            row = &page_PSMCT16.get(block & 0x1F, y & 0x3F, 0);
+            break;
+        case 0xA:
+            page = (block >> 5) + (y >> 6) * width;
+            row = &page_PSMCT16S.get(block & 0x1F, y & 0x3F, 0);
+            break;
+        case 0x30:
+        case 0x31:
+            page = (block >> 5) + (y >> 5) * width;
+            row = &page_PSMCT32Z.get(block & 0x1F, y & 0x1F, 0);
+            break;
+        case 0x32:
+            page = (block >> 5) + (y >> 6) * width;
+            row = &page_PSMCT16Z.get(block & 0x1F, y & 0x3F, 0);
+            break;
+        case 0x3A:
+            page = (block >> 5) + (y >> 6) * width;
+            row = &page_PSMCT16SZ.get(block & 0x1F, y & 0x3F, 0);
+            break;
+        default:
+            page = 0;
+            row = nullptr;
+            break;
+    }
+}
+
+void GraphicsSynthesizerThread::draw_span(RasterWorker& worker)
+{
+    int count = worker.span_count;
+    if (!count)
+        return;
+    worker.span_count = 0;
+    int32_t x = worker.span_x;
+    int32_t y = worker.span_y;
+
+    if (!pixel_pipeline)
+    {
+        for (int i = 0; i < count; i++)
+            draw_pixel((x + i) * 16, y * 16, worker.span_z[i], worker.span_color[i], worker);
+        return;
+    }
+
+    //SCANMSK prohibits drawing on even or odd y-coordinates
+    if (SCANMSK == 2 && (y & 0x1) == 0)
+        return;
+    else if (SCANMSK == 3 && (y & 0x1) == 1)
+        return;
+
+    int32_t dither[4];
+    for (int i = 0; i < 4; i++)
+    {
+        uint8_t element = dither_mtx[y & 0x3][i];
+        dither[i] = (element & 0x4) ? -(element & 0x3) : (element & 0x3);
+    }
+
+    PixelSpan span;
+    span.local_mem = local_mem;
+    span.color = worker.span_color;
+    span.z = worker.span_z;
+    get_span_row(current_ctx->frame.format, current_ctx->frame.base_pointer, y, span.frame_row, span.frame_page);
+    get_span_row(current_ctx->zbuf.format | 0x30, current_ctx->zbuf.base_pointer, y, span.z_row, span.z_page);
+    span.dither = dither;
+    span.x = x;
+    span.count = count;
+    pixel_pipeline(&span);
+}
+
+void GraphicsSynthesizerThread::render_point(const Vertex* vtx, RasterWorker& worker)
+{
+    Vertex v1 = vtx[0]; v1.to_relative(current_ctx->xyoffset);
     if (v1.x < current_ctx->scissor.x1 || v1.x > current_ctx->scissor.x2 ||
         v1.y < current_ctx->scissor.y1 || v1.y > current_ctx->scissor.y2)
         return;
+    if (!owns_row(worker, v1.y >> 4))
+        return;
     printf("[GS_t] Rendering point!\n");
     printf("Coords: (%d, %d, %d)\n", v1.x >> 4, v1.y >> 4, v1.z);
     TexLookupInfo tex_info;
@@ -1788,6 +2629,7 @@ void GraphicsSynthesizerThread::render_point()
     tex_info.buffer_width = current_ctx->tex0.width;
     tex_info.tex_width = current_ctx->tex0.tex_width;
     tex_info.tex_height = current_ctx->tex0.tex_height;
+    tex_info.texture = current_texture;
 
     if (current_PRMODE->texture_mapping)
     {
@@ -1806,19 +2648,19 @@ void GraphicsSynthesizerThread::render_point()
             v = (uint32_t) v1.uv.v;
         }
         tex_lookup(u, v, tex_info);
-        draw_pixel(v1.x, v1.y, v1.z, tex_info.tex_color);
+        draw_pixel(v1.x, v1.y, v1.z, tex_info.tex_color, worker);
     }
     else
     {
-        draw_pixel(v1.x, v1.y, v1.z, tex_info.vtx_color);
+        draw_pixel(v1.x, v1.y, v1.z, tex_info.vtx_color, worker);
     }
 }
 
-void GraphicsSynthesizerThread::render_line()
+void GraphicsSynthesizerThread::render_line(const Vertex* vtx, RasterWorker& worker)
 {
     printf("[GS_t] Rendering line!\n");
-    Vertex v1 = vtx_queue[1]; v1.to_relative(current_ctx->xyoffset);
-    Vertex v2 = vtx_queue[0]; v2.to_relative(current_ctx->xyoffset);
+    Vertex v1 = vtx[1]; v1.to_relative(current_ctx->xyoffset);
+    Vertex v2 = vtx[0]; v2.to_relative(current_ctx->xyoffset);
 
     //Transpose line if it's steep
     bool is_steep = false;
@@ -1842,11 +2684,12 @@ void GraphicsSynthesizerThread::render_line()
     
     TexLookupInfo tex_info;
     tex_info.new_lookup = true;
-    tex_info.vtx_color = vtx_queue[0].rgbaq;
+    tex_info.vtx_color = vtx[0].rgbaq;
     tex_info.tex_base = current_ctx->tex0.texture_base;
     tex_info.buffer_width = current_ctx->tex0.width;
     tex_info.tex_width = current_ctx->tex0.tex_width;
     tex_info.tex_height = current_ctx->tex0.tex_height;
+    tex_info.texture = current_texture;
 
     printf("Coords: (%d, %d, %d) (%d, %d, %d)\n", v1.x >> 4, v1.y >> 4, v1.z, v2.x >> 4, v2.y >> 4, v2.z);
 
@@ -1857,6 +2700,8 @@ void GraphicsSynthesizerThread::render_line()
         int32_t y = v1.y*(1.-t) + v2.y*t;        
         //if (y < min_y || y > max_y)
             //continue;
+        if (!owns_row(worker, (is_steep ? x : y) >> 4))
+            continue;
         tex_info.fog = interpolate(x, v1.fog, v1.x, v2.fog, v2.x);
         if (current_PRMODE->gourand_shading)
         {
@@ -1886,9 +2731,9 @@ void GraphicsSynthesizerThread::render_line()
             tex_info.vtx_color = tex_info.tex_color;
         }
         if (is_steep)
-            draw_pixel(y, x, z, tex_info.vtx_color);
+            draw_pixel(y, x, z, tex_info.vtx_color, worker);
         else
-            draw_pixel(x, y, z, tex_info.vtx_color);
+            draw_pixel(x, y, z, tex_info.vtx_color, worker);
     }
 }
 
@@ -1942,7 +2787,7 @@ static void order3(int32_t a, int32_t b, int32_t c, uint8_t* order)
     }
 }
 
-void GraphicsSynthesizerThread::render_triangle2() {
+void GraphicsSynthesizerThread::render_triangle2(const Vertex* vtx, RasterWorker& worker) {
     // This is a "scanline" algorithm which reduces flops/pixel
     //  at the cost of a longer setup time.
 
@@ -1972,9 +2817,9 @@ void GraphicsSynthesizerThread::render_triangle2() {
 
 
     Vertex unsortedVerts[3]; // vertices in the order they were sent to GS
-    unsortedVerts[0] = vtx_queue[2]; unsortedVerts[0].to_relative(current_ctx->xyoffset);
-    unsortedVerts[1] = vtx_queue[1]; unsortedVerts[1].to_relative(current_ctx->xyoffset);
-    unsortedVerts[2] = vtx_queue[0]; unsortedVerts[2].to_relative(current_ctx->xyoffset);
+    unsortedVerts[0] = vtx[2]; unsortedVerts[0].to_relative(current_ctx->xyoffset);
+    unsortedVerts[1] = vtx[1]; unsortedVerts[1].to_relative(current_ctx->xyoffset);
+    unsortedVerts[2] = vtx[0]; unsortedVerts[2].to_relative(current_ctx->xyoffset);
 
     if (!current_PRMODE->gourand_shading)
     {
@@ -1998,6 +2843,7 @@ void GraphicsSynthesizerThread::render_triangle2() {
     tex_info.buffer_width = current_ctx->tex0.width;
     tex_info.tex_width = current_ctx->tex0.tex_width;
     tex_info.tex_height = current_ctx->tex0.tex_height;
+    tex_info.texture = current_texture;
 
 
     // fast reject - some games like to spam triangles that don't have any pixels
@@ -2144,7 +2990,8 @@ void GraphicsSynthesizerThread::render_triangle2() {
                                  lowerRightEdgeStep,  // slope of right edge
                                  scissorX1,        // x scissor (integer pixels, do draw this px)
                                  scissorX2,        // x scissor (integer pixels, don't draw this px)
-                                 tex_info);        // texture
+                                 tex_info,         // texture
+                                 worker);          // thread drawing the primitive
         }
     }
     else
@@ -2162,7 +3009,7 @@ void GraphicsSynthesizerThread::render_triangle2() {
                                  v0,                  // interpolate from this vertex
                                  upperLeftEdgeStep, upperRightEdgeStep, // slopes
                                  scissorX1, scissorX2,  // integer x scissor
-                                 tex_info);
+                                 tex_info, worker);
         }
 
         if(lowerTop < lowerBot)
@@ -2176,13 +3023,30 @@ void GraphicsSynthesizerThread::render_triangle2() {
             render_half_triangle(v0.x + upperLeftEdgeStep * e10.y, // one of our upper edge vertices isn't v0,v1,v2, but we don't know which. todo is this faster than branch?
                                  v0.x + upperRightEdgeStep * e10.y,
                                  lowerTop, lowerBot, dvdx, dvdy, v1,
-                                 lowerLeftEdgeStep, lowerRightEdgeStep, scissorX1, scissorX2, tex_info);
+                                 lowerLeftEdgeStep, lowerRightEdgeStep, scissorX1, scissorX2, tex_info, worker);
         }
 
     }
 
 }
 
+static SpanGradient span_gradient(const VertexF& vtx)
+{
+    SpanGradient gradient;
+    gradient.z = vtx.z;
+    gradient.r = vtx.r;
+    gradient.g = vtx.g;
+    gradient.b = vtx.b;
+    gradient.a = vtx.a;
+    gradient.q = vtx.q;
+    gradient.s = vtx.s;
+    gradient.t = vtx.t;
+    gradient.u = vtx.u;
+    gradient.v = vtx.v;
+    gradient.fog = vtx.fog;
+    return gradient;
+}
+
 /*!
  * Render a "half-triangle" which has a horizontal edge
  * @param x0 - the x coordinate of the upper left most point of the triangle. floating point pixels
@@ -2197,16 +3061,21 @@ void GraphicsSynthesizerThread::render_triangle2() {
  * @param scx1    - left x scissor (fp px)
  * @param scx2    - right x scissor (fp px)
  * @param tex_info - texture data
+ * @param worker  - thread drawing the triangle, only rows in its tiles are drawn
  */
 void GraphicsSynthesizerThread::render_half_triangle(float x0, float x1, int y0, int y1, VertexF &x_step,
                                                      VertexF &y_step, VertexF &init, float step_x0, float step_x1,
-                                                     float scx1, float scx2, TexLookupInfo& tex_info) {
+                                                     float scx1, float scx2, TexLookupInfo& tex_info,
+                                                     RasterWorker& worker) {
 
     bool tmp_tex = current_PRMODE->texture_mapping;
     bool tmp_uv = !current_PRMODE->use_UV;
+    SpanGradient step = span_gradient(x_step);
 
     for(int y = y0; y < y1; y++) // loop over scanlines of triangle
     {
+        if(!owns_row(worker, y)) continue;          // another thread draws this row
+
         float height = y - init.y; // how far down we've made it
         VertexF vtx = init + y_step * height;       // interpolate to point (x_init, y)
         float x0l = x0 + step_x0 * height;          // start x coordinates of scanline from interpolation
@@ -2220,59 +3089,58 @@ void GraphicsSynthesizerThread::render_half_triangle(float x0, float x1, int y0,
 
         vtx += (x_step * (x0l - init.x));           // interpolate to point (x0l, y)
 
-        for(int x = x0l; x < xStop; x++)            // loop over x pixels of scanline
+        // the scanline is interpolated a span at a time, with only texture sampling done per pixel
+        SpanGradient start = span_gradient(vtx);
+        for(int i = 0; i < xStop - xStart; i += RasterWorker::MAX_SPAN_PIXELS)
         {
-            //vtx = init + y_step * height + (x_step * (x - init.x));
-            tex_info.vtx_color.r = vtx.r;           // set most recently interpolated stuff
-            tex_info.vtx_color.g = vtx.g;
-            tex_info.vtx_color.b = vtx.b;
-            tex_info.vtx_color.a = vtx.a;
-            tex_info.vtx_color.q = vtx.q;
-            tex_info.fog = vtx.fog;
-            if (tmp_tex)
+            int count = std::min(xStop - xStart - i, RasterWorker::MAX_SPAN_PIXELS);
+            if (!tmp_tex)
             {
-                int32_t u, v;
-                calculate_LOD(tex_info);
-                if (tmp_uv)
-                {
-                    float s, t, q;
-                    s = vtx.s * 16.f;
-                    t = vtx.t * 16.f;
-                    q = vtx.q * 16.f;
-
-                    s /= q;
-                    t /= q;
-                    u = (s * tex_info.tex_width) * 16.f;
-                    v = (t * tex_info.tex_height) * 16.f;
-                    //fprintf(stderr, "q: %f, u: %d, v: %d, a: %d\n", vtx.q, u,v, tex_info.vtx_color.a);
-                }
-                else
-                {
-                    u = (uint32_t) vtx.u;
-                    v = (uint32_t) vtx.v;
-                }
-                tex_lookup(u, v, tex_info);
-                draw_pixel(x * 16, y * 16, (uint32_t)(vtx.z * 16.f), tex_info.tex_color);
-
+                SpanOutput out = {worker.span_color, worker.span_z, nullptr, nullptr, nullptr, nullptr, nullptr};
+                interpolate_span(start, step, i, count, SpanTexMode::NONE, out);
             }
             else
             {
-                draw_pixel(x * 16, y * 16, (uint32_t)(vtx.z * 16.f), tex_info.vtx_color);
+                SpanOutput out = {worker.tex_vtx_color, worker.span_z, worker.tex_fog,
+                                  worker.tex_s, worker.tex_t, worker.tex_u, worker.tex_v};
+                interpolate_span(start, step, i, count, tmp_uv ? SpanTexMode::STQ : SpanTexMode::UV, out);
+                for(int j = 0; j < count; j++)
+                {
+                    tex_info.vtx_color = worker.tex_vtx_color[j];
+                    tex_info.fog = worker.tex_fog[j];
+                    calculate_LOD(tex_info);
+                    int32_t u, v;
+                    if (tmp_uv)
+                    {
+                        // the texture size depends on the mipmap level chosen for this pixel
+                        u = (worker.tex_s[j] * tex_info.tex_width) * 16.f;
+                        v = (worker.tex_t[j] * tex_info.tex_height) * 16.f;
+                    }
+                    else
+                    {
+                        u = worker.tex_u[j];
+                        v = worker.tex_v[j];
+                    }
+                    tex_lookup(u, v, tex_info);
+                    worker.span_color[j] = tex_info.tex_color;
+                }
             }
-
-            vtx += x_step;                       // get values for the adjacent pixel
+            begin_span(worker, y);
+            worker.span_x = xStart + i;
+            worker.span_count = count;
+            draw_span(worker);
         }
     }
 
 }
 
-void GraphicsSynthesizerThread::render_triangle()
+void GraphicsSynthesizerThread::render_triangle(const Vertex* vtx, RasterWorker& worker)
 {
     printf("[GS_t] Rendering triangle!\n");
 
-    Vertex v1 = vtx_queue[2]; v1.to_relative(current_ctx->xyoffset);
-    Vertex v2 = vtx_queue[1]; v2.to_relative(current_ctx->xyoffset);
-    Vertex v3 = vtx_queue[0]; v3.to_relative(current_ctx->xyoffset);
+    Vertex v1 = vtx[2]; v1.to_relative(current_ctx->xyoffset);
+    Vertex v2 = vtx[1]; v2.to_relative(current_ctx->xyoffset);
+    Vertex v3 = vtx[0]; v3.to_relative(current_ctx->xyoffset);
 
     if (!current_PRMODE->gourand_shading)
     {
@@ -2353,6 +3221,7 @@ void GraphicsSynthesizerThread::render_triangle()
     tex_info.buffer_width = current_ctx->tex0.width;
     tex_info.tex_width = current_ctx->tex0.tex_width;
     tex_info.tex_height = current_ctx->tex0.tex_height;
+    tex_info.texture = current_texture;
 
     bool tmp_tex = current_PRMODE->texture_mapping;
     bool tmp_uv = !current_PRMODE->use_UV;//allow for loop unswitching
@@ -2367,6 +3236,7 @@ void GraphicsSynthesizerThread::render_triangle()
         int32_t w1_block = w1_row_block;
         int32_t w2_block = w2_row_block;
         int32_t w3_block = w3_row_block;
+        begin_span(worker, y_block >> 4);
         for (int32_t x_block = min_x; x_block < max_x; x_block += BLOCKSIZE)
         {
             //Store barycentric coordinates for the corners of a block
@@ -2424,6 +3294,9 @@ void GraphicsSynthesizerThread::render_triangle()
                         //Is inside triangle?
                         if ((w1 | w2 | w3) >= 0)
                         {
+                            if (!owns_row(worker, y >> 4))
+                                break;
+
                             //Interpolate Z
                             double z = (double) v1.z * w1 + (double) v2.z * w2 + (double) v3.z * w3;
                             z /= divider;
@@ -2470,11 +3343,11 @@ void GraphicsSynthesizerThread::render_triangle()
                                     v = (uint32_t) temp_v;
                                 }
                                 tex_lookup(u, v, tex_info);
-                                draw_pixel(x, y, (uint32_t)z, tex_info.tex_color);
+                                add_span_pixel(worker, x >> 4, (uint32_t)z, tex_info.tex_color);
                             }
                             else
                             {
-                                draw_pixel(x, y, (uint32_t)z, tex_info.vtx_color);
+                                add_span_pixel(worker, x >> 4, (uint32_t)z, tex_info.vtx_color);
                             }
                         }
                         else
@@ -2496,6 +3369,7 @@ void GraphicsSynthesizerThread::render_triangle()
             w3_block += BLOCKSIZE * A12;
 
         }
+        draw_span(worker);
         w1_row_block += BLOCKSIZE * B23;
         w2_row_block += BLOCKSIZE * B31;
         w3_row_block += BLOCKSIZE * B12;
@@ -2503,19 +3377,20 @@ void GraphicsSynthesizerThread::render_triangle()
 
 }
 
-void GraphicsSynthesizerThread::render_sprite()
+void GraphicsSynthesizerThread::render_sprite(const Vertex* vtx, RasterWorker& worker)
 {
     printf("[GS_t] Rendering sprite!\n");
-    Vertex v1 = vtx_queue[1]; v1.to_relative(current_ctx->xyoffset);
-    Vertex v2 = vtx_queue[0]; v2.to_relative(current_ctx->xyoffset);
+    Vertex v1 = vtx[1]; v1.to_relative(current_ctx->xyoffset);
+    Vertex v2 = vtx[0]; v2.to_relative(current_ctx->xyoffset);
     TexLookupInfo tex_info;
     tex_info.new_lookup = true;
 
-    tex_info.vtx_color = vtx_queue[0].rgbaq;
+    tex_info.vtx_color = vtx[0].rgbaq;
     tex_info.tex_base = current_ctx->tex0.texture_base;
     tex_info.buffer_width = current_ctx->tex0.width;
     tex_info.tex_width = current_ctx->tex0.tex_width;
     tex_info.tex_height = current_ctx->tex0.tex_height;
+    tex_info.texture = current_texture;
 
     calculate_LOD(tex_info);
 
@@ -2547,30 +3422,47 @@ void GraphicsSynthesizerThread::render_sprite()
 
     for (int32_t y = min_y; y < max_y; y += 0x10)
     {
+        //Rows drawn by other threads still need to step the texture coordinates
+        if (!owns_row(worker, y >> 4))
+        {
+            pix_t += pix_t_step;
+            pix_v += pix_v_step;
+            continue;
+        }
+        if (!tmp_tex)
+        {
+            //Every pixel has the same color and depth, so spans are filled without going through add_span_pixel
+            int32_t width = (max_x - min_x) >> 4;
+            for (int32_t i = 0; i < width; i += RasterWorker::MAX_SPAN_PIXELS)
+            {
+                begin_span(worker, y >> 4);
+                worker.span_x = (min_x >> 4) + i;
+                worker.span_count = std::min(width - i, RasterWorker::MAX_SPAN_PIXELS);
+                std::fill_n(worker.span_color, worker.span_count, tex_info.vtx_color);
+                std::fill_n(worker.span_z, worker.span_count, v2.z);
+                draw_span(worker);
+            }
+            continue;
+        }
         float pix_s = pix_s_init;
         uint32_t pix_u = pix_u_init;
+        begin_span(worker, y >> 4);
         for (int32_t x = min_x; x < max_x; x += 0x10)
         {
-            if (tmp_tex)
+            tex_info.fog = v2.fog;
+            if (tmp_uv)
             {
-                tex_info.fog = v2.fog;
-                if (tmp_uv)
-                {
-                    pix_v = (pix_t * tex_info.tex_height) * 16.0;
-                    pix_u = (pix_s * tex_info.tex_width) * 16.0;
-                    tex_lookup(pix_u, pix_v, tex_info);
-                }
-                else
-                    tex_lookup(pix_u >> 16, pix_v >> 16, tex_info);
-                draw_pixel(x, y, v2.z, tex_info.tex_color);
+                pix_v = (pix_t * tex_info.tex_height) * 16.0;
+                pix_u = (pix_s * tex_info.tex_width) * 16.0;
+                tex_lookup(pix_u, pix_v, tex_info);
             }
             else
-            {
-                draw_pixel(x, y, v2.z, tex_info.vtx_color);
-            }
+                tex_lookup(pix_u >> 16, pix_v >> 16, tex_info);
+            add_span_pixel(worker, x >> 4, v2.z, tex_info.tex_color);
             pix_s += pix_s_step;
             pix_u += pix_u_step;
         }
+        draw_span(worker);
         pix_t += pix_t_step;
         pix_v += pix_v_step;
     }
@@ -2578,6 +3470,27 @@ void GraphicsSynthesizerThread::render_sprite()
 
 void GraphicsSynthesizerThread::write_HWREG(uint64_t data)
 {
+    if (transfer_blocks)
+    {
+        //Pixels are counted a row of blocks at a time, as 24-bit ones don't fit evenly in a doubleword
+        memcpy(&transfer_buffer[transfer_buffer_pos], &data, sizeof(data));
+        transfer_buffer_pos += sizeof(data);
+        if (transfer_buffer_pos == transfer_buffer.size())
+        {
+            write_transfer_blocks();
+            transfer_buffer_pos = 0;
+            pixels_transferred += TRXREG.width * transfer_block_height;
+        }
+
+        if (pixels_transferred >= TRXREG.width * TRXREG.height)
+        {
+            TRXDIR = 3;
+            pixels_transferred = 0;
+            transfer_blocks = false;
+        }
+        return;
+    }
+
     int ppd = 0; //pixels per doubleword (64-bits)
 
     switch (BITBLTBUF.dest_format)
@@ -2618,10 +3531,22 @@ void GraphicsSynthesizerThread::write_HWREG(uint64_t data)
         case 0x2C:
             ppd = 16;
             break;
+        //PSMZ32
+        case 0x30:
+            ppd = 2;
+            break;
         //PSMCT24Z
         case 0x31:
             ppd = 3;
             break;
+        //PSMZ16
+        case 0x32:
+            ppd = 4;
+            break;
+        //PSMZ16S
+        case 0x3A:
+            ppd = 4;
+            break;
         default:
             Errors::print_warning("[GS_t] Unrecognized BITBLTBUF dest format $%02X\n", BITBLTBUF.dest_format);
             return;
@@ -2727,9 +3652,24 @@ void GraphicsSynthesizerThread::write_HWREG(uint64_t data)
                 TRXPOS.int_dest_x++;
             }
                 break;
+            case 0x30:
+                write_PSMCT32Z_block(BITBLTBUF.dest_base, BITBLTBUF.dest_width, TRXPOS.int_dest_x, TRXPOS.int_dest_y, (data >> (i * 32)) & 0xFFFFFFFF);
+                pixels_transferred++;
+                TRXPOS.int_dest_x++;
+                break;
             case 0x31:
                 unpack_PSMCT24(data, i, true);
                 break;
+            case 0x32:
+                write_PSMCT16Z_block(BITBLTBUF.dest_base, BITBLTBUF.dest_width, TRXPOS.int_dest_x, TRXPOS.int_dest_y, (data >> (i * 16)) & 0xFFFF);
+                pixels_transferred++;
+                TRXPOS.int_dest_x++;
+                break;
+            case 0x3A:
+                write_PSMCT16SZ_block(BITBLTBUF.dest_base, BITBLTBUF.dest_width, TRXPOS.int_dest_x, TRXPOS.int_dest_y, (data >> (i * 16)) & 0xFFFF);
+                pixels_transferred++;
+                TRXPOS.int_dest_x++;
+                break;
         }
         if (TRXPOS.int_dest_x - TRXPOS.dest_x == TRXREG.width)
         {
@@ -2750,6 +3690,7 @@ void GraphicsSynthesizerThread::write_HWREG(uint64_t data)
 
 uint128_t GraphicsSynthesizerThread::local_to_host()
 {
+    flush_draws();
     int ppd = 0; //pixels per doubleword (64-bits)
     uint128_t return_data;
     return_data._u64[0] = 0;
@@ -2757,6 +3698,32 @@ uint128_t GraphicsSynthesizerThread::local_to_host()
     if (TRXDIR == 3)
         return return_data;
 
+    if (transfer_blocks && TRXDIR == 1)
+    {
+        if (!transfer_buffer_loaded)
+        {
+            read_transfer_blocks(transfer_buffer.data());
+            transfer_buffer_loaded = true;
+        }
+        memcpy(&return_data, &transfer_buffer[transfer_buffer_pos], sizeof(return_data));
+        transfer_buffer_pos += sizeof(return_data);
+        if (transfer_buffer_pos == transfer_buffer.size())
+        {
+            TRXPOS.int_source_y += transfer_block_height;
+            transfer_buffer_pos = 0;
+            transfer_buffer_loaded = false;
+            pixels_transferred += TRXREG.width * transfer_block_height;
+        }
+
+        if (pixels_transferred >= TRXREG.width * TRXREG.height)
+        {
+            TRXDIR = 3;
+            pixels_transferred = 0;
+            transfer_blocks = false;
+        }
+        return return_data;
+    }
+
     switch (BITBLTBUF.source_format)
     {
         //PSMCT32
@@ -2787,9 +3754,16 @@ uint128_t GraphicsSynthesizerThread::local_to_host()
         case 0x1B:
             ppd = 8;
             break;
+        case 0x30:
+            ppd = 2;
+            break;
         case 0x31:
             ppd = 1; //Does it all in one go
             break;
+        case 0x32:
+        case 0x3A:
+            ppd = 4;
+            break;
         default:
             Errors::print_warning("[GS_t] GS Download Unrecognized BITBLTBUF source format $%02X\n", BITBLTBUF.source_format);
             return return_data;
@@ -2843,9 +3817,27 @@ uint128_t GraphicsSynthesizerThread::local_to_host()
                     pixels_transferred++;
                     TRXPOS.int_source_x++;
                     break;
+                case 0x30:
+                    data |= (uint64_t)(read_PSMCT32Z_block(BITBLTBUF.source_base, BITBLTBUF.source_width,
+                        TRXPOS.int_source_x, TRXPOS.int_source_y) & 0xFFFFFFFF) << (i * 32);
+                    pixels_transferred++;
+                    TRXPOS.int_source_x++;
+                    break;
                 case 0x31:
                     data = pack_PSMCT24(true);
                     break;
+                case 0x32:
+                    data |= (uint64_t)(read_PSMCT16Z_block(BITBLTBUF.source_base, BITBLTBUF.source_width,
+                        TRXPOS.int_source_x, TRXPOS.int_source_y) & 0xFFFF) << (i * 16);
+                    pixels_transferred++;
+                    TRXPOS.int_source_x++;
+                    break;
+                case 0x3A:
+                    data |= (uint64_t)(read_PSMCT16SZ_block(BITBLTBUF.source_base, BITBLTBUF.source_width,
+                        TRXPOS.int_source_x, TRXPOS.int_source_y) & 0xFFFF) << (i * 16);
+                    pixels_transferred++;
+                    TRXPOS.int_source_x++;
+                    break;
                 default:
                     Errors::print_warning("[GS_t] GS Download Unrecognized BITBLTBUF source format $%02X\n", BITBLTBUF.source_format);
                     return return_data;
@@ -2875,6 +3867,150 @@ uint128_t GraphicsSynthesizerThread::local_to_host()
     return return_data;
 }
 
+//Reads back everything left of a local->host transfer, so the emu thread only has to wait once per transfer
+void GraphicsSynthesizerThread::download_transfer()
+{
+    flush_draws();
+    download_buffer.clear();
+    download_pos = 0;
+    while (TRXDIR == 1)
+    {
+        if (transfer_blocks && !transfer_buffer_pos)
+        {
+            //Whole rows of blocks are unswizzled straight into the download buffer
+            uint32_t row_pixels = TRXREG.width * transfer_block_height;
+            uint32_t rows = (TRXREG.width * TRXREG.height - pixels_transferred) / row_pixels;
+            size_t start = download_buffer.size();
+            download_buffer.resize(start + rows * row_pixels * transfer_bpp / 128);
+            uint8_t* dest = (uint8_t*)(download_buffer.data() + start);
+            for (uint32_t row = 0; row < rows; row++)
+            {
+                read_transfer_blocks(dest);
+                dest += row_pixels * transfer_bpp / 8;
+                TRXPOS.int_source_y += transfer_block_height;
+            }
+            TRXDIR = 3;
+            pixels_transferred = 0;
+            transfer_blocks = false;
+            transfer_buffer_loaded = false;
+            break;
+        }
+
+        //Formats without block kernels, or a row of blocks that was partly read before a save state
+        int old_pixels = pixels_transferred;
+        download_buffer.push_back(local_to_host());
+        if (TRXDIR == 1 && pixels_transferred == old_pixels)
+            break;
+    }
+}
+
+//Transfers covering whole blocks of a format with block kernels skip the per-pixel path
+void GraphicsSynthesizerThread::start_block_transfer(uint8_t format, uint32_t x, uint32_t y)
+{
+    if (!get_block_size(format, transfer_block_width, transfer_block_height, transfer_bpp))
+        return;
+    if (!TRXREG.width || !TRXREG.height)
+        return;
+    if ((x | TRXREG.width) % transfer_block_width || (y | TRXREG.height) % transfer_block_height)
+        return;
+
+    transfer_blocks = true;
+    transfer_buffer.resize(TRXREG.width * transfer_block_height * transfer_bpp / 8);
+}
+
+//Blocks are contiguous 256 bytes starting at the address of their top-left pixel
+uint8_t* GraphicsSynthesizerThread::get_transfer_block(uint32_t base, uint32_t width, uint8_t format,
+                                                       uint32_t x, uint32_t y)
+{
+    switch (format)
+    {
+        case 0x00:
+        case 0x01:
+            return &local_mem[addr_PSMCT32(base / 256, width / 64, x, y)];
+        case 0x02:
+            return &local_mem[addr_PSMCT16(base / 256, width / 64, x, y)];
+        case 0x0A:
+            return &local_mem[addr_PSMCT16S(base / 256, width / 64, x, y)];
+        case 0x30:
+        case 0x31:
+            return &local_mem[addr_PSMCT32Z(base / 256, width / 64, x, y)];
+        case 0x32:
+            return &local_mem[addr_PSMCT16Z(base / 256, width / 64, x, y)];
+        case 0x3A:
+            return &local_mem[addr_PSMCT16SZ(base / 256, width / 64, x, y)];
+        case 0x13:
+            return &local_mem[addr_PSMCT8(base / 256, width / 64, x, y)];
+        case 0x14:
+            return &local_mem[addr_PSMCT4(base / 256, width / 64, x, y) >> 1];
+        default:
+            Errors::die("[GS_t] Block transfer of unsupported format $%02X", format);
+            return nullptr;
+    }
+}
+
+void GraphicsSynthesizerThread::write_transfer_blocks()
+{
+    int pitch = TRXREG.width * transfer_bpp / 8;
+    for (uint32_t x = 0; x < TRXREG.width; x += transfer_block_width)
+    {
+        uint8_t* block = get_transfer_block(BITBLTBUF.dest_base, BITBLTBUF.dest_width, BITBLTBUF.dest_format,
+                                            TRXPOS.int_dest_x + x, TRXPOS.int_dest_y);
+        swizzle_block(BITBLTBUF.dest_format, block, &transfer_buffer[x * transfer_bpp / 8], pitch);
+    }
+    TRXPOS.int_dest_y += transfer_block_height;
+}
+
+//Reads the row of blocks at the current source position
+void GraphicsSynthesizerThread::read_transfer_blocks(uint8_t* dest)
+{
+    int pitch = TRXREG.width * transfer_bpp / 8;
+    for (uint32_t x = 0; x < TRXREG.width; x += transfer_block_width)
+    {
+        uint8_t* block = get_transfer_block(BITBLTBUF.source_base, BITBLTBUF.source_width, BITBLTBUF.source_format,
+                                            TRXPOS.int_source_x + x, TRXPOS.int_source_y);
+        unswizzle_block(BITBLTBUF.source_format, &dest[x * transfer_bpp / 8], pitch, block);
+    }
+}
+
+//Switches a transfer in progress to the per-pixel path, writing out any incomplete row of an upload
+void GraphicsSynthesizerThread::end_block_transfer()
+{
+    uint32_t pixels = transfer_buffer_pos * 8 / transfer_bpp;
+    std::vector<uint64_t> pending;
+    if (TRXDIR == 0)
+    {
+        pending.resize(transfer_buffer_pos / sizeof(uint64_t));
+        memcpy(pending.data(), transfer_buffer.data(), transfer_buffer_pos);
+    }
+    else
+    {
+        //A 24-bit pixel can be split between quadwords, what's left of it is sent first by pack_PSMCT24
+        uint32_t bits_sent = (transfer_buffer_pos * 8) % transfer_bpp;
+        if (bits_sent)
+        {
+            uint32_t x = TRXPOS.int_source_x + pixels % TRXREG.width;
+            uint32_t y = TRXPOS.int_source_y + pixels / TRXREG.width;
+            uint32_t color;
+            if (BITBLTBUF.source_format == 0x31)
+                color = read_PSMCT32Z_block(BITBLTBUF.source_base, BITBLTBUF.source_width, x, y);
+            else
+                color = read_PSMCT32_block(BITBLTBUF.source_base, BITBLTBUF.source_width, x, y);
+            PSMCT24_color = (color & 0xFFFFFF) >> bits_sent;
+            PSMCT24_unpacked_count = transfer_bpp - bits_sent;
+            pixels++;
+        }
+        TRXPOS.int_source_x += pixels % TRXREG.width;
+        TRXPOS.int_source_y += pixels / TRXREG.width;
+        pixels_transferred += pixels;
+    }
+    transfer_blocks = false;
+    transfer_buffer_pos = 0;
+    transfer_buffer_loaded = false;
+
+    for (uint64_t data : pending)
+        write_HWREG(data);
+}
+
 void GraphicsSynthesizerThread::unpack_PSMCT24(uint64_t data, int offset, bool z_format)
 {
     int bytes_unpacked = 0;
@@ -2956,6 +4092,7 @@ uint64_t GraphicsSynthesizerThread::pack_PSMCT24(bool z_format)
 
 void GraphicsSynthesizerThread::local_to_local()
 {
+    flush_draws();
     printf("[GS_t] Local to local transfer\n");
     printf("(%d, %d) -> (%d, %d)\n", TRXPOS.source_x, TRXPOS.source_y, TRXPOS.dest_x, TRXPOS.dest_y);
     printf("Trans order: %d\n", TRXPOS.trans_order);
@@ -3365,81 +4502,98 @@ void GraphicsSynthesizerThread::tex_lookup_int(int16_t u, int16_t v, TexLookupIn
     info.lastv = v;
     info.new_lookup = forced_lookup; //If we're forcing a lookup, it's bilinear filtering, so the src will get polluted
 
-    uint32_t tex_base = info.tex_base;
-    uint32_t width = info.buffer_width;
+    //The decoded copy only holds the base level, and wrapping can leave coordinates outside of it
+    const CachedTexture* texture = info.texture;
+    if (texture && info.tex_base == texture->key.tex_base && info.buffer_width == texture->key.buffer_width &&
+            (uint16_t)u < texture->key.width && (uint16_t)v < texture->key.height &&
+            info.tex_width == texture->key.width && info.tex_height == texture->key.height)
+    {
+        uint32_t color = texture->texels[v * texture->key.width + u];
+        info.srctex_color.r = color & 0xFF;
+        info.srctex_color.g = (color >> 8) & 0xFF;
+        info.srctex_color.b = (color >> 16) & 0xFF;
+        info.srctex_color.a = color >> 24;
+        return;
+    }
+
+    read_texel(info.tex_base, info.buffer_width, u, v, info.srctex_color);
+}
+
+void GraphicsSynthesizerThread::read_texel(uint32_t tex_base, uint32_t width, int16_t u, int16_t v, RGBAQ_REG& tex_color)
+{
     switch (current_ctx->tex0.format)
     {
         case 0x00:
         {
             uint32_t color = read_PSMCT32_block(tex_base, width, u, v);
-            info.srctex_color.r = color & 0xFF;
-            info.srctex_color.g = (color >> 8) & 0xFF;
-            info.srctex_color.b = (color >> 16) & 0xFF;
-            info.srctex_color.a = color >> 24;
+            tex_color.r = color & 0xFF;
+            tex_color.g = (color >> 8) & 0xFF;
+            tex_color.b = (color >> 16) & 0xFF;
+            tex_color.a = color >> 24;
         }
             break;
         case 0x01:
         {
             uint32_t color = read_PSMCT32_block(tex_base, width, u, v);
-            info.srctex_color.r = color & 0xFF;
-            info.srctex_color.g = (color >> 8) & 0xFF;
-            info.srctex_color.b = (color >> 16) & 0xFF;
+            tex_color.r = color & 0xFF;
+            tex_color.g = (color >> 8) & 0xFF;
+            tex_color.b = (color >> 16) & 0xFF;
 
             if (!(color & 0xFFFFFF) && TEXA.trans_black)
-                info.srctex_color.a = 0;
+                tex_color.a = 0;
             else
-                info.srctex_color.a = TEXA.alpha0;
+                tex_color.a = TEXA.alpha0;
         }
             break;
         case 0x02:
         {
             uint16_t color = read_PSMCT16_block(tex_base, width, u, v);
-            info.srctex_color.r = (color & 0x1F) << 3;
-            info.srctex_color.g = ((color >> 5) & 0x1F) << 3;
-            info.srctex_color.b = ((color >> 10) & 0x1F) << 3;
-            info.srctex_color.a = get_16bit_alpha(color);
+            tex_color.r = (color & 0x1F) << 3;
+            tex_color.g = ((color >> 5) & 0x1F) << 3;
+            tex_color.b = ((color >> 10) & 0x1F) << 3;
+            tex_color.a = get_16bit_alpha(color);
         }
             break;
         case 0x09: //Invalid format??? FFX uses it
-            info.srctex_color.r = 0;
-            info.srctex_color.g = 0;
-            info.srctex_color.b = 0;
-            info.srctex_color.a = 0;
+            tex_color.r = 0;
+            tex_color.g = 0;
+            tex_color.b = 0;
+            tex_color.a = 0;
             break;
         case 0x0A:
         {
             uint16_t color = read_PSMCT16S_block(tex_base, width, u, v);
-            info.srctex_color.r = (color & 0x1F) << 3;
-            info.srctex_color.g = ((color >> 5) & 0x1F) << 3;
-            info.srctex_color.b = ((color >> 10) & 0x1F) << 3;
-            info.srctex_color.a = get_16bit_alpha(color);
+            tex_color.r = (color & 0x1F) << 3;
+            tex_color.g = ((color >> 5) & 0x1F) << 3;
+            tex_color.b = ((color >> 10) & 0x1F) << 3;
+            tex_color.a = get_16bit_alpha(color);
         }
             break;
         case 0x13:
         {
             uint8_t entry = read_PSMCT8_block(tex_base, width, u, v);
             if (current_ctx->tex0.use_CSM2)
-                clut_CSM2_lookup(entry, info.srctex_color);
+                clut_CSM2_lookup(entry, tex_color);
             else
-                clut_lookup(entry, info.srctex_color);
+                clut_lookup(entry, tex_color);
         }
             break;
         case 0x14:
         {
             uint8_t entry = read_PSMCT4_block(tex_base, width, u, v);
             if (current_ctx->tex0.use_CSM2)
-                clut_CSM2_lookup(entry, info.srctex_color);
+                clut_CSM2_lookup(entry, tex_color);
             else
-                clut_lookup(entry, info.srctex_color);
+                clut_lookup(entry, tex_color);
         }
             break;
         case 0x1B:
         {
             uint8_t entry = read_PSMCT32_block(tex_base, width, u, v) >> 24;
             if (current_ctx->tex0.use_CSM2)
-                clut_CSM2_lookup(entry, info.srctex_color);
+                clut_CSM2_lookup(entry, tex_color);
             else
-                clut_lookup(entry, info.srctex_color);
+                clut_lookup(entry, tex_color);
         }
             break;
         case 0x24:
@@ -3447,9 +4601,9 @@ void GraphicsSynthesizerThread::tex_lookup_int(int16_t u, int16_t v, TexLookupIn
             //printf("[GS_t] Format $24: Read from $%08X\n", tex_base + (coord << 2));
             uint8_t entry = (read_PSMCT32_block(tex_base, width, u, v) >> 24) & 0xF;
             if (current_ctx->tex0.use_CSM2)
-                clut_CSM2_lookup(entry, info.srctex_color);
+                clut_CSM2_lookup(entry, tex_color);
             else
-                clut_lookup(entry, info.srctex_color);
+                clut_lookup(entry, tex_color);
             break;
         }
             break;
@@ -3457,48 +4611,48 @@ void GraphicsSynthesizerThread::tex_lookup_int(int16_t u, int16_t v, TexLookupIn
         {
             uint8_t entry = read_PSMCT32_block(tex_base, width, u, v) >> 28;
             if (current_ctx->tex0.use_CSM2)
-                clut_CSM2_lookup(entry, info.srctex_color);
+                clut_CSM2_lookup(entry, tex_color);
             else
-                clut_lookup(entry, info.srctex_color);
+                clut_lookup(entry, tex_color);
         }
             break;
         case 0x30:
         {
             uint32_t color = read_PSMCT32Z_block(tex_base, width, u, v);
-            info.srctex_color.r = color & 0xFF;
-            info.srctex_color.g = (color >> 8) & 0xFF;
-            info.srctex_color.b = (color >> 16) & 0xFF;
-            info.srctex_color.a = color >> 24;
+            tex_color.r = color & 0xFF;
+            tex_color.g = (color >> 8) & 0xFF;
+            tex_color.b = (color >> 16) & 0xFF;
+            tex_color.a = color >> 24;
         }
             break;
         case 0x31:
         {
             uint32_t color = read_PSMCT32Z_block(tex_base, width, u, v);
-            info.srctex_color.r = color & 0xFF;
-            info.srctex_color.g = (color >> 8) & 0xFF;
-            info.srctex_color.b = (color >> 16) & 0xFF;
+            tex_color.r = color & 0xFF;
+            tex_color.g = (color >> 8) & 0xFF;
+            tex_color.b = (color >> 16) & 0xFF;
             if (!(color & 0xFFFFFF) && TEXA.trans_black)
-                info.srctex_color.a = 0;
+                tex_color.a = 0;
             else
-                info.srctex_color.a = TEXA.alpha0;
+                tex_color.a = TEXA.alpha0;
         }
             break;
         case 0x32:
         {
             uint16_t color = read_PSMCT16Z_block(tex_base, width, u, v);
-            info.srctex_color.r = (color & 0x1F) << 3;
-            info.srctex_color.g = ((color >> 5) & 0x1F) << 3;
-            info.srctex_color.b = ((color >> 10) & 0x1F) << 3;
-            info.srctex_color.a = get_16bit_alpha(color);
+            tex_color.r = (color & 0x1F) << 3;
+            tex_color.g = ((color >> 5) & 0x1F) << 3;
+            tex_color.b = ((color >> 10) & 0x1F) << 3;
+            tex_color.a = get_16bit_alpha(color);
         }
             break;
         case 0x3A:
         {
             uint16_t color = read_PSMCT16SZ_block(tex_base, width, u, v);
-            info.srctex_color.r = (color & 0x1F) << 3;
-            info.srctex_color.g = ((color >> 5) & 0x1F) << 3;
-            info.srctex_color.b = ((color >> 10) & 0x1F) << 3;
-            info.srctex_color.a = get_16bit_alpha(color);
+            tex_color.r = (color & 0x1F) << 3;
+            tex_color.g = ((color >> 5) & 0x1F) << 3;
+            tex_color.b = ((color >> 10) & 0x1F) << 3;
+            tex_color.a = get_16bit_alpha(color);
         }
             break;
         default:
@@ -3551,6 +4705,7 @@ void GraphicsSynthesizerThread::clut_CSM2_lookup(uint8_t entry, RGBAQ_REG &tex_c
 
 void GraphicsSynthesizerThread::reload_clut(const GSContext& context)
 {
+    flush_draws();
     int eight_bit = false;
     switch (context.tex0.format)
     {
@@ -3667,6 +4822,9 @@ void GraphicsSynthesizerThread::reload_clut(const GSContext& context)
 
 void GraphicsSynthesizerThread::load_state(ifstream *state)
 {
+    flush_draws();
+    draw_state_valid = false;
+    texture_cache.clear();
     state->read((char*)local_mem, 1024 * 1024 * 4);
     state->read((char*)&IMR, sizeof(IMR));
     state->read((char*)&context1, sizeof(context1));
@@ -3709,14 +4867,30 @@ void GraphicsSynthesizerThread::load_state(ifstream *state)
     state->read((char*)&PSMCT24_color, sizeof(PSMCT24_color));
     state->read((char*)&PSMCT24_unpacked_count, sizeof(PSMCT24_unpacked_count));
 
+    //Transfers are saved in the middle of the per-pixel path, see save_state
+    transfer_blocks = false;
+    transfer_buffer_pos = 0;
+    transfer_buffer_loaded = false;
+
     state->read((char*)&reg, sizeof(reg));
     state->read((char*)&current_vtx, sizeof(current_vtx));
     state->read((char*)&vtx_queue, sizeof(vtx_queue));
     state->read((char*)&num_vertices, sizeof(num_vertices));
+    state->read((char*)&gif_path, sizeof(gif_path));
+    state->read((char*)&gif_Q, sizeof(gif_Q));
+
+    uint32_t download_left;
+    state->read((char*)&download_left, sizeof(download_left));
+    download_buffer.resize(download_left);
+    download_pos = 0;
+    state->read((char*)download_buffer.data(), download_left * sizeof(uint128_t));
 }
 
 void GraphicsSynthesizerThread::save_state(ofstream *state)
 {
+    flush_draws();
+    if (transfer_blocks)
+        end_block_transfer();
     state->write((char*)local_mem, 1024 * 1024 * 4);
     state->write((char*)&IMR, sizeof(IMR));
     state->write((char*)&context1, sizeof(context1));
@@ -3761,4 +4935,11 @@ void GraphicsSynthesizerThread::save_state(ofstream *state)
     state->write((char*)&current_vtx, sizeof(current_vtx));
     state->write((char*)&vtx_queue, sizeof(vtx_queue));
     state->write((char*)&num_vertices, sizeof(num_vertices));
+    state->write((char*)&gif_path, sizeof(gif_path));
+    state->write((char*)&gif_Q, sizeof(gif_Q));
+
+    //Saved from the emu thread's read position, it is waiting on this
+    uint32_t download_left = download_buffer.size() - download_pos;
+    state->write((char*)&download_left, sizeof(download_left));
+    state->write((char*)(download_buffer.data() + download_pos), download_left * sizeof(uint128_t));
 }
@@ -1,12 +1,19 @@
 #ifndef GSTHREAD_HPP
 #define GSTHREAD_HPP
+#include <atomic>
 #include <cstdint>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
 #include "gscontext.hpp"
+#include "giftag.hpp"
 #include "gsregisters.hpp"
+#include "gstexcache.hpp"
+#include "byteFIFO.hpp"
 #include "circularFIFO.hpp"
 #include "int128.hpp"
 
@@ -32,7 +39,7 @@ enum GSCommand:uint8_t
     write64_t, write64_privileged_t, write32_privileged_t,
     set_rgba_t, set_st_t, set_uv_t, set_xyz_t, set_xyzf_t, set_crt_t,
     render_crt_t, assert_finish_t, assert_vsync_t, set_vblank_t, memdump_t, die_t,
-    save_state_t, load_state_t, gsdump_t, request_local_host_tx,
+    save_state_t, load_state_t, gsdump_t, request_local_host_tx, gif_packet_t,
 };
 
 union GSMessagePayload 
@@ -94,6 +101,11 @@ union GSMessagePayload
     {
         std::ifstream* state;
     } load_state_payload;
+    struct
+    {
+        uint8_t path;
+        uint32_t count; //quadwords following the message in the FIFO
+    } gif_packet_payload;
     struct 
     {
         uint8_t BLANK; 
@@ -131,10 +143,6 @@ union GSReturnMessagePayload
     {
         uint8_t BLANK;
     } no_payload;//C++ doesn't like the empty struct
-    struct
-    {
-        uint128_t quad_data;
-    } data_payload;
 };
 
 struct GSReturnMessage
@@ -143,7 +151,7 @@ struct GSReturnMessage
     GSReturnMessagePayload payload;
 };
 
-typedef CircularFifo<GSMessage, 1024 * 1024 * 16> gs_fifo;
+typedef ByteFifo<1024 * 1024 * 16> gs_fifo;
 typedef CircularFifo<GSReturnMessage, 1024> gs_return_fifo;
 
 struct PRMODE_REG
@@ -243,6 +251,9 @@ struct TexLookupInfo
     uint8_t fog;
     bool new_lookup;
     int16_t lastu, lastv;
+
+    //Decoded copy of the base level, or nullptr when texels are read from local memory
+    const CachedTexture* texture;
 };
 
 struct VertexF
@@ -317,6 +328,43 @@ struct VertexF
     }
 };
 
+//A primitive waiting to be drawn by the raster threads
+struct QueuedPrimitive
+{
+    uint8_t type;
+    Vertex vtx[3];
+};
+
+class GSPixelJIT;
+struct PixelSpan;
+
+//State owned by a single raster thread.
+//The screen is split into tiles of rows, with each thread drawing every pixel of the tiles it owns.
+struct RasterWorker
+{
+    uint32_t id;
+
+    //Indices into the draw queue of primitives that touch this thread's tiles
+    std::vector<uint32_t> bin;
+
+    //Destination color of the pixel being drawn, read at most once per pixel
+    uint32_t frame_color;
+    bool frame_color_looked_up;
+
+    //Pixels of the current run on a line, drawn together by draw_span
+    constexpr static int MAX_SPAN_PIXELS = 64;
+    RGBAQ_REG span_color[MAX_SPAN_PIXELS];
+    uint32_t span_z[MAX_SPAN_PIXELS];
+    int32_t span_x, span_y;
+    int span_count;
+
+    //Interpolated inputs to texture sampling for the pixels of a span
+    RGBAQ_REG tex_vtx_color[MAX_SPAN_PIXELS];
+    uint8_t tex_fog[MAX_SPAN_PIXELS];
+    float tex_s[MAX_SPAN_PIXELS], tex_t[MAX_SPAN_PIXELS];
+    int32_t tex_u[MAX_SPAN_PIXELS], tex_v[MAX_SPAN_PIXELS];
+};
+
 class GraphicsSynthesizerThread
 {
     private:
@@ -329,9 +377,63 @@ class GraphicsSynthesizerThread
         bool send_data = false;
         bool recieve_data = false;
 
+        //Set once the GS thread leaves its event loop, after any error it died with is on the return queue
+        std::atomic<bool> thread_stopped{false};
+
         gs_fifo* message_queue = nullptr;
         gs_return_fifo* return_queue = nullptr;
 
+        //GIF data is staged on the emu thread and sent as one message per packet, rather than one per register
+        constexpr static int MAX_GIF_PACKET_QUADS = 1024;
+        uint128_t gif_packet[MAX_GIF_PACKET_QUADS];
+        uint32_t gif_packet_count = 0;
+        int gif_packet_path = 0;
+
+        bool gsdump_recording;
+        std::ofstream gsdump_file;
+
+        //Local->host transfers are read back whole by the GS thread and streamed from here by the emu thread.
+        //The GS thread only touches these while the emu thread waits on it.
+        std::vector<uint128_t> download_buffer;
+        size_t download_pos = 0;
+
+        //Rasterization is spread across the GS thread (worker 0) and raster_thread_count - 1 helper threads.
+        //Primitives are queued while no drawing state changes and drawn in parallel when the queue is flushed.
+        constexpr static int MAX_RASTER_THREADS = 16;
+        constexpr static int RASTER_TILE_SHIFT = 3;
+        constexpr static size_t MAX_QUEUED_PRIMS = 4096;
+
+        int raster_thread_count;
+        std::thread raster_threads[MAX_RASTER_THREADS];
+        RasterWorker raster_workers[MAX_RASTER_THREADS];
+        std::vector<QueuedPrimitive> draw_queue;
+
+        std::mutex raster_mutex;
+        std::condition_variable raster_start, raster_done;
+        uint32_t raster_generation;
+        int raster_busy;
+        bool raster_exit;
+        std::string raster_error;
+
+        //Set while a primitive is drawn by the GS thread alone, letting worker 0 draw every row
+        bool draw_serially;
+
+        //Compiled pixel pipeline for the current draw state, looked up again after any state change.
+        //A null pipeline means pixels go through draw_pixel.
+        GSPixelJIT* pixel_jit;
+        void (*pixel_pipeline)(const PixelSpan* span);
+
+        //Decoded textures, and the one sampled with the current draw state if it could be cached
+        GSTextureCache texture_cache;
+        const CachedTexture* current_texture;
+        bool texture_in_target;
+
+        //Set when the frame and Z buffers share pages, so that a row of one can land on another thread's row of the other
+        bool frame_in_zbuf;
+
+        //Cleared on any state change, making the next primitive update the pipeline and texture
+        bool draw_state_valid;
+
         bool frame_complete;
         int frame_count;
         uint8_t* local_mem;
@@ -375,20 +477,57 @@ class GraphicsSynthesizerThread
         uint32_t PSMCT24_color;
         int PSMCT24_unpacked_count;
 
+        //Block-aligned transfers go through one row of blocks at a time, staged linearly in transfer_buffer.
+        //Uploads are swizzled once a row is complete, downloads are unswizzled when their row is first read.
+        bool transfer_blocks;
+        int transfer_block_width, transfer_block_height, transfer_bpp;
+        std::vector<uint8_t> transfer_buffer;
+        uint32_t transfer_buffer_pos;
+        bool transfer_buffer_loaded;
+
         GS_REGISTERS reg;
 
         Vertex current_vtx;
         Vertex vtx_queue[3];
         unsigned int num_vertices;
 
-        uint32_t frame_color;
-        bool frame_color_looked_up;
-
         static const unsigned int max_vertices[8];
 
         float log2_lookup[32768][4];
 
         void event_loop();
+        void push_message(GSMessage& message, const void* data, size_t size);
+        bool pop_message(GSMessage& message);
+        void flush_GIF_packet();
+        void record_message(GSCommand type, const GSMessagePayload& payload);
+
+        void start_raster_threads();
+        void stop_raster_threads();
+        void raster_loop(int id);
+        void render_bin(RasterWorker& worker);
+        void flush_draws();
+        bool draw_state_changed(uint32_t addr, uint64_t value);
+        inline bool owns_row(const RasterWorker& worker, int32_t y)
+        {
+            return raster_thread_count == 1 || draw_serially || (((uint32_t)y >> RASTER_TILE_SHIFT) % raster_thread_count) == worker.id;
+        };
+        inline void begin_span(RasterWorker& worker, int32_t y)
+        {
+            worker.span_y = y;
+            worker.span_count = 0;
+        };
+        inline void add_span_pixel(RasterWorker& worker, int32_t x, uint32_t z, const RGBAQ_REG& color)
+        {
+            //A gap in the line starts a new span
+            if (worker.span_x + worker.span_count != x || worker.span_count == RasterWorker::MAX_SPAN_PIXELS)
+            {
+                draw_span(worker);
+                worker.span_x = x;
+            }
+            worker.span_z[worker.span_count] = z;
+            worker.span_color[worker.span_count] = color;
+            worker.span_count++;
+        };
 
         inline const uint32_t get_word(uint32_t addr) { return *(uint32_t*)&local_mem[addr]; };
         inline void set_word(uint32_t addr, uint32_t value) { *(uint32_t*)&local_mem[addr] = value; };
@@ -437,24 +576,43 @@ class GraphicsSynthesizerThread
         void calculate_LOD(TexLookupInfo& info);
         void tex_lookup(int16_t u, int16_t v, TexLookupInfo& info);
         void tex_lookup_int(int16_t u, int16_t v, TexLookupInfo& info, bool forced_lookup = false);
+        void read_texel(uint32_t tex_base, uint32_t width, int16_t u, int16_t v, RGBAQ_REG& tex_color);
         void clut_lookup(uint8_t entry, RGBAQ_REG& tex_color);
         void clut_CSM2_lookup(uint8_t entry, RGBAQ_REG& tex_color);
         void reload_clut(const GSContext& context);
 
         void vertex_kick(bool drawing_kick);
         bool depth_test(int32_t x, int32_t y, uint32_t z);
-        void draw_pixel(int32_t x, int32_t y, uint32_t z, RGBAQ_REG& color);
-        uint32_t lookup_frame_color(int32_t x, int32_t y);
+        void draw_pixel(int32_t x, int32_t y, uint32_t z, RGBAQ_REG color, RasterWorker& worker);
+        void update_pixel_pipeline();
+        void draw_span(RasterWorker& worker);
+        void get_span_row(uint8_t format, uint32_t base, uint32_t y, const uint32_t*& row, uint32_t& page);
+        uint32_t lookup_frame_color(int32_t x, int32_t y, RasterWorker& worker);
         void render_primitive();
-        void render_point();
-        void render_line();
-        void render_triangle();
-        void render_triangle2();
+        GSTextureCache::PageMask get_texture_pages();
+        GSTextureCache::PageMask get_frame_pages();
+        GSTextureCache::PageMask get_zbuf_pages();
+        GSTextureCache::PageMask get_target_pages();
+        bool frame_overlaps_zbuf();
+        bool texture_overlaps_target();
+        void update_texture();
+        void decode_texture(CachedTexture& texture);
+        void draw_primitive(uint8_t type, const Vertex* vtx, RasterWorker& worker);
+        void render_point(const Vertex* vtx, RasterWorker& worker);
+        void render_line(const Vertex* vtx, RasterWorker& worker);
+        void render_triangle(const Vertex* vtx, RasterWorker& worker);
+        void render_triangle2(const Vertex* vtx, RasterWorker& worker);
         void render_half_triangle(float x0, float x1, int y0, int y1, VertexF& x_step, VertexF& y_step, VertexF& init,
-                float step_x0, float step_x1, float scx1, float scx2, TexLookupInfo& tex_info);
-        void render_sprite();
+                float step_x0, float step_x1, float scx1, float scx2, TexLookupInfo& tex_info, RasterWorker& worker);
+        void render_sprite(const Vertex* vtx, RasterWorker& worker);
         void write_HWREG(uint64_t data);
         uint128_t local_to_host();
+        void download_transfer();
+        void start_block_transfer(uint8_t format, uint32_t x, uint32_t y);
+        uint8_t* get_transfer_block(uint32_t base, uint32_t width, uint8_t format, uint32_t x, uint32_t y);
+        void write_transfer_blocks();
+        void read_transfer_blocks(uint8_t* dest);
+        void end_block_transfer();
         void unpack_PSMCT24(uint64_t data, int offset, bool z_format);
         uint64_t pack_PSMCT24(bool z_format);
         void local_to_local();
@@ -472,6 +630,15 @@ class GraphicsSynthesizerThread
 
         void write64(uint32_t addr, uint64_t value);
 
+        //GIF packet decoding, the GIF itself only walks packets to find where they end
+        GIFtag gif_path[4];
+        float gif_Q;
+        void process_GIF_packet(int path, uint32_t count);
+        void process_GIF_quad(GIFtag& tag, const uint128_t& quad);
+        void process_PACKED(GIFtag& tag, const uint128_t& quad);
+        void process_REGLIST(GIFtag& tag, const uint128_t& quad);
+        void sync_block_transfer();
+
         void set_RGBA(uint8_t r, uint8_t g, uint8_t b, uint8_t a, float q);
         void set_ST(uint32_t s, uint32_t t);
         void set_UV(uint16_t u, uint16_t v);
@@ -480,12 +647,18 @@ class GraphicsSynthesizerThread
 
         void load_state(std::ifstream* state);
         void save_state(std::ofstream* state);
+
+        //The tests draw through both draw_pixel and the compiled pipelines and compare local memory
+        friend class Emulator;
     public:
         GraphicsSynthesizerThread();
         ~GraphicsSynthesizerThread();
         
         // safe to access from emu thread
         void send_message(GSMessage message);
+        void send_GIF_data(int path, const uint128_t& quad);
+        uint128_t read_download();
+        void reset_download();
         void wake_thread();
         void wait_for_return(GSReturn type, GSReturnMessage &data);
         void reset_fifos();
@@ -24,7 +24,8 @@ uint32_t CDVD_Drive::get_block_timing(bool mode_DVD)
     return (IOP_CLOCK * block_size) / (speed * (mode_DVD ? PSX_DVD_READSPEED : PSX_CD_READSPEED));
 }
 
-CDVD_Drive::CDVD_Drive(Emulator* e, IOP_DMA* dma) : e(e), dma(dma), container(CDVD_CONTAINER::ISO)
+CDVD_Drive::CDVD_Drive(Emulator* e, IOP_DMA* dma) : e(e), dma(dma), container(CDVD_CONTAINER::ISO),
+    sector_data(nullptr), sector_data_offset(0)
 {
 
 }
@@ -38,14 +39,10 @@ bool CDVD_Drive::container_open(const char* file_path)
 {
     if (container == CDVD_CONTAINER::ISO)
     {
-        if (cdvd_file.is_open())
-            cdvd_file.close();
-    
-        cdvd_file.open(file_path, ios::in | ios::binary | ifstream::ate);
-        if (!cdvd_file.is_open())
+        if (!iso_file.open(file_path))
             return false;
-    
-        file_size = cdvd_file.tellg();
+
+        file_size = iso_file.get_size();
         return true;
     }
     else if (container == CDVD_CONTAINER::CISO)
@@ -62,10 +59,10 @@ bool CDVD_Drive::container_open(const char* file_path)
 
 void CDVD_Drive::container_close()
 {
+    sector_data = nullptr;
     if (container == CDVD_CONTAINER::ISO)
     {
-        if (cdvd_file.is_open())
-            cdvd_file.close();
+        iso_file.close();
     }
     else if (container == CDVD_CONTAINER::CISO)
     {
@@ -77,7 +74,7 @@ bool CDVD_Drive::container_isopen()
 {
     if (container == CDVD_CONTAINER::ISO)
     {
-        return cdvd_file.is_open();
+        return iso_file.isopen();
     }
     else if (container == CDVD_CONTAINER::CISO)
     {
@@ -91,7 +88,7 @@ void CDVD_Drive::container_seek(std::ios::streamoff ofs, std::ios::seekdir whenc
 {
     if (container == CDVD_CONTAINER::ISO)
     {
-        cdvd_file.seekg(ofs, whence);
+        iso_file.seek((int64_t)ofs, whence);
     }
     else if (container == CDVD_CONTAINER::CISO)
     {
@@ -103,7 +100,7 @@ uint64_t CDVD_Drive::container_tell()
 {
     if (container == CDVD_CONTAINER::ISO)
     {
-        return cdvd_file.tellg();
+        return iso_file.tell();
     }
     else if (container == CDVD_CONTAINER::CISO)
     {
@@ -117,8 +114,7 @@ size_t CDVD_Drive::container_read(void* dst, size_t size)
 {
     if (container == CDVD_CONTAINER::ISO)
     {
-        cdvd_file.read((char*)dst, size);
-        return cdvd_file.gcount();
+        return iso_file.read((uint8_t*)dst, size);
     }
     else if (container == CDVD_CONTAINER::CISO)
     {
@@ -128,6 +124,40 @@ size_t CDVD_Drive::container_read(void* dst, size_t size)
     return 0;
 }
 
+//Hints that the next size bytes from the current position are about to be read
+void CDVD_Drive::container_prefetch(uint64_t size)
+{
+    if (container == CDVD_CONTAINER::ISO)
+    {
+        iso_file.prefetch(iso_file.tell(), size);
+    }
+    else if (container == CDVD_CONTAINER::CISO)
+    {
+        cso_file.prefetch(cso_file.tell(), size);
+    }
+}
+
+//Data at the current position that can be used in place, moving past it. Only mapped images have it.
+const uint8_t* CDVD_Drive::container_get_data(size_t size)
+{
+    if (container == CDVD_CONTAINER::ISO)
+    {
+        return iso_file.get_data(size);
+    }
+
+    return nullptr;
+}
+
+//Puts a sector that's still in the image into read_buffer, so that the buffer holds the whole block
+void CDVD_Drive::flush_sector_data()
+{
+    if (sector_data)
+    {
+        memcpy(read_buffer + sector_data_offset, sector_data, 2048);
+        sector_data = nullptr;
+    }
+}
+
 
 void CDVD_Drive::reset()
 {
@@ -145,6 +175,7 @@ void CDVD_Drive::reset()
     S_status = 0x40;
     S_out_params = 0;
     read_bytes_left = 0;
+    sector_data = nullptr;
     ISTAT = 0;
     file_size = 0;
     time_t raw_time;
@@ -240,7 +271,16 @@ int CDVD_Drive::bytes_left()
 
 uint32_t CDVD_Drive::read_to_RAM(uint8_t *RAM, uint32_t bytes)
 {
-    memcpy(RAM, read_buffer, block_size);
+    if (sector_data)
+    {
+        int data_end = sector_data_offset + 2048;
+        memcpy(RAM, read_buffer, sector_data_offset);
+        memcpy(RAM + sector_data_offset, sector_data, 2048);
+        memcpy(RAM + data_end, read_buffer + data_end, block_size - data_end);
+        sector_data = nullptr;
+    }
+    else
+        memcpy(RAM, read_buffer, block_size);
     dma->clear_DMA_request(IOP_CDVD);
     read_bytes_left -= block_size;
     if (read_bytes_left <= 0)
@@ -392,6 +432,7 @@ uint8_t* CDVD_Drive::read_file(string name, uint32_t& file_size)
 
                 file = new uint8_t[file_size];
                 container_seek(file_location);
+                container_prefetch(file_size);
                 container_read(file, file_size);
                 delete[] root_extent;
                 return file;
@@ -772,6 +813,7 @@ void CDVD_Drive::N_command_read()
     speed = 24;
     printf("[CDVD] Read; Seek pos: %lu, Sectors: %lu\n", sector_pos, sectors_left);
     start_seek();
+    container_prefetch(sectors_left * 2048);
     active_N_command = NCOMMAND::READ_SEEK;
 }
 
@@ -785,6 +827,7 @@ void CDVD_Drive::N_command_dvdread()
     speed = 4;
     block_size = 2064;
     start_seek();
+    container_prefetch(sectors_left * 2048);
     active_N_command = NCOMMAND::READ_SEEK;
 }
 
@@ -792,6 +835,7 @@ void CDVD_Drive::N_command_gettoc()
 {
     printf("[CDVD] Get TOC\n");
     sectors_left = 0;
+    sector_data = nullptr;
     block_size = 2064;
     read_bytes_left = 2064;
     memset(read_buffer, 0, 2064);
@@ -857,11 +901,21 @@ void CDVD_Drive::N_command_readkey(uint32_t arg)
 void CDVD_Drive::read_CD_sector()
 {
     printf("[CDVD] Read CD sector - Sector: %lu Size: %lu\n", current_sector, block_size);
+
+    //Only 2048-byte sectors come straight from the image, the others are always in read_buffer
+    sector_data = nullptr;
     switch (block_size)
     {
         case 2340:
             fill_CDROM_sector();
             break;
+        case 2048:
+            //Mapped images hand the sector to the DMA without going through read_buffer
+            sector_data = container_get_data(2048);
+            sector_data_offset = 0;
+            if (!sector_data)
+                container_read(read_buffer, block_size);
+            break;
         default:
             container_read(read_buffer, block_size);
             break;
@@ -929,7 +983,10 @@ void CDVD_Drive::read_DVD_sector()
     read_buffer[9] = 0;
     read_buffer[10] = 0;
     read_buffer[11] = 0;
-    container_read(&read_buffer[12], 2048);
+    sector_data = container_get_data(2048);
+    sector_data_offset = 12;
+    if (!sector_data)
+        container_read(&read_buffer[12], 2048);
     read_buffer[2060] = 0;
     read_buffer[2061] = 0;
     read_buffer[2062] = 0;
@@ -2,6 +2,7 @@
 #define CDVD_HPP
 
 #include "cso_reader.hpp"
+#include "iso_reader.hpp"
 #include <fstream>
 
 class Emulator;
@@ -51,7 +52,7 @@ class CDVD_Drive
         Emulator* e;
         IOP_DMA* dma;
         CDVD_CONTAINER container;
-        std::ifstream cdvd_file;
+        ISO_Reader iso_file;
         CSO_Reader cso_file;
         uint64_t file_size;
         int read_bytes_left;
@@ -69,6 +70,11 @@ class CDVD_Drive
 
         uint8_t read_buffer[4096];
 
+        //Sector data that read_to_RAM takes straight from the mapped image, and where it goes in the block.
+        //Everything else in the block comes from read_buffer.
+        const uint8_t* sector_data;
+        int sector_data_offset;
+
         uint8_t ISTAT;
 
         uint8_t drive_status;
@@ -98,6 +104,9 @@ class CDVD_Drive
         void container_seek(std::ios::streamoff ofs, std::ios::seekdir whence = std::ios::beg);
         uint64_t container_tell();
         size_t container_read(void* dst, size_t size);
+        void container_prefetch(uint64_t size);
+        const uint8_t* container_get_data(size_t size);
+        void flush_sector_data();
 
         void start_seek();
         void prepare_S_outdata(int amount);
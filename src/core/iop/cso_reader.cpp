@@ -10,6 +10,7 @@ Based off reference by unknownbrackets:
 #include <libdeflate.h>
 #include <cstring>
 #include <cassert>
+#include <algorithm>
 
 constexpr uint32_t FOURCC(const char chars[4])
 {
@@ -46,9 +47,24 @@ struct CSO_Header
 CSO_Reader::CSO_Reader() :
     m_size(0), m_shift(0), m_blocksize(0), m_version(0), m_virtptr(0),
     m_indices(nullptr),
-    m_framesize(0), m_curframe(0xFFFFFFFF),
-    m_frame(nullptr), m_readbuf(nullptr),
-    m_inflate(nullptr) {}
+    m_framesize(0), m_readbuf(nullptr),
+    m_inflate(nullptr),
+    m_cache_clock(0),
+    m_readahead_next(0), m_readahead_end(0),
+    m_workers_quit(false)
+{
+    for (int i = 0; i < CACHE_FRAMES; ++i)
+    {
+        m_cache[i].state = FrameState::EMPTY;
+        m_cache[i].last_used = 0;
+        m_cache[i].data = nullptr;
+    }
+    for (int i = 0; i < WORKER_COUNT; ++i)
+    {
+        m_decoders[i].readbuf = nullptr;
+        m_decoders[i].inflate = nullptr;
+    }
+}
 
 CSO_Reader::~CSO_Reader()
 {
@@ -108,55 +124,186 @@ uint64_t CSO_Reader::tell()
     return m_virtptr;
 }
 
-bool CSO_Reader::read_block_internal(uint32_t block)
+// reads and decompresses one block, touching nothing shared so it can run on any thread
+bool CSO_Reader::decode_block(uint32_t block, std::ifstream& file, struct libdeflate_decompressor* inflate,
+                              uint8_t* readbuf, uint8_t* frame)
 {
-    // if this block was decoded last time we don't need to do it again
-    if (block == m_curframe)
-        return true;
-    
     uint32_t index = m_indices[block];
     uint64_t ofs = (uint64_t)(index & ~IDX_COMPRESS_BIT) << m_shift;
     uint64_t len = ((uint64_t)(m_indices[block + 1] & ~IDX_COMPRESS_BIT) << m_shift) - ofs;
     
     if (index & IDX_COMPRESS_BIT) // if uncompressed
     {
-        m_file.seekg(ofs, std::ios::beg);
-        m_file.read((char*)m_frame, len);
-        if ((uint64_t)m_file.gcount() != len)
+        file.seekg(ofs, std::ios::beg);
+        file.read((char*)frame, len);
+        if ((uint64_t)file.gcount() != len)
         {
             fprintf(stderr, "read error reading (uncompressed) block %d\n", block);
-            m_curframe = 0xFFFFFFFF;
+            file.clear();
             return false;
         }
     }
     else // compressed
     {
-        m_file.seekg(ofs, std::ios::beg);
-        m_file.read((char*)m_readbuf, len);
-        if ((uint64_t)m_file.gcount() != len)
+        file.seekg(ofs, std::ios::beg);
+        file.read((char*)readbuf, len);
+        if ((uint64_t)file.gcount() != len)
         {
             fprintf(stderr, "read error reading (compressed) block %d\n", block);
+            file.clear();
             return false;
         }
         
         size_t read;
-        auto res = libdeflate_deflate_decompress(m_inflate, m_readbuf, len, m_frame, m_framesize, &read);
+        auto res = libdeflate_deflate_decompress(inflate, readbuf, len, frame, m_framesize, &read);
         if (res != LIBDEFLATE_SUCCESS)
         {
             fprintf(stderr, "libdeflate error on block %d: %d\n", block, res);
-            m_curframe = 0xFFFFFFFF;
             return false;
         }
         
         if (read < m_blocksize)
         {
             fprintf(stderr, "compressed sector %d decoded to less than the blocksize\n", block);
-            m_curframe = 0xFFFFFFFF;
             return false;
         }
     }
     
-    m_curframe = block;
+    return true;
+}
+
+// takes the least recently used frame that isn't being decoded for the block and marks it pending.
+// returns -1 if the block is already cached or on its way. must be called with m_cache_mutex held
+int CSO_Reader::claim_frame(uint32_t block)
+{
+    if (m_cache_map.count(block))
+        return -1;
+    
+    int victim = -1;
+    for (int i = 0; i < CACHE_FRAMES; ++i)
+    {
+        if (m_cache[i].state == FrameState::PENDING)
+            continue;
+        if (victim < 0 || m_cache[i].last_used < m_cache[victim].last_used)
+            victim = i;
+    }
+    if (victim < 0)
+        return -1;
+    
+    CachedFrame& frame = m_cache[victim];
+    if (frame.state == FrameState::READY)
+        m_cache_map.erase(frame.block);
+    frame.block = block;
+    frame.state = FrameState::PENDING;
+    frame.last_used = ++m_cache_clock;
+    m_cache_map[block] = victim;
+    return victim;
+}
+
+// keeps the workers READAHEAD_FRAMES ahead of a sequential reader that has reached the given block.
+// must be called with m_cache_mutex held
+void CSO_Reader::queue_readahead(uint32_t block)
+{
+    if (block >= m_readahead_end)
+        return;
+    
+    m_readahead_next = std::max(m_readahead_next, block);
+    uint32_t limit = std::min(m_readahead_end, block + READAHEAD_FRAMES);
+    if (m_readahead_next >= limit)
+        return;
+    
+    while (m_readahead_next < limit)
+        m_requests.push_back(m_readahead_next++);
+    m_request_added.notify_all();
+}
+
+void CSO_Reader::worker_loop(int id)
+{
+    Decoder& decoder = m_decoders[id];
+    std::unique_lock<std::mutex> lock(m_cache_mutex);
+    while (true)
+    {
+        m_request_added.wait(lock, [this] { return m_workers_quit || !m_requests.empty(); });
+        if (m_workers_quit)
+            return;
+        
+        uint32_t block = m_requests.front();
+        m_requests.pop_front();
+        int slot = claim_frame(block);
+        if (slot < 0)
+            continue;
+        
+        lock.unlock();
+        bool ok = decode_block(block, decoder.file, decoder.inflate, decoder.readbuf, m_cache[slot].data);
+        lock.lock();
+        
+        if (ok)
+            m_cache[slot].state = FrameState::READY;
+        else
+        {
+            // let the emulation thread retry the block itself
+            m_cache_map.erase(block);
+            m_cache[slot].state = FrameState::EMPTY;
+        }
+        m_frame_ready.notify_all();
+    }
+}
+
+void CSO_Reader::stop_workers()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_cache_mutex);
+        m_workers_quit = true;
+        m_requests.clear();
+    }
+    m_request_added.notify_all();
+    
+    for (int i = 0; i < WORKER_COUNT; ++i)
+    {
+        if (m_workers[i].joinable())
+            m_workers[i].join();
+    }
+    m_workers_quit = false;
+}
+
+bool CSO_Reader::read_block_internal(uint32_t block, uint8_t* dst, uint32_t offset, uint32_t len)
+{
+    std::unique_lock<std::mutex> lock(m_cache_mutex);
+    
+    int slot = -1;
+    while (slot < 0)
+    {
+        auto it = m_cache_map.find(block);
+        if (it == m_cache_map.end())
+        {
+            // nobody has it, decode it here. a free frame always exists as each worker holds at most one
+            slot = claim_frame(block);
+            lock.unlock();
+            bool ok = decode_block(block, m_file, m_inflate, m_readbuf, m_cache[slot].data);
+            lock.lock();
+            
+            if (!ok)
+            {
+                m_cache_map.erase(block);
+                m_cache[slot].state = FrameState::EMPTY;
+                m_frame_ready.notify_all();
+                return false;
+            }
+            m_cache[slot].state = FrameState::READY;
+            m_frame_ready.notify_all();
+        }
+        else if (m_cache[it->second].state == FrameState::READY)
+            slot = it->second;
+        else
+        {
+            // a worker is decoding it already
+            m_frame_ready.wait(lock);
+        }
+    }
+    
+    m_cache[slot].last_used = ++m_cache_clock;
+    memcpy(dst, m_cache[slot].data + offset, len);
+    queue_readahead(block + 1);
     return true;
 }
 
@@ -168,22 +315,18 @@ uint64_t CSO_Reader::read(uint8_t* dst, uint64_t size)
     const uint64_t start = m_virtptr;
     const uint64_t end = start + size;
     const auto start_block = (uint32_t)(start / m_blocksize);
-    const auto end_block = (uint32_t)(end / m_blocksize);
+    const auto end_block = (uint32_t)((end - 1) / m_blocksize);
     
     uint64_t total_read = 0;
     for (uint32_t i = start_block; i <= end_block; ++i)
     {
-        if (!read_block_internal(i))
+        uint64_t block_start = (uint64_t)i * m_blocksize;
+        uint32_t local_ofs = (uint32_t)(std::max(start, block_start) - block_start);
+        uint32_t readlen = (uint32_t)(std::min(end, block_start + m_blocksize) - block_start) - local_ofs;
+        
+        if (!read_block_internal(i, dst, local_ofs, readlen))
             return total_read;
         
-        const uint64_t local_ofs = start - (uint64_t)start_block * m_blocksize;
-        uint64_t readlen = m_blocksize;
-        if (i == start_block)
-            readlen -= local_ofs;
-        if (i == end_block)
-            readlen -= m_blocksize - (end - (uint64_t)end_block * m_blocksize);
-
-        memcpy(dst, m_frame + local_ofs, readlen);
         total_read += readlen;
         m_virtptr += readlen;
         dst += readlen;
@@ -192,6 +335,21 @@ uint64_t CSO_Reader::read(uint8_t* dst, uint64_t size)
     return total_read;
 }
 
+void CSO_Reader::prefetch(uint64_t ofs, uint64_t size)
+{
+    if (!isopen() || ofs >= m_size)
+        return;
+    
+    uint64_t end = std::min(ofs + size, m_size);
+    std::lock_guard<std::mutex> lock(m_cache_mutex);
+    
+    // whatever was queued for an earlier read isn't needed anymore
+    m_requests.clear();
+    m_readahead_next = (uint32_t)(ofs / m_blocksize);
+    m_readahead_end = (uint32_t)((end + m_blocksize - 1) / m_blocksize);
+    queue_readahead(m_readahead_next);
+}
+
 
 bool CSO_Reader::open(const char* path)
 {
@@ -294,8 +452,13 @@ bool CSO_Reader::open(const char* path)
     m_shift = header.index_shift;
     m_blocksize = header.block_len;
     m_framesize = framesize;
-    m_frame = new uint8_t[m_framesize];
     m_readbuf = new uint8_t[m_framesize];
+    for (int i = 0; i < CACHE_FRAMES; ++i)
+    {
+        m_cache[i].state = FrameState::EMPTY;
+        m_cache[i].last_used = 0;
+        m_cache[i].data = new uint8_t[m_framesize];
+    }
     
     // setup libdeflate
     m_inflate = libdeflate_alloc_decompressor();
@@ -306,20 +469,56 @@ bool CSO_Reader::open(const char* path)
         return false;
     }
     
+    // the workers get their own file handles and decompressors so they never wait on the emulation thread
+    for (int i = 0; i < WORKER_COUNT; ++i)
+    {
+        Decoder& decoder = m_decoders[i];
+        decoder.file.open(path, std::ios::binary);
+        decoder.readbuf = new uint8_t[m_framesize];
+        decoder.inflate = libdeflate_alloc_decompressor();
+        if (!decoder.file.is_open() || !decoder.inflate)
+        {
+            fprintf(stderr, "failed to set up CSO decoder thread\n");
+            close();
+            return false;
+        }
+    }
+    for (int i = 0; i < WORKER_COUNT; ++i)
+        m_workers[i] = std::thread(&CSO_Reader::worker_loop, this, i);
+    
     return true;
 }
 
 void CSO_Reader::close()
 {
+    stop_workers();
+    for (int i = 0; i < WORKER_COUNT; ++i)
+    {
+        Decoder& decoder = m_decoders[i];
+        libdeflate_free_decompressor(decoder.inflate);
+        decoder.inflate = nullptr;
+        delete[] decoder.readbuf;
+        decoder.readbuf = nullptr;
+        if (decoder.file.is_open())
+            decoder.file.close();
+    }
+    
+    m_cache_map.clear();
+    for (int i = 0; i < CACHE_FRAMES; ++i)
+    {
+        m_cache[i].state = FrameState::EMPTY;
+        delete[] m_cache[i].data;
+        m_cache[i].data = nullptr;
+    }
+    m_readahead_next = 0;
+    m_readahead_end = 0;
+    
     libdeflate_free_decompressor(m_inflate);
     m_inflate = nullptr;
     
     delete[] m_readbuf;
     m_readbuf = nullptr;
 
-    delete[] m_frame;
-    m_frame = nullptr;
-    
     delete[] m_indices;
     m_indices = nullptr;
 
@@ -332,5 +531,4 @@ void CSO_Reader::close()
     m_shift = 0;
     m_blocksize = 0;
     m_framesize = 0;
-    m_curframe = 0xFFFFFFFF;
 }
@@ -1,44 +1,102 @@
 #ifndef CSO_READER_H
 #define CSO_READER_H
 
-#include <fstream>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 class CSO_Reader
 {
 protected:
+    // decoded frames kept around, and how far sequential reads are decoded ahead
+    static const int CACHE_FRAMES = 64;
+    static const int READAHEAD_FRAMES = 32;
+    static const int WORKER_COUNT = 2;
+
+    enum class FrameState
+    {
+        EMPTY,
+        PENDING,
+        READY
+    };
+
+    struct CachedFrame
+    {
+        uint32_t block;
+        FrameState state;
+        uint64_t last_used;
+        uint8_t* data;
+    };
+
+    // everything a thread needs to decode blocks on its own
+    struct Decoder
+    {
+        std::ifstream file;
+        uint8_t* readbuf;
+        struct libdeflate_decompressor* inflate;
+    };
+
     std::ifstream m_file;
     uint64_t m_size;
     uint32_t m_shift;
     uint32_t m_blocksize;
     uint8_t m_version;
     uint64_t m_virtptr;
-    
+
     uint32_t* m_indices;
-    
+
     uint32_t m_framesize;
-    uint32_t m_curframe;
-    uint8_t* m_frame;
     uint8_t* m_readbuf;
-    
+
     struct libdeflate_decompressor* m_inflate;
-    
-    bool read_block_internal(uint32_t block);
-    
+
+    // LRU cache of decoded frames, shared with the workers and guarded by m_cache_mutex
+    CachedFrame m_cache[CACHE_FRAMES];
+    std::unordered_map<uint32_t, int> m_cache_map;
+    uint64_t m_cache_clock;
+    std::mutex m_cache_mutex;
+    std::condition_variable m_frame_ready;
+
+    // read-ahead requests for the workers
+    std::deque<uint32_t> m_requests;
+    std::condition_variable m_request_added;
+    uint32_t m_readahead_next;
+    uint32_t m_readahead_end;
+    bool m_workers_quit;
+
+    std::thread m_workers[WORKER_COUNT];
+    Decoder m_decoders[WORKER_COUNT];
+
+    bool decode_block(uint32_t block, std::ifstream& file, struct libdeflate_decompressor* inflate,
+                      uint8_t* readbuf, uint8_t* frame);
+    int claim_frame(uint32_t block);
+    void queue_readahead(uint32_t block);
+    void worker_loop(int id);
+    void stop_workers();
+
+    bool read_block_internal(uint32_t block, uint8_t* dst, uint32_t offset, uint32_t len);
+
 public:
     CSO_Reader();
     ~CSO_Reader();
-    
+
     uint8_t get_version();
     uint64_t get_size();
     uint32_t get_blocksize();
     uint32_t get_numblocks();
-    
+
     bool isopen();
     void seek(int64_t ofs, std::ios::seekdir whence);
     uint64_t tell();
     uint64_t read(uint8_t* dst, uint64_t size);
-    
+
+    // decode the given range in the background, for reads that are known to be coming
+    void prefetch(uint64_t ofs, uint64_t size);
+
     bool open(const char* path);
     void close();
 };
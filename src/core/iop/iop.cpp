@@ -4,6 +4,7 @@
 #include <cstring>
 #include "iop.hpp"
 #include "iop_interpreter.hpp"
+#include "iop_jit.hpp"
 
 #include "../emulator.hpp"
 #include "../ee/emotiondisasm.hpp"
@@ -11,7 +12,7 @@
 
 IOP::IOP(Emulator* e) : e(e)
 {
-
+    jit_pages = nullptr;
 }
 
 const char* IOP::REG(int id)
@@ -42,6 +43,7 @@ void IOP::reset()
     wait_for_IRQ = false;
     muldiv_delay = 0;
     cycles_to_run = 0;
+    IRQ_line_stale = false;
 }
 
 uint32_t IOP::translate_addr(uint32_t addr)
@@ -57,47 +59,133 @@ uint32_t IOP::translate_addr(uint32_t addr)
     return addr;
 }
 
+//Runs the IOP for the given number of cycles with the same results as running it one cycle at a time.
+//Interrupts are still checked at the end of every cycle, but cycles in which that check can't do anything are skipped.
 void IOP::run(int cycles)
 {
-    if (!wait_for_IRQ)
+    while (cycles > 0)
     {
-        cycles_to_run += cycles;
-        while (cycles_to_run > 0)
+        bool idle = !IRQ_line_stale && !interrupt_ready();
+        if (wait_for_IRQ)
         {
-            cycles_to_run--;
-            if (muldiv_delay > 0)
+            //Only an interrupt can wake up the IOP, so the rest of the slice can be skipped
+            if (idle)
+            {
+                muldiv_delay = std::max(muldiv_delay - cycles, 0);
+                return;
+            }
+            if (muldiv_delay)
                 muldiv_delay--;
-            uint32_t instr = read_instr(PC);
-            if (can_disassemble)
+        }
+        else
+        {
+            //Skip the cycles spent waiting for the last instruction to finish
+            if (idle && cycles_to_run < 0)
             {
-                printf("[IOP] [$%08X] $%08X - %s\n", PC, instr, EmotionDisasm::disasm_instr(instr, PC).c_str());
-                //print_state();
+                int wait_cycles = std::min(-cycles_to_run, cycles);
+                cycles_to_run += wait_cycles;
+                cycles -= wait_cycles;
+                continue;
             }
-            IOP_Interpreter::interpret(*this, instr);
 
-            PC += 4;
+            cycles_to_run++;
+            while (cycles_to_run > 0)
+                interpret_instr();
+        }
+        cycles--;
+
+        if (interrupt_ready())
+            interrupt();
+        update_IRQ_line();
+    }
+}
+
+void IOP::run_jit(int cycles)
+{
+    //Enable code invalidation on writes now that there may be recompiled code in IOP RAM
+    if (!jit_pages)
+        jit_pages = IOP_JIT::get_code_pages();
+
+    if (!wait_for_IRQ)
+    {
+        cycles_to_run += cycles;
+        while (cycles_to_run > 0 && !wait_for_IRQ)
+        {
+            //Blocks always start outside of a delay slot
+            if (will_branch || can_disassemble)
+                interpret_instr();
+            else
+                IOP_JIT::run(this);
+
+            //Interrupts are only checked between blocks
+            update_IRQ_line();
+            if (interrupt_ready())
+                interrupt();
+        }
+
+        //Cycles left over after halting are spent idling
+        if (cycles_to_run > 0)
+            cycles_to_run = 0;
+    }
+    else
+    {
+        muldiv_delay = std::max(muldiv_delay - cycles, 0);
+        update_IRQ_line();
+        if (interrupt_ready())
+            interrupt();
+    }
+}
+
+//I_STAT and I_MASK update the interrupt line immediately, but I_CTRL changes only reach it at the end of the cycle
+void IOP::update_IRQ_line()
+{
+    if (IRQ_line_stale)
+    {
+        IRQ_line_stale = false;
+        interrupt_check(e->iop_IRQ_asserted());
+    }
+}
+
+void IOP::interpret_instr()
+{
+    cycles_to_run--;
+    if (muldiv_delay > 0)
+        muldiv_delay--;
+    uint32_t instr = read_instr(PC);
+    if (can_disassemble)
+    {
+        printf("[IOP] [$%08X] $%08X - %s\n", PC, instr, EmotionDisasm::disasm_instr(instr, PC).c_str());
+        //print_state();
+    }
+    IOP_Interpreter::interpret(*this, instr);
+
+    update_branch();
+}
+
+//Advances the PC past the current instruction, taking a pending branch once its delay slot is done
+void IOP::update_branch()
+{
+    PC += 4;
 
-            if (will_branch)
+    if (will_branch)
+    {
+        if (!branch_delay)
+        {
+            will_branch = false;
+            PC = new_PC;
+            if (PC & 0x3)
             {
-                if (!branch_delay)
-                {
-                    will_branch = false;
-                    PC = new_PC;
-                    if (PC & 0x3)
-                    {
-                        Errors::die("[IOP] Invalid PC address $%08X!\n", PC);
-                    }
-                }
-                else
-                    branch_delay--;
+                Errors::die("[IOP] Invalid PC address $%08X!\n", PC);
             }
         }
+        else
+            branch_delay--;
     }
-    else if (muldiv_delay)
-        muldiv_delay--;
+}
 
-    if (cop0.status.IEc && (cop0.status.Im & cop0.cause.int_pending))
-        interrupt();
+void IOP::invalidate_code_page(uint32_t page)
+{
+    IOP_JIT::invalidate_page(page);
 }
 
 void IOP::print_state()
@@ -19,6 +19,10 @@ class IOP
     private:
         Emulator* e;
         IOP_Cop0 cop0;
+
+        //jit_pages is only set once the JIT has been used, so the interpreter doesn't pay for the check.
+        uint8_t* jit_pages;
+
         uint32_t gpr[32];
         uint32_t PC;
         uint32_t LO, HI;
@@ -32,17 +36,26 @@ class IOP
         bool can_disassemble;
         bool will_branch;
         bool wait_for_IRQ;
+        bool IRQ_line_stale;
 
         int muldiv_delay;
         int cycles_to_run;
 
         uint32_t translate_addr(uint32_t addr);
+
+        void interpret_instr();
+        void update_branch();
+        void invalidate_code_page(uint32_t page);
+
+        bool interrupt_ready();
+        void update_IRQ_line();
     public:
         IOP(Emulator* e);
         static const char* REG(int id);
 
         void reset();
         void run(int cycles);
+        void run_jit(int cycles);
         void halt();
         void unhalt();
         void print_state();
@@ -55,6 +68,7 @@ class IOP
         void handle_exception(uint32_t addr, uint8_t cause);
         void syscall_exception();
         void interrupt_check(bool i_pass);
+        void mark_IRQ_line_stale();
         void interrupt();
         void rfe();
 
@@ -79,8 +93,12 @@ class IOP
         void write16(uint32_t addr, uint16_t value);
         void write32(uint32_t addr, uint32_t value);
 
+        void check_ram_write(uint32_t address);
+
         void load_state(std::ifstream& state);
         void save_state(std::ofstream& state);
+
+        friend class IOP_JIT64;
 };
 
 inline void IOP::halt()
@@ -93,6 +111,23 @@ inline void IOP::unhalt()
     wait_for_IRQ = false;
 }
 
+//Used by every bus master that writes to physical IOP RAM, including the IOP itself
+inline void IOP::check_ram_write(uint32_t address)
+{
+    if (jit_pages && jit_pages[(address & 0x1FFFFF) / 4096])
+        invalidate_code_page((address & 0x1FFFFF) / 4096);
+}
+
+inline bool IOP::interrupt_ready()
+{
+    return cop0.status.IEc && (cop0.status.Im & cop0.cause.int_pending);
+}
+
+inline void IOP::mark_IRQ_line_stale()
+{
+    IRQ_line_stale = true;
+}
+
 inline uint32_t IOP::get_PC()
 {
     return PC;
@@ -65,6 +65,8 @@ void IOP_DMA::process_CDVD()
     uint32_t count = channels[IOP_CDVD].word_count * channels[IOP_CDVD].block_size * 4;
     printf("[IOP DMA] CDVD bytes: $%08X\n", count);
     uint32_t bytes_read = cdvd->read_to_RAM(RAM + channels[IOP_CDVD].addr, count);
+    e->iop_check_ram_write(channels[IOP_CDVD].addr);
+    e->iop_check_ram_write(channels[IOP_CDVD].addr + bytes_read - 1);
     if (count <= bytes_read)
     {
         transfer_end(IOP_CDVD);
@@ -101,6 +103,7 @@ void IOP_DMA::process_SPU()
             {
                 uint32_t value = spu->read_DMA();
                 *(uint32_t*)&RAM[channels[IOP_SPU].addr] = value;
+                e->iop_check_ram_write(channels[IOP_SPU].addr);
             }
             channels[IOP_SPU].size--;
             channels[IOP_SPU].addr += 4;
@@ -145,6 +148,7 @@ void IOP_DMA::process_SPU2()
             {
                 uint32_t value = spu2->read_DMA();
                 *(uint32_t*)&RAM[channels[IOP_SPU2].addr] = value;
+                e->iop_check_ram_write(channels[IOP_SPU2].addr);
             }
             channels[IOP_SPU2].size--;
             channels[IOP_SPU2].addr += 4;
@@ -205,6 +209,7 @@ void IOP_DMA::process_SIF1()
         uint32_t data = sif->read_SIF1();
 
         *(uint32_t*)&RAM[channels[IOP_SIF1].addr] = data;
+        e->iop_check_ram_write(channels[IOP_SIF1].addr);
         channels[IOP_SIF1].addr += 4;
         channels[IOP_SIF1].word_count--;
         if (!channels[IOP_SIF1].word_count && channels[IOP_SIF1].tag_end)
@@ -248,6 +253,7 @@ void IOP_DMA::process_SIO2out()
     while (size)
     {
         RAM[channels[IOP_SIO2out].addr] = sio2->read_serial();
+        e->iop_check_ram_write(channels[IOP_SIO2out].addr);
         channels[IOP_SIO2out].addr++;
         size--;
     }
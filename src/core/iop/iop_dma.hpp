@@ -108,6 +108,7 @@ class IOP_DMA
 
         void reset(uint8_t* RAM);
         void run(int cycles);
+        bool is_active();
 
         uint32_t get_DPCR();
         uint32_t get_DPCR2();
@@ -137,4 +138,9 @@ class IOP_DMA
         void save_state(std::ofstream& state);
 };
 
+inline bool IOP_DMA::is_active()
+{
+    return active_channel != nullptr;
+}
+
 #endif // IOP_DMA_HPP
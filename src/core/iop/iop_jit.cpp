@@ -0,0 +1,30 @@
+#include "iop_jit.hpp"
+#include "iop_jit64.hpp"
+#include "iop.hpp"
+
+namespace IOP_JIT
+{
+
+IOP_JIT64 jit64;
+
+void run(IOP *iop)
+{
+    jit64.run(*iop);
+}
+
+void reset()
+{
+    jit64.reset();
+}
+
+uint8_t* get_code_pages()
+{
+    return jit64.get_code_pages();
+}
+
+void invalidate_page(uint32_t page)
+{
+    jit64.invalidate_page(page);
+}
+
+};
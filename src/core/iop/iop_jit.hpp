@@ -0,0 +1,18 @@
+#ifndef IOP_JIT_HPP
+#define IOP_JIT_HPP
+#include <cstdint>
+
+class IOP;
+
+namespace IOP_JIT
+{
+
+void run(IOP* iop);
+void reset();
+
+uint8_t* get_code_pages();
+void invalidate_page(uint32_t page);
+
+};
+
+#endif // IOP_JIT_HPP
@@ -0,0 +1,620 @@
+#include <algorithm>
+#include <cstring>
+#include "iop_jit64.hpp"
+#include "iop_interpreter.hpp"
+
+#include "../emulator.hpp"
+#include "../errors.hpp"
+
+#ifdef _WIN32
+const static REG_64 abi_regs[] = {RCX, RDX, R8, R9};
+#else
+const static REG_64 abi_regs[] = {RDI, RSI, RDX, RCX, R8, R9};
+#endif
+
+IOP_JIT64::IOP_JIT64() : emitter(&cache)
+{
+    reset();
+}
+
+void IOP_JIT64::reset()
+{
+    cache.flush_all_blocks();
+    memset(code_pages, 0, sizeof(code_pages));
+    for (int i = 0; i < RAM_PAGES; i++)
+        page_blocks[i].clear();
+    dirty_pages.clear();
+    block_dirty = false;
+    abi_int_count = 0;
+    pending_cycles = 0;
+}
+
+uint8_t* IOP_JIT64::get_code_pages()
+{
+    return code_pages;
+}
+
+void IOP_JIT64::invalidate_page(uint32_t page)
+{
+    if (!code_pages[page])
+        return;
+
+    code_pages[page] = 0;
+    dirty_pages.push_back(page);
+    block_dirty = true;
+}
+
+void IOP_JIT64::free_dirty_blocks()
+{
+    for (unsigned int i = 0; i < dirty_pages.size(); i++)
+    {
+        std::vector<uint32_t>& blocks = page_blocks[dirty_pages[i]];
+        for (unsigned int j = 0; j < blocks.size(); j++)
+        {
+            cache.free_block(BlockState(blocks[j], 0, 0, false, 0));
+            cache.free_block(BlockState(blocks[j], 0, 0, true, 0));
+        }
+        blocks.clear();
+    }
+    dirty_pages.clear();
+}
+
+void IOP_JIT64::run(IOP& iop)
+{
+    if (dirty_pages.size())
+        free_dirty_blocks();
+
+    uint32_t pc = iop.PC;
+
+    //Blocks are compiled separately for cached and uncached execution, as their timing differs
+    bool cached = pc < 0xA0000000 && (iop.cache_control & (1 << 11));
+    if (!cache.find_block(BlockState(pc, 0, 0, cached, 0)))
+    {
+        //Writes are only tracked for IOP RAM, so code anywhere else other than the BIOS is interpreted
+        uint32_t addr = pc & 0x1FFFFFFF;
+        if (addr >= 0x00200000 && addr < 0x1FC00000)
+        {
+            iop.interpret_instr();
+            return;
+        }
+        recompile_block(iop, pc, cached);
+    }
+
+    block_dirty = false;
+    ((void(*)())cache.get_current_block_start())();
+}
+
+void IOP_JIT64::recompile_block(IOP& iop, uint32_t start, bool cached)
+{
+    uint32_t pcs[MAX_BLOCK_INSTRS + 1];
+    uint32_t instrs[MAX_BLOCK_INSTRS + 1];
+    int count = 0;
+    bool has_branch = false;
+
+    //Blocks end after a branch's delay slot, after a COP operation, or at the end of a page
+    uint32_t pc = start;
+    while (true)
+    {
+        uint32_t instr = iop.e->iop_read32(pc & 0x1FFFFFFF);
+        pcs[count] = pc;
+        instrs[count] = instr;
+        count++;
+
+        pc += 4;
+
+        if (has_branch)
+            break;
+
+        if (is_branch(instr))
+        {
+            has_branch = true;
+            continue;
+        }
+
+        if (ends_block(instr) || count >= MAX_BLOCK_INSTRS || (pc & ~0xFFF) != (start & ~0xFFF))
+            break;
+    }
+
+    uint32_t end = pc;
+
+    cache.alloc_block(BlockState(start, 0, 0, cached, 0));
+    register_block(start, pcs[count - 1]);
+
+    exits.clear();
+    abi_int_count = 0;
+    pending_cycles = 0;
+
+    emit_prologue();
+
+    //Instruction cache misses are all taken upon entering the block
+    if (cached)
+    {
+        prepare_abi((uint64_t)&iop);
+        prepare_abi(start);
+        prepare_abi(end);
+        call_abi_func((uint64_t)&fetch_block);
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        pending_cycles++;
+        if (!cached)
+            pending_cycles += 4;
+
+        emit_instruction(iop, instrs[i], pcs[i]);
+
+        //The branch has been handled, so the next instruction is its delay slot
+        if (has_branch && i == count - 2)
+        {
+            emitter.load_addr((uint64_t)&iop.branch_delay, REG_64::RAX);
+            emitter.MOV32_IMM_MEM(0, REG_64::RAX);
+        }
+    }
+
+    flush_cycles(iop);
+
+    if (has_branch)
+    {
+        prepare_abi((uint64_t)&iop);
+        prepare_abi(pcs[count - 1]);
+        call_abi_func((uint64_t)&end_branch);
+    }
+    else
+        store_pc(iop, end);
+
+    emit_epilogue();
+    emit_exit_stub(iop);
+
+    cache.set_current_block_rx();
+}
+
+void IOP_JIT64::register_block(uint32_t start, uint32_t end)
+{
+    uint32_t pages[] = {(start & 0x1FFFFFFF) / 4096, (end & 0x1FFFFFFF) / 4096};
+    for (int i = 0; i < 2; i++)
+    {
+        if (i && pages[1] == pages[0])
+            break;
+
+        if (pages[i] < RAM_PAGES)
+        {
+            code_pages[pages[i]] = 1;
+            page_blocks[pages[i]].push_back(start);
+        }
+    }
+}
+
+void IOP_JIT64::emit_prologue()
+{
+    //Keeps the stack aligned on a 16-byte boundary for calls
+    emitter.PUSH(REG_64::RBP);
+    emitter.MOV64_MR(REG_64::RSP, REG_64::RBP);
+#ifdef _WIN32
+    //x64 Windows requires a 32-byte "shadow region" for the callee
+    emitter.SUB64_REG_IMM(32, REG_64::RSP);
+#endif
+}
+
+void IOP_JIT64::emit_epilogue()
+{
+    emitter.MOV64_MR(REG_64::RBP, REG_64::RSP);
+    emitter.POP(REG_64::RBP);
+    emitter.RET();
+}
+
+//Every early exit happens after the IOP state has been written back, so they can all share one stub
+void IOP_JIT64::emit_exit_stub(IOP& iop)
+{
+    if (!exits.size())
+        return;
+
+    for (unsigned int i = 0; i < exits.size(); i++)
+        emitter.set_jump_dest(exits[i]);
+    prepare_abi((uint64_t)&iop);
+    call_abi_func((uint64_t)&exit_block);
+    emit_epilogue();
+}
+
+void IOP_JIT64::prepare_abi(uint64_t value)
+{
+    if (abi_int_count >= sizeof(abi_regs) / sizeof(REG_64))
+        Errors::die("[IOP_JIT64] ABI integer arguments exceeded %d!", sizeof(abi_regs) / sizeof(REG_64));
+
+    emitter.MOV64_OI(value, abi_regs[abi_int_count]);
+    abi_int_count++;
+}
+
+//Returns the next argument register so that it can be filled in by the caller
+REG_64 IOP_JIT64::prepare_abi_reg()
+{
+    if (abi_int_count >= sizeof(abi_regs) / sizeof(REG_64))
+        Errors::die("[IOP_JIT64] ABI integer arguments exceeded %d!", sizeof(abi_regs) / sizeof(REG_64));
+
+    REG_64 arg = abi_regs[abi_int_count];
+    abi_int_count++;
+    return arg;
+}
+
+void IOP_JIT64::call_abi_func(uint64_t addr)
+{
+    emitter.MOV64_OI(addr, REG_64::RAX);
+    emitter.CALL_INDIR(REG_64::RAX);
+    abi_int_count = 0;
+}
+
+void IOP_JIT64::flush_cycles(IOP& iop)
+{
+    if (!pending_cycles)
+        return;
+
+    emitter.load_addr((uint64_t)&iop.cycles_to_run, REG_64::RAX);
+    emitter.MOV32_FROM_MEM(REG_64::RAX, REG_64::RCX);
+    emitter.ADD32_REG_IMM(-pending_cycles, REG_64::RCX);
+    emitter.MOV32_TO_MEM(REG_64::RCX, REG_64::RAX);
+
+    //A multiply or divide in progress counts down along with the instructions
+    emitter.load_addr((uint64_t)&iop.muldiv_delay, REG_64::RAX);
+    emitter.MOV32_FROM_MEM(REG_64::RAX, REG_64::RAX);
+    emitter.TEST32_EAX(0xFFFFFFFF);
+    uint8_t* no_muldiv = emitter.JE_NEAR_DEFERRED();
+    prepare_abi((uint64_t)&iop);
+    prepare_abi(pending_cycles);
+    call_abi_func((uint64_t)&sync_muldiv);
+    emitter.set_jump_dest(no_muldiv);
+
+    pending_cycles = 0;
+}
+
+void IOP_JIT64::store_pc(IOP& iop, uint32_t pc)
+{
+    emitter.load_addr((uint64_t)&iop.PC, REG_64::RAX);
+    emitter.MOV32_IMM_MEM(pc, REG_64::RAX);
+}
+
+//Leave the block if the last call changed the PC, halted the IOP, or invalidated code
+void IOP_JIT64::check_exit()
+{
+    emitter.TEST32_EAX(1);
+    exits.push_back(emitter.JNE_NEAR_DEFERRED());
+}
+
+void IOP_JIT64::load_gpr(IOP& iop, int reg, REG_64 dest)
+{
+    if (!reg)
+    {
+        emitter.XOR32_REG(dest, dest);
+        return;
+    }
+    emitter.load_addr((uint64_t)&iop.gpr[reg], REG_64::RAX);
+    emitter.MOV32_FROM_MEM(REG_64::RAX, dest);
+}
+
+void IOP_JIT64::store_gpr(IOP& iop, REG_64 source, int reg)
+{
+    emitter.load_addr((uint64_t)&iop.gpr[reg], REG_64::RAX);
+    emitter.MOV32_TO_MEM(source, REG_64::RAX);
+}
+
+//Calculates base + offset for loads and stores
+void IOP_JIT64::load_address(IOP& iop, uint32_t instr, REG_64 dest)
+{
+    int base = (instr >> 21) & 0x1F;
+    int16_t offset = (int16_t)(instr & 0xFFFF);
+    load_gpr(iop, base, dest);
+    if (offset)
+        emitter.ADD32_REG_IMM((int32_t)offset, dest);
+}
+
+void IOP_JIT64::emit_instruction(IOP& iop, uint32_t instr, uint32_t pc)
+{
+    int op = instr >> 26;
+    int rs = (instr >> 21) & 0x1F;
+    int rt = (instr >> 16) & 0x1F;
+    uint16_t imm = instr & 0xFFFF;
+
+    switch (op)
+    {
+        case 0x00:
+            if (emit_special(iop, instr))
+                return;
+            break;
+        case 0x08:
+        case 0x09:
+            //ADDI/ADDIU. The IOP doesn't emulate overflow exceptions.
+            if (rt)
+            {
+                load_gpr(iop, rs, REG_64::RCX);
+                if (imm)
+                    emitter.ADD32_REG_IMM((int32_t)(int16_t)imm, REG_64::RCX);
+                store_gpr(iop, REG_64::RCX, rt);
+            }
+            return;
+        case 0x0C:
+            //ANDI
+            if (rt)
+            {
+                load_gpr(iop, rs, REG_64::RCX);
+                emitter.AND32_REG_IMM(imm, REG_64::RCX);
+                store_gpr(iop, REG_64::RCX, rt);
+            }
+            return;
+        case 0x0D:
+            //ORI
+            if (rt)
+            {
+                load_gpr(iop, rs, REG_64::RCX);
+                if (imm)
+                    emitter.OR64_REG_IMM(imm, REG_64::RCX);
+                store_gpr(iop, REG_64::RCX, rt);
+            }
+            return;
+        case 0x0E:
+            //XORI
+            if (rt)
+            {
+                load_gpr(iop, rs, REG_64::RCX);
+                if (imm)
+                    emitter.XOR64_REG_IMM(imm, REG_64::RCX);
+                store_gpr(iop, REG_64::RCX, rt);
+            }
+            return;
+        case 0x0F:
+            //LUI
+            if (rt)
+            {
+                emitter.MOV32_REG_IMM(imm << 16, REG_64::RCX);
+                store_gpr(iop, REG_64::RCX, rt);
+            }
+            return;
+        case 0x20:
+            emit_load(iop, instr, (uint64_t)&load8);
+            return;
+        case 0x21:
+            emit_load(iop, instr, (uint64_t)&load16);
+            return;
+        case 0x23:
+            emit_load(iop, instr, (uint64_t)&load32);
+            return;
+        case 0x24:
+            emit_load(iop, instr, (uint64_t)&load8u);
+            return;
+        case 0x25:
+            emit_load(iop, instr, (uint64_t)&load16u);
+            return;
+        case 0x28:
+            emit_store(iop, instr, pc, (uint64_t)&store8);
+            return;
+        case 0x29:
+            emit_store(iop, instr, pc, (uint64_t)&store16);
+            return;
+        case 0x2B:
+            emit_store(iop, instr, pc, (uint64_t)&store32);
+            return;
+        default:
+            break;
+    }
+    fallback_interpreter(iop, instr, pc);
+}
+
+bool IOP_JIT64::emit_special(IOP& iop, uint32_t instr)
+{
+    int rs = (instr >> 21) & 0x1F;
+    int rt = (instr >> 16) & 0x1F;
+    int rd = (instr >> 11) & 0x1F;
+    int sa = (instr >> 6) & 0x1F;
+
+    switch (instr & 0x3F)
+    {
+        case 0x00:
+        case 0x02:
+        case 0x03:
+            //SLL/SRL/SRA. This also covers NOP.
+            if (rd)
+            {
+                load_gpr(iop, rt, REG_64::RCX);
+                if (sa)
+                {
+                    if ((instr & 0x3F) == 0x00)
+                        emitter.SHL32_REG_IMM(sa, REG_64::RCX);
+                    else if ((instr & 0x3F) == 0x02)
+                        emitter.SHR32_REG_IMM(sa, REG_64::RCX);
+                    else
+                        emitter.SAR32_REG_IMM(sa, REG_64::RCX);
+                }
+                store_gpr(iop, REG_64::RCX, rd);
+            }
+            return true;
+        case 0x20:
+        case 0x21:
+        case 0x22:
+        case 0x23:
+        case 0x24:
+        case 0x25:
+        case 0x26:
+        case 0x27:
+            //ADD/ADDU/SUB/SUBU/AND/OR/XOR/NOR
+            if (rd)
+            {
+                load_gpr(iop, rs, REG_64::RCX);
+                load_gpr(iop, rt, REG_64::RDX);
+                switch (instr & 0x3F)
+                {
+                    case 0x20:
+                    case 0x21:
+                        emitter.ADD32_REG(REG_64::RDX, REG_64::RCX);
+                        break;
+                    case 0x22:
+                    case 0x23:
+                        emitter.SUB32_REG(REG_64::RDX, REG_64::RCX);
+                        break;
+                    case 0x24:
+                        emitter.AND64_REG(REG_64::RDX, REG_64::RCX);
+                        break;
+                    case 0x25:
+                        emitter.OR64_REG(REG_64::RDX, REG_64::RCX);
+                        break;
+                    case 0x26:
+                        emitter.XOR64_REG(REG_64::RDX, REG_64::RCX);
+                        break;
+                    default:
+                        emitter.OR64_REG(REG_64::RDX, REG_64::RCX);
+                        emitter.NOT64(REG_64::RCX);
+                        break;
+                }
+                store_gpr(iop, REG_64::RCX, rd);
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+//IOP loads never have side effects on the IOP itself, so the block doesn't need to sync up before them
+void IOP_JIT64::emit_load(IOP& iop, uint32_t instr, uint64_t func)
+{
+    int rt = (instr >> 16) & 0x1F;
+
+    prepare_abi((uint64_t)&iop);
+    load_address(iop, instr, prepare_abi_reg());
+    prepare_abi(rt);
+    call_abi_func(func);
+}
+
+void IOP_JIT64::emit_store(IOP& iop, uint32_t instr, uint32_t pc, uint64_t func)
+{
+    int rt = (instr >> 16) & 0x1F;
+
+    //Stores may overwrite code or change the cache configuration, so the IOP state needs to be up to date
+    flush_cycles(iop);
+    store_pc(iop, pc);
+
+    prepare_abi((uint64_t)this);
+    prepare_abi((uint64_t)&iop);
+    load_address(iop, instr, prepare_abi_reg());
+    load_gpr(iop, rt, prepare_abi_reg());
+    call_abi_func(func);
+    check_exit();
+}
+
+void IOP_JIT64::fallback_interpreter(IOP& iop, uint32_t instr, uint32_t pc)
+{
+    flush_cycles(iop);
+    store_pc(iop, pc);
+
+    prepare_abi((uint64_t)this);
+    prepare_abi((uint64_t)&iop);
+    prepare_abi(instr);
+    call_abi_func((uint64_t)&interpret);
+    check_exit();
+}
+
+bool IOP_JIT64::is_branch(uint32_t instr)
+{
+    switch (instr >> 26)
+    {
+        case 0x00:
+            //JR/JALR
+            return (instr & 0x3E) == 0x08;
+        case 0x01:
+        case 0x02:
+        case 0x03:
+        case 0x04:
+        case 0x05:
+        case 0x06:
+        case 0x07:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool IOP_JIT64::ends_block(uint32_t instr)
+{
+    //COP0 operations can enable interrupts or isolate the cache
+    return (instr >> 26) >= 0x10 && (instr >> 26) <= 0x13;
+}
+
+void IOP_JIT64::fetch_block(IOP& iop, uint32_t start, uint32_t end)
+{
+    for (uint32_t addr = start & ~0xF; addr < end; addr += 16)
+        iop.read_instr(addr);
+}
+
+void IOP_JIT64::sync_muldiv(IOP& iop, int cycles)
+{
+    iop.muldiv_delay = std::max(iop.muldiv_delay - cycles, 0);
+}
+
+int IOP_JIT64::interpret(IOP_JIT64& jit, IOP& iop, uint32_t instr)
+{
+    uint32_t pc = iop.PC;
+    IOP_Interpreter::interpret(iop, instr);
+    return jit.must_exit(iop, pc);
+}
+
+//True if the interpreter would not simply continue with the next instruction
+bool IOP_JIT64::must_exit(IOP& iop, uint32_t pc)
+{
+    return iop.PC != pc || iop.wait_for_IRQ || block_dirty;
+}
+
+//Finishes the instruction that caused an early exit the same way the interpreter would
+void IOP_JIT64::exit_block(IOP& iop)
+{
+    iop.update_branch();
+}
+
+void IOP_JIT64::end_branch(IOP& iop, uint32_t last_pc)
+{
+    iop.PC = last_pc;
+    iop.update_branch();
+}
+
+void IOP_JIT64::load8(IOP& iop, uint32_t addr, uint64_t reg)
+{
+    iop.set_gpr(reg, (int32_t)(int8_t)iop.read8(addr));
+}
+
+void IOP_JIT64::load8u(IOP& iop, uint32_t addr, uint64_t reg)
+{
+    iop.set_gpr(reg, iop.read8(addr));
+}
+
+void IOP_JIT64::load16(IOP& iop, uint32_t addr, uint64_t reg)
+{
+    iop.set_gpr(reg, (int32_t)(int16_t)iop.read16(addr));
+}
+
+void IOP_JIT64::load16u(IOP& iop, uint32_t addr, uint64_t reg)
+{
+    iop.set_gpr(reg, iop.read16(addr));
+}
+
+void IOP_JIT64::load32(IOP& iop, uint32_t addr, uint64_t reg)
+{
+    iop.set_gpr(reg, iop.read32(addr));
+}
+
+int IOP_JIT64::store8(IOP_JIT64& jit, IOP& iop, uint32_t addr, uint64_t value)
+{
+    uint32_t pc = iop.PC;
+    iop.write8(addr, value);
+    return jit.must_exit(iop, pc);
+}
+
+int IOP_JIT64::store16(IOP_JIT64& jit, IOP& iop, uint32_t addr, uint64_t value)
+{
+    uint32_t pc = iop.PC;
+    iop.write16(addr, value);
+    return jit.must_exit(iop, pc);
+}
+
+int IOP_JIT64::store32(IOP_JIT64& jit, IOP& iop, uint32_t addr, uint64_t value)
+{
+    uint32_t pc = iop.PC;
+    uint32_t cache_control = iop.cache_control;
+    iop.write32(addr, value);
+
+    //Blocks are compiled for one cache configuration
+    return jit.must_exit(iop, pc) || iop.cache_control != cache_control;
+}
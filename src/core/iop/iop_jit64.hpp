@@ -0,0 +1,91 @@
+#ifndef IOP_JIT64_HPP
+#define IOP_JIT64_HPP
+#include <vector>
+#include "../jitcommon/emitter64.hpp"
+#include "iop.hpp"
+
+class IOP_JIT64
+{
+    private:
+        constexpr static int RAM_PAGES = (1024 * 1024 * 2) / 4096;
+        constexpr static int MAX_BLOCK_INSTRS = 128;
+
+        JitCache cache;
+        Emitter64 emitter;
+
+        //Nonzero for every 4 KB page of IOP RAM that has recompiled code in it
+        uint8_t code_pages[RAM_PAGES];
+
+        //Start PCs of the blocks recompiled from each page
+        std::vector<uint32_t> page_blocks[RAM_PAGES];
+
+        //Invalidation happens while a block may be running, so blocks are only freed before the next lookup.
+        std::vector<uint32_t> dirty_pages;
+
+        //Set when a page is invalidated during a block, telling the block to exit after the current instruction
+        bool block_dirty;
+
+        unsigned int abi_int_count;
+
+        //Cycles of the block that haven't yet been subtracted from cycles_to_run
+        int pending_cycles;
+
+        //Jumps to the shared exit taken when a call leaves the block early
+        std::vector<uint8_t*> exits;
+
+        void recompile_block(IOP& iop, uint32_t start, bool cached);
+        void register_block(uint32_t start, uint32_t end);
+        void free_dirty_blocks();
+
+        void emit_prologue();
+        void emit_epilogue();
+        void emit_exit_stub(IOP& iop);
+
+        void prepare_abi(uint64_t value);
+        REG_64 prepare_abi_reg();
+        void call_abi_func(uint64_t addr);
+
+        void flush_cycles(IOP& iop);
+        void store_pc(IOP& iop, uint32_t pc);
+        void check_exit();
+
+        void load_gpr(IOP& iop, int reg, REG_64 dest);
+        void store_gpr(IOP& iop, REG_64 source, int reg);
+        void load_address(IOP& iop, uint32_t instr, REG_64 dest);
+
+        void emit_instruction(IOP& iop, uint32_t instr, uint32_t pc);
+        bool emit_special(IOP& iop, uint32_t instr);
+        void emit_load(IOP& iop, uint32_t instr, uint64_t func);
+        void emit_store(IOP& iop, uint32_t instr, uint32_t pc, uint64_t func);
+        void fallback_interpreter(IOP& iop, uint32_t instr, uint32_t pc);
+
+        static bool is_branch(uint32_t instr);
+        static bool ends_block(uint32_t instr);
+
+        static void fetch_block(IOP& iop, uint32_t start, uint32_t end);
+        static void sync_muldiv(IOP& iop, int cycles);
+        bool must_exit(IOP& iop, uint32_t pc);
+
+        static int interpret(IOP_JIT64& jit, IOP& iop, uint32_t instr);
+        static void exit_block(IOP& iop);
+        static void end_branch(IOP& iop, uint32_t last_pc);
+
+        static void load8(IOP& iop, uint32_t addr, uint64_t reg);
+        static void load8u(IOP& iop, uint32_t addr, uint64_t reg);
+        static void load16(IOP& iop, uint32_t addr, uint64_t reg);
+        static void load16u(IOP& iop, uint32_t addr, uint64_t reg);
+        static void load32(IOP& iop, uint32_t addr, uint64_t reg);
+        static int store8(IOP_JIT64& jit, IOP& iop, uint32_t addr, uint64_t value);
+        static int store16(IOP_JIT64& jit, IOP& iop, uint32_t addr, uint64_t value);
+        static int store32(IOP_JIT64& jit, IOP& iop, uint32_t addr, uint64_t value);
+    public:
+        IOP_JIT64();
+
+        void reset();
+        void run(IOP& iop);
+
+        uint8_t* get_code_pages();
+        void invalidate_page(uint32_t page);
+};
+
+#endif // IOP_JIT64_HPP
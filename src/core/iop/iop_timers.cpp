@@ -124,16 +124,6 @@ void IOPTiming::reschedule()
     next_event = cycle_count + next_event_delta;
 }
 
-void IOPTiming::run(int cycles)
-{
-    cycle_count += cycles;
-    if (cycle_count >= next_event)
-    {
-        update_timers();
-        reschedule();
-    }
-}
-
 void IOPTiming::IRQ_test(int index, bool overflow)
 {
     if (timers[index].control.int_enable)
@@ -63,4 +63,14 @@ class IOPTiming
         void save_state(std::ofstream& state);
 };
 
+inline void IOPTiming::run(int cycles)
+{
+    cycle_count += cycles;
+    if (cycle_count >= next_event)
+    {
+        update_timers();
+        reschedule();
+    }
+}
+
 #endif // IOP_TIMERS_HPP
@@ -0,0 +1,164 @@
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include "iso_reader.hpp"
+
+//How much of a READ command's range is paged in ahead of time
+static const uint64_t MAX_PREFETCH = 8 * 1024 * 1024;
+
+ISO_Reader::ISO_Reader() : data(nullptr), size(0), pos(0)
+{
+#ifdef _WIN32
+    file_handle = INVALID_HANDLE_VALUE;
+    mapping_handle = NULL;
+#endif
+}
+
+ISO_Reader::~ISO_Reader()
+{
+    close();
+}
+
+bool ISO_Reader::open(const char* path)
+{
+    close();
+#ifdef _WIN32
+    file_handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file_handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_handle, &file_size) || !file_size.QuadPart)
+    {
+        close();
+        return false;
+    }
+    size = file_size.QuadPart;
+
+    mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping_handle)
+    {
+        close();
+        return false;
+    }
+    data = (uint8_t*)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+    if (!data)
+    {
+        close();
+        return false;
+    }
+#else
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) || !file_stat.st_size)
+    {
+        ::close(fd);
+        return false;
+    }
+    size = file_stat.st_size;
+
+    //The mapping keeps the file referenced, so the descriptor isn't needed past this point
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+    {
+        size = 0;
+        return false;
+    }
+    data = (uint8_t*)map;
+
+    //Discs are mostly streamed, so the kernel can read ahead aggressively and drop pages behind the reader
+    madvise(data, size, MADV_SEQUENTIAL);
+#endif
+    pos = 0;
+    return true;
+}
+
+void ISO_Reader::close()
+{
+#ifdef _WIN32
+    if (data)
+        UnmapViewOfFile(data);
+    if (mapping_handle)
+        CloseHandle(mapping_handle);
+    if (file_handle != INVALID_HANDLE_VALUE)
+        CloseHandle(file_handle);
+    mapping_handle = NULL;
+    file_handle = INVALID_HANDLE_VALUE;
+#else
+    if (data)
+        munmap(data, size);
+#endif
+    data = nullptr;
+    size = 0;
+    pos = 0;
+}
+
+bool ISO_Reader::isopen()
+{
+    return data != nullptr;
+}
+
+uint64_t ISO_Reader::get_size()
+{
+    return size;
+}
+
+void ISO_Reader::seek(int64_t ofs, std::ios::seekdir whence)
+{
+    if (whence == std::ios::cur)
+        ofs += pos;
+    else if (whence == std::ios::end)
+        ofs += size;
+    if (ofs >= 0)
+        pos = ofs;
+}
+
+uint64_t ISO_Reader::tell()
+{
+    return pos;
+}
+
+uint64_t ISO_Reader::read(uint8_t* dst, uint64_t len)
+{
+    if (pos >= size)
+        return 0;
+    len = std::min(len, size - pos);
+    memcpy(dst, data + pos, len);
+    pos += len;
+    return len;
+}
+
+const uint8_t* ISO_Reader::get_data(uint64_t len)
+{
+    if (pos >= size || size - pos < len)
+        return nullptr;
+    const uint8_t* result = data + pos;
+    pos += len;
+    return result;
+}
+
+void ISO_Reader::prefetch(uint64_t ofs, uint64_t len)
+{
+    if (ofs >= size)
+        return;
+    len = std::min(std::min(len, MAX_PREFETCH), size - ofs);
+#ifndef _WIN32
+    //madvise wants a page-aligned start
+    uint64_t page_size = sysconf(_SC_PAGESIZE);
+    uint64_t start = ofs & ~(page_size - 1);
+    madvise(data + start, len + (ofs - start), MADV_WILLNEED);
+#endif
+}
@@ -0,0 +1,38 @@
+#ifndef ISO_READER_HPP
+#define ISO_READER_HPP
+#include <cstdint>
+#include <fstream>
+
+//Plain disc image, mapped into memory whole.
+//Sectors can be read straight out of the mapping with get_data instead of being copied into a buffer first,
+//and the OS is told which parts of the image are about to be needed so that it can page them in ahead of time.
+class ISO_Reader
+{
+    private:
+        uint8_t* data;
+        uint64_t size;
+        uint64_t pos;
+#ifdef _WIN32
+        void* file_handle;
+        void* mapping_handle;
+#endif
+    public:
+        ISO_Reader();
+        ~ISO_Reader();
+
+        bool open(const char* path);
+        void close();
+        bool isopen();
+        uint64_t get_size();
+
+        void seek(int64_t ofs, std::ios::seekdir whence);
+        uint64_t tell();
+        uint64_t read(uint8_t* dst, uint64_t len);
+
+        //Returns the next len bytes in place and moves past them, or nullptr if they aren't all in the image
+        const uint8_t* get_data(uint64_t len);
+
+        void prefetch(uint64_t ofs, uint64_t len);
+};
+
+#endif // ISO_READER_HPP
@@ -62,6 +62,19 @@ void Emitter64::modrm(uint8_t mode, uint8_t reg, uint8_t rm)
     cache->write<uint8_t>(((mode & 0x3) << 6) | ((reg & 0x7) << 3) | (rm & 0x7));
 }
 
+//Memory operand with a displacement, usable with any base register
+void Emitter64::modrm_offset(uint8_t reg, REG_64 base, int32_t offset)
+{
+    uint8_t mode = (offset >= -128 && offset < 128) ? 1 : 2;
+    modrm(mode, reg, base);
+    if ((base & 0x7) == RSP)
+        cache->write<uint8_t>(0x24);
+    if (mode == 1)
+        cache->write<int8_t>(offset);
+    else
+        cache->write<int32_t>(offset);
+}
+
 int Emitter64::get_rip_offset(uint64_t addr)
 {
     int64_t offset = (uint64_t)cache->get_literal_offset<uint64_t>(addr);
@@ -77,6 +90,7 @@ void Emitter64::load_addr(uint64_t addr, REG_64 dest)
     rexw_r(dest);
     cache->write<uint8_t>(0x8B);
     modrm(0, dest, DISP32);
+    cache->add_literal_ref(cache->get_current_block_pos());
     cache->write<uint32_t>(offset - 7);
 }
 
@@ -97,6 +111,21 @@ void Emitter64::ADD16_REG_IMM(uint16_t imm, REG_64 dest)
     cache->write<uint16_t>(imm);
 }
 
+void Emitter64::ADD32_REG(REG_64 source, REG_64 dest)
+{
+    rex_r_rm(source, dest);
+    cache->write<uint8_t>(0x01);
+    modrm(0b11, source, dest);
+}
+
+void Emitter64::ADD32_REG_IMM(uint32_t imm, REG_64 dest)
+{
+    rex_rm(dest);
+    cache->write<uint8_t>(0x81);
+    modrm(0b11, 0, dest);
+    cache->write<uint32_t>(imm);
+}
+
 void Emitter64::ADD64_REG(REG_64 source, REG_64 dest)
 {
     rexw_r_rm(source, dest);
@@ -141,6 +170,13 @@ void Emitter64::AND32_EAX(uint32_t imm)
     cache->write<uint32_t>(imm);
 }
 
+void Emitter64::AND32_REG(REG_64 source, REG_64 dest)
+{
+    rex_r_rm(source, dest);
+    cache->write<uint8_t>(0x21);
+    modrm(0b11, source, dest);
+}
+
 void Emitter64::AND32_REG_IMM(uint32_t imm, REG_64 dest)
 {
     rex_rm(dest);
@@ -149,6 +185,21 @@ void Emitter64::AND32_REG_IMM(uint32_t imm, REG_64 dest)
     cache->write<uint32_t>(imm);
 }
 
+void Emitter64::AND64_REG(REG_64 source, REG_64 dest)
+{
+    rexw_r_rm(source, dest);
+    cache->write<uint8_t>(0x21);
+    modrm(0b11, source, dest);
+}
+
+void Emitter64::AND64_REG_IMM(uint32_t imm, REG_64 dest)
+{
+    rexw_rm(dest);
+    cache->write<uint8_t>(0x81);
+    modrm(0b11, 4, dest);
+    cache->write<uint32_t>(imm);
+}
+
 void Emitter64::CMP16_IMM(uint16_t imm, REG_64 op)
 {
     cache->write<uint8_t>(0x66);
@@ -172,6 +223,21 @@ void Emitter64::CMP32_EAX(uint32_t imm)
     cache->write<uint32_t>(imm);
 }
 
+void Emitter64::CMP32_IMM(uint32_t imm, REG_64 op)
+{
+    rex_rm(op);
+    cache->write<uint8_t>(0x81);
+    modrm(0b11, 7, op);
+    cache->write<uint32_t>(imm);
+}
+
+void Emitter64::CMP32_REG(REG_64 op2, REG_64 op1)
+{
+    rex_r_rm(op2, op1);
+    cache->write<uint8_t>(0x39);
+    modrm(0b11, op2, op1);
+}
+
 void Emitter64::DEC16(REG_64 dest)
 {
     cache->write<uint8_t>(0x66);
@@ -180,6 +246,14 @@ void Emitter64::DEC16(REG_64 dest)
     modrm(0b11, 1, dest);
 }
 
+void Emitter64::IMUL32_REG(REG_64 source, REG_64 dest)
+{
+    rex_r_rm(dest, source);
+    cache->write<uint8_t>(0x0F);
+    cache->write<uint8_t>(0xAF);
+    modrm(0b11, dest, source);
+}
+
 void Emitter64::NOT16(REG_64 dest)
 {
     cache->write<uint8_t>(0x66);
@@ -188,6 +262,13 @@ void Emitter64::NOT16(REG_64 dest)
     modrm(0b11, 2, dest);
 }
 
+void Emitter64::NOT64(REG_64 dest)
+{
+    rexw_rm(dest);
+    cache->write<uint8_t>(0xF7);
+    modrm(0b11, 2, dest);
+}
+
 void Emitter64::OR16_REG(REG_64 source, REG_64 dest)
 {
     cache->write<uint8_t>(0x66);
@@ -209,6 +290,29 @@ void Emitter64::OR32_EAX(uint32_t imm)
     cache->write<uint32_t>(imm);
 }
 
+void Emitter64::OR32_REG_IMM(uint32_t imm, REG_64 dest)
+{
+    rex_rm(dest);
+    cache->write<uint8_t>(0x81);
+    modrm(0b11, 1, dest);
+    cache->write<uint32_t>(imm);
+}
+
+void Emitter64::OR64_REG(REG_64 source, REG_64 dest)
+{
+    rexw_r_rm(source, dest);
+    cache->write<uint8_t>(0x09);
+    modrm(0b11, source, dest);
+}
+
+void Emitter64::OR64_REG_IMM(uint32_t imm, REG_64 dest)
+{
+    rexw_rm(dest);
+    cache->write<uint8_t>(0x81);
+    modrm(0b11, 1, dest);
+    cache->write<uint32_t>(imm);
+}
+
 void Emitter64::SETE_REG(REG_64 dest)
 {
     rex_rm(dest);
@@ -307,6 +411,22 @@ void Emitter64::SHR16_REG_IMM(uint8_t shift, REG_64 dest)
     cache->write<uint8_t>(shift);
 }
 
+void Emitter64::SHR32_REG_IMM(uint8_t shift, REG_64 dest)
+{
+    rex_rm(dest);
+    cache->write<uint8_t>(0xC1);
+    modrm(0b11, 5, dest);
+    cache->write<uint8_t>(shift);
+}
+
+void Emitter64::SAR32_REG_IMM(uint8_t shift, REG_64 dest)
+{
+    rex_rm(dest);
+    cache->write<uint8_t>(0xC1);
+    modrm(0b11, 7, dest);
+    cache->write<uint8_t>(shift);
+}
+
 void Emitter64::SUB16_REG_IMM(uint16_t imm, REG_64 dest)
 {
     cache->write<uint8_t>(0x66);
@@ -323,6 +443,21 @@ void Emitter64::SUB32_REG(REG_64 source, REG_64 dest)
     modrm(0b11, source, dest);
 }
 
+void Emitter64::SUB32_REG_IMM(uint32_t imm, REG_64 dest)
+{
+    rex_rm(dest);
+    cache->write<uint8_t>(0x81);
+    modrm(0b11, 5, dest);
+    cache->write<uint32_t>(imm);
+}
+
+void Emitter64::SUB64_REG(REG_64 source, REG_64 dest)
+{
+    rexw_r_rm(source, dest);
+    cache->write<uint8_t>(0x29);
+    modrm(0b11, source, dest);
+}
+
 void Emitter64::SUB64_REG_IMM(uint32_t imm, REG_64 dest)
 {
     rexw_rm(dest);
@@ -345,6 +480,14 @@ void Emitter64::TEST32_EAX(uint32_t imm)
     cache->write<uint32_t>(imm);
 }
 
+void Emitter64::TEST32_REG_IMM(uint32_t imm, REG_64 op)
+{
+    rex_rm(op);
+    cache->write<uint8_t>(0xF7);
+    modrm(0b11, 0, op);
+    cache->write<uint32_t>(imm);
+}
+
 void Emitter64::XOR16_REG(REG_64 source, REG_64 dest)
 {
     cache->write<uint8_t>(0x66);
@@ -360,6 +503,21 @@ void Emitter64::XOR32_REG(REG_64 source, REG_64 dest)
     modrm(0b11, source, dest);
 }
 
+void Emitter64::XOR64_REG(REG_64 source, REG_64 dest)
+{
+    rexw_r_rm(source, dest);
+    cache->write<uint8_t>(0x31);
+    modrm(0b11, source, dest);
+}
+
+void Emitter64::XOR64_REG_IMM(uint32_t imm, REG_64 dest)
+{
+    rexw_rm(dest);
+    cache->write<uint8_t>(0x81);
+    modrm(0b11, 6, dest);
+    cache->write<uint32_t>(imm);
+}
+
 void Emitter64::MOV8_TO_MEM(REG_64 source, REG_64 indir_dest)
 {
     rex_r_rm(source, indir_dest);
@@ -445,6 +603,13 @@ void Emitter64::MOV32_FROM_MEM(REG_64 indir_source, REG_64 dest)
     modrm(0, dest, indir_source);
 }
 
+void Emitter64::MOV32_FROM_MEM(REG_64 indir_source, REG_64 dest, int32_t offset)
+{
+    rex_r_rm(dest, indir_source);
+    cache->write<uint8_t>(0x8B);
+    modrm_offset(dest, indir_source, offset);
+}
+
 void Emitter64::MOV32_TO_MEM(REG_64 source, REG_64 indir_dest)
 {
     rex_r_rm(source, indir_dest);
@@ -473,6 +638,13 @@ void Emitter64::MOV64_FROM_MEM(REG_64 indir_source, REG_64 dest)
     modrm(0, dest, indir_source);
 }
 
+void Emitter64::MOV64_FROM_MEM(REG_64 indir_source, REG_64 dest, int32_t offset)
+{
+    rexw_r_rm(dest, indir_source);
+    cache->write<uint8_t>(0x8B);
+    modrm_offset(dest, indir_source, offset);
+}
+
 void Emitter64::MOV64_TO_MEM(REG_64 source, REG_64 indir_dest)
 {
     rexw_r_rm(source, indir_dest);
@@ -488,6 +660,13 @@ void Emitter64::MOVSX64_REG(REG_64 source, REG_64 dest)
     modrm(0b11, dest, source);
 }
 
+void Emitter64::MOVSXD64_REG(REG_64 source, REG_64 dest)
+{
+    rexw_r_rm(dest, source);
+    cache->write<uint8_t>(0x63);
+    modrm(0b11, dest, source);
+}
+
 void Emitter64::MOVZX64_REG(REG_64 source, REG_64 dest)
 {
     rexw_r_rm(dest, source);
@@ -496,6 +675,22 @@ void Emitter64::MOVZX64_REG(REG_64 source, REG_64 dest)
     modrm(0b11, dest, source);
 }
 
+void Emitter64::MOVSX32_FROM_MEM16(REG_64 indir_source, REG_64 dest, int32_t offset)
+{
+    rex_r_rm(dest, indir_source);
+    cache->write<uint8_t>(0x0F);
+    cache->write<uint8_t>(0xBF);
+    modrm_offset(dest, indir_source, offset);
+}
+
+void Emitter64::MOVZX32_FROM_MEM16(REG_64 indir_source, REG_64 dest, int32_t offset)
+{
+    rex_r_rm(dest, indir_source);
+    cache->write<uint8_t>(0x0F);
+    cache->write<uint8_t>(0xB7);
+    modrm_offset(dest, indir_source, offset);
+}
+
 void Emitter64::MOVD_FROM_XMM(REG_64 xmm_source, REG_64 dest)
 {
     cache->write<uint8_t>(0x66);
@@ -575,6 +770,73 @@ uint8_t* Emitter64::JNE_NEAR_DEFERRED()
     return addr;
 }
 
+uint8_t* Emitter64::JB_NEAR_DEFERRED()
+{
+    cache->write<uint8_t>(0x0F);
+    cache->write<uint8_t>(0x82);
+    uint8_t* addr = cache->get_current_block_pos();
+
+    cache->write<uint32_t>(0);
+    return addr;
+}
+
+uint8_t* Emitter64::JBE_NEAR_DEFERRED()
+{
+    cache->write<uint8_t>(0x0F);
+    cache->write<uint8_t>(0x86);
+    uint8_t* addr = cache->get_current_block_pos();
+
+    cache->write<uint32_t>(0);
+    return addr;
+}
+
+uint8_t* Emitter64::JG_NEAR_DEFERRED()
+{
+    cache->write<uint8_t>(0x0F);
+    cache->write<uint8_t>(0x8F);
+    uint8_t* addr = cache->get_current_block_pos();
+
+    cache->write<uint32_t>(0);
+    return addr;
+}
+
+uint8_t* Emitter64::JGE_NEAR_DEFERRED()
+{
+    cache->write<uint8_t>(0x0F);
+    cache->write<uint8_t>(0x8D);
+    uint8_t* addr = cache->get_current_block_pos();
+
+    cache->write<uint32_t>(0);
+    return addr;
+}
+
+uint8_t* Emitter64::JL_NEAR_DEFERRED()
+{
+    cache->write<uint8_t>(0x0F);
+    cache->write<uint8_t>(0x8C);
+    uint8_t* addr = cache->get_current_block_pos();
+
+    cache->write<uint32_t>(0);
+    return addr;
+}
+
+uint8_t* Emitter64::JLE_NEAR_DEFERRED()
+{
+    cache->write<uint8_t>(0x0F);
+    cache->write<uint8_t>(0x8E);
+    uint8_t* addr = cache->get_current_block_pos();
+
+    cache->write<uint32_t>(0);
+    return addr;
+}
+
+void Emitter64::JMP_NEAR(uint8_t* dest)
+{
+    cache->write<uint8_t>(0xE9);
+    int jump_offset = dest - cache->get_current_block_pos() - 4;
+    cache->write<uint32_t>(jump_offset);
+}
+
 void Emitter64::set_jump_dest(uint8_t *jump)
 {
     uint8_t* jump_dest_addr = cache->get_current_block_pos();
@@ -35,6 +35,7 @@ class Emitter64
         void rexw_rm(REG_64 rm);
         void rexw_r_rm(REG_64 reg, REG_64 rm);
         void modrm(uint8_t mode, uint8_t reg, uint8_t rm);
+        void modrm_offset(uint8_t reg, REG_64 base, int32_t offset);
 
         int get_rip_offset(uint64_t addr);
     public:
@@ -44,6 +45,8 @@ class Emitter64
 
         void ADD16_REG(REG_64 source, REG_64 dest);
         void ADD16_REG_IMM(uint16_t imm, REG_64 dest);
+        void ADD32_REG(REG_64 source, REG_64 dest);
+        void ADD32_REG_IMM(uint32_t imm, REG_64 dest);
         void ADD64_REG(REG_64 source, REG_64 dest);
         void ADD64_REG_IMM(uint32_t imm, REG_64 dest);
 
@@ -52,19 +55,30 @@ class Emitter64
         void AND16_AX(uint16_t imm);
         void AND16_REG(REG_64 source, REG_64 dest);
         void AND32_EAX(uint32_t imm);
+        void AND32_REG(REG_64 source, REG_64 dest);
         void AND32_REG_IMM(uint32_t imm, REG_64 dest);
+        void AND64_REG(REG_64 source, REG_64 dest);
+        void AND64_REG_IMM(uint32_t imm, REG_64 dest);
 
         void CMP16_IMM(uint16_t imm, REG_64 op);
         void CMP16_REG(REG_64 op2, REG_64 op1);
         void CMP32_EAX(uint32_t imm);
+        void CMP32_IMM(uint32_t imm, REG_64 op);
+        void CMP32_REG(REG_64 op2, REG_64 op1);
 
         void DEC16(REG_64 dest);
 
+        void IMUL32_REG(REG_64 source, REG_64 dest);
+
         void NOT16(REG_64 dest);
+        void NOT64(REG_64 dest);
 
         void OR16_REG(REG_64 source, REG_64 dest);
         void OR32_REG(REG_64 source, REG_64 dest);
         void OR32_EAX(uint32_t imm);
+        void OR32_REG_IMM(uint32_t imm, REG_64 dest);
+        void OR64_REG(REG_64 source, REG_64 dest);
+        void OR64_REG_IMM(uint32_t imm, REG_64 dest);
 
         void SETE_REG(REG_64 dest);
         void SETE_MEM(REG_64 indir_dest);
@@ -79,16 +93,23 @@ class Emitter64
         void SHL16_REG_IMM(uint8_t shift, REG_64 dest);
         void SHL32_REG_IMM(uint8_t shift, REG_64 dest);
         void SHR16_REG_IMM(uint8_t shift, REG_64 dest);
+        void SHR32_REG_IMM(uint8_t shift, REG_64 dest);
+        void SAR32_REG_IMM(uint8_t shift, REG_64 dest);
 
         void SUB16_REG_IMM(uint16_t imm, REG_64 dest);
         void SUB32_REG(REG_64 source, REG_64 dest);
+        void SUB32_REG_IMM(uint32_t imm, REG_64 dest);
+        void SUB64_REG(REG_64 source, REG_64 dest);
         void SUB64_REG_IMM(uint32_t imm, REG_64 dest);
 
         void TEST16_REG(REG_64 op2, REG_64 op1);
         void TEST32_EAX(uint32_t imm);
+        void TEST32_REG_IMM(uint32_t imm, REG_64 op);
 
         void XOR16_REG(REG_64 source, REG_64 dest);
         void XOR32_REG(REG_64 source, REG_64 dest);
+        void XOR64_REG(REG_64 source, REG_64 dest);
+        void XOR64_REG_IMM(uint32_t imm, REG_64 dest);
 
         void MOV8_TO_MEM(REG_64 source, REG_64 indir_dest);
         void MOV8_IMM_MEM(uint8_t imm, REG_64 indir_dest);
@@ -101,14 +122,19 @@ class Emitter64
         void MOV32_REG_IMM(uint32_t imm, REG_64 dest);
         void MOV32_IMM_MEM(uint32_t imm, REG_64 indir_dest);
         void MOV32_FROM_MEM(REG_64 indir_source, REG_64 dest);
+        void MOV32_FROM_MEM(REG_64 indir_source, REG_64 dest, int32_t offset);
         void MOV32_TO_MEM(REG_64 source, REG_64 indir_dest);
         void MOV64_MR(REG_64 source, REG_64 dest);
         void MOV64_OI(uint64_t imm, REG_64 dest);
         void MOV64_FROM_MEM(REG_64 indir_source, REG_64 dest);
+        void MOV64_FROM_MEM(REG_64 indir_source, REG_64 dest, int32_t offset);
         void MOV64_TO_MEM(REG_64 source, REG_64 indir_dest);
 
         void MOVSX64_REG(REG_64 source, REG_64 dest);
+        void MOVSXD64_REG(REG_64 source, REG_64 dest);
         void MOVZX64_REG(REG_64 source, REG_64 dest);
+        void MOVSX32_FROM_MEM16(REG_64 indir_source, REG_64 dest, int32_t offset);
+        void MOVZX32_FROM_MEM16(REG_64 indir_source, REG_64 dest, int32_t offset);
 
         void MOVD_FROM_XMM(REG_64 xmm_source, REG_64 dest);
         void MOVD_TO_XMM(REG_64 source, REG_64 xmm_dest);
@@ -120,6 +146,13 @@ class Emitter64
         uint8_t* JMP_NEAR_DEFERRED();
         uint8_t* JE_NEAR_DEFERRED();
         uint8_t* JNE_NEAR_DEFERRED();
+        uint8_t* JB_NEAR_DEFERRED();
+        uint8_t* JBE_NEAR_DEFERRED();
+        uint8_t* JG_NEAR_DEFERRED();
+        uint8_t* JGE_NEAR_DEFERRED();
+        uint8_t* JL_NEAR_DEFERRED();
+        uint8_t* JLE_NEAR_DEFERRED();
+        void JMP_NEAR(uint8_t* dest);
 
         void set_jump_dest(uint8_t* jump);
 
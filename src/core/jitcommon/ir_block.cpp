@@ -1,3 +1,4 @@
+#include <type_traits>
 #include "ir_block.hpp"
 
 namespace IR
@@ -6,6 +7,7 @@ namespace IR
 Block::Block()
 {
     cycle_count = 0;
+    instructions.reserve(256);
 }
 
 void Block::add_instr(Instruction &instr)
@@ -23,11 +25,9 @@ int Block::get_cycle_count()
     return cycle_count;
 }
 
-Instruction Block::get_next_instr()
+std::vector<Instruction>& Block::get_instrs()
 {
-    Instruction instr = instructions.front();
-    instructions.pop_front();
-    return instr;
+    return instructions;
 }
 
 void Block::set_cycle_count(int cycles)
@@ -35,4 +35,30 @@ void Block::set_cycle_count(int cycles)
     cycle_count = cycles;
 }
 
+void Block::save(std::ofstream &file)
+{
+    static_assert(std::is_trivially_copyable<Instruction>::value, "IR instructions can't be saved as-is");
+
+    uint32_t count = instructions.size();
+    file.write((char*)&cycle_count, sizeof(cycle_count));
+    file.write((char*)&count, sizeof(count));
+    file.write((char*)instructions.data(), count * sizeof(Instruction));
+}
+
+bool Block::load(std::ifstream &file)
+{
+    uint32_t count = 0;
+    file.read((char*)&cycle_count, sizeof(cycle_count));
+    file.read((char*)&count, sizeof(count));
+
+    instructions.clear();
+    for (uint32_t i = 0; i < count && file.good(); i++)
+    {
+        Instruction instr;
+        file.read((char*)&instr, sizeof(Instruction));
+        instructions.push_back(instr);
+    }
+    return file.good();
+}
+
 };
@@ -1,6 +1,7 @@
 #ifndef IR_BLOCK_HPP
 #define IR_BLOCK_HPP
-#include <list>
+#include <fstream>
+#include <vector>
 #include "ir_instr.hpp"
 
 namespace IR
@@ -9,7 +10,8 @@ namespace IR
 class Block
 {
     private:
-        std::list<Instruction> instructions;
+        //Kept flat so passes can walk and rewrite the block in place before it's emitted
+        std::vector<Instruction> instructions;
         int cycle_count;
     public:
         Block();
@@ -18,9 +20,13 @@ class Block
 
         unsigned int get_instruction_count();
         int get_cycle_count();
-        Instruction get_next_instr();
+        std::vector<Instruction>& get_instrs();
 
         void set_cycle_count(int cycles);
+
+        //Instructions are stored as they are in memory, so files are only valid for the build that wrote them
+        void save(std::ofstream& file);
+        bool load(std::ifstream& file);
 };
 
 };
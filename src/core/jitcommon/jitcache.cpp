@@ -4,43 +4,62 @@
 #include <sys/mman.h>
 #endif
 
+#include <cstring>
 #include "../errors.hpp"
 #include "jitcache.hpp"
 
-JitCache::JitCache()
+JitCache::JitCache(size_t arena_size) : arena_size(arena_size)
 {
+    //The whole arena is reserved up front so that blocks can jump to each other with rel32 offsets.
+    //Pages aren't backed by memory until they're first written to.
+#ifdef _WIN32
+    arena = (uint8_t*)VirtualAlloc(NULL, arena_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!arena)
+        Errors::die("[JIT] Unable to allocate code arena");
+#else
+    arena = (uint8_t*)mmap(NULL, arena_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (arena == MAP_FAILED)
+        Errors::die("[JIT] Unable to allocate code arena");
+#endif
+    arena_pos = arena;
+
     //We reserve blocks so that they don't get reallocated.
     blocks.reserve(1024 * 4);
     current_block = nullptr;
 }
 
-//Allocate a block with read and write, but not executable, privileges.
-void JitCache::alloc_block(BlockState state)
+JitCache::~JitCache()
 {
-    JitBlock new_block;
-
-    new_block.mem = nullptr;
-    new_block.block_start = nullptr;
-    new_block.state = state;
 #ifdef _WIN32
-    //Errors::die("[JIT] alloc_block not implemented for WIN32");
-    new_block.block_start = (uint8_t *)VirtualAlloc(NULL, BLOCK_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    VirtualFree(arena, 0, MEM_RELEASE);
 #else
-    new_block.block_start = (uint8_t*)mmap(NULL, BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    munmap(arena, arena_size);
 #endif
+}
+
+//Allocate a block with read and write, but not executable, privileges.
+//The block gets the whole of BLOCK_SIZE to be written in and is shrunk down by set_current_block_rx.
+void JitCache::alloc_block(BlockState state)
+{
+    free_block(state);
 
-    if (!new_block.block_start)
-        Errors::die("[JIT] Unable to allocate block");
+    if (arena_pos + BLOCK_SIZE > arena + arena_size)
+        arena_pos = arena;
+    evict_blocks(arena_pos, arena_pos + BLOCK_SIZE);
+    set_protection(arena_pos, BLOCK_SIZE, false);
 
+    JitBlock new_block;
+
+    new_block.state = state;
+    new_block.block_start = arena_pos;
     new_block.mem = new_block.block_start;
 
     new_block.pool_start = &new_block.block_start[START_OF_POOL];
     new_block.pool_size = 0;
-
-    if (blocks.size() > 0x2000)
-        flush_all_blocks();
+    new_block.size = 0;
 
     blocks.insert({ state, new_block });
+    block_addrs[new_block.block_start] = state;
     current_block = &blocks[state];
 }
 
@@ -50,37 +69,132 @@ void JitCache::free_block(BlockState state)
 
     if (search == blocks.end()) 
         return;
-    if (&search->second == current_block)
+    JitBlock& block = search->second;
+    if (&block == current_block)
         current_block = nullptr;
 
-#ifdef _WIN32
-    VirtualFree(search->second.block_start, 0, MEM_RELEASE);
-#else
-    munmap(search->second.block_start, BLOCK_SIZE);
-#endif
+    //Forget the links out of the block, then point the ones into it back at their fallbacks
+    for (BlockLink& link : block.links)
+    {
+        auto incoming = incoming_links.find(link.target);
+        if (incoming == incoming_links.end())
+            continue;
+
+        std::vector<BlockLink>& sources = incoming->second;
+        for (auto it = sources.begin(); it != sources.end(); ++it)
+        {
+            if (it->jump == link.jump)
+            {
+                sources.erase(it);
+                break;
+            }
+        }
+        if (sources.empty())
+            incoming_links.erase(incoming);
+    }
+
+    auto incoming = incoming_links.find(state);
+    if (incoming != incoming_links.end() && block.size)
+    {
+        for (BlockLink& link : incoming->second)
+            patch_jump(link.jump, link.fallback);
+    }
+
+    block_addrs.erase(block.block_start);
     blocks.erase(search);
 }
 
 void JitCache::flush_all_blocks()
 {
-    //Deallocate all virtual memory claimed by blocks
-    for (auto it = blocks.begin(); it != blocks.end(); ++it)
-    {
-#ifdef _WIN32
-        //Errors::die("[JIT] flush_all_blocks not implemented for WIN32");
-        VirtualFree(it->second.block_start, 0, MEM_RELEASE);
-#else
-        munmap(it->second.block_start, BLOCK_SIZE);
-#endif
-    }
-
-    //Clear out the blocks vector and replace it with an empty one.
+    //Nothing is unmapped, the arena is simply written over from the start again.
     //We reserve blocks to prevent them from getting reallocated
     blocks = std::unordered_map<BlockState, JitBlock, BlockStateHash>();
     blocks.reserve(1024 * 4);
+    block_addrs.clear();
+    incoming_links.clear();
+    arena_pos = arena;
     current_block = nullptr;
 }
 
+//Evict every block starting in [start, end). Blocks are laid out in the arena in the order they were
+//allocated, so this throws out the oldest blocks first.
+void JitCache::evict_blocks(uint8_t* start, uint8_t* end)
+{
+    std::vector<BlockState> evicted;
+    for (auto it = block_addrs.lower_bound(start); it != block_addrs.end() && it->first < end; ++it)
+        evicted.push_back(it->second);
+
+    for (BlockState& state : evicted)
+        free_block(state);
+}
+
+void JitCache::set_protection(uint8_t* start, size_t size, bool executable)
+{
+    uintptr_t first_page = (uintptr_t)start & ~(uintptr_t)(CODE_PAGE_SIZE - 1);
+    uintptr_t last_page = ((uintptr_t)start + size + CODE_PAGE_SIZE - 1) & ~(uintptr_t)(CODE_PAGE_SIZE - 1);
+#ifdef _WIN32
+    DWORD old_protect;
+    bool pass = VirtualProtect((void*)first_page, last_page - first_page,
+                               executable ? PAGE_EXECUTE_READ : PAGE_READWRITE, &old_protect);
+    if (!pass)
+        Errors::die("[JIT] Unable to change block protection");
+#else
+    int error = mprotect((void*)first_page, last_page - first_page,
+                         executable ? (PROT_READ | PROT_EXEC) : (PROT_READ | PROT_WRITE));
+    if (error == -1)
+        Errors::die("[JIT] Unable to change block protection");
+#endif
+}
+
+//Rewrite the rel32 of a jump in a finished block
+void JitCache::patch_jump(uint8_t* jump, uint8_t* dest)
+{
+    set_protection(jump, sizeof(int32_t), false);
+    *(int32_t*)jump = (int32_t)(dest - (jump + sizeof(int32_t)));
+    set_protection(jump, sizeof(int32_t), true);
+}
+
+void JitCache::add_literal_ref(uint8_t* ref)
+{
+    current_block->literal_refs.push_back(ref);
+}
+
+//Have a jump in the current block go straight to the block for target whenever it exists.
+//The jump is pointed at fallback until then, as well as after the target is freed.
+void JitCache::add_link(BlockState target, uint8_t* jump, uint8_t* fallback)
+{
+    BlockLink link = { target, jump, fallback };
+    *(int32_t*)jump = (int32_t)(fallback - (jump + sizeof(int32_t)));
+    current_block->links.push_back(link);
+    incoming_links[target].push_back(link);
+}
+
+//Move the literal pool down to the end of the code, so the block only takes up the pages it needs,
+//and resolve links in both directions.
+void JitCache::finish_block()
+{
+    JitBlock& block = *current_block;
+
+    uint8_t* new_pool = (uint8_t*)(((uintptr_t)block.mem + 15) & ~(uintptr_t)15);
+    int32_t delta = (int32_t)(block.pool_start - new_pool);
+    memmove(new_pool, block.pool_start, block.pool_size);
+    for (uint8_t* ref : block.literal_refs)
+        *(int32_t*)ref -= delta;
+    block.pool_start = new_pool;
+    block.literal_refs.clear();
+
+    size_t used = (new_pool + block.pool_size) - block.block_start;
+    block.size = (used + CODE_PAGE_SIZE - 1) & ~(size_t)(CODE_PAGE_SIZE - 1);
+    arena_pos = block.block_start + block.size;
+
+    for (BlockLink& link : block.links)
+    {
+        auto target = blocks.find(link.target);
+        if (target != blocks.end() && target->second.size)
+            *(int32_t*)link.jump = (int32_t)(target->second.block_start - (link.jump + sizeof(int32_t)));
+    }
+}
+
 JitBlock *JitCache::find_block(BlockState state)
 {
     auto search = blocks.find(state);
@@ -114,17 +228,20 @@ void JitCache::set_current_block_pos(uint8_t *pos)
 //This is to prevent the security risks that RWX memory has.
 void JitCache::set_current_block_rx()
 {
-#ifdef _WIN32
-    //Errors::die("[JIT] set_current_block_rx not implemented for WIN32");
-    DWORD old_protect;
-    bool pass = VirtualProtect(current_block->block_start, BLOCK_SIZE, PAGE_EXECUTE_READ, &old_protect);
-    if(!pass)
-        Errors::die("[JIT] set_current_block_rx failed");
-#else
-    int error = mprotect(current_block->block_start, BLOCK_SIZE, PROT_READ | PROT_EXEC);
-    if (error == -1)
-        Errors::die("[JIT] set_current_block_rx failed");
-#endif
+    finish_block();
+    set_protection(current_block->block_start, current_block->size, true);
+
+    //Links from blocks compiled before this one, links from this block to itself were resolved above
+    auto incoming = incoming_links.find(current_block->state);
+    if (incoming != incoming_links.end())
+    {
+        uint8_t* start = current_block->block_start;
+        for (BlockLink& link : incoming->second)
+        {
+            if (link.jump < start || link.jump >= start + current_block->size)
+                patch_jump(link.jump, start);
+        }
+    }
 }
 
 void JitCache::print_current_block()
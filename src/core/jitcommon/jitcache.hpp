@@ -1,6 +1,8 @@
 #ifndef JITCACHE_HPP
 #define JITCACHE_HPP
+#include <map>
 #include <unordered_map>
+#include <vector>
 #include "../errors.hpp"
 
 struct BlockState
@@ -46,6 +48,14 @@ struct BlockStateHash
     }
 };
 
+//A direct jump from the end of one block to the start of another
+struct BlockLink
+{
+    BlockState target;
+    uint8_t* jump; //rel32 of the jump instruction
+    uint8_t* fallback; //where the jump goes while the target doesn't exist
+};
+
 struct JitBlock
 {
     //Variables needed for code execution
@@ -56,19 +66,47 @@ struct JitBlock
     //Related to the literal pool
     uint8_t* pool_start;
     int pool_size;
+    std::vector<uint8_t*> literal_refs;
+
+    //Bytes of the arena taken up by the finished block
+    size_t size;
+
+    std::vector<BlockLink> links;
 };
 
+//Blocks are carved out of one large arena, each one starting on a page so that finished blocks can be made
+//executable without making the block being written executable too. The arena is used as a ring: once it's
+//full, allocation wraps around to the start and the oldest blocks are evicted to make room.
 class JitCache
 {
     private:
         constexpr static int BLOCK_SIZE = 1024 * 64;
         constexpr static int POOL_SIZE = 1024 * 8;
         constexpr static int START_OF_POOL = BLOCK_SIZE - POOL_SIZE;
+        constexpr static int CODE_PAGE_SIZE = 4096;
+        constexpr static size_t DEFAULT_ARENA_SIZE = 1024 * 1024 * 32;
+
         std::unordered_map<BlockState, JitBlock, BlockStateHash> blocks;
 
+        //Blocks by start address, for evicting them in the order they were allocated
+        std::map<uint8_t*, BlockState> block_addrs;
+
+        //Links waiting on each block, whether or not the block currently exists
+        std::unordered_map<BlockState, std::vector<BlockLink>, BlockStateHash> incoming_links;
+
+        uint8_t* arena;
+        size_t arena_size;
+        uint8_t* arena_pos;
+
         JitBlock* current_block;
+
+        void evict_blocks(uint8_t* start, uint8_t* end);
+        void set_protection(uint8_t* start, size_t size, bool executable);
+        void patch_jump(uint8_t* jump, uint8_t* dest);
+        void finish_block();
     public:
-        JitCache();
+        JitCache(size_t arena_size = DEFAULT_ARENA_SIZE);
+        ~JitCache();
 
         void alloc_block(BlockState state);
         void free_block(BlockState state);
@@ -80,6 +118,9 @@ class JitCache
         uint8_t* get_current_block_pos();
         void set_current_block_pos(uint8_t* pos);
 
+        void add_literal_ref(uint8_t* ref);
+        void add_link(BlockState target, uint8_t* jump, uint8_t* fallback);
+
         void set_current_block_rx();
         void print_current_block();
         void print_literal_pool();
@@ -93,6 +134,8 @@ inline uint8_t* JitCache::get_literal_offset(T literal)
 {
     //Search for the literal in the pool. If it is not found, add it to the end of the pool.
     //Return the 16-byte aligned offset of the literal in the block.
+    //The pool is kept at the end of the block while it's written and moved down to the code once it's finished,
+    //so references to it have to be passed to add_literal_ref.
     uint8_t* pool = current_block->block_start;
     int offset = START_OF_POOL;
     while (offset < START_OF_POOL + current_block->pool_size)
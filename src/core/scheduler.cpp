@@ -5,7 +5,7 @@
 
 Scheduler::Scheduler()
 {
-
+    events.reserve(RESERVED_EVENTS);
 }
 
 void Scheduler::reset()
@@ -21,6 +21,24 @@ void Scheduler::reset()
     closest_event_time = 0x7FFFFFFFULL << 32ULL;
 
     events.clear();
+    next_order = 0;
+}
+
+//Comparison for std::push_heap and friends, which build a max-heap.
+//Reversing it puts the earliest event at the front.
+bool Scheduler::later(const SchedulerEvent& a, const SchedulerEvent& b)
+{
+    if (a.time_to_run != b.time_to_run)
+        return a.time_to_run > b.time_to_run;
+    return a.order > b.order;
+}
+
+void Scheduler::update_closest_event()
+{
+    if (events.size())
+        closest_event_time = events.front().time_to_run;
+    else
+        closest_event_time = 0x7FFFFFFFULL << 32ULL;
 }
 
 unsigned int Scheduler::calculate_run_cycles()
@@ -62,9 +80,12 @@ unsigned int Scheduler::get_iop_run_cycles()
 
 void Scheduler::add_event(SchedulerEvent& event)
 {
-    closest_event_time = std::min(event.time_to_run, closest_event_time);
+    event.order = next_order;
+    next_order++;
 
     events.push_back(event);
+    std::push_heap(events.begin(), events.end(), &later);
+    update_closest_event();
 }
 
 void Scheduler::update_cycle_counts()
@@ -92,20 +113,15 @@ void Scheduler::process_events(Emulator* e)
 {
     if (ee_cycles.count >= closest_event_time)
     {
-        int64_t new_time = 0x7FFFFFFFULL << 32ULL;
-        for (auto it = events.begin(); it != events.end(); )
+        //Run every event due at the closest time, including ones added by the events themselves
+        int64_t time = closest_event_time;
+        while (events.size() && events.front().time_to_run <= time)
         {
-            if (it->time_to_run <= closest_event_time)
-            {
-                (e->*it->func)();
-                it = events.erase(it);
-            }
-            else
-            {
-                new_time = std::min(it->time_to_run, new_time);
-                it++;
-            }
+            SchedulerEvent event = events.front();
+            std::pop_heap(events.begin(), events.end(), &later);
+            events.pop_back();
+            (e->*event.func)();
         }
-        closest_event_time = new_time;
+        update_closest_event();
     }
 }
@@ -1,7 +1,7 @@
 #ifndef SCHEDULER_HPP
 #define SCHEDULER_HPP
 #include <cstdint>
-#include <list>
+#include <vector>
 
 class Emulator;
 
@@ -28,6 +28,9 @@ struct SchedulerEvent
     EVENT_ID id;
     int64_t time_to_run;
     event_func func;
+
+    //Events due on the same cycle run in the order they were added
+    uint64_t order;
 };
 
 class Scheduler
@@ -39,9 +42,15 @@ class Scheduler
 
         unsigned int run_cycles;
 
-        std::list<SchedulerEvent> events;
+        //Min-heap ordered by time_to_run. Space is reserved up front so that adding events doesn't allocate.
+        constexpr static int RESERVED_EVENTS = 64;
+        std::vector<SchedulerEvent> events;
+        uint64_t next_order;
 
         int64_t closest_event_time;
+
+        static bool later(const SchedulerEvent& a, const SchedulerEvent& b);
+        void update_closest_event();
     public:
         Scheduler();
 
@@ -1,10 +1,11 @@
+#include <algorithm>
 #include <fstream>
 #include <cstring>
 #include "emulator.hpp"
 
 #define VER_MAJOR 0
 #define VER_MINOR 0
-#define VER_REV 27
+#define VER_REV 29
 
 using namespace std;
 
@@ -386,6 +387,10 @@ void VectorUnit::load_state(ifstream &state)
         state.read((char*)&data_mem, 1024 * 16);
     }
 
+    //The program may differ from the one that was last hashed
+    vumem_is_dirty = true;
+    dirty_instr_pages = ~0ULL;
+
     state.read((char*)&running, sizeof(running));
     state.read((char*)&PC, sizeof(PC));
     state.read((char*)&new_PC, sizeof(new_PC));
@@ -601,7 +606,6 @@ void GraphicsInterface::load_state(ifstream &state)
     state.read((char*)&active_path, sizeof(active_path));
     state.read((char*)&path_queue, sizeof(path_queue));
     state.read((char*)&path3_vif_masked, sizeof(path3_vif_masked));
-    state.read((char*)&internal_Q, sizeof(internal_Q));
     state.read((char*)&path3_dma_waiting, sizeof(path3_dma_waiting));
 }
 
@@ -623,7 +627,6 @@ void GraphicsInterface::save_state(ofstream &state)
     state.write((char*)&active_path, sizeof(active_path));
     state.write((char*)&path_queue, sizeof(path_queue));
     state.write((char*)&path3_vif_masked, sizeof(path3_vif_masked));
-    state.write((char*)&internal_Q, sizeof(internal_Q));
     state.write((char*)&path3_dma_waiting, sizeof(path3_dma_waiting));
 }
 
@@ -725,6 +728,8 @@ void VectorInterface::load_state(ifstream &state)
 
     state.read((char*)&mark_detected, sizeof(mark_detected));
     state.read((char*)&VIF_ERR, sizeof(VIF_ERR));
+
+    setup_UNPACK();
 }
 
 void VectorInterface::save_state(ofstream &state)
@@ -786,6 +791,7 @@ void CDVD_Drive::load_state(ifstream &state)
     state.read((char*)&sectors_left, sizeof(sectors_left));
     state.read((char*)&block_size, sizeof(block_size));
     state.read((char*)&read_buffer, sizeof(read_buffer));
+    sector_data = nullptr;
     state.read((char*)&ISTAT, sizeof(ISTAT));
     state.read((char*)&drive_status, sizeof(drive_status));
     state.read((char*)&is_spinning, sizeof(is_spinning));
@@ -814,6 +820,7 @@ void CDVD_Drive::save_state(ofstream &state)
     state.write((char*)&sector_pos, sizeof(sector_pos));
     state.write((char*)&sectors_left, sizeof(sectors_left));
     state.write((char*)&block_size, sizeof(block_size));
+    flush_sector_data();
     state.write((char*)&read_buffer, sizeof(read_buffer));
     state.write((char*)&ISTAT, sizeof(ISTAT));
     state.write((char*)&drive_status, sizeof(drive_status));
@@ -866,7 +873,7 @@ void Scheduler::load_state(ifstream &state)
                 Errors::die("Event id %d not recognized!", event.id);
         }
 
-        events.push_back(event);
+        add_event(event);
     }
 }
 
@@ -881,7 +888,13 @@ void Scheduler::save_state(ofstream &state)
     int event_size = events.size();
     state.write((char*)&event_size, sizeof(event_size));
 
-    for (auto it = events.begin(); it != events.end(); it++)
+    //Save events in the order they'll run, so that loading them keeps the same order
+    std::vector<SchedulerEvent> sorted_events = events;
+    std::sort(sorted_events.begin(), sorted_events.end(), [](const SchedulerEvent& a, const SchedulerEvent& b) {
+        return later(b, a);
+    });
+
+    for (auto it = sorted_events.begin(); it != sorted_events.end(); it++)
     {
         SchedulerEvent event = *it;
         state.write((char*)&event.id, sizeof(event.id));
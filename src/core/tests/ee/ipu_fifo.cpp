@@ -0,0 +1,172 @@
+#include "../../emulator.hpp"
+#include "../../ee/ipu/ipu_fifo.hpp"
+#include <deque>
+#include <random>
+
+using namespace std;
+
+#define FIFO_OPS 1000000
+
+//Bitstream reader over a plain queue of quadwords that reads one bit at a time, to check the cached reader against
+struct ReferenceFIFO
+{
+    deque<uint128_t> quads;
+    int bit_pointer;
+
+    void reset()
+    {
+        quads.clear();
+        bit_pointer = 0;
+    }
+
+    int available() const
+    {
+        return (int)(quads.size() * 128) - bit_pointer;
+    }
+
+    bool get_bits(uint32_t& data, int bits) const
+    {
+        data = 0;
+        if (available() < bits || available() <= 0)
+            return false;
+        for (int i = 0; i < bits; i++)
+        {
+            int pos = bit_pointer + i;
+            const uint8_t* bytes = (const uint8_t*)&quads[pos / 128];
+            data = (data << 1) | ((bytes[(pos % 128) / 8] >> (7 - (pos % 8))) & 1);
+        }
+        return true;
+    }
+
+    bool advance_stream(int amount)
+    {
+        if (amount > 32)
+            amount = 32;
+        if (amount > available())
+            return false;
+        bit_pointer += amount;
+        while (bit_pointer >= 128)
+        {
+            bit_pointer -= 128;
+            quads.pop_front();
+        }
+        return true;
+    }
+};
+
+//Random pushes, pops, peeks, advances and BCLRs. The ring's head moves all the time,
+//so reads across the end of the ring, where refill has to wrap around, come up often.
+void Emulator::test_ipu_fifo()
+{
+    ofstream test_output("test_log.txt");
+
+    mt19937 rng(0x1337);
+    uniform_int_distribution<int> op_dist(0, 99);
+    uniform_int_distribution<uint32_t> word;
+
+    IPU_FIFO FIFO;
+    ReferenceFIFO reference;
+    FIFO.reset();
+    reference.reset();
+
+    test_output << "-- TEST BEGIN\n";
+    test_output << "IPU_FIFO:\n";
+
+    int mismatches = 0, wrapped_reads = 0;
+    auto mismatch = [&](const char* op, int bits, uint32_t expected, uint32_t result)
+    {
+        if (!mismatches)
+        {
+            test_output << "  first mismatch: " << op << " " << dec << bits << " bits, bit pointer " << reference.bit_pointer
+                        << ", " << reference.quads.size() << " quads, expected $" << hex << expected
+                        << ", got $" << result << "\n";
+        }
+        mismatches++;
+    };
+
+    for (int i = 0; i < FIFO_OPS; i++)
+    {
+        int op = op_dist(rng);
+        if (op < 15)
+        {
+            if (FIFO.space())
+            {
+                uint128_t quad;
+                for (int j = 0; j < 4; j++)
+                    quad._u32[j] = word(rng);
+                FIFO.push(quad);
+                reference.quads.push_back(quad);
+            }
+        }
+        else if (op < 20)
+        {
+            //DMA sends several quadwords at once
+            if (FIFO.space())
+            {
+                uint128_t quads[IPU_FIFO::SIZE];
+                int amount = uniform_int_distribution<int>(1, FIFO.space())(rng);
+                for (int j = 0; j < amount; j++)
+                {
+                    for (int k = 0; k < 4; k++)
+                        quads[j]._u32[k] = word(rng);
+                    reference.quads.push_back(quads[j]);
+                }
+                FIFO.push(quads, amount);
+            }
+        }
+        else if (op < 22)
+        {
+            if (FIFO.size())
+            {
+                uint128_t expected = reference.quads.front();
+                uint128_t result = FIFO.pop();
+                reference.quads.pop_front();
+                if (expected._u64[0] != result._u64[0] || expected._u64[1] != result._u64[1])
+                    mismatch("pop", 128, expected._u32[0], result._u32[0]);
+            }
+        }
+        else if (op < 62)
+        {
+            int bits = uniform_int_distribution<int>(0, 32)(rng);
+            uint32_t expected, result;
+            bool expected_ok = reference.get_bits(expected, bits);
+            int start = ((FIFO.head * 128) + FIFO.bit_pointer) & ((IPU_FIFO::SIZE * 128) - 1);
+            bool result_ok = FIFO.get_bits(result, bits);
+            if (expected_ok != result_ok || expected != result)
+                mismatch("get_bits", bits, expected, result);
+            else if (result_ok && start + bits > IPU_FIFO::SIZE * 128)
+                wrapped_reads++;
+        }
+        else if (op < 98)
+        {
+            //Mostly short codes, sometimes more than the 32 bits advance_stream takes at once
+            int amount = (word(rng) & 1) ? uniform_int_distribution<int>(0, 8)(rng)
+                                         : uniform_int_distribution<int>(0, 40)(rng);
+            bool expected_ok = reference.advance_stream(amount);
+            bool result_ok = FIFO.advance_stream(amount);
+            if (expected_ok != result_ok)
+                mismatch("advance_stream", amount, expected_ok, result_ok);
+        }
+        else
+        {
+            //BCLR
+            int bit_pointer = word(rng) & 0x7F;
+            FIFO.reset();
+            FIFO.bit_pointer = bit_pointer;
+            reference.reset();
+            reference.bit_pointer = bit_pointer;
+        }
+
+        if (FIFO.bit_pointer != reference.bit_pointer || FIFO.size() != (int)reference.quads.size())
+        {
+            mismatch("state", 0, reference.bit_pointer, FIFO.bit_pointer);
+            FIFO.reset();
+            reference.reset();
+        }
+    }
+
+    test_output << "  " << dec << mismatches << " mismatches in " << FIFO_OPS << " operations ("
+                << wrapped_reads << " reads across the end of the ring)\n";
+    test_output << "-- TEST END\n";
+    test_output.flush();
+}
@@ -0,0 +1,123 @@
+#include "../../emulator.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+
+using namespace std;
+
+//IEEE 1180 accuracy test of the fixed-point IDCT against the double precision one.
+//Random blocks go through a double precision forward DCT, get rounded and clipped to 12 bits,
+//then both inverse transforms are run on them and the differences measured.
+#define IDCT_BLOCKS 10000
+
+//Random number generator given by the standard, so that the blocks match its test data
+struct IEEE1180_Random
+{
+    long seed;
+
+    IEEE1180_Random() : seed(1) {}
+
+    long next(long low, long high)
+    {
+        static const double z = (double)0x7FFFFFFF;
+        seed = (seed * 1103515245) + 12345;
+        long i = seed & 0x7FFFFFFE;
+        double x = ((double)i / z) * (low + high + 1);
+        return (long)x - low;
+    }
+};
+
+static int16_t clip(double value, int low, int high)
+{
+    value = floor(value + 0.5);
+    if (value < low)
+        return low;
+    if (value > high)
+        return high;
+    return (int16_t)value;
+}
+
+void Emulator::test_ipu_idct()
+{
+    ofstream test_output("test_log.txt");
+
+    static const int ranges[3][2] = {{256, 255}, {5, 5}, {300, 300}};
+
+    ipu.prepare_IDCT();
+
+    test_output << "-- TEST BEGIN\n";
+    test_output << "perform_IDCT:\n";
+    test_output << fixed << setprecision(4);
+    for (int r = 0; r < 3; r++)
+    {
+        for (int sign = 1; sign >= -1; sign -= 2)
+        {
+            IEEE1180_Random rng;
+            double error_sum[64] = {}, error_squared[64] = {};
+            int peak_error = 0;
+
+            for (int n = 0; n < IDCT_BLOCKS; n++)
+            {
+                int16_t block[64], coeffs[64], reference[64], result[64];
+                for (int i = 0; i < 64; i++)
+                    block[i] = sign * rng.next(ranges[r][0], ranges[r][1]);
+
+                for (int u = 0; u < 8; u++)
+                {
+                    for (int v = 0; v < 8; v++)
+                    {
+                        double sum = 0.0;
+                        for (int x = 0; x < 8; x++)
+                        {
+                            for (int y = 0; y < 8; y++)
+                                sum += ipu.IDCT_table[u][x] * ipu.IDCT_table[v][y] * block[(x * 8) + y];
+                        }
+                        coeffs[(u * 8) + v] = clip(sum, -2048, 2047);
+                    }
+                }
+
+                ipu.perform_IDCT_reference(coeffs, reference);
+                memcpy(result, coeffs, sizeof(result));
+                ipu.perform_IDCT(result);
+
+                for (int i = 0; i < 64; i++)
+                {
+                    int error = result[i] - clip(reference[i], -256, 255);
+                    if (abs(error) > peak_error)
+                        peak_error = abs(error);
+                    error_sum[i] += error;
+                    error_squared[i] += error * error;
+                }
+            }
+
+            double peak_mse = 0.0, peak_mean = 0.0, total_mse = 0.0, total_mean = 0.0;
+            for (int i = 0; i < 64; i++)
+            {
+                peak_mse = max(peak_mse, error_squared[i] / IDCT_BLOCKS);
+                peak_mean = max(peak_mean, fabs(error_sum[i]) / IDCT_BLOCKS);
+                total_mse += error_squared[i];
+                total_mean += error_sum[i];
+            }
+            total_mse /= 64.0 * IDCT_BLOCKS;
+            total_mean = fabs(total_mean) / (64.0 * IDCT_BLOCKS);
+
+            bool pass = peak_error <= 1 && peak_mse <= 0.06 && total_mse <= 0.02 &&
+                        peak_mean <= 0.015 && total_mean <= 0.0015;
+            test_output << "  range -" << dec << ranges[r][0] << ".." << ranges[r][1]
+                        << (sign < 0 ? " negated" : "") << ": " << (pass ? "PASS" : "FAIL")
+                        << " (peak error " << peak_error << ", peak MSE " << peak_mse
+                        << ", MSE " << total_mse << ", peak mean error " << peak_mean
+                        << ", mean error " << setprecision(5) << total_mean << setprecision(4) << ")\n";
+        }
+    }
+
+    int16_t zeroes[64] = {};
+    ipu.perform_IDCT(zeroes);
+    bool all_zero = true;
+    for (int i = 0; i < 64; i++)
+        all_zero &= !zeroes[i];
+    test_output << "  all zero input: " << (all_zero ? "PASS" : "FAIL") << "\n";
+    test_output << "-- TEST END\n";
+    test_output.flush();
+}
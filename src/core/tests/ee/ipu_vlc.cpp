@@ -0,0 +1,126 @@
+#include "../../emulator.hpp"
+#include "../../ee/ipu/ipu.hpp"
+#include <iomanip>
+#include <random>
+
+using namespace std;
+
+#define VLC_TRIALS 20000
+
+struct VLC_Result
+{
+    bool found;
+    bool error;
+    VLC_Entry entry;
+};
+
+static VLC_Result peek(VLC_Table& table, IPU_FIFO& FIFO, bool slow)
+{
+    VLC_Result result = {};
+    try
+    {
+        if (slow)
+            result.found = table.peek_symbol_slow(FIFO, result.entry);
+        else
+            result.found = table.peek_symbol(FIFO, result.entry);
+    }
+    catch (VLC_Error&)
+    {
+        result.error = true;
+    }
+    return result;
+}
+
+static bool same_result(const VLC_Result& a, const VLC_Result& b)
+{
+    if (a.found != b.found || a.error != b.error)
+        return false;
+    if (!a.found)
+        return true;
+    return a.entry.key == b.entry.key && a.entry.bits == b.entry.bits && a.entry.value == b.entry.value;
+}
+
+//Streams are mostly zeroes, as that's where the long codes and the escapes are.
+//Only one to three quadwords are pushed and the bit pointer can land anywhere in them,
+//so codes cut off by the end of the data go through the fallback to the slow search too.
+static void random_stream(mt19937& rng, IPU_FIFO& FIFO)
+{
+    uniform_int_distribution<uint32_t> word;
+    uniform_int_distribution<int> quads_dist(1, 3);
+
+    FIFO.reset();
+    int quads = quads_dist(rng);
+    for (int i = 0; i < quads; i++)
+    {
+        uint128_t quad;
+        for (int j = 0; j < 4; j++)
+        {
+            uint32_t density = (word(rng) & 1) ? word(rng) : 0xFFFFFFFF;
+            quad._u32[j] = word(rng) & density & word(rng);
+        }
+        FIFO.push(quad);
+    }
+    FIFO.bit_pointer = uniform_int_distribution<int>(0, quads * 128 - 1)(rng);
+}
+
+static void test_vlc_table(ofstream& test_output, VLC_Table& table, const char* name)
+{
+    mt19937 rng(0x1337);
+    int mismatches = 0, errors = 0;
+    for (int trial = 0; trial < VLC_TRIALS; trial++)
+    {
+        IPU_FIFO FIFO;
+        random_stream(rng, FIFO);
+
+        VLC_Result expected = peek(table, FIFO, true);
+        VLC_Result result = peek(table, FIFO, false);
+        if (expected.error)
+            errors++;
+        if (!same_result(expected, result))
+        {
+            if (!mismatches)
+            {
+                uint32_t bits;
+                FIFO.get_bits(bits, 32);
+                test_output << "  first mismatch: bits $" << hex << setfill('0') << setw(8) << bits
+                            << dec << ", expected found " << expected.found << " error " << expected.error
+                            << " key $" << hex << expected.entry.key << dec << "/" << (int)expected.entry.bits
+                            << ", got found " << result.found << " error " << result.error
+                            << " key $" << hex << result.entry.key << dec << "/" << (int)result.entry.bits << "\n";
+            }
+            mismatches++;
+        }
+    }
+    test_output << "  " << name << ": " << dec << mismatches << " mismatches (" << errors << " invalid codes)\n";
+}
+
+void Emulator::test_ipu_vlc()
+{
+    ofstream test_output("test_log.txt");
+
+    DCT_Coeff_Table0 dct_coeff0;
+    DCT_Coeff_Table1 dct_coeff1;
+    MacroblockAddrInc macroblock_increment;
+    MotionCode motion_code;
+    CodedBlockPattern block_pattern;
+    LumTable lum_table;
+    ChromTable chrom_table;
+    Macroblock_IPic I_macroblock;
+    Macroblock_PPic P_macroblock;
+    Macroblock_BPic B_macroblock;
+
+    test_output << "-- TEST BEGIN\n";
+    test_output << "VLC_Table::peek_symbol:\n";
+    test_vlc_table(test_output, dct_coeff0, "DCT_Coeff_Table0");
+    test_vlc_table(test_output, dct_coeff1, "DCT_Coeff_Table1");
+    test_vlc_table(test_output, macroblock_increment, "MacroblockAddrInc");
+    test_vlc_table(test_output, motion_code, "MotionCode");
+    test_vlc_table(test_output, block_pattern, "CodedBlockPattern");
+    test_vlc_table(test_output, lum_table, "LumTable");
+    test_vlc_table(test_output, chrom_table, "ChromTable");
+    test_vlc_table(test_output, I_macroblock, "Macroblock_IPic");
+    test_vlc_table(test_output, P_macroblock, "Macroblock_PPic");
+    test_vlc_table(test_output, B_macroblock, "Macroblock_BPic");
+    test_output << "-- TEST END\n";
+    test_output.flush();
+}
@@ -0,0 +1,513 @@
+#include "../../emulator.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+#define VIF_TRIALS 2000
+#define VU1_DATA_SIZE (1024 * 16)
+
+//Scalar model of how UNPACK decoded, masked and offset each vector before the decoders were picked per command.
+//Only runs the VIFcodes the test sends: NOP, STCYCL, STMOD, STMASK, STROW, STCOL and UNPACK.
+struct UnpackModel
+{
+    uint8_t mem[VU1_DATA_SIZE];
+    uint32_t ROW[4], COL[4], MASK;
+    uint8_t MODE;
+    CYCLE_REG CYCLE;
+
+    uint8_t command;
+    uint16_t imm;
+    int command_len;
+    UNPACK_Command unpack;
+    uint32_t buffer[4];
+    int buffer_size;
+
+    //Set when a V3 format waits for data that never fits in the buffer, which the VIF doesn't handle either
+    bool overflowed;
+
+    uint32_t read32(uint32_t addr)
+    {
+        uint32_t value;
+        memcpy(&value, &mem[addr & (VU1_DATA_SIZE - 1)], 4);
+        return value;
+    }
+
+    void write128(uint32_t addr, const uint128_t& quad)
+    {
+        memcpy(&mem[addr & (VU1_DATA_SIZE - 1)], &quad, 16);
+    }
+
+    bool is_filling_write()
+    {
+        return CYCLE.CL < CYCLE.WL && unpack.blocks_written >= CYCLE.CL;
+    }
+
+    void run(uint32_t value)
+    {
+        if (command == 0)
+        {
+            buffer_size = 0;
+            decode(value);
+        }
+        else
+        {
+            switch (command)
+            {
+                case 0x20:
+                    MASK = value;
+                    command = 0;
+                    break;
+                case 0x30:
+                    ROW[4 - command_len] = value;
+                    if (command_len <= 1)
+                        command = 0;
+                    break;
+                case 0x31:
+                    COL[4 - command_len] = value;
+                    if (command_len <= 1)
+                        command = 0;
+                    break;
+                default:
+                    handle_UNPACK(value);
+                    break;
+            }
+        }
+        if (command_len)
+            command_len--;
+    }
+
+    void decode(uint32_t value)
+    {
+        command = (value >> 24) & 0x7F;
+        imm = value & 0xFFFF;
+        command_len = 1;
+        switch (command)
+        {
+            case 0x00:
+                command = 0;
+                break;
+            case 0x01:
+                CYCLE.CL = imm & 0xFF;
+                CYCLE.WL = imm >> 8;
+                command = 0;
+                break;
+            case 0x05:
+                MODE = value & 0x3;
+                command = 0;
+                break;
+            case 0x20:
+                command_len++;
+                break;
+            case 0x30:
+            case 0x31:
+                command_len += 4;
+                break;
+            default:
+                init_UNPACK(value);
+                break;
+        }
+    }
+
+    void init_UNPACK(uint32_t value)
+    {
+        unpack.addr = (imm & 0x3FF) * 16;
+        unpack.sign_extend = !(imm & (1 << 14));
+        unpack.masked = (command >> 4) & 0x1;
+        unpack.num = (value >> 16) & 0xFF;
+        if (!unpack.num)
+            unpack.num = 256;
+        unpack.cmd = command & 0xF;
+        unpack.blocks_written = 0;
+        buffer_size = 0;
+        unpack.offset = 0;
+        int vl = command & 0x3;
+        int vn = (command >> 2) & 0x3;
+
+        if (vl == 3 && vn == 3)
+            unpack.words_per_op = 16;
+        else
+            unpack.words_per_op = (32 >> vl) * (vn + 1);
+
+        uint32_t data_read;
+        if (CYCLE.WL <= CYCLE.CL)
+            data_read = unpack.num;
+        else
+            data_read = CYCLE.CL * (unpack.num / CYCLE.WL) + min((int)(unpack.num % CYCLE.WL), (int)CYCLE.CL);
+
+        data_read = unpack.words_per_op * data_read;
+        unpack.words_per_op = (unpack.words_per_op + 0x1F) & ~0x1F;
+        data_read = (data_read + 0x1F) & ~0x1F;
+        unpack.words_per_op /= 32;
+        data_read /= 32;
+
+        command_len += data_read;
+    }
+
+    uint32_t extend16(uint32_t value)
+    {
+        return unpack.sign_extend ? (uint32_t)(int32_t)(int16_t)value : (uint16_t)value;
+    }
+
+    uint32_t extend8(uint32_t value)
+    {
+        return unpack.sign_extend ? (uint32_t)(int32_t)(int8_t)value : (uint8_t)value;
+    }
+
+    //Returns false when the format needs more data before it can produce a vector
+    bool decode_vector(uint128_t& quad)
+    {
+        int bufferpos = 0;
+        switch (unpack.cmd)
+        {
+            case 0x0:
+                for (int i = 0; i < 4; i++)
+                    quad._u32[i] = buffer[0];
+                buffer_size -= 1;
+                break;
+            case 0x1:
+                for (int i = 0; i < 4; i++)
+                    quad._u32[i] = extend16(unpack.offset ? (buffer[0] >> 16) : buffer[0]);
+                if (unpack.offset++)
+                {
+                    unpack.offset = 0;
+                    buffer_size -= 1;
+                }
+                break;
+            case 0x2:
+                for (int i = 0; i < 4; i++)
+                    quad._u32[i] = extend8(buffer[0] >> (unpack.offset * 8));
+                if (unpack.offset++ == 3)
+                {
+                    unpack.offset = 0;
+                    buffer_size -= 1;
+                }
+                break;
+            case 0x4:
+                quad._u32[0] = buffer[0];
+                quad._u32[1] = buffer[1];
+                quad._u32[2] = buffer[0];
+                quad._u32[3] = buffer[1];
+                buffer_size -= 2;
+                break;
+            case 0x5:
+                quad._u32[0] = quad._u32[2] = extend16(buffer[0]);
+                quad._u32[1] = quad._u32[3] = extend16(buffer[0] >> 16);
+                buffer_size -= 1;
+                break;
+            case 0x6:
+                quad._u32[0] = quad._u32[2] = extend8(buffer[0] >> (unpack.offset * 16));
+                quad._u32[1] = quad._u32[3] = extend8(buffer[0] >> ((unpack.offset * 16) + 8));
+                if (unpack.offset++)
+                {
+                    unpack.offset = 0;
+                    buffer_size -= 1;
+                }
+                break;
+            case 0x8:
+                if (buffer_size < 4 && unpack.num > 1 && unpack.offset > 0)
+                    return false;
+                for (int i = 0; i < 3; i++)
+                    quad._u32[i] = buffer[i];
+                if (buffer_size >= 4)
+                {
+                    quad._u32[3] = buffer[3];
+                    buffer[0] = buffer[3];
+                }
+                else
+                    quad._u32[3] = 0;
+                buffer_size -= 3;
+                unpack.offset++;
+                break;
+            case 0x9:
+                for (int i = 0; i < 3; i++)
+                {
+                    quad._u32[i] = extend16(unpack.offset ? (buffer[bufferpos] >> 16) : buffer[bufferpos]);
+                    if (unpack.offset++)
+                    {
+                        unpack.offset = 0;
+                        bufferpos++;
+                        buffer_size -= 1;
+                    }
+                }
+                if (buffer_size >= 1)
+                    quad._u32[3] = extend16(unpack.offset ? (buffer[bufferpos] >> 16) : buffer[bufferpos]);
+                else
+                    quad._u32[3] = 0;
+                if (buffer_size < 2 && unpack.offset)
+                    buffer[0] = buffer[bufferpos];
+                break;
+            case 0xA:
+                if ((buffer_size * 4) - unpack.offset < 3)
+                    return false;
+                for (int i = 0; i < 3; i++)
+                {
+                    quad._u32[i] = extend8(buffer[bufferpos] >> (unpack.offset * 8));
+                    if (unpack.offset++ == 3)
+                    {
+                        unpack.offset = 0;
+                        bufferpos++;
+                        buffer_size -= 1;
+                    }
+                }
+                if (buffer_size >= 1)
+                    quad._u32[3] = extend8(buffer[bufferpos] >> (unpack.offset * 8));
+                else
+                    quad._u32[3] = 0;
+                if (buffer_size == 1 && unpack.offset)
+                    buffer[0] = buffer[bufferpos];
+                break;
+            case 0xC:
+                for (int i = 0; i < 4; i++)
+                    quad._u32[i] = buffer[i];
+                buffer_size -= 4;
+                break;
+            case 0xD:
+                for (int i = 0; i < 4; i++)
+                    quad._u32[i] = extend16(buffer[i / 2] >> ((i % 2) * 16));
+                buffer_size -= 2;
+                break;
+            case 0xE:
+                for (int i = 0; i < 4; i++)
+                    quad._u32[i] = extend8(buffer[0] >> (i * 8));
+                buffer_size -= 1;
+                break;
+            case 0xF:
+            {
+                uint16_t data = (buffer[0] >> (unpack.offset * 16)) & 0xFFFF;
+                quad._u32[0] = (data & 0x1F) << 3;
+                quad._u32[1] = ((data >> 5) & 0x1F) << 3;
+                quad._u32[2] = ((data >> 10) & 0x1F) << 3;
+                quad._u32[3] = ((data >> 15) & 0x1) << 7;
+                if (unpack.offset++)
+                {
+                    unpack.offset = 0;
+                    buffer_size -= 1;
+                }
+                break;
+            }
+        }
+        return true;
+    }
+
+    void handle_UNPACK(uint32_t value)
+    {
+        if (buffer_size == 4)
+        {
+            overflowed = true;
+            return;
+        }
+        buffer[buffer_size] = value;
+        buffer_size++;
+
+        while ((is_filling_write() || (buffer_size >= unpack.words_per_op)) && unpack.num)
+        {
+            uint128_t quad;
+            if (unpack.blocks_written < CYCLE.CL)
+            {
+                if (!decode_vector(quad))
+                    return;
+            }
+            else
+            {
+                quad._u64[0] = 0;
+                quad._u64[1] = 0;
+            }
+            process_quad(quad);
+        }
+        if (unpack.num == 0)
+            command = 0;
+    }
+
+    void process_quad(uint128_t& quad)
+    {
+        int shift = min(unpack.blocks_written * 8, 24);
+        if (unpack.masked || is_filling_write())
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                switch ((MASK >> ((i * 2) + shift)) & 0x3)
+                {
+                    case 1:
+                        quad._u32[i] = ROW[i];
+                        break;
+                    case 2:
+                        quad._u32[i] = COL[min(unpack.blocks_written, 3)];
+                        break;
+                    case 3:
+                        quad._u32[i] = read32(unpack.addr + (i * 4));
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+
+        if (MODE && unpack.cmd != 0xF)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                if (((MASK >> ((i * 2) + shift)) & 0x3) && unpack.masked)
+                    continue;
+                switch (MODE)
+                {
+                    case 1:
+                        quad._u32[i] += ROW[i];
+                        break;
+                    case 2:
+                        quad._u32[i] += ROW[i];
+                        ROW[i] = quad._u32[i];
+                        break;
+                    case 3:
+                        ROW[i] = quad._u32[i];
+                        break;
+                }
+            }
+        }
+
+        unpack.blocks_written++;
+        write128(unpack.addr, quad);
+        unpack.addr += 16;
+        unpack.num -= 1;
+
+        if (unpack.blocks_written >= CYCLE.WL)
+        {
+            if (CYCLE.CL > CYCLE.WL)
+                unpack.addr += (CYCLE.CL - unpack.blocks_written) * 16;
+            unpack.blocks_written = 0;
+        }
+    }
+};
+
+//Words of data an UNPACK with these settings reads after its VIFcode
+static int unpack_data_words(int cmd, int num, int CL, int WL)
+{
+    int vl = cmd & 0x3;
+    int vn = (cmd >> 2) & 0x3;
+    int bits = (vl == 3 && vn == 3) ? 16 : (32 >> vl) * (vn + 1);
+    int vectors = num;
+    if (WL > CL)
+        vectors = CL * (num / WL) + min(num % WL, CL);
+    return (bits * vectors + 0x1F) / 32;
+}
+
+//Runs the VIFcodes through the model, then through the VIF one quadword at a time.
+//Streams that leave the model stuck in an UNPACK are skipped, as what follows depends on overflowing the buffer.
+static bool run_vif_stream(VectorInterface& vif, UnpackModel& model, vector<uint32_t>& words)
+{
+    while (words.size() % 4)
+        words.push_back(0);
+
+    UnpackModel* backup = new UnpackModel(model);
+    model.overflowed = false;
+    for (uint32_t word : words)
+        model.run(word);
+    if (model.overflowed || model.command)
+    {
+        model = *backup;
+        delete backup;
+        return false;
+    }
+    delete backup;
+
+    for (size_t pos = 0; pos < words.size(); pos += 4)
+    {
+        uint128_t quad;
+        for (int i = 0; i < 4; i++)
+            quad._u32[i] = words[pos + i];
+        while (!vif.feed_DMA(quad))
+            vif.update(16);
+    }
+    vif.update(words.size());
+    return true;
+}
+
+void Emulator::test_vif()
+{
+    ofstream test_output("test_log.txt");
+
+    static const int formats[] = {0x0, 0x1, 0x2, 0x4, 0x5, 0x6, 0x8, 0x9, 0xA, 0xC, 0xD, 0xE, 0xF};
+    static const char* format_names[] = {"S-32", "S-16", "S-8", "V2-32", "V2-16", "V2-8", "V3-32", "V3-16",
+                                         "V3-8", "V4-32", "V4-16", "V4-8", "V4-5"};
+    int trials[13] = {}, mismatches[13] = {}, skipped = 0;
+
+    mt19937 rng(0x1337);
+    UnpackModel* model = new UnpackModel();
+    vif1.reset();
+    model->command = 0;
+    model->command_len = 0;
+
+    test_output << "-- TEST BEGIN\n";
+    for (int trial = 0; trial < VIF_TRIALS; trial++)
+    {
+        for (uint32_t addr = 0; addr < VU1_DATA_SIZE; addr += 4)
+        {
+            uint32_t value = rng();
+            vu1.write_data<uint32_t>(addr, value);
+            memcpy(&model->mem[addr], &value, 4);
+        }
+
+        int format = rng() % 13;
+        int cmd = formats[format];
+        bool masked = rng() & 1;
+        bool unsigned_data = rng() & 1;
+        int num = (rng() % 8) ? rng() % 40 + 1 : 0;
+        int CL = rng() % 5 + 1;
+        int WL = rng() % 5 + 1;
+        uint32_t addr = rng() % 0x400;
+
+        vector<uint32_t> words;
+        words.push_back((0x01 << 24) | (WL << 8) | CL);
+        words.push_back((0x05 << 24) | (rng() % 4));
+        words.push_back(0x20 << 24);
+        words.push_back((rng() % 2) ? rng() : 0);
+        words.push_back(0x30 << 24);
+        for (int i = 0; i < 4; i++)
+            words.push_back(rng());
+        words.push_back(0x31 << 24);
+        for (int i = 0; i < 4; i++)
+            words.push_back(rng());
+        words.push_back(((0x60 | (masked << 4) | cmd) << 24) | (num << 16) | (unsigned_data << 14) | addr);
+        int data_words = unpack_data_words(cmd, num ? num : 256, CL, WL);
+        for (int i = 0; i < data_words; i++)
+            words.push_back(rng());
+
+        if (!run_vif_stream(vif1, *model, words))
+        {
+            skipped++;
+            continue;
+        }
+
+        bool same = true;
+        for (uint32_t addr = 0; addr < VU1_DATA_SIZE && same; addr += 4)
+            same = vu1.read_data<uint32_t>(addr) == model->read32(addr);
+        for (int i = 0; i < 4 && same; i++)
+            same = vif1.get_row(i << 4) == model->ROW[i];
+
+        trials[format]++;
+        if (!same)
+        {
+            if (!mismatches[format])
+            {
+                test_output << "  first " << format_names[format] << " mismatch: trial " << dec << trial
+                            << ", num " << num << ", CL " << CL << ", WL " << WL << ", masked " << masked
+                            << ", MODE " << (int)model->MODE << "\n";
+            }
+            mismatches[format]++;
+        }
+    }
+
+    test_output << "UNPACK:\n";
+    for (int i = 0; i < 13; i++)
+    {
+        test_output << "  " << format_names[i] << ": " << dec << mismatches[i] << " mismatches in "
+                    << trials[i] << " trials\n";
+    }
+    test_output << "  " << dec << skipped << " trials skipped, stuck waiting for V3 data\n";
+    test_output << "-- TEST END\n";
+    test_output.flush();
+    delete model;
+}
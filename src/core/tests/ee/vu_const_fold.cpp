@@ -0,0 +1,159 @@
+#include "../../emulator.hpp"
+#include "../../ee/vu_jittrans.hpp"
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+#define FOLD_TRIALS 20000
+#define FOLD_MAX_INSTRS 32
+
+//Runs the integer ops int_const_pass works on. Writes to vi0 are dropped like on the VU.
+//LoadInt stands in for anything that isn't folded, giving its destination a value the pass can't know.
+static void run_int_ops(vector<IR::Instruction> instrs, uint16_t* vi, uint32_t load_seed)
+{
+    mt19937 loads(load_seed);
+    for (IR::Instruction& instr : instrs)
+    {
+        int dest = instr.get_dest();
+        int source = instr.get_source() & 0xF;
+        int source2 = instr.get_source2() & 0xF;
+        uint16_t result;
+        switch (instr.op)
+        {
+            case IR::Opcode::LoadConst:
+                result = instr.get_source();
+                break;
+            case IR::Opcode::MoveIntReg:
+                result = vi[source];
+                break;
+            case IR::Opcode::AddUnsignedImm:
+                result = vi[source] + instr.get_source2();
+                break;
+            case IR::Opcode::SubUnsignedImm:
+                result = vi[source] - instr.get_source2();
+                break;
+            case IR::Opcode::AddIntReg:
+                result = vi[source] + vi[source2];
+                break;
+            case IR::Opcode::SubIntReg:
+                result = vi[source] - vi[source2];
+                break;
+            case IR::Opcode::AndInt:
+                result = vi[source] & vi[source2];
+                break;
+            case IR::Opcode::OrInt:
+                result = vi[source] | vi[source2];
+                break;
+            default:
+                result = loads();
+                break;
+        }
+        if (dest)
+            vi[dest] = result;
+    }
+}
+
+static IR::Instruction int_op(IR::Opcode op, int dest, uint64_t source, uint64_t source2 = 0)
+{
+    IR::Instruction instr(op);
+    instr.set_dest(dest);
+    instr.set_source(source);
+    instr.set_source2(source2);
+    return instr;
+}
+
+//Few registers and plenty of vi0, so that ops keep reading what earlier ones wrote
+static IR::Instruction random_int_op(mt19937& rng)
+{
+    static const IR::Opcode ops[] =
+    {
+        IR::Opcode::LoadConst, IR::Opcode::MoveIntReg, IR::Opcode::AddUnsignedImm, IR::Opcode::SubUnsignedImm,
+        IR::Opcode::AddIntReg, IR::Opcode::SubIntReg, IR::Opcode::AndInt, IR::Opcode::OrInt, IR::Opcode::LoadInt
+    };
+    uniform_int_distribution<int> op_dist(0, 8);
+    uniform_int_distribution<int> reg_dist(0, 5);
+    uniform_int_distribution<int> imm_dist(0, 3);
+
+    IR::Opcode op = ops[op_dist(rng)];
+    int dest = reg_dist(rng);
+    int source = reg_dist(rng);
+    int source2 = reg_dist(rng);
+    switch (op)
+    {
+        case IR::Opcode::LoadConst:
+            return int_op(op, dest, imm_dist(rng));
+        case IR::Opcode::AddUnsignedImm:
+        case IR::Opcode::SubUnsignedImm:
+            return int_op(op, dest, source, imm_dist(rng));
+        default:
+            return int_op(op, dest, source, source2);
+    }
+}
+
+static bool fold_matches(const vector<IR::Instruction>& instrs, const vector<IR::Instruction>& folded, uint32_t seed)
+{
+    uint16_t expected[16], result[16];
+    mt19937 rng(seed);
+    for (int i = 0; i < 16; i++)
+        expected[i] = result[i] = i ? rng() : 0;
+
+    run_int_ops(instrs, expected, seed);
+    run_int_ops(folded, result, seed);
+    return !memcmp(expected, result, sizeof(expected));
+}
+
+void Emulator::test_vu_const_fold()
+{
+    ofstream test_output("test_log.txt");
+
+    unique_ptr<VU_JitTranslator> translator(new VU_JitTranslator);
+    auto fold = [&](const vector<IR::Instruction>& instrs)
+    {
+        IR::Block block;
+        for (IR::Instruction instr : instrs)
+            block.add_instr(instr);
+        translator->int_const_pass(block);
+        return block.get_instrs();
+    };
+
+    test_output << "-- TEST BEGIN\n";
+    test_output << "VU_JitTranslator::int_const_pass:\n";
+
+    //IADDI vi0, vi0, 5 must not make later reads of vi0 fold to 5
+    vector<IR::Instruction> vi0_write =
+    {
+        int_op(IR::Opcode::AddUnsignedImm, 0, 0, 5),
+        int_op(IR::Opcode::AddIntReg, 1, 0, 0),
+        int_op(IR::Opcode::OrInt, 2, 0, 1)
+    };
+    bool vi0_ok = fold_matches(vi0_write, fold(vi0_write), 1);
+    test_output << "  write to vi0: " << (vi0_ok ? "PASS" : "FAIL") << "\n";
+
+    mt19937 rng(0x1337);
+    uniform_int_distribution<int> length_dist(1, FOLD_MAX_INSTRS);
+    int mismatches = 0;
+    unsigned int total_size = 0, total_folded_size = 0;
+    for (int trial = 0; trial < FOLD_TRIALS; trial++)
+    {
+        vector<IR::Instruction> instrs(length_dist(rng));
+        for (IR::Instruction& instr : instrs)
+            instr = random_int_op(rng);
+
+        vector<IR::Instruction> folded = fold(instrs);
+        if (!fold_matches(instrs, folded, trial))
+        {
+            if (!mismatches)
+                test_output << "  first mismatch: trial " << dec << trial << ", " << instrs.size() << " instructions\n";
+            mismatches++;
+        }
+        total_size += instrs.size();
+        total_folded_size += folded.size();
+    }
+    test_output << "  random blocks: " << dec << mismatches << " mismatches (" << total_size
+                << " instructions, " << total_folded_size << " after the pass)\n";
+    test_output << "-- TEST END\n";
+    test_output.flush();
+}
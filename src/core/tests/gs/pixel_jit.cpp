@@ -0,0 +1,217 @@
+#include "../../emulator.hpp"
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+#define PIXEL_TRIALS 4000
+#define PIXEL_SPANS 8
+
+//Frame buffers start in the first 512 KB and Z buffers in the second MB, so everything drawn lands in the first 2 MB
+#define PIXEL_MEM_SIZE (1024 * 1024 * 2)
+
+static const uint8_t frame_formats[] = {0x0, 0x1, 0x2, 0xA, 0x30, 0x31, 0x32, 0x3A};
+static const uint8_t zbuf_formats[] = {0x0, 0x1, 0x2, 0xA};
+
+static void random_state(mt19937& rng, GSContext& ctx, PRMODE_REG& prim)
+{
+    auto pick = [&](int max) { return uniform_int_distribution<int>(0, max)(rng); };
+
+    TEST& test = ctx.test;
+    test.alpha_test = pick(1);
+    test.alpha_method = pick(7);
+    test.alpha_ref = pick(1) ? 0x80 : pick(0xFF);
+    test.alpha_fail_method = pick(3);
+    test.dest_alpha_test = pick(1);
+    test.dest_alpha_method = pick(1);
+    test.depth_test = pick(1);
+    test.depth_method = pick(3);
+
+    ALPHA& alpha = ctx.alpha;
+    alpha.spec_A = pick(3);
+    alpha.spec_B = pick(3);
+    alpha.spec_C = pick(3);
+    alpha.spec_D = pick(3);
+    alpha.fixed_alpha = pick(0xFF);
+    prim.alpha_blend = pick(1);
+
+    ctx.frame.format = frame_formats[pick(7)];
+    ctx.frame.base_pointer = pick(63) * 2048 * 4;
+    ctx.frame.width = (pick(9) + 1) * 64;
+    switch (pick(3))
+    {
+        case 0:
+            ctx.frame.mask = uniform_int_distribution<uint32_t>()(rng);
+            break;
+        case 1:
+            ctx.frame.mask = 0xFF000000;
+            break;
+        default:
+            ctx.frame.mask = 0;
+            break;
+    }
+
+    ctx.zbuf.format = zbuf_formats[pick(3)];
+    ctx.zbuf.base_pointer = (128 + pick(63)) * 2048 * 4;
+    ctx.zbuf.no_update = pick(1);
+    ctx.FBA = pick(1);
+}
+
+//Either a random depth, one in the range of the Z buffer format, or the depth already stored,
+//so that the GEQUAL and GREATER cases of equal depths come up often
+static uint32_t random_z(mt19937& rng, uint32_t stored, uint8_t format)
+{
+    uint32_t value = uniform_int_distribution<uint32_t>()(rng);
+    switch (uniform_int_distribution<int>(0, 3)(rng))
+    {
+        case 0:
+            return value;
+        case 1:
+            return (format & 0x2) ? (value & 0xFFFF) : (value & 0xFFFFFF);
+        case 2:
+            return stored + 1;
+        default:
+            return stored;
+    }
+}
+
+void Emulator::test_gs_pixel_jit()
+{
+    ofstream test_output("test_log.txt");
+
+    //The GS thread is stopped right away, leaving its drawing state to this thread alone
+    unique_ptr<GraphicsSynthesizerThread> gs(new GraphicsSynthesizerThread);
+    gs->exit();
+    GSContext& ctx = *gs->current_ctx;
+    RasterWorker& worker = gs->raster_workers[0];
+
+    mt19937 rng(0x1337);
+    uniform_int_distribution<uint32_t> word;
+    auto pick = [&](int max) { return uniform_int_distribution<int>(0, max)(rng); };
+
+    vector<uint8_t> start(PIXEL_MEM_SIZE), expected(PIXEL_MEM_SIZE);
+
+    struct Span
+    {
+        int32_t x, y;
+        int count;
+        uint32_t z[RasterWorker::MAX_SPAN_PIXELS];
+        RGBAQ_REG color[RasterWorker::MAX_SPAN_PIXELS];
+    };
+    Span spans[PIXEL_SPANS];
+
+    auto draw = [&]()
+    {
+        for (int i = 0; i < PIXEL_SPANS; i++)
+        {
+            gs->begin_span(worker, spans[i].y);
+            worker.span_x = spans[i].x;
+            worker.span_count = spans[i].count;
+            memcpy(worker.span_z, spans[i].z, sizeof(spans[i].z));
+            memcpy(worker.span_color, spans[i].color, sizeof(spans[i].color));
+            gs->draw_span(worker);
+        }
+    };
+
+    test_output << "-- TEST BEGIN\n";
+    test_output << "GSPixelJIT:\n";
+
+    int mismatches = 0, skipped = 0;
+    for (int trial = 0; trial < PIXEL_TRIALS; trial++)
+    {
+        //Memory drawn to in one trial is carried over to the next, and is refilled every so often
+        if (!(trial % 16))
+        {
+            for (size_t i = 0; i < PIXEL_MEM_SIZE; i += 4)
+                *(uint32_t*)&start[i] = word(rng);
+        }
+        memcpy(gs->local_mem, start.data(), PIXEL_MEM_SIZE);
+
+        random_state(rng, ctx, gs->PRIM);
+        gs->current_PRMODE = &gs->PRIM;
+        gs->PABE = pick(1);
+        gs->DTHE = pick(1);
+        gs->COLCLAMP = pick(1);
+        gs->SCANMSK = pick(3);
+        for (int y = 0; y < 4; y++)
+        {
+            for (int x = 0; x < 4; x++)
+                gs->dither_mtx[y][x] = pick(7);
+        }
+
+        gs->update_pixel_pipeline();
+        auto pipeline = gs->pixel_pipeline;
+        if (!pipeline)
+        {
+            skipped++;
+            continue;
+        }
+
+        for (int i = 0; i < PIXEL_SPANS; i++)
+        {
+            Span& span = spans[i];
+            span.count = pick(RasterWorker::MAX_SPAN_PIXELS - 1) + 1;
+            span.x = pick(ctx.frame.width - span.count);
+            span.y = pick(63);
+            for (int j = 0; j < span.count; j++)
+            {
+                uint32_t x = span.x + j;
+                uint32_t stored;
+                if (ctx.zbuf.format & 0x2)
+                    stored = gs->read_PSMCT16Z_block(ctx.zbuf.base_pointer, ctx.frame.width, x, span.y);
+                else
+                    stored = gs->read_PSMCT32Z_block(ctx.zbuf.base_pointer, ctx.frame.width, x, span.y);
+                span.z[j] = random_z(rng, stored, ctx.zbuf.format);
+
+                //Alpha is often around the 0x80 the alpha test and PABE look at
+                span.color[j].r = pick(0xFF);
+                span.color[j].g = pick(0xFF);
+                span.color[j].b = pick(0xFF);
+                span.color[j].a = pick(1) ? 0x7E + pick(3) : pick(0xFF);
+                span.color[j].q = 1.0f;
+            }
+        }
+
+        gs->pixel_pipeline = nullptr;
+        draw();
+        memcpy(expected.data(), gs->local_mem, PIXEL_MEM_SIZE);
+
+        memcpy(gs->local_mem, start.data(), PIXEL_MEM_SIZE);
+        gs->pixel_pipeline = pipeline;
+        draw();
+
+        if (memcmp(expected.data(), gs->local_mem, PIXEL_MEM_SIZE))
+        {
+            if (!mismatches)
+            {
+                size_t offset = 0;
+                while (expected[offset] == gs->local_mem[offset])
+                    offset++;
+                test_output << "  first mismatch: trial " << dec << trial << hex
+                            << ", FRAME format $" << (int)ctx.frame.format << " mask $" << ctx.frame.mask
+                            << ", ZBUF format $" << (int)ctx.zbuf.format << (ctx.zbuf.no_update ? " no update" : "")
+                            << ", TEST alpha " << ctx.test.alpha_test << "/" << (int)ctx.test.alpha_method
+                            << "/$" << (int)ctx.test.alpha_ref << "/" << (int)ctx.test.alpha_fail_method
+                            << " dest alpha " << ctx.test.dest_alpha_test << "/" << ctx.test.dest_alpha_method
+                            << " depth " << ctx.test.depth_test << "/" << (int)ctx.test.depth_method
+                            << ", blend " << gs->PRIM.alpha_blend << " " << (int)ctx.alpha.spec_A
+                            << (int)ctx.alpha.spec_B << (int)ctx.alpha.spec_C << (int)ctx.alpha.spec_D
+                            << " fix $" << (int)ctx.alpha.fixed_alpha
+                            << ", PABE " << gs->PABE << " DTHE " << gs->DTHE << " COLCLAMP " << gs->COLCLAMP
+                            << " FBA " << ctx.FBA << ", at $" << offset << ": expected $" << (int)expected[offset]
+                            << ", got $" << (int)gs->local_mem[offset] << "\n";
+            }
+            mismatches++;
+        }
+
+        //Carry the result over either way, so that a mismatch isn't reported again by later trials
+        start = expected;
+    }
+
+    test_output << "  " << dec << mismatches << " mismatches in " << PIXEL_TRIALS - skipped << " draw states ("
+                << skipped << " left to draw_pixel)\n";
+    test_output << "-- TEST END\n";
+    test_output.flush();
+}
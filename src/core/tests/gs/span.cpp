@@ -0,0 +1,159 @@
+#include "../../emulator.hpp"
+#include "../../gsspan.hpp"
+#include <cstring>
+#include <iomanip>
+#include <random>
+
+using namespace std;
+
+#define SPAN_PIXELS 64
+#define SPAN_TRIALS 20000
+
+struct SpanResult
+{
+    RGBAQ_REG color[SPAN_PIXELS];
+    uint32_t z[SPAN_PIXELS];
+    uint8_t fog[SPAN_PIXELS];
+    float s[SPAN_PIXELS];
+    float t[SPAN_PIXELS];
+    int32_t u[SPAN_PIXELS];
+    int32_t v[SPAN_PIXELS];
+};
+
+static void run_span(const SpanGradient& start, const SpanGradient& step, int first, int count,
+                     SpanTexMode mode, SpanPath path, SpanResult& result)
+{
+    //Fill with garbage first so that pixels a path forgets to write show up as mismatches
+    memset(&result, 0xCD, sizeof(result));
+    SpanOutput out;
+    out.color = result.color;
+    out.z = result.z;
+    out.fog = result.fog;
+    out.s = result.s;
+    out.t = result.t;
+    out.u = result.u;
+    out.v = result.v;
+    interpolate_span(start, step, first, count, mode, out, path);
+}
+
+//Every field is compared bit for bit, including the floats
+static bool same_span(const SpanResult& a, const SpanResult& b, int count, SpanTexMode mode)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (memcmp(&a.color[i], &b.color[i], sizeof(RGBAQ_REG)) || a.z[i] != b.z[i])
+            return false;
+        if (mode == SpanTexMode::NONE)
+            continue;
+        if (a.fog[i] != b.fog[i])
+            return false;
+        if (mode == SpanTexMode::STQ && (memcmp(&a.s[i], &b.s[i], 4) || memcmp(&a.t[i], &b.t[i], 4)))
+            return false;
+        if (mode == SpanTexMode::UV && (a.u[i] != b.u[i] || a.v[i] != b.v[i]))
+            return false;
+    }
+    return true;
+}
+
+//Z and UV are drawn from ranges around the edges of what the SIMD conversions take, [-2^31, 2^32),
+//so that both the vector conversions and the scalar fallback for lanes outside of it are exercised.
+static float wide_value(mt19937& rng)
+{
+    static const float edges[] = {0.f, 2147483648.f, -2147483648.f, 4294967296.f};
+    uniform_int_distribution<int> pick(0, 4);
+    int choice = pick(rng);
+    if (choice == 4)
+        return uniform_real_distribution<float>(0.f, 65536.f)(rng);
+    return edges[choice] + uniform_real_distribution<float>(-1048576.f, 1048576.f)(rng);
+}
+
+static void random_gradient(mt19937& rng, SpanGradient& start, SpanGradient& step)
+{
+    uniform_real_distribution<float> color(-64.f, 320.f);
+    uniform_real_distribution<float> color_step(-4.f, 4.f);
+    uniform_real_distribution<float> fog(0.f, 255.f);
+    uniform_real_distribution<float> q(0.5f, 4.f);
+    uniform_real_distribution<float> small_step(-0.01f, 0.01f);
+    uniform_real_distribution<float> st(-2.f, 2.f);
+    uniform_real_distribution<float> wide_step(-65536.f, 65536.f);
+
+    start.r = color(rng);
+    start.g = color(rng);
+    start.b = color(rng);
+    start.a = color(rng);
+    step.r = color_step(rng);
+    step.g = color_step(rng);
+    step.b = color_step(rng);
+    step.a = color_step(rng);
+
+    //Fog stays in range over the whole span, as uint8_t conversions outside of it aren't defined
+    start.fog = fog(rng);
+    step.fog = (fog(rng) - start.fog) / (SPAN_PIXELS * 2);
+
+    start.q = q(rng);
+    step.q = small_step(rng);
+    start.s = st(rng);
+    start.t = st(rng);
+    step.s = small_step(rng);
+    step.t = small_step(rng);
+
+    start.z = wide_value(rng) / 16.f;
+    step.z = wide_step(rng) / 16.f;
+    start.u = wide_value(rng);
+    start.v = wide_value(rng);
+    step.u = wide_step(rng);
+    step.v = wide_step(rng);
+}
+
+static void test_span_path(ofstream& test_output, SpanPath path, const char* name)
+{
+    static const SpanTexMode modes[] = {SpanTexMode::NONE, SpanTexMode::STQ, SpanTexMode::UV};
+    static const char* mode_names[] = {"NONE", "STQ", "UV"};
+
+    mt19937 rng(0x1337);
+    uniform_int_distribution<int> first_dist(0, 1024);
+    uniform_int_distribution<int> count_dist(1, SPAN_PIXELS);
+
+    SpanResult expected, result;
+    for (int m = 0; m < 3; m++)
+    {
+        int mismatches = 0;
+        for (int trial = 0; trial < SPAN_TRIALS; trial++)
+        {
+            SpanGradient start, step;
+            random_gradient(rng, start, step);
+            int first = first_dist(rng);
+            int count = count_dist(rng);
+
+            run_span(start, step, first, count, modes[m], SpanPath::SCALAR, expected);
+            run_span(start, step, first, count, modes[m], path, result);
+            if (!same_span(expected, result, count, modes[m]))
+            {
+                if (!mismatches)
+                {
+                    test_output << "  first mismatch: first " << dec << first << ", count " << count
+                                << ", z " << start.z << " + " << step.z
+                                << ", u " << start.u << " + " << step.u
+                                << ", v " << start.v << " + " << step.v << "\n";
+                }
+                mismatches++;
+            }
+        }
+        test_output << "  " << name << " " << mode_names[m] << ": " << dec << mismatches << " mismatches\n";
+    }
+}
+
+void Emulator::test_gs_span()
+{
+    ofstream test_output("test_log.txt");
+
+    test_output << "-- TEST BEGIN\n";
+    test_output << "interpolate_span:\n";
+    test_span_path(test_output, SpanPath::SSE2, "SSE2");
+    if (has_avx2())
+        test_span_path(test_output, SpanPath::AVX2, "AVX2");
+    else
+        test_output << "  AVX2 skipped, not supported by this CPU\n";
+    test_output << "-- TEST END\n";
+    test_output.flush();
+}
@@ -0,0 +1,233 @@
+#include "../../emulator.hpp"
+#include "../../gsswizzle.hpp"
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+#define SWIZZLE_TRIALS 2000
+#define SWIZZLE_MEM_SIZE (1024 * 1024 * 4)
+
+//Linear images are packed like transfer data: 4-bit pixels with an even x in the low nibble, 24-bit ones three bytes apart
+static uint32_t get_linear(const uint8_t* image, int pitch, int bpp, int x, int y)
+{
+    const uint8_t* row = image + y * pitch;
+    switch (bpp)
+    {
+        case 32:
+            return *(uint32_t*)&row[x * 4];
+        case 24:
+            return row[x * 3] | (row[x * 3 + 1] << 8) | (row[x * 3 + 2] << 16);
+        case 16:
+            return *(uint16_t*)&row[x * 2];
+        case 8:
+            return row[x];
+        default:
+            return (row[x >> 1] >> ((x & 1) << 2)) & 0xF;
+    }
+}
+
+static void set_linear(uint8_t* image, int pitch, int bpp, int x, int y, uint32_t value)
+{
+    uint8_t* row = image + y * pitch;
+    switch (bpp)
+    {
+        case 32:
+            *(uint32_t*)&row[x * 4] = value;
+            break;
+        case 24:
+            row[x * 3] = value;
+            row[x * 3 + 1] = value >> 8;
+            row[x * 3 + 2] = value >> 16;
+            break;
+        case 16:
+            *(uint16_t*)&row[x * 2] = value;
+            break;
+        case 8:
+            row[x] = value;
+            break;
+        default:
+            row[x >> 1] = (row[x >> 1] & (0xF0 >> ((x & 1) << 2))) | (value << ((x & 1) << 2));
+            break;
+    }
+}
+
+//Checks swizzle_block and unswizzle_block against the per-pixel addressing functions.
+//Both go to the same random local memory, kept in two copies with local_mem pointed at each in turn.
+void Emulator::test_gs_swizzle()
+{
+    ofstream test_output("test_log.txt");
+
+    static const uint8_t formats[] = {0x00, 0x01, 0x02, 0x0A, 0x13, 0x14, 0x30, 0x31, 0x32, 0x3A};
+    static const char* names[] = {"PSMCT32", "PSMCT24", "PSMCT16", "PSMCT16S", "PSMCT8", "PSMCT4",
+                                  "PSMZ32", "PSMZ24", "PSMZ16", "PSMZ16S"};
+
+    //The GS thread is stopped right away, leaving local memory to this thread alone
+    unique_ptr<GraphicsSynthesizerThread> gs(new GraphicsSynthesizerThread);
+    gs->exit();
+
+    auto write_pixel = [&](uint8_t format, uint32_t base, uint32_t width, uint32_t x, uint32_t y, uint32_t value)
+    {
+        switch (format)
+        {
+            case 0x00:
+                gs->write_PSMCT32_block(base, width, x, y, value);
+                break;
+            case 0x01:
+                gs->write_PSMCT24_block(base, width, x, y, value);
+                break;
+            case 0x02:
+                gs->write_PSMCT16_block(base, width, x, y, value);
+                break;
+            case 0x0A:
+                gs->write_PSMCT16S_block(base, width, x, y, value);
+                break;
+            case 0x13:
+                gs->write_PSMCT8_block(base, width, x, y, value);
+                break;
+            case 0x14:
+                gs->write_PSMCT4_block(base, width, x, y, value);
+                break;
+            case 0x30:
+                gs->write_PSMCT32Z_block(base, width, x, y, value);
+                break;
+            case 0x31:
+                gs->write_PSMCT24Z_block(base, width, x, y, value);
+                break;
+            case 0x32:
+                gs->write_PSMCT16Z_block(base, width, x, y, value);
+                break;
+            case 0x3A:
+                gs->write_PSMCT16SZ_block(base, width, x, y, value);
+                break;
+        }
+    };
+
+    auto read_pixel = [&](uint8_t format, uint32_t base, uint32_t width, uint32_t x, uint32_t y) -> uint32_t
+    {
+        switch (format)
+        {
+            case 0x00:
+                return gs->read_PSMCT32_block(base, width, x, y);
+            case 0x01:
+                return gs->read_PSMCT32_block(base, width, x, y) & 0xFFFFFF;
+            case 0x02:
+                return gs->read_PSMCT16_block(base, width, x, y);
+            case 0x0A:
+                return gs->read_PSMCT16S_block(base, width, x, y);
+            case 0x13:
+                return gs->read_PSMCT8_block(base, width, x, y);
+            case 0x14:
+                return gs->read_PSMCT4_block(base, width, x, y);
+            case 0x30:
+                return gs->read_PSMCT32Z_block(base, width, x, y);
+            case 0x31:
+                return gs->read_PSMCT32Z_block(base, width, x, y) & 0xFFFFFF;
+            case 0x32:
+                return gs->read_PSMCT16Z_block(base, width, x, y);
+            default:
+                return gs->read_PSMCT16SZ_block(base, width, x, y);
+        }
+    };
+
+    mt19937 rng(0x1337);
+    uniform_int_distribution<uint32_t> word;
+    auto pick = [&](int max) { return uniform_int_distribution<int>(0, max)(rng); };
+
+    uint8_t* mem = gs->local_mem;
+    for (int i = 0; i < SWIZZLE_MEM_SIZE; i += 4)
+        *(uint32_t*)&mem[i] = word(rng);
+    vector<uint8_t> reference(mem, mem + SWIZZLE_MEM_SIZE);
+
+    test_output << "-- TEST BEGIN\n";
+    test_output << "swizzle_block/unswizzle_block:\n";
+
+    for (int f = 0; f < 10; f++)
+    {
+        uint8_t format = formats[f];
+        int block_width, block_height, bpp;
+        if (!get_block_size(format, block_width, block_height, bpp))
+        {
+            test_output << "  " << names[f] << ": FAIL (no block kernels)\n";
+            continue;
+        }
+
+        int swizzle_mismatches = 0, unswizzle_mismatches = 0;
+        for (int trial = 0; trial < SWIZZLE_TRIALS; trial++)
+        {
+            //Buffer widths are a multiple of 128 so that the 8-bit and 4-bit formats can use them too
+            uint32_t base = pick(16383) * 256;
+            uint32_t width = (pick(7) + 1) * 128;
+            uint32_t x = pick(width / block_width - 1) * block_width;
+            uint32_t y = pick(255 / block_height) * block_height;
+
+            //Rows of the linear image are padded by a random amount, like a transfer wider than one block
+            int pitch = block_width * bpp / 8 + pick(3) * 8;
+            vector<uint8_t> image(pitch * block_height);
+            for (uint8_t& byte : image)
+                byte = word(rng);
+
+            gs->local_mem = reference.data();
+            for (int py = 0; py < block_height; py++)
+            {
+                for (int px = 0; px < block_width; px++)
+                    write_pixel(format, base, width, x + px, y + py, get_linear(image.data(), pitch, bpp, px, py));
+            }
+            uint8_t* block = gs->get_transfer_block(base, width, format, x, y);
+            size_t offset = block - reference.data();
+
+            gs->local_mem = mem;
+            swizzle_block(format, gs->get_transfer_block(base, width, format, x, y), image.data(), pitch);
+            if (memcmp(&mem[offset], &reference[offset], 256))
+            {
+                if (!swizzle_mismatches)
+                {
+                    test_output << "  first swizzle mismatch: " << names[f] << " at (" << dec << x << ", " << y
+                                << "), buffer width " << width << "\n";
+                }
+                swizzle_mismatches++;
+                memcpy(&mem[offset], &reference[offset], 256);
+            }
+
+            //Unswizzle the same block, or another one of the now changed memory
+            if (pick(1))
+            {
+                x = pick(width / block_width - 1) * block_width;
+                y = pick(255 / block_height) * block_height;
+            }
+            vector<uint8_t> expected(image.size()), result(image.size());
+            for (size_t i = 0; i < expected.size(); i++)
+                expected[i] = result[i] = word(rng);
+
+            gs->local_mem = reference.data();
+            for (int py = 0; py < block_height; py++)
+            {
+                for (int px = 0; px < block_width; px++)
+                    set_linear(expected.data(), pitch, bpp, px, py, read_pixel(format, base, width, x + px, y + py));
+            }
+
+            gs->local_mem = mem;
+            unswizzle_block(format, result.data(), pitch, gs->get_transfer_block(base, width, format, x, y));
+            if (expected != result)
+            {
+                if (!unswizzle_mismatches)
+                {
+                    test_output << "  first unswizzle mismatch: " << names[f] << " at (" << dec << x << ", " << y
+                                << "), buffer width " << width << "\n";
+                }
+                unswizzle_mismatches++;
+            }
+        }
+
+        test_output << "  " << names[f] << ": " << dec << swizzle_mismatches << " swizzle mismatches, "
+                    << unswizzle_mismatches << " unswizzle mismatches\n";
+    }
+
+    //Catches writes outside of the block being swizzled
+    bool same_memory = !memcmp(mem, reference.data(), SWIZZLE_MEM_SIZE);
+    test_output << "  local memory after all blocks: " << (same_memory ? "PASS" : "FAIL") << "\n";
+    test_output << "-- TEST END\n";
+    test_output.flush();
+}
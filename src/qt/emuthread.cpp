@@ -34,6 +34,27 @@ void EmuThread::set_skip_BIOS_hack(SKIP_HACK skip)
     load_mutex.unlock();
 }
 
+void EmuThread::set_ee_mode(CPU_MODE mode)
+{
+    load_mutex.lock();
+    e.set_ee_mode(mode);
+    load_mutex.unlock();
+}
+
+void EmuThread::set_iop_mode(CPU_MODE mode)
+{
+    load_mutex.lock();
+    e.set_iop_mode(mode);
+    load_mutex.unlock();
+}
+
+void EmuThread::set_vu0_mode(VU_MODE mode)
+{
+    load_mutex.lock();
+    e.set_vu0_mode(mode);
+    load_mutex.unlock();
+}
+
 void EmuThread::set_vu1_mode(VU_MODE mode)
 {
     load_mutex.lock();
@@ -41,6 +62,13 @@ void EmuThread::set_vu1_mode(VU_MODE mode)
     load_mutex.unlock();
 }
 
+void EmuThread::set_cache_directory(const QString& directory)
+{
+    load_mutex.lock();
+    e.set_cache_directory(directory.toStdString());
+    load_mutex.unlock();
+}
+
 void EmuThread::load_BIOS(const uint8_t *BIOS)
 {
     load_mutex.lock();
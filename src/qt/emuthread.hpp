@@ -45,7 +45,11 @@ class EmuThread : public QThread
         void reset();
 
         void set_skip_BIOS_hack(SKIP_HACK skip);
+        void set_ee_mode(CPU_MODE mode);
+        void set_iop_mode(CPU_MODE mode);
+        void set_vu0_mode(VU_MODE mode);
         void set_vu1_mode(VU_MODE mode);
+        void set_cache_directory(const QString& directory);
         void load_BIOS(const uint8_t* BIOS);
         void load_ELF(const uint8_t* ELF, uint64_t ELF_size);
         void load_CDVD(const char* name, CDVD_CONTAINER type);
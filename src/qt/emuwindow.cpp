@@ -175,8 +175,14 @@ int EmuWindow::load_exec(const char* file_name, bool skip_BIOS)
         return 1;
     }
 
+    set_ee_mode();
+    set_iop_mode();
+    set_vu0_mode();
     set_vu1_mode();
 
+    QDir().mkpath(Settings::instance().cache_directory);
+    emu_thread.set_cache_directory(Settings::instance().cache_directory);
+
     current_ROM = file_info;
     emu_thread.unpause(PAUSE_EVENT::GAME_NOT_LOADED);
     show_render_view();
@@ -535,8 +541,8 @@ void EmuWindow::update_FPS(int FPS)
     if (elapsed_update_seconds.count() >= 1.0)
     {
         // avoid multiple copies
-        QString status = QString("FPS: %1 - %2 [VU1: %3]").arg(
-            QString::number(FPS), current_ROM.fileName(), vu1_mode
+        QString status = QString("FPS: %1 - %2 [EE: %3] [IOP: %4] [VU0: %5] [VU1: %6]").arg(
+            QString::number(FPS), current_ROM.fileName(), ee_mode, iop_mode, vu0_mode, vu1_mode
         );
 
         setWindowTitle(status);
@@ -665,6 +671,54 @@ void EmuWindow::show_render_view()
     stack_widget->setCurrentIndex(1);
 }
 
+void EmuWindow::set_ee_mode()
+{
+    CPU_MODE mode;
+    if (Settings::instance().ee_jit_enabled)
+    {
+        mode = CPU_MODE::JIT;
+        ee_mode = "JIT";
+    }
+    else
+    {
+        mode = CPU_MODE::INTERPRETER;
+        ee_mode = "Interpreter";
+    }
+    emu_thread.set_ee_mode(mode);
+}
+
+void EmuWindow::set_iop_mode()
+{
+    CPU_MODE mode;
+    if (Settings::instance().iop_jit_enabled)
+    {
+        mode = CPU_MODE::JIT;
+        iop_mode = "JIT";
+    }
+    else
+    {
+        mode = CPU_MODE::INTERPRETER;
+        iop_mode = "Interpreter";
+    }
+    emu_thread.set_iop_mode(mode);
+}
+
+void EmuWindow::set_vu0_mode()
+{
+    VU_MODE mode;
+    if (Settings::instance().vu0_jit_enabled)
+    {
+        mode = VU_MODE::JIT;
+        vu0_mode = "JIT";
+    }
+    else
+    {
+        mode = VU_MODE::INTERPRETER;
+        vu0_mode = "Interpreter";
+    }
+    emu_thread.set_vu0_mode(mode);
+}
+
 void EmuWindow::set_vu1_mode()
 {
     VU_MODE mode;
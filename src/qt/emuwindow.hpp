@@ -18,6 +18,9 @@ class EmuWindow : public QMainWindow
     Q_OBJECT
     private:
         EmuThread emu_thread;
+        QString ee_mode;
+        QString iop_mode;
+        QString vu0_mode;
         QString vu1_mode;
         std::chrono::system_clock::time_point old_frametime;
         std::chrono::system_clock::time_point old_update_time;
@@ -38,6 +41,9 @@ class EmuWindow : public QMainWindow
 
         SettingsWindow* settings_window = nullptr;
 
+        void set_ee_mode();
+        void set_iop_mode();
+        void set_vu0_mode();
         void set_vu1_mode();
         void show_render_view();
         void show_default_view();
@@ -29,9 +29,14 @@ void Settings::reset()
     bios_path = qsettings().value("bios_path", "").toString();
     rom_directories = qsettings().value("rom_directories", {}).toStringList();
     recent_roms = qsettings().value("recent_roms", {}).toStringList();
+    ee_jit_enabled = qsettings().value("ee_jit_enabled", false).toBool();
+    iop_jit_enabled = qsettings().value("iop_jit_enabled", false).toBool();
+    vu0_jit_enabled = qsettings().value("vu0_jit_enabled", false).toBool();
     vu1_jit_enabled = qsettings().value("vu1_jit_enabled", true).toBool();
     last_used_directory = qsettings().value("last_used_dir", QDir::homePath()).toString();
     screenshot_directory = qsettings().value("screenshot_directory", QDir::homePath()).toString();
+    cache_directory = qsettings().value("cache_directory",
+        QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).toString();
 
     rom_directories_to_add = QStringList();
     rom_directories_to_remove = QStringList();
@@ -63,8 +68,12 @@ void Settings::save()
 
     qsettings().setValue("rom_directories", rom_directories);
     qsettings().setValue("bios_path", bios_path);
+    qsettings().setValue("ee_jit_enabled", ee_jit_enabled);
+    qsettings().setValue("iop_jit_enabled", iop_jit_enabled);
+    qsettings().setValue("vu0_jit_enabled", vu0_jit_enabled);
     qsettings().setValue("vu1_jit_enabled", vu1_jit_enabled);
     qsettings().setValue("screenshot_directory", screenshot_directory);
+    qsettings().setValue("cache_directory", cache_directory);
     qsettings().sync();
     reset();
 }
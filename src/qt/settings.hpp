@@ -5,6 +5,7 @@
 #include <QSettings>
 #include <QString>
 #include <QDir>
+#include <QStandardPaths>
 
 class Settings final : public QObject
 {
@@ -23,11 +24,15 @@ class Settings final : public QObject
         QString bios_path;
         QString last_used_directory;
         QString screenshot_directory;
+        QString cache_directory;
         QStringList rom_directories;
         QStringList rom_directories_to_add;
         QStringList rom_directories_to_remove;
         QStringList recent_roms;
 
+        bool ee_jit_enabled;
+        bool iop_jit_enabled;
+        bool vu0_jit_enabled;
         bool vu1_jit_enabled;
 
         void save();
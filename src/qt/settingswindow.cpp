@@ -18,10 +18,52 @@
 GeneralTab::GeneralTab(QWidget* parent)
     : QWidget(parent)
 {
+    QRadioButton* ee_jit_checkbox = new QRadioButton(tr("JIT (experimental)"));
+    QRadioButton* ee_interpreter_checkbox = new QRadioButton(tr("Interpreter"));
+    QRadioButton* iop_jit_checkbox = new QRadioButton(tr("JIT (experimental)"));
+    QRadioButton* iop_interpreter_checkbox = new QRadioButton(tr("Interpreter"));
+    QRadioButton* vu0_jit_checkbox = new QRadioButton(tr("JIT (experimental)"));
+    QRadioButton* vu0_interpreter_checkbox = new QRadioButton(tr("Interpreter"));
     QRadioButton* jit_checkbox = new QRadioButton(tr("JIT"));
     QRadioButton* interpreter_checkbox = new QRadioButton(tr("Interpreter"));
     QLabel* warning = new QLabel(tr("NOTE: Change will take effect the next time you load a game."));
 
+    bool ee_jit = Settings::instance().ee_jit_enabled;
+    ee_jit_checkbox->setChecked(ee_jit);
+    ee_interpreter_checkbox->setChecked(!ee_jit);
+
+    connect(ee_jit_checkbox, &QRadioButton::clicked, this, [=] (){
+        Settings::instance().ee_jit_enabled = true;
+    });
+
+    connect(ee_interpreter_checkbox, &QRadioButton::clicked, this, [=] (){
+        Settings::instance().ee_jit_enabled = false;
+    });
+
+    bool iop_jit = Settings::instance().iop_jit_enabled;
+    iop_jit_checkbox->setChecked(iop_jit);
+    iop_interpreter_checkbox->setChecked(!iop_jit);
+
+    connect(iop_jit_checkbox, &QRadioButton::clicked, this, [=] (){
+        Settings::instance().iop_jit_enabled = true;
+    });
+
+    connect(iop_interpreter_checkbox, &QRadioButton::clicked, this, [=] (){
+        Settings::instance().iop_jit_enabled = false;
+    });
+
+    bool vu0_jit = Settings::instance().vu0_jit_enabled;
+    vu0_jit_checkbox->setChecked(vu0_jit);
+    vu0_interpreter_checkbox->setChecked(!vu0_jit);
+
+    connect(vu0_jit_checkbox, &QRadioButton::clicked, this, [=] (){
+        Settings::instance().vu0_jit_enabled = true;
+    });
+
+    connect(vu0_interpreter_checkbox, &QRadioButton::clicked, this, [=] (){
+        Settings::instance().vu0_jit_enabled = false;
+    });
+
     bool vu1_jit = Settings::instance().vu1_jit_enabled;
     jit_checkbox->setChecked(vu1_jit);
     interpreter_checkbox->setChecked(!vu1_jit);
@@ -35,21 +77,57 @@ GeneralTab::GeneralTab(QWidget* parent)
     });
 
     connect(&Settings::instance(), &Settings::reload, this, [=]() {
+        bool vu0_jit_enabled = Settings::instance().vu0_jit_enabled;
+        vu0_jit_checkbox->setChecked(vu0_jit_enabled);
+        vu0_interpreter_checkbox->setChecked(!vu0_jit_enabled);
+
         bool vu1_jit_enabled = Settings::instance().vu1_jit_enabled;
         jit_checkbox->setChecked(vu1_jit_enabled);
         interpreter_checkbox->setChecked(!vu1_jit_enabled);
+
+        bool ee_jit_enabled = Settings::instance().ee_jit_enabled;
+        ee_jit_checkbox->setChecked(ee_jit_enabled);
+        ee_interpreter_checkbox->setChecked(!ee_jit_enabled);
+
+        bool iop_jit_enabled = Settings::instance().iop_jit_enabled;
+        iop_jit_checkbox->setChecked(iop_jit_enabled);
+        iop_interpreter_checkbox->setChecked(!iop_jit_enabled);
     });
 
+    QVBoxLayout* ee_layout = new QVBoxLayout;
+    ee_layout->addWidget(ee_jit_checkbox);
+    ee_layout->addWidget(ee_interpreter_checkbox);
+
+    QGroupBox* ee_groupbox = new QGroupBox(tr("EE"));
+    ee_groupbox->setLayout(ee_layout);
+
+    QVBoxLayout* iop_layout = new QVBoxLayout;
+    iop_layout->addWidget(iop_jit_checkbox);
+    iop_layout->addWidget(iop_interpreter_checkbox);
+
+    QGroupBox* iop_groupbox = new QGroupBox(tr("IOP"));
+    iop_groupbox->setLayout(iop_layout);
+
+    QVBoxLayout* vu0_layout = new QVBoxLayout;
+    vu0_layout->addWidget(vu0_jit_checkbox);
+    vu0_layout->addWidget(vu0_interpreter_checkbox);
+
+    QGroupBox* vu0_groupbox = new QGroupBox(tr("VU0"));
+    vu0_groupbox->setLayout(vu0_layout);
+
     QVBoxLayout* vu1_layout = new QVBoxLayout;
     vu1_layout->addWidget(jit_checkbox);
     vu1_layout->addWidget(interpreter_checkbox);
-    vu1_layout->addWidget(warning);
 
     QGroupBox* vu1_groupbox = new QGroupBox(tr("VU1"));
     vu1_groupbox->setLayout(vu1_layout);
 
     QVBoxLayout* layout = new QVBoxLayout;
+    layout->addWidget(ee_groupbox);
+    layout->addWidget(iop_groupbox);
+    layout->addWidget(vu0_groupbox);
     layout->addWidget(vu1_groupbox);
+    layout->addWidget(warning);
     layout->addStretch(1);
 
     setLayout(layout);